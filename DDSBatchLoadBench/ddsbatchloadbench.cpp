@@ -0,0 +1,545 @@
+//--------------------------------------------------------------------------------------
+// File: ddsbatchloadbench.cpp
+//
+// Command-line benchmark for DDSBatchLoader. It writes a set of small DDS files (BC1,
+// RGBA8 and RGBA8 cube maps with full mip chains, a few of them truncated, corrupt or
+// missing), checks that DDSBatchLoader delivers each one once with the same data and
+// errors as LoadDDSTextureDataFromMemory, and then times loading them all:
+//
+//   per-file   CreateFile, read the whole file and parse it, one file at a time, which
+//              is what CreateDDSTextureFromFile does before it needs the device
+//   batch      DDSBatchLoader::Load with overlapped reads into its staging arena
+//
+// Allocations made through operator new are counted for both. Right after the files
+// are written they are in the file cache, where there is no latency for overlapped I/O
+// to hide. To time reads from the device, write the files with -g, clear the file cache
+// (for example by restarting) and run again with -l.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248926
+//--------------------------------------------------------------------------------------
+
+#pragma warning(push)
+#pragma warning(disable : 4005)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#define NODRAWTEXT
+#define NOGDI
+#define NOBITMAP
+#define NOMCX
+#define NOSERVICE
+#define NOHELP
+#pragma warning(pop)
+
+#include <Windows.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cwchar>
+#include <memory>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "DDSBatchLoader.h"
+
+using namespace DirectX;
+
+namespace
+{
+    struct handle_closer { void operator()(HANDLE h) { if (h) CloseHandle(h); } };
+
+    using ScopedHandle = std::unique_ptr<void, handle_closer>;
+
+    inline HANDLE safe_handle(HANDLE h) { return (h == INVALID_HANDLE_VALUE) ? nullptr : h; }
+
+    constexpr uint32_t DEFAULT_FILE_COUNT = 10000;
+    constexpr uint32_t DEFAULT_REPEAT_COUNT = 3;
+
+    std::atomic<uint64_t> g_allocations(0);
+
+    //----------------------------------------------------------------------------------
+    // Timer
+    //----------------------------------------------------------------------------------
+    double GetMilliseconds()
+    {
+        static LARGE_INTEGER frequency = {};
+        if (!frequency.QuadPart)
+            QueryPerformanceFrequency(&frequency);
+
+        LARGE_INTEGER counter;
+        QueryPerformanceCounter(&counter);
+        return double(counter.QuadPart) * 1000.0 / double(frequency.QuadPart);
+    }
+
+    //----------------------------------------------------------------------------------
+    // Test files
+    //----------------------------------------------------------------------------------
+    constexpr uint32_t MakeFourCC(char a, char b, char c, char d)
+    {
+        return uint32_t(uint8_t(a)) | (uint32_t(uint8_t(b)) << 8) | (uint32_t(uint8_t(c)) << 16) | (uint32_t(uint8_t(d)) << 24);
+    }
+
+    void WriteU32(std::vector<uint8_t>& data, size_t offset, uint32_t value)
+    {
+        memcpy(data.data() + offset, &value, sizeof(value));
+    }
+
+    // A BC1 2D texture, an RGBA8 2D texture or an RGBA8 cube map with a DX10 header, of 16 to
+    // 128 pixels with a full mip chain of random texels
+    void MakeDDSFile(std::mt19937& rng, std::vector<uint8_t>& data)
+    {
+        const uint32_t kind = rng() % 3;
+        const uint32_t size = ((kind == 0) ? 64u : (kind == 1) ? 32u : 16u) << (rng() % 2);
+
+        uint32_t mipLevels = 1;
+        for (uint32_t s = size; s > 1; s >>= 1)
+            ++mipLevels;
+
+        // Magic, DDS_HEADER and room for DDS_HEADER_DXT10
+        data.assign(4 + 124 + 20, 0);
+        WriteU32(data, 0, MakeFourCC('D', 'D', 'S', ' '));
+        WriteU32(data, 4, 124);                         // size
+        WriteU32(data, 8, 0x1007 | 0x20000);            // CAPS | HEIGHT | WIDTH | PIXELFORMAT | MIPMAPCOUNT
+        WriteU32(data, 12, size);                       // height
+        WriteU32(data, 16, size);                       // width
+        WriteU32(data, 28, mipLevels);
+        WriteU32(data, 76, 32);                         // ddspf.size
+
+        size_t headerSize = 4 + 124;
+        uint32_t faces = 1;
+        switch (kind)
+        {
+        case 0:
+            WriteU32(data, 80, 0x4);                    // DDPF_FOURCC
+            WriteU32(data, 84, MakeFourCC('D', 'X', 'T', '1'));
+            break;
+
+        case 1:
+            WriteU32(data, 80, 0x41);                   // DDPF_RGB | DDPF_ALPHAPIXELS
+            WriteU32(data, 88, 32);
+            WriteU32(data, 92, 0x00ff0000);
+            WriteU32(data, 96, 0x0000ff00);
+            WriteU32(data, 100, 0x000000ff);
+            WriteU32(data, 104, 0xff000000);
+            break;
+
+        default:
+            WriteU32(data, 80, 0x4);
+            WriteU32(data, 84, MakeFourCC('D', 'X', '1', '0'));
+            WriteU32(data, 128, DXGI_FORMAT_R8G8B8A8_UNORM);
+            WriteU32(data, 132, 3);                     // D3D11_RESOURCE_DIMENSION_TEXTURE2D
+            WriteU32(data, 136, 0x4);                   // D3D11_RESOURCE_MISC_TEXTURECUBE
+            WriteU32(data, 140, 1);                     // arraySize
+            headerSize += 20;
+            faces = 6;
+            break;
+        }
+
+        data.resize(headerSize);
+
+        for (uint32_t face = 0; face < faces; ++face)
+        {
+            uint32_t w = size;
+            for (uint32_t level = 0; level < mipLevels; ++level)
+            {
+                const size_t bytes = (kind == 0)
+                    ? size_t(std::max(1u, (w + 3) / 4)) * std::max(1u, (w + 3) / 4) * 8
+                    : size_t(w) * w * 4;
+                for (size_t j = 0; j < bytes; ++j)
+                    data.push_back(uint8_t(rng()));
+                w = std::max(1u, w / 2);
+            }
+        }
+    }
+
+    HRESULT WriteFileData(const wchar_t* fileName, const std::vector<uint8_t>& data)
+    {
+        ScopedHandle hFile(safe_handle(CreateFileW(fileName, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr)));
+        if (!hFile)
+            return HRESULT_FROM_WIN32(GetLastError());
+
+        DWORD bytesWritten = 0;
+        if (!WriteFile(hFile.get(), data.data(), static_cast<DWORD>(data.size()), &bytesWritten, nullptr))
+            return HRESULT_FROM_WIN32(GetLastError());
+
+        return (bytesWritten == data.size()) ? S_OK : E_FAIL;
+    }
+
+    HRESULT ReadFileData(const wchar_t* fileName, std::unique_ptr<uint8_t[]>& data, DWORD& size)
+    {
+        size = 0;
+
+        ScopedHandle hFile(safe_handle(CreateFileW(fileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr)));
+        if (!hFile)
+            return HRESULT_FROM_WIN32(GetLastError());
+
+        FILE_STANDARD_INFO fileInfo;
+        if (!GetFileInformationByHandleEx(hFile.get(), FileStandardInfo, &fileInfo, sizeof(fileInfo)))
+            return HRESULT_FROM_WIN32(GetLastError());
+
+        if (fileInfo.EndOfFile.HighPart > 0)
+            return E_FAIL;
+
+        data.reset(new (std::nothrow) uint8_t[fileInfo.EndOfFile.LowPart]);
+        if (!data)
+            return E_OUTOFMEMORY;
+
+        if (!ReadFile(hFile.get(), data.get(), fileInfo.EndOfFile.LowPart, &size, nullptr))
+            return HRESULT_FROM_WIN32(GetLastError());
+
+        return (size == fileInfo.EndOfFile.LowPart) ? S_OK : E_FAIL;
+    }
+
+    // Writes count files to directory; every 997th is truncated, every 1499th has a bad
+    // header and every 1999th is not written at all
+    HRESULT WriteTestFiles(const std::vector<std::wstring>& fileNames, uint64_t& totalBytes)
+    {
+        std::mt19937 rng(41);
+        std::vector<uint8_t> data;
+
+        totalBytes = 0;
+        for (size_t i = 0; i < fileNames.size(); ++i)
+        {
+            MakeDDSFile(rng, data);
+
+            if ((i % 997) == 5)
+                data.resize(data.size() / 2);
+            if ((i % 1499) == 7)
+                data[4] = 0;
+
+            if ((i % 1999) == 9)
+            {
+                DeleteFileW(fileNames[i].c_str());
+                continue;
+            }
+
+            HRESULT hr = WriteFileData(fileNames[i].c_str(), data);
+            if (FAILED(hr))
+                return hr;
+
+            totalBytes += data.size();
+        }
+
+        return S_OK;
+    }
+
+    //----------------------------------------------------------------------------------
+    // Checks every file is delivered once, with the subresources or the error that
+    // LoadDDSTextureDataFromMemory gives for it
+    //----------------------------------------------------------------------------------
+    bool Validate(const std::vector<const wchar_t*>& fileNames, size_t arenaSize, unsigned int maxReads, unsigned int numThreads, size_t maxsize)
+    {
+        DDSBatchLoader loader;
+        HRESULT hr = loader.Initialize(arenaSize, maxReads, numThreads);
+        if (FAILED(hr))
+        {
+            wprintf(L"ERROR: DDSBatchLoader::Initialize failed (%08X)\n", static_cast<unsigned int>(hr));
+            return false;
+        }
+
+        std::unique_ptr<std::atomic<uint32_t>[]> delivered(new std::atomic<uint32_t>[fileNames.size()]);
+        for (size_t i = 0; i < fileNames.size(); ++i)
+            delivered[i] = 0;
+
+        std::atomic<uint32_t> loaded(0);
+        std::atomic<uint32_t> failed(0);
+        std::atomic<uint32_t> mismatched(0);
+
+        hr = loader.Load(fileNames.data(), fileNames.size(), maxsize,
+            [&](size_t index, HRESULT hrLoad, const DDS_TEXTURE_DESC& desc, const std::vector<DDS_SUBRESOURCE_DATA>& subresources)
+            {
+                ++delivered[index];
+
+                std::unique_ptr<uint8_t[]> data;
+                DWORD size = 0;
+                DDS_TEXTURE_DESC expectedDesc = {};
+                std::vector<DDS_SUBRESOURCE_DATA> expected;
+                HRESULT hrExpected = ReadFileData(fileNames[index], data, size);
+                if (SUCCEEDED(hrExpected))
+                    hrExpected = LoadDDSTextureDataFromMemory(data.get(), size, maxsize, &expectedDesc, expected);
+
+                if (FAILED(hrLoad))
+                {
+                    ++failed;
+                    if (SUCCEEDED(hrExpected) || !subresources.empty())
+                        ++mismatched;
+                    return;
+                }
+
+                if (FAILED(hrExpected)
+                    || expected.size() != subresources.size()
+                    || expectedDesc.width != desc.width
+                    || expectedDesc.height != desc.height
+                    || expectedDesc.mipLevels != desc.mipLevels
+                    || expectedDesc.format != desc.format)
+                {
+                    ++mismatched;
+                    return;
+                }
+
+                for (size_t j = 0; j < subresources.size(); ++j)
+                {
+                    if (subresources[j].offset != expected[j].offset
+                        || memcmp(subresources[j].data, expected[j].data, size_t(expected[j].slicePitch) * expected[j].depth) != 0)
+                    {
+                        ++mismatched;
+                        return;
+                    }
+                }
+
+                ++loaded;
+            });
+
+        uint32_t notOnce = 0;
+        for (size_t i = 0; i < fileNames.size(); ++i)
+        {
+            if (delivered[i] != 1)
+                ++notOnce;
+        }
+
+        const bool ok = SUCCEEDED(hr) && !mismatched && !notOnce;
+        wprintf(L"  %zu KB arena, %u reads, maxsize %zu: %u loaded, %u failed, %u mismatched, %u not delivered once, %llu stalls%ls\n",
+            arenaSize / 1024, maxReads, maxsize, loaded.load(), failed.load(), mismatched.load(), notOnce,
+            static_cast<unsigned long long>(loader.GetStallCount()), ok ? L"" : L" - FAILED");
+        return ok;
+    }
+
+    //----------------------------------------------------------------------------------
+    void PrintUsage()
+    {
+        wprintf(L"Usage: ddsbatchloadbench <options>\n");
+        wprintf(L"\n");
+        wprintf(L"   -d <directory>      directory for the test files (defaults to %%TEMP%%\\ddsbatchloadbench)\n");
+        wprintf(L"   -n <count>          number of files (defaults to %u)\n", DEFAULT_FILE_COUNT);
+        wprintf(L"   -r <count>          number of timed runs (defaults to %u)\n", DEFAULT_REPEAT_COUNT);
+        wprintf(L"   -g                  write the files and exit\n");
+        wprintf(L"   -l                  time the files already written, without validation\n");
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// Count the allocations made by both paths
+//--------------------------------------------------------------------------------------
+void* operator new(size_t size)
+{
+    ++g_allocations;
+    void* p = malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    ++g_allocations;
+    return malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    ++g_allocations;
+    return malloc(size ? size : 1);
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+
+//--------------------------------------------------------------------------------------
+// Entry-point
+//--------------------------------------------------------------------------------------
+#pragma prefast(disable : 28198, "Command-line tool, frees all memory on exit")
+
+int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
+{
+    wchar_t szDirectory[MAX_PATH] = {};
+    uint32_t fileCount = DEFAULT_FILE_COUNT;
+    uint32_t repeatCount = DEFAULT_REPEAT_COUNT;
+    bool writeOnly = false;
+    bool loadOnly = false;
+
+    for (int iArg = 1; iArg < argc; iArg++)
+    {
+        const wchar_t* pArg = argv[iArg];
+        if (('-' != pArg[0]) && ('/' != pArg[0]))
+        {
+            PrintUsage();
+            return 1;
+        }
+
+        pArg++;
+        if (!_wcsicmp(pArg, L"g"))
+        {
+            writeOnly = true;
+        }
+        else if (!_wcsicmp(pArg, L"l"))
+        {
+            loadOnly = true;
+        }
+        else if ((!_wcsicmp(pArg, L"d") || !_wcsicmp(pArg, L"n") || !_wcsicmp(pArg, L"r")) && (iArg + 1 < argc))
+        {
+            const wchar_t* pValue = argv[++iArg];
+            if (!_wcsicmp(pArg, L"d"))
+            {
+                wcscpy_s(szDirectory, MAX_PATH, pValue);
+            }
+            else if (swscanf_s(pValue, L"%u", !_wcsicmp(pArg, L"n") ? &fileCount : &repeatCount) != 1
+                || !fileCount || !repeatCount)
+            {
+                wprintf(L"Invalid value specified with -%ls (%ls)\n", pArg, pValue);
+                return 1;
+            }
+        }
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (writeOnly && loadOnly)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    if (!*szDirectory)
+    {
+        wchar_t szTemp[MAX_PATH] = {};
+        if (!GetTempPathW(MAX_PATH, szTemp))
+        {
+            wprintf(L"ERROR: Failed to get the temporary directory\n");
+            return 1;
+        }
+        swprintf_s(szDirectory, L"%lsddsbatchloadbench", szTemp);
+    }
+
+    if (!CreateDirectoryW(szDirectory, nullptr) && GetLastError() != ERROR_ALREADY_EXISTS)
+    {
+        wprintf(L"ERROR: Failed to create %ls (%08X)\n", szDirectory, static_cast<unsigned int>(HRESULT_FROM_WIN32(GetLastError())));
+        return 1;
+    }
+
+    std::vector<std::wstring> fileNames;
+    fileNames.reserve(fileCount);
+    for (uint32_t i = 0; i < fileCount; ++i)
+    {
+        wchar_t szFile[MAX_PATH] = {};
+        swprintf_s(szFile, L"%ls\\t%05u.dds", szDirectory, i);
+        fileNames.emplace_back(szFile);
+    }
+
+    std::vector<const wchar_t*> fileNamePtrs;
+    fileNamePtrs.reserve(fileCount);
+    for (const auto& fileName : fileNames)
+        fileNamePtrs.push_back(fileName.c_str());
+
+    if (!loadOnly)
+    {
+        uint64_t totalBytes = 0;
+        HRESULT hr = WriteTestFiles(fileNames, totalBytes);
+        if (FAILED(hr))
+        {
+            wprintf(L"ERROR: Failed to write the test files to %ls (%08X)\n", szDirectory, static_cast<unsigned int>(hr));
+            return 1;
+        }
+
+        wprintf(L"%u files in %ls, %.1f MB\n", fileCount, szDirectory, double(totalBytes) / (1024.0 * 1024.0));
+
+        if (writeOnly)
+            return 0;
+
+        // Small arenas and few reads make the loader wrap around the arena and stall
+        wprintf(L"validating\n");
+        bool ok = Validate(fileNamePtrs, 256 * 1024, 16, 3, 0);
+        ok &= Validate(fileNamePtrs, 100 * 1024, 3, 1, 0);
+        ok &= Validate(fileNamePtrs, 64 * 1024 * 1024, 64, 0, 16);
+        if (!ok)
+            return 1;
+    }
+
+    DDSBatchLoader loader;
+    HRESULT hr = loader.Initialize();
+    if (FAILED(hr))
+    {
+        wprintf(L"ERROR: DDSBatchLoader::Initialize failed (%08X)\n", static_cast<unsigned int>(hr));
+        return 1;
+    }
+
+    std::atomic<size_t> batchSubresources(0);
+    const DDSBatchLoader::Callback callback =
+        [&](size_t, HRESULT hrLoad, const DDS_TEXTURE_DESC&, const std::vector<DDS_SUBRESOURCE_DATA>& subresources)
+        {
+            if (SUCCEEDED(hrLoad))
+                batchSubresources += subresources.size();
+        };
+
+    // Let the workers size their vectors before the allocations are counted
+    hr = loader.Load(fileNamePtrs.data(), std::min<size_t>(fileCount, 200), 0, callback);
+    if (FAILED(hr))
+    {
+        wprintf(L"ERROR: DDSBatchLoader::Load failed (%08X)\n", static_cast<unsigned int>(hr));
+        return 1;
+    }
+
+    wprintf(L"timing\n");
+    for (uint32_t run = 0; run < repeatCount; ++run)
+    {
+        uint64_t allocations = g_allocations;
+        double start = GetMilliseconds();
+
+        size_t fileSubresources = 0;
+        for (const wchar_t* fileName : fileNamePtrs)
+        {
+            std::unique_ptr<uint8_t[]> data;
+            DWORD size = 0;
+            if (FAILED(ReadFileData(fileName, data, size)))
+                continue;
+
+            DDS_TEXTURE_DESC desc = {};
+            std::vector<DDS_SUBRESOURCE_DATA> subresources;
+            if (SUCCEEDED(LoadDDSTextureDataFromMemory(data.get(), size, 0, &desc, subresources)))
+                fileSubresources += subresources.size();
+        }
+
+        const double fileTime = GetMilliseconds() - start;
+        const uint64_t fileAllocations = g_allocations - allocations;
+
+        batchSubresources = 0;
+        allocations = g_allocations;
+        start = GetMilliseconds();
+
+        hr = loader.Load(fileNamePtrs.data(), fileNamePtrs.size(), 0, callback);
+
+        const double batchTime = GetMilliseconds() - start;
+        const uint64_t batchAllocations = g_allocations - allocations;
+
+        if (FAILED(hr) || fileSubresources != batchSubresources)
+        {
+            wprintf(L"ERROR: DDSBatchLoader::Load (%08X) delivered %zu subresources, expected %zu\n",
+                static_cast<unsigned int>(hr), batchSubresources.load(), fileSubresources);
+            return 1;
+        }
+
+        wprintf(L"  per-file %.1f ms, %llu allocations | batch %.1f ms, %llu allocations | %zu subresources\n",
+            fileTime, static_cast<unsigned long long>(fileAllocations),
+            batchTime, static_cast<unsigned long long>(batchAllocations), fileSubresources);
+    }
+
+    return 0;
+}
@@ -0,0 +1,467 @@
+//--------------------------------------------------------------------------------------
+// File: DDSBatchLoader.cpp
+//
+// Loads many DDS files at once with overlapped I/O, without a Direct3D device
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248926
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+
+#include "DDSBatchLoader.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <new>
+#include <thread>
+
+using namespace DirectX;
+
+namespace
+{
+    struct handle_closer { void operator()(HANDLE h) noexcept { if (h) CloseHandle(h); } };
+
+    using ScopedHandle = std::unique_ptr<void, handle_closer>;
+
+    inline HANDLE safe_handle(HANDLE h) noexcept { return (h == INVALID_HANDLE_VALUE) ? nullptr : h; }
+
+    // Completion keys
+    constexpr ULONG_PTR c_KeyRead = 1;
+    constexpr ULONG_PTR c_KeyShutdown = 2;
+
+    // Allocations in the arena are rounded up to this, which keeps the data of every file aligned
+    constexpr size_t c_ArenaAlignment = 64;
+
+    inline size_t AlignUp(size_t size) noexcept
+    {
+        return (size + c_ArenaAlignment - 1) & ~(c_ArenaAlignment - 1);
+    }
+
+    // One read in flight. The OVERLAPPED comes first so a completion packet leads back to it.
+    struct Request
+    {
+        OVERLAPPED  ov;
+        HANDLE      file;
+        size_t      index;
+        size_t      offset;         // of the file data in the arena
+        size_t      size;           // of the file
+        size_t      reserved;       // of the arena, the size rounded up
+        bool        done;
+    };
+}
+
+
+//--------------------------------------------------------------------------------------
+class DDSBatchLoader::Impl
+{
+public:
+    Impl() noexcept :
+        m_arenaSize(0),
+        m_head(0),
+        m_tail(0),
+        m_wrapped(false),
+        m_maxReads(0),
+        m_first(0),
+        m_count(0),
+        m_stalls(0),
+        m_maxsize(0),
+        m_callback(nullptr)
+    {
+    }
+
+    void Worker();
+
+    bool Reserve(size_t size, size_t& offset) const noexcept;
+    void Complete(Request& request, HRESULT hr, DWORD bytesRead, std::vector<DDS_SUBRESOURCE_DATA>& subresources);
+
+    ScopedHandle                    m_port;
+    std::vector<std::thread>        m_threads;
+
+    std::unique_ptr<uint8_t[]>      m_arena;
+    size_t                          m_arenaSize;
+    size_t                          m_head;         // start of the oldest read
+    size_t                          m_tail;         // end of the newest read
+    bool                            m_wrapped;      // the newest read is before the oldest
+
+    std::unique_ptr<Request[]>      m_requests;     // a FIFO of the reads in flight, oldest at m_first
+    unsigned int                    m_maxReads;
+    unsigned int                    m_first;
+    unsigned int                    m_count;
+
+    std::mutex                      m_mutex;
+    std::condition_variable         m_retired;
+    uint64_t                        m_stalls;
+
+    size_t                          m_maxsize;
+    const Callback*                 m_callback;
+};
+
+
+//--------------------------------------------------------------------------------------
+void DDSBatchLoader::Impl::Worker()
+{
+    // Reused for every file this thread parses
+    std::vector<DDS_SUBRESOURCE_DATA> subresources;
+
+    for (;;)
+    {
+        DWORD bytesRead = 0;
+        ULONG_PTR key = 0;
+        OVERLAPPED* ov = nullptr;
+        const BOOL result = GetQueuedCompletionStatus(m_port.get(), &bytesRead, &key, &ov, INFINITE);
+
+        if (key == c_KeyShutdown)
+            return;
+
+        if (!ov)
+            continue;
+
+        Complete(*reinterpret_cast<Request*>(ov),
+            result ? S_OK : HRESULT_FROM_WIN32(GetLastError()),
+            bytesRead,
+            subresources);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Finds room for size bytes after the newest read. Called with m_mutex held.
+//--------------------------------------------------------------------------------------
+bool DDSBatchLoader::Impl::Reserve(size_t size, size_t& offset) const noexcept
+{
+    if (!m_count)
+    {
+        offset = 0;
+        return size <= m_arenaSize;
+    }
+
+    if (m_wrapped)
+    {
+        offset = m_tail;
+        return size <= m_head - m_tail;
+    }
+
+    if (size <= m_arenaSize - m_tail)
+    {
+        offset = m_tail;
+        return true;
+    }
+
+    // Wrap around, leaving the end of the arena unused until the reads before it retire
+    offset = 0;
+    return size <= m_head;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Parses a finished read, hands it to the callback and retires it. Reads retire in the
+// order they were issued so the arena is freed from its oldest end.
+//--------------------------------------------------------------------------------------
+void DDSBatchLoader::Impl::Complete(
+    Request& request,
+    HRESULT hr,
+    DWORD bytesRead,
+    std::vector<DDS_SUBRESOURCE_DATA>& subresources)
+{
+    CloseHandle(request.file);
+    request.file = nullptr;
+
+    DDS_TEXTURE_DESC desc = {};
+    subresources.clear();
+
+    if (SUCCEEDED(hr))
+    {
+        if (bytesRead < request.size)
+        {
+            hr = HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+        }
+        else
+        {
+            hr = LoadDDSTextureDataFromMemory(m_arena.get() + request.offset, request.size,
+                m_maxsize, &desc, subresources);
+        }
+    }
+
+    if (FAILED(hr))
+    {
+        desc = {};
+        subresources.clear();
+    }
+
+    (*m_callback)(request.index, hr, desc, subresources);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        request.done = true;
+
+        while (m_count && m_requests[m_first].done)
+        {
+            m_first = (m_first + 1) % m_maxReads;
+            --m_count;
+
+            if (!m_count)
+            {
+                m_head = m_tail = 0;
+                m_wrapped = false;
+            }
+            else
+            {
+                const size_t next = m_requests[m_first].offset;
+                if (next < m_head)
+                {
+                    m_wrapped = false;
+                }
+                m_head = next;
+            }
+        }
+    }
+    m_retired.notify_all();
+}
+
+
+//--------------------------------------------------------------------------------------
+DDSBatchLoader::DDSBatchLoader() noexcept
+{
+}
+
+DDSBatchLoader::DDSBatchLoader(DDSBatchLoader&&) noexcept = default;
+DDSBatchLoader& DDSBatchLoader::operator= (DDSBatchLoader&&) noexcept = default;
+
+DDSBatchLoader::~DDSBatchLoader()
+{
+    Shutdown();
+}
+
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DDSBatchLoader::Initialize(size_t arenaSize, unsigned int maxReads, unsigned int numThreads) noexcept
+{
+    if (pImpl)
+        return E_UNEXPECTED;
+
+    if (!arenaSize || !maxReads)
+        return E_INVALIDARG;
+
+    if (!numThreads)
+    {
+        numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    std::unique_ptr<Impl> impl(new (std::nothrow) Impl);
+    if (!impl)
+        return E_OUTOFMEMORY;
+
+    impl->m_arenaSize = AlignUp(arenaSize);
+    impl->m_arena.reset(new (std::nothrow) uint8_t[impl->m_arenaSize]);
+    impl->m_requests.reset(new (std::nothrow) Request[maxReads]);
+    if (!impl->m_arena || !impl->m_requests)
+        return E_OUTOFMEMORY;
+
+    impl->m_maxReads = maxReads;
+
+    impl->m_port.reset(CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, numThreads));
+    if (!impl->m_port)
+        return HRESULT_FROM_WIN32(GetLastError());
+
+    pImpl = std::move(impl);
+
+    try
+    {
+        pImpl->m_threads.reserve(numThreads);
+        for (unsigned int i = 0; i < numThreads; ++i)
+        {
+            pImpl->m_threads.emplace_back(&Impl::Worker, pImpl.get());
+        }
+    }
+    catch (...)
+    {
+        Shutdown();
+        return E_FAIL;
+    }
+
+    return S_OK;
+}
+
+
+//--------------------------------------------------------------------------------------
+void DDSBatchLoader::Shutdown() noexcept
+{
+    if (!pImpl)
+        return;
+
+    for (size_t i = 0; i < pImpl->m_threads.size(); ++i)
+    {
+        PostQueuedCompletionStatus(pImpl->m_port.get(), 0, c_KeyShutdown, nullptr);
+    }
+
+    for (auto& it : pImpl->m_threads)
+    {
+        it.join();
+    }
+
+    pImpl.reset();
+}
+
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DDSBatchLoader::Load(
+    const wchar_t* const* fileNames,
+    size_t count,
+    size_t maxsize,
+    const Callback& callback) noexcept
+{
+    if (!pImpl)
+        return E_UNEXPECTED;
+
+    if ((!fileNames && count) || !callback)
+        return E_INVALIDARG;
+
+    auto impl = pImpl.get();
+    impl->m_maxsize = maxsize;
+    impl->m_callback = &callback;
+
+    // For files that fail before they are read; only this thread uses it
+    std::vector<DDS_SUBRESOURCE_DATA> subresources;
+    const DDS_TEXTURE_DESC emptyDesc = {};
+
+    for (size_t index = 0; index < count; ++index)
+    {
+    #if (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
+        CREATEFILE2_EXTENDED_PARAMETERS params = {};
+        params.dwSize = sizeof(CREATEFILE2_EXTENDED_PARAMETERS);
+        params.dwFileAttributes = FILE_ATTRIBUTE_NORMAL;
+        params.dwFileFlags = FILE_FLAG_OVERLAPPED | FILE_FLAG_SEQUENTIAL_SCAN;
+        ScopedHandle hFile(safe_handle(CreateFile2(
+            fileNames[index],
+            GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING,
+            &params)));
+    #else
+        ScopedHandle hFile(safe_handle(CreateFileW(
+            fileNames[index],
+            GENERIC_READ, FILE_SHARE_READ,
+            nullptr,
+            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED | FILE_FLAG_SEQUENTIAL_SCAN,
+            nullptr)));
+    #endif
+
+        HRESULT hr = S_OK;
+        FILE_STANDARD_INFO fileInfo = {};
+
+        if (!hFile)
+        {
+            hr = HRESULT_FROM_WIN32(GetLastError());
+        }
+        else if (!GetFileInformationByHandleEx(hFile.get(), FileStandardInfo, &fileInfo, sizeof(fileInfo)))
+        {
+            hr = HRESULT_FROM_WIN32(GetLastError());
+        }
+        else if (fileInfo.EndOfFile.HighPart > 0)
+        {
+            // Same limit as LoadDDSTextureDataFromMemory
+            hr = E_FAIL;
+        }
+        else if (AlignUp(fileInfo.EndOfFile.LowPart) > impl->m_arenaSize)
+        {
+            hr = E_OUTOFMEMORY;
+        }
+        else if (!CreateIoCompletionPort(hFile.get(), impl->m_port.get(), c_KeyRead, 0))
+        {
+            hr = HRESULT_FROM_WIN32(GetLastError());
+        }
+
+        if (FAILED(hr))
+        {
+            callback(index, hr, emptyDesc, subresources);
+            continue;
+        }
+
+        const size_t size = fileInfo.EndOfFile.LowPart;
+        const size_t reserved = AlignUp(size);
+
+        // Wait for a free read and room in the arena
+        Request* request = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(impl->m_mutex);
+
+            size_t offset = 0;
+            if (impl->m_count >= impl->m_maxReads || !impl->Reserve(reserved, offset))
+            {
+                ++impl->m_stalls;
+                impl->m_retired.wait(lock, [&]
+                    {
+                        return impl->m_count < impl->m_maxReads && impl->Reserve(reserved, offset);
+                    });
+            }
+
+            if (impl->m_count && !impl->m_wrapped && offset < impl->m_tail)
+            {
+                impl->m_wrapped = true;
+            }
+
+            if (!impl->m_count)
+            {
+                impl->m_head = offset;
+            }
+            impl->m_tail = offset + reserved;
+
+            request = &impl->m_requests[(impl->m_first + impl->m_count) % impl->m_maxReads];
+            ++impl->m_count;
+
+            *request = {};
+            request->file = hFile.release();
+            request->index = index;
+            request->offset = offset;
+            request->size = size;
+            request->reserved = reserved;
+        }
+
+        // The completion is queued to the port even when the read finishes at once
+        if (!ReadFile(request->file,
+            impl->m_arena.get() + request->offset,
+            static_cast<DWORD>(size),
+            nullptr,
+            &request->ov))
+        {
+            const DWORD error = GetLastError();
+            if (error != ERROR_IO_PENDING)
+            {
+                impl->Complete(*request, HRESULT_FROM_WIN32(error), 0, subresources);
+            }
+        }
+    }
+
+    // Wait for the reads still in flight
+    {
+        std::unique_lock<std::mutex> lock(impl->m_mutex);
+        impl->m_retired.wait(lock, [&] { return impl->m_count == 0; });
+    }
+
+    impl->m_callback = nullptr;
+
+    return S_OK;
+}
+
+
+//--------------------------------------------------------------------------------------
+uint64_t DDSBatchLoader::GetStallCount() const noexcept
+{
+    if (!pImpl)
+        return 0;
+
+    std::lock_guard<std::mutex> lock(pImpl->m_mutex);
+    return pImpl->m_stalls;
+}
@@ -0,0 +1,82 @@
+//--------------------------------------------------------------------------------------
+// File: DDSBatchLoader.h
+//
+// Loads many DDS files at once with overlapped I/O, without a Direct3D device.
+// CreateDDSTexturesFromFiles in DDSTextureLoader.h creates textures with it.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248926
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "DDSParser.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+
+namespace DirectX
+{
+    //----------------------------------------------------------------------------------
+    // Reads a list of DDS files into one staging arena, which is allocated as a ring so
+    // nothing is allocated per file. Up to maxReads files are read at once with overlapped
+    // I/O. Worker threads take the completed reads, parse them and pass the subresources
+    // to the callback. The callback runs on the worker threads, several at once (files that
+    // fail to open are reported on the calling thread). It must not throw, and the data it
+    // is given is reused as soon as it returns.
+    //----------------------------------------------------------------------------------
+    class DDSBatchLoader
+    {
+    public:
+        // Called once per file. desc and subresources are empty when hr is a failure.
+        using Callback = std::function<void(
+            size_t index,
+            HRESULT hr,
+            const DDS_TEXTURE_DESC& desc,
+            const std::vector<DDS_SUBRESOURCE_DATA>& subresources)>;
+
+        DDSBatchLoader() noexcept;
+
+        DDSBatchLoader(DDSBatchLoader&&) noexcept;
+        DDSBatchLoader& operator= (DDSBatchLoader&&) noexcept;
+
+        DDSBatchLoader(DDSBatchLoader const&) = delete;
+        DDSBatchLoader& operator= (DDSBatchLoader const&) = delete;
+
+        ~DDSBatchLoader();
+
+        // Files larger than arenaSize fail with E_OUTOFMEMORY. numThreads of 0 uses one worker
+        // per logical processor.
+        HRESULT __cdecl Initialize(
+            _In_ size_t arenaSize = 64 * 1024 * 1024,
+            _In_ unsigned int maxReads = 64,
+            _In_ unsigned int numThreads = 0) noexcept;
+
+        void __cdecl Shutdown() noexcept;
+
+        // Returns once every file has been passed to the callback. Failures to open or read
+        // a file go to the callback, which is given the index into fileNames. Mip levels
+        // larger than maxsize are skipped as in LoadDDSTextureDataFromMemory. Call from one
+        // thread at a time.
+        HRESULT __cdecl Load(
+            _In_reads_(count) const wchar_t* const* fileNames,
+            _In_ size_t count,
+            _In_ size_t maxsize,
+            const Callback& callback) noexcept;
+
+        // Times Load waited for the arena or for a free read since Initialize
+        uint64_t __cdecl GetStallCount() const noexcept;
+
+    private:
+        class Impl;
+
+        std::unique_ptr<Impl> pImpl;
+    };
+}
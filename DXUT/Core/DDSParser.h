@@ -0,0 +1,117 @@
+//--------------------------------------------------------------------------------------
+// File: DDSParser.h
+//
+// Functions for reading the layout of a DDS texture in memory, without a Direct3D device.
+// DDSTextureLoader creates its resources from these, and texture streaming code or tools
+// can use them directly.
+//
+// Note these functions are useful as a light-weight runtime loader for DDS files. For
+// a full-featured DDS file reader, writer, and texture processing pipeline see
+// the 'Texconv' sample and the 'DirectXTex' library.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248926
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#ifdef _WIN32
+#include <dxgiformat.h>
+#else
+#include <wsl/winadapter.h>
+#include <directx/dxgiformat.h>
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+namespace DirectX
+{
+#ifndef DDS_ALPHA_MODE_DEFINED
+#define DDS_ALPHA_MODE_DEFINED
+    enum DDS_ALPHA_MODE : uint32_t
+    {
+        DDS_ALPHA_MODE_UNKNOWN       = 0,
+        DDS_ALPHA_MODE_STRAIGHT      = 1,
+        DDS_ALPHA_MODE_PREMULTIPLIED = 2,
+        DDS_ALPHA_MODE_OPAQUE        = 3,
+        DDS_ALPHA_MODE_CUSTOM        = 4,
+    };
+#endif
+
+    // Same values as D3D11_RESOURCE_DIMENSION and D3D12_RESOURCE_DIMENSION
+    enum DDS_RESOURCE_DIMENSION : uint32_t
+    {
+        DDS_DIMENSION_TEXTURE1D = 2,
+        DDS_DIMENSION_TEXTURE2D = 3,
+        DDS_DIMENSION_TEXTURE3D = 4,
+    };
+
+    struct DDS_TEXTURE_DESC
+    {
+        DDS_RESOURCE_DIMENSION dimension;
+        DXGI_FORMAT format;
+        uint32_t width;
+        uint32_t height;
+        uint32_t depth;
+        uint32_t mipLevels;
+        uint32_t arraySize;         // six per cube for cube maps
+        bool isCubeMap;
+        DDS_ALPHA_MODE alphaMode;
+    };
+
+    // One mip level of one array item. Volume textures have depth slices of slicePitch bytes each.
+    struct DDS_SUBRESOURCE_DATA
+    {
+        const uint8_t* data;        // points into the DDS data
+        size_t offset;              // of data from the start of the DDS data
+        size_t rowPitch;
+        size_t slicePitch;
+        size_t numRows;             // rows of blocks for compressed formats
+        size_t depth;
+    };
+
+    // Reads and checks the headers. Only they need to be in memory, so this works on the start of a file.
+    // bitOffset receives the offset of the first subresource.
+    HRESULT __cdecl GetDDSTextureDesc(
+        _In_reads_bytes_(ddsDataSize) const uint8_t* ddsData,
+        _In_ size_t ddsDataSize,
+        _Out_ DDS_TEXTURE_DESC* desc,
+        _Out_opt_ size_t* bitOffset = nullptr) noexcept;
+
+    // Finds every subresource of a DDS texture in memory, in D3D11CalcSubresource order (the mip
+    // levels of the first array item, then those of the next). No pixels are copied. Mip levels
+    // larger than maxsize are left out, and desc describes the texture that remains.
+    HRESULT __cdecl LoadDDSTextureDataFromMemory(
+        _In_reads_bytes_(ddsDataSize) const uint8_t* ddsData,
+        _In_ size_t ddsDataSize,
+        _In_ size_t maxsize,
+        _Out_ DDS_TEXTURE_DESC* desc,
+        std::vector<DDS_SUBRESOURCE_DATA>& subresources) noexcept;
+
+    // Finds where every subresource lies in a DDS file from its headers alone, for reading just
+    // the mip levels wanted. Takes the desc and bitOffset from GetDDSTextureDesc and the size of
+    // the whole file. Offsets are from the start of the file and data is left null.
+    HRESULT __cdecl GetDDSSubresourceLayout(
+        _In_ const DDS_TEXTURE_DESC& desc,
+        _In_ size_t bitOffset,
+        _In_ size_t ddsDataSize,
+        std::vector<DDS_SUBRESOURCE_DATA>& subresources) noexcept;
+
+    // Bits per pixel of a format, or zero for formats DDS files cannot hold
+    size_t __cdecl GetDDSBitsPerPixel(_In_ DXGI_FORMAT fmt) noexcept;
+
+    // Size of one surface (one depth slice) of a mip level
+    HRESULT __cdecl GetDDSSurfaceInfo(
+        _In_ size_t width,
+        _In_ size_t height,
+        _In_ DXGI_FORMAT fmt,
+        _Out_opt_ size_t* outNumBytes,
+        _Out_opt_ size_t* outRowBytes,
+        _Out_opt_ size_t* outNumRows) noexcept;
+}
@@ -20,22 +20,15 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "DDSBatchLoader.h"
+#include "DDSParser.h"
 
 
 namespace DirectX
 {
-#ifndef DDS_ALPHA_MODE_DEFINED
-#define DDS_ALPHA_MODE_DEFINED
-    enum DDS_ALPHA_MODE : uint32_t
-    {
-        DDS_ALPHA_MODE_UNKNOWN       = 0,
-        DDS_ALPHA_MODE_STRAIGHT      = 1,
-        DDS_ALPHA_MODE_PREMULTIPLIED = 2,
-        DDS_ALPHA_MODE_OPAQUE        = 3,
-        DDS_ALPHA_MODE_CUSTOM        = 4,
-    };
-#endif
-
     inline namespace DX11
     {
         enum DDS_LOADER_FLAGS : uint32_t
@@ -43,6 +36,7 @@ namespace DirectX
             DDS_LOADER_DEFAULT = 0,
             DDS_LOADER_FORCE_SRGB = 0x1,
             DDS_LOADER_IGNORE_SRGB = 0x2,
+            DDS_LOADER_CPU_MIPS = 0x100, // full mip chain from GenerateMipChain in TextureConvert.h
         };
     }
 
@@ -142,6 +136,81 @@ namespace DirectX
         _Outptr_opt_ ID3D11ShaderResourceView** textureView,
         _Out_opt_ DDS_ALPHA_MODE* alphaMode = nullptr) noexcept;
 
+    // Batch version. Reads the files with the loader and creates each texture on the worker
+    // thread that parsed it. textureViews receives count views, left null for files that
+    // failed; the result is the failure of one of them, or S_OK when all loaded.
+    HRESULT __cdecl CreateDDSTexturesFromFiles(
+        _In_ ID3D11Device* d3dDevice,
+        DDSBatchLoader& loader,
+        _In_reads_(count) const wchar_t* const* fileNames,
+        _In_ size_t count,
+        _Out_writes_(count) ID3D11ShaderResourceView** textureViews,
+        _In_ size_t maxsize = 0,
+        _In_ DDS_LOADER_FLAGS loadFlags = DDS_LOADER_DEFAULT) noexcept;
+
+    //----------------------------------------------------------------------------------
+    // Streams the mip levels of a DDS file for a texture streamer. Open reads only the
+    // headers. CreateTexture then reads the small mips at the end of the chain and makes a
+    // texture of just those, and RaiseResidency later reads larger levels and grows the
+    // texture to hold them. Each read is positioned at the levels' offset in the file, so
+    // levels that are not wanted yet are never read.
+    //----------------------------------------------------------------------------------
+    class DDSTextureStream
+    {
+    public:
+        DDSTextureStream();
+
+        DDSTextureStream(DDSTextureStream&&) noexcept;
+        DDSTextureStream& operator= (DDSTextureStream&&) noexcept;
+
+        DDSTextureStream(DDSTextureStream const&) = delete;
+        DDSTextureStream& operator= (DDSTextureStream const&) = delete;
+
+        ~DDSTextureStream();
+
+        HRESULT __cdecl Open(_In_z_ const wchar_t* szFileName) noexcept;
+        void __cdecl Close() noexcept;
+
+        // The whole texture in the file
+        const DDS_TEXTURE_DESC& __cdecl GetDesc() const noexcept;
+
+        // Reads mipLevels levels from mostDetailedMip of every array item, with one read per item.
+        // The subresources point into a buffer owned by the stream, valid until its next read.
+        HRESULT __cdecl ReadMips(
+            _In_ uint32_t mostDetailedMip,
+            _In_ uint32_t mipLevels,
+            std::vector<DDS_SUBRESOURCE_DATA>& subresources) noexcept;
+
+        // Creates a D3D11_USAGE_DEFAULT texture of mostDetailedMip and the levels below it. Block
+        // compressed textures start at the nearest larger level that is a multiple of 4 in size.
+        HRESULT __cdecl CreateTexture(
+            _In_ ID3D11Device* d3dDevice,
+            _In_ uint32_t mostDetailedMip,
+            _Outptr_opt_ ID3D11Resource** texture,
+            _Outptr_opt_ ID3D11ShaderResourceView** textureView,
+            _In_ DDS_LOADER_FLAGS loadFlags = DDS_LOADER_DEFAULT) noexcept;
+
+        // Reads the levels from mostDetailedMip up to those already resident, and replaces the
+        // texture with a larger one holding all of them. Resident levels are copied on the GPU
+        // rather than read again. Returns S_FALSE when the levels are already resident.
+        HRESULT __cdecl RaiseResidency(
+            _In_ ID3D11DeviceContext* d3dContext,
+            _In_ uint32_t mostDetailedMip,
+            _Outptr_opt_ ID3D11Resource** texture,
+            _Outptr_opt_ ID3D11ShaderResourceView** textureView) noexcept;
+
+        // Most detailed level of the texture, or the file's mip count before CreateTexture
+        uint32_t __cdecl GetResidentMip() const noexcept;
+
+        // Pixel bytes read from the file since Open
+        uint64_t __cdecl GetBytesRead() const noexcept;
+
+    private:
+        class Impl;
+
+        std::unique_ptr<Impl> pImpl;
+    };
+
 #ifdef __clang__
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wdeprecated-dynamic-exception-spec"
@@ -0,0 +1,794 @@
+//--------------------------------------------------------------------------------------
+// File: DDSWriter.cpp
+//
+// Writes a DDS file a few rows at a time, without a Direct3D device
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248926
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+
+#include "DDSWriter.h"
+#include "TextureConvert.h"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <system_error>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#ifdef __clang__
+#pragma clang diagnostic ignored "-Wcovered-switch-default"
+#pragma clang diagnostic ignored "-Wswitch-enum"
+#endif
+
+using namespace DirectX;
+
+//--------------------------------------------------------------------------------------
+// Macros
+//--------------------------------------------------------------------------------------
+#ifndef MAKEFOURCC
+#define MAKEFOURCC(ch0, ch1, ch2, ch3)                              \
+                ((uint32_t)(uint8_t)(ch0) | ((uint32_t)(uint8_t)(ch1) << 8) |       \
+                ((uint32_t)(uint8_t)(ch2) << 16) | ((uint32_t)(uint8_t)(ch3) << 24 ))
+#endif /* defined(MAKEFOURCC) */
+
+//--------------------------------------------------------------------------------------
+// DDS file structure definitions
+//
+// See DDS.h in the 'Texconv' sample and the 'DirectXTex' library
+//--------------------------------------------------------------------------------------
+namespace
+{
+#pragma pack(push,1)
+
+#define DDS_MAGIC 0x20534444 // "DDS "
+
+    struct DDS_PIXELFORMAT
+    {
+        uint32_t    size;
+        uint32_t    flags;
+        uint32_t    fourCC;
+        uint32_t    RGBBitCount;
+        uint32_t    RBitMask;
+        uint32_t    GBitMask;
+        uint32_t    BBitMask;
+        uint32_t    ABitMask;
+    };
+
+#define DDS_FOURCC      0x00000004  // DDPF_FOURCC
+
+#define DDS_HEADER_FLAGS_TEXTURE        0x00001007  // DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT
+#define DDS_HEADER_FLAGS_MIPMAP         0x00020000  // DDSD_MIPMAPCOUNT
+#define DDS_HEADER_FLAGS_VOLUME         0x00800000  // DDSD_DEPTH
+#define DDS_HEADER_FLAGS_PITCH          0x00000008  // DDSD_PITCH
+#define DDS_HEADER_FLAGS_LINEARSIZE     0x00080000  // DDSD_LINEARSIZE
+
+#define DDS_SURFACE_FLAGS_TEXTURE 0x00001000 // DDSCAPS_TEXTURE
+#define DDS_SURFACE_FLAGS_MIPMAP  0x00400008 // DDSCAPS_COMPLEX | DDSCAPS_MIPMAP
+#define DDS_SURFACE_FLAGS_CUBEMAP 0x00000008 // DDSCAPS_COMPLEX
+
+#define DDS_CUBEMAP_ALLFACES 0x0000fe00 // DDSCAPS2_CUBEMAP and all six DDSCAPS2_CUBEMAP_* faces
+#define DDS_FLAGS_VOLUME 0x00200000 // DDSCAPS2_VOLUME
+
+#define DDS_RESOURCE_MISC_TEXTURECUBE 0x4
+
+    struct DDS_HEADER
+    {
+        uint32_t        size;
+        uint32_t        flags;
+        uint32_t        height;
+        uint32_t        width;
+        uint32_t        pitchOrLinearSize;
+        uint32_t        depth; // only if DDS_HEADER_FLAGS_VOLUME is set in flags
+        uint32_t        mipMapCount;
+        uint32_t        reserved1[11];
+        DDS_PIXELFORMAT ddspf;
+        uint32_t        caps;
+        uint32_t        caps2;
+        uint32_t        caps3;
+        uint32_t        caps4;
+        uint32_t        reserved2;
+    };
+
+    struct DDS_HEADER_DXT10
+    {
+        DXGI_FORMAT     dxgiFormat;
+        uint32_t        resourceDimension;
+        uint32_t        miscFlag; // see D3D11_RESOURCE_MISC_FLAG
+        uint32_t        arraySize;
+        uint32_t        miscFlags2;
+    };
+
+#pragma pack(pop)
+
+    const DDS_PIXELFORMAT DDSPF_DX10 =
+    { sizeof(DDS_PIXELFORMAT), DDS_FOURCC, MAKEFOURCC('D','X','1','0'), 0, 0, 0, 0, 0 };
+
+    constexpr size_t c_HeaderSize = sizeof(uint32_t) + sizeof(DDS_HEADER) + sizeof(DDS_HEADER_DXT10);
+
+    // Unbuffered writes must start and end on a sector. 4K covers both 512 byte and
+    // Advanced Format disks.
+    constexpr size_t c_SectorSize = 4096;
+
+    // Each half of the buffer is at least this large, and grows to fit a row of the
+    // top mip level and a sector besides
+    constexpr size_t c_MinHalfSize = 2 * 1024 * 1024;
+
+    // Converting fewer pixels than this on another thread costs more than it saves
+    constexpr size_t c_MinBandPixels = 65536;
+
+    inline size_t AlignUp(size_t size) noexcept
+    {
+        return (size + c_SectorSize - 1) & ~(c_SectorSize - 1);
+    }
+
+    struct handle_closer { void operator()(HANDLE h) noexcept { if (h) CloseHandle(h); } };
+
+    using ScopedHandle = std::unique_ptr<void, handle_closer>;
+
+    inline HANDLE safe_handle(HANDLE h) noexcept { return (h == INVALID_HANDLE_VALUE) ? nullptr : h; }
+
+    struct virtual_deleter { void operator()(void* p) noexcept { if (p) VirtualFree(p, 0, MEM_RELEASE); } };
+
+    //--------------------------------------------------------------------------------------
+    bool IsCompressed(_In_ DXGI_FORMAT fmt) noexcept
+    {
+        switch (fmt)
+        {
+        case DXGI_FORMAT_BC1_TYPELESS:
+        case DXGI_FORMAT_BC1_UNORM:
+        case DXGI_FORMAT_BC1_UNORM_SRGB:
+        case DXGI_FORMAT_BC2_TYPELESS:
+        case DXGI_FORMAT_BC2_UNORM:
+        case DXGI_FORMAT_BC2_UNORM_SRGB:
+        case DXGI_FORMAT_BC3_TYPELESS:
+        case DXGI_FORMAT_BC3_UNORM:
+        case DXGI_FORMAT_BC3_UNORM_SRGB:
+        case DXGI_FORMAT_BC4_TYPELESS:
+        case DXGI_FORMAT_BC4_UNORM:
+        case DXGI_FORMAT_BC4_SNORM:
+        case DXGI_FORMAT_BC5_TYPELESS:
+        case DXGI_FORMAT_BC5_UNORM:
+        case DXGI_FORMAT_BC5_SNORM:
+        case DXGI_FORMAT_BC6H_TYPELESS:
+        case DXGI_FORMAT_BC6H_UF16:
+        case DXGI_FORMAT_BC6H_SF16:
+        case DXGI_FORMAT_BC7_TYPELESS:
+        case DXGI_FORMAT_BC7_UNORM:
+        case DXGI_FORMAT_BC7_UNORM_SRGB:
+            return true;
+
+        default:
+            return false;
+        }
+    }
+
+    //--------------------------------------------------------------------------------------
+    // Converts rows, split into bands across threads when there are enough pixels
+    HRESULT ConvertRows(
+        _In_ const uint8_t* src,
+        size_t srcRowPitch,
+        DXGI_FORMAT srcFormat,
+        _Out_ uint8_t* dst,
+        size_t dstRowPitch,
+        DXGI_FORMAT dstFormat,
+        size_t width,
+        size_t height,
+        unsigned int numThreads) noexcept
+    {
+        auto convert = [=](size_t y0, size_t y1) noexcept
+            {
+                return ConvertPixels(src + y0 * srcRowPitch, srcRowPitch, srcFormat,
+                    dst + y0 * dstRowPitch, dstRowPitch, dstFormat,
+                    width, y1 - y0);
+            };
+
+        const size_t bands = std::min<size_t>({ numThreads, height, std::max<size_t>(1, (width * height) / c_MinBandPixels) });
+        if (bands <= 1)
+            return convert(size_t(0), height);
+
+        try
+        {
+            std::vector<HRESULT> results(bands, S_OK);
+            std::vector<std::thread> threads;
+            threads.reserve(bands - 1);
+
+            for (size_t band = 1; band < bands; ++band)
+            {
+                const size_t y0 = height * band / bands;
+                const size_t y1 = height * (band + 1) / bands;
+                try
+                {
+                    threads.emplace_back([&convert, &results, band, y0, y1]() noexcept
+                        {
+                            results[band] = convert(y0, y1);
+                        });
+                }
+                catch (const std::system_error&)
+                {
+                    results[band] = convert(y0, y1);
+                }
+            }
+
+            results[0] = convert(size_t(0), height / bands);
+
+            for (auto& t : threads)
+            {
+                t.join();
+            }
+
+            for (const HRESULT hr : results)
+            {
+                if (FAILED(hr))
+                    return hr;
+            }
+        }
+        catch (const std::bad_alloc&)
+        {
+            return convert(size_t(0), height);
+        }
+
+        return S_OK;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+class DDSWriter::Impl
+{
+public:
+    Impl() noexcept :
+        m_desc{},
+        m_numThreads(0),
+        m_subresourceCount(0),
+        m_subresource(0),
+        m_width(0),
+        m_rowBytes(0),
+        m_rowsLeft(0),
+        m_halfSize(0),
+        m_current(0),
+        m_used(0),
+        m_fileOffset(0),
+        m_fileSize(0),
+        m_ov{},
+        m_pending{},
+        m_hr(S_OK)
+    {
+    }
+
+    ~Impl()
+    {
+        // The buffer must outlive the writes reading it
+        std::ignore = Wait(0);
+        std::ignore = Wait(1);
+    }
+
+    Impl(const Impl&) = delete;
+    Impl& operator=(const Impl&) = delete;
+
+    HRESULT Setup(const DDS_TEXTURE_DESC& desc) noexcept;
+    HRESULT StartSubresource() noexcept;
+    HRESULT Append(const uint8_t* data, size_t size) noexcept;
+    HRESULT Flush(bool final) noexcept;
+    HRESULT Wait(size_t half) noexcept;
+
+    uint8_t* Current() const noexcept { return static_cast<uint8_t*>(m_buffer.get()) + m_current * m_halfSize; }
+
+    ScopedHandle                        m_file;
+    DDS_TEXTURE_DESC                    m_desc;
+    unsigned int                        m_numThreads;
+
+    uint32_t                            m_subresourceCount;
+    uint32_t                            m_subresource;  // being written
+    size_t                              m_width;        // in pixels of the subresource being written
+    size_t                              m_rowBytes;
+    size_t                              m_rowsLeft;
+
+    std::unique_ptr<void, virtual_deleter> m_buffer;    // two halves, the one filling at m_current
+    size_t                              m_halfSize;
+    size_t                              m_current;
+    size_t                              m_used;         // bytes in the half filling
+    uint64_t                            m_fileOffset;   // of the half filling
+    uint64_t                            m_fileSize;     // bytes given so far, headers included
+
+    OVERLAPPED                          m_ov[2];
+    ScopedHandle                        m_events[2];
+    DWORD                               m_pending[2];   // bytes being written from each half
+
+    HRESULT                             m_hr;           // the first failure, after which every call fails
+};
+
+
+//--------------------------------------------------------------------------------------
+// Checks the description and builds the headers in the first half of the buffer
+HRESULT DDSWriter::Impl::Setup(const DDS_TEXTURE_DESC& desc) noexcept
+{
+    if (!desc.width || !desc.height || !desc.depth || !desc.mipLevels || !desc.arraySize)
+        return E_INVALIDARG;
+
+    if (!GetDDSBitsPerPixel(desc.format))
+        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+    switch (desc.dimension)
+    {
+    case DDS_DIMENSION_TEXTURE1D:
+        if (desc.height != 1 || desc.depth != 1 || desc.isCubeMap)
+            return E_INVALIDARG;
+        break;
+
+    case DDS_DIMENSION_TEXTURE2D:
+        if (desc.depth != 1 || (desc.isCubeMap && (desc.arraySize % 6) != 0))
+            return E_INVALIDARG;
+        break;
+
+    case DDS_DIMENSION_TEXTURE3D:
+        if (desc.arraySize != 1 || desc.isCubeMap)
+            return E_INVALIDARG;
+        break;
+
+    default:
+        return E_INVALIDARG;
+    }
+
+    const uint64_t subresources = uint64_t(desc.mipLevels) * uint64_t(desc.arraySize);
+    if (subresources > UINT32_MAX)
+        return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+    size_t numBytes, rowBytes, numRows;
+    HRESULT hr = GetDDSSurfaceInfo(desc.width, desc.height, desc.format, &numBytes, &rowBytes, &numRows);
+    if (FAILED(hr))
+        return hr;
+
+    if (numBytes > UINT32_MAX)
+        return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+    m_desc = desc;
+    m_subresourceCount = static_cast<uint32_t>(subresources);
+
+    // Both halves together are allocated once, page aligned
+    m_halfSize = std::max(c_MinHalfSize, AlignUp(rowBytes + c_SectorSize));
+    m_buffer.reset(VirtualAlloc(nullptr, 2 * m_halfSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+    if (!m_buffer)
+        return E_OUTOFMEMORY;
+
+    auto header = reinterpret_cast<DDS_HEADER*>(Current() + sizeof(uint32_t));
+    auto extHeader = reinterpret_cast<DDS_HEADER_DXT10*>(Current() + sizeof(uint32_t) + sizeof(DDS_HEADER));
+
+    memset(Current(), 0, c_HeaderSize);
+    *reinterpret_cast<uint32_t*>(Current()) = DDS_MAGIC;
+
+    header->size = sizeof(DDS_HEADER);
+    header->flags = DDS_HEADER_FLAGS_TEXTURE | DDS_HEADER_FLAGS_MIPMAP;
+    header->height = desc.height;
+    header->width = desc.width;
+    header->mipMapCount = desc.mipLevels;
+    header->caps = DDS_SURFACE_FLAGS_TEXTURE;
+    memcpy(&header->ddspf, &DDSPF_DX10, sizeof(DDS_PIXELFORMAT));
+
+    if (desc.mipLevels > 1)
+    {
+        header->caps |= DDS_SURFACE_FLAGS_MIPMAP;
+    }
+
+    if (IsCompressed(desc.format))
+    {
+        header->flags |= DDS_HEADER_FLAGS_LINEARSIZE;
+        header->pitchOrLinearSize = static_cast<uint32_t>(numBytes);
+    }
+    else
+    {
+        header->flags |= DDS_HEADER_FLAGS_PITCH;
+        header->pitchOrLinearSize = static_cast<uint32_t>(rowBytes);
+    }
+
+    extHeader->dxgiFormat = desc.format;
+    extHeader->resourceDimension = desc.dimension;
+    extHeader->arraySize = desc.arraySize;
+    extHeader->miscFlags2 = desc.alphaMode;
+
+    if (desc.dimension == DDS_DIMENSION_TEXTURE3D)
+    {
+        header->flags |= DDS_HEADER_FLAGS_VOLUME;
+        header->depth = desc.depth;
+        header->caps2 = DDS_FLAGS_VOLUME;
+    }
+    else if (desc.isCubeMap)
+    {
+        header->caps |= DDS_SURFACE_FLAGS_CUBEMAP;
+        header->caps2 = DDS_CUBEMAP_ALLFACES;
+        extHeader->miscFlag = DDS_RESOURCE_MISC_TEXTURECUBE;
+        extHeader->arraySize = desc.arraySize / 6;
+    }
+
+    m_used = c_HeaderSize;
+    m_fileSize = c_HeaderSize;
+
+    return StartSubresource();
+}
+
+
+//--------------------------------------------------------------------------------------
+// Finds the size of the subresource now being written
+HRESULT DDSWriter::Impl::StartSubresource() noexcept
+{
+    if (m_subresource >= m_subresourceCount)
+    {
+        m_width = m_rowBytes = m_rowsLeft = 0;
+        return S_OK;
+    }
+
+    const uint32_t level = m_subresource % m_desc.mipLevels;
+    const size_t width = std::max<size_t>(m_desc.width >> level, 1);
+    const size_t height = std::max<size_t>(m_desc.height >> level, 1);
+    const size_t depth = std::max<size_t>(m_desc.depth >> level, 1);
+
+    size_t rowBytes, numRows;
+    HRESULT hr = GetDDSSurfaceInfo(width, height, m_desc.format, nullptr, &rowBytes, &numRows);
+    if (FAILED(hr))
+        return hr;
+
+    m_width = width;
+    m_rowBytes = rowBytes;
+    m_rowsLeft = numRows * depth;
+
+    // Zero sized levels of odd formats have nothing to write
+    if (!m_rowsLeft)
+    {
+        ++m_subresource;
+        return StartSubresource();
+    }
+
+    return S_OK;
+}
+
+
+//--------------------------------------------------------------------------------------
+HRESULT DDSWriter::Impl::Append(const uint8_t* data, size_t size) noexcept
+{
+    while (size > 0)
+    {
+        const size_t count = std::min(size, m_halfSize - m_used);
+        memcpy(Current() + m_used, data, count);
+        m_used += count;
+        m_fileSize += count;
+        data += count;
+        size -= count;
+
+        if (m_used == m_halfSize)
+        {
+            HRESULT hr = Flush(false);
+            if (FAILED(hr))
+                return hr;
+        }
+    }
+
+    return S_OK;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Starts writing the whole sectors of the half filling and moves the part sector left
+// over to the other half, once its own write is done. The final flush pads the last
+// sector instead.
+HRESULT DDSWriter::Impl::Flush(bool final) noexcept
+{
+    const size_t size = final ? AlignUp(m_used) : (m_used & ~(c_SectorSize - 1));
+    if (!size)
+        return S_OK;
+
+    uint8_t* half = Current();
+    if (size > m_used)
+    {
+        memset(half + m_used, 0, size - m_used);
+    }
+
+    const size_t next = m_current ^ 1;
+    HRESULT hr = Wait(next);
+    if (FAILED(hr))
+        return hr;
+
+    OVERLAPPED& ov = m_ov[m_current];
+    ov = {};
+    ov.Offset = static_cast<DWORD>(m_fileOffset);
+    ov.OffsetHigh = static_cast<DWORD>(m_fileOffset >> 32);
+    ov.hEvent = m_events[m_current].get();
+
+    if (!WriteFile(m_file.get(), half, static_cast<DWORD>(size), nullptr, &ov))
+    {
+        const DWORD error = GetLastError();
+        if (error != ERROR_IO_PENDING)
+            return HRESULT_FROM_WIN32(error);
+    }
+
+    m_pending[m_current] = static_cast<DWORD>(size);
+    m_fileOffset += size;
+
+    const size_t left = (size < m_used) ? m_used - size : 0;
+    memcpy(static_cast<uint8_t*>(m_buffer.get()) + next * m_halfSize, half + size, left);
+
+    m_current = next;
+    m_used = left;
+
+    return S_OK;
+}
+
+
+//--------------------------------------------------------------------------------------
+HRESULT DDSWriter::Impl::Wait(size_t half) noexcept
+{
+    if (!m_pending[half])
+        return S_OK;
+
+    const DWORD expected = m_pending[half];
+    m_pending[half] = 0;
+
+    DWORD bytesWritten = 0;
+    if (!GetOverlappedResult(m_file.get(), &m_ov[half], &bytesWritten, TRUE))
+        return HRESULT_FROM_WIN32(GetLastError());
+
+    if (bytesWritten != expected)
+        return E_FAIL;
+
+    return S_OK;
+}
+
+
+//--------------------------------------------------------------------------------------
+DDSWriter::DDSWriter() noexcept
+{
+}
+
+DDSWriter::DDSWriter(DDSWriter&&) noexcept = default;
+
+DDSWriter& DDSWriter::operator= (DDSWriter&& moveFrom) noexcept
+{
+    if (this != &moveFrom)
+    {
+        // A file still being written is deleted, as by the destructor
+        Abort();
+        pImpl = std::move(moveFrom.pImpl);
+    }
+    return *this;
+}
+
+DDSWriter::~DDSWriter()
+{
+    Abort();
+}
+
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DDSWriter::Begin(const wchar_t* fileName, const DDS_TEXTURE_DESC& desc, unsigned int numThreads) noexcept
+{
+    if (pImpl)
+        return E_UNEXPECTED;
+
+    if (!fileName)
+        return E_INVALIDARG;
+
+    if (!numThreads)
+    {
+        numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    std::unique_ptr<Impl> impl(new (std::nothrow) Impl);
+    if (!impl)
+        return E_OUTOFMEMORY;
+
+    HRESULT hr = impl->Setup(desc);
+    if (FAILED(hr))
+        return hr;
+
+    impl->m_numThreads = numThreads;
+
+    for (auto& it : impl->m_events)
+    {
+        it.reset(CreateEventEx(nullptr, nullptr, CREATE_EVENT_MANUAL_RESET, EVENT_MODIFY_STATE | SYNCHRONIZE));
+        if (!it)
+            return HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    // Create file
+#if (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
+    CREATEFILE2_EXTENDED_PARAMETERS params = {};
+    params.dwSize = sizeof(CREATEFILE2_EXTENDED_PARAMETERS);
+    params.dwFileAttributes = FILE_ATTRIBUTE_NORMAL;
+    params.dwFileFlags = FILE_FLAG_OVERLAPPED | FILE_FLAG_NO_BUFFERING;
+    impl->m_file.reset(safe_handle(CreateFile2(fileName,
+        GENERIC_WRITE | DELETE, 0, CREATE_ALWAYS, &params)));
+#else
+    impl->m_file.reset(safe_handle(CreateFileW(fileName,
+        GENERIC_WRITE | DELETE, 0, nullptr, CREATE_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED | FILE_FLAG_NO_BUFFERING, nullptr)));
+#endif
+    if (!impl->m_file)
+        return HRESULT_FROM_WIN32(GetLastError());
+
+    pImpl = std::move(impl);
+
+    return S_OK;
+}
+
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DDSWriter::WriteSubresourceRows(
+    uint32_t subresource,
+    const uint8_t* rows,
+    size_t rowPitch,
+    size_t numRows,
+    DXGI_FORMAT rowFormat) noexcept
+{
+    if (!pImpl)
+        return E_UNEXPECTED;
+
+    Impl& impl = *pImpl;
+    if (FAILED(impl.m_hr))
+        return impl.m_hr;
+
+    if (!numRows)
+        return S_OK;
+
+    if (!rows)
+        return E_INVALIDARG;
+
+    if (subresource != impl.m_subresource || numRows > impl.m_rowsLeft)
+        return E_INVALIDARG;
+
+    if (rowFormat == impl.m_desc.format)
+    {
+        rowFormat = DXGI_FORMAT_UNKNOWN;
+    }
+
+    HRESULT hr = S_OK;
+    if (rowFormat == DXGI_FORMAT_UNKNOWN)
+    {
+        if (rowPitch < impl.m_rowBytes)
+            return E_INVALIDARG;
+
+        if (rowPitch == impl.m_rowBytes)
+        {
+            hr = impl.Append(rows, impl.m_rowBytes * numRows);
+        }
+        else
+        {
+            for (size_t y = 0; y < numRows && SUCCEEDED(hr); ++y)
+            {
+                hr = impl.Append(rows + y * rowPitch, impl.m_rowBytes);
+            }
+        }
+    }
+    else
+    {
+        if (!IsConvertFormatSupported(rowFormat) || !IsConvertFormatSupported(impl.m_desc.format))
+            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+        // Converted straight into the buffer, as many whole rows as fit at a time
+        for (size_t y = 0; y < numRows && SUCCEEDED(hr); )
+        {
+            size_t count = std::min((impl.m_halfSize - impl.m_used) / impl.m_rowBytes, numRows - y);
+            if (!count)
+            {
+                hr = impl.Flush(false);
+                continue;
+            }
+
+            hr = ConvertRows(rows + y * rowPitch, rowPitch, rowFormat,
+                impl.Current() + impl.m_used, impl.m_rowBytes, impl.m_desc.format,
+                impl.m_width, count, impl.m_numThreads);
+            if (FAILED(hr))
+                break;
+
+            impl.m_used += count * impl.m_rowBytes;
+            impl.m_fileSize += count * impl.m_rowBytes;
+            y += count;
+
+            if (impl.m_used == impl.m_halfSize)
+            {
+                hr = impl.Flush(false);
+            }
+        }
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        impl.m_rowsLeft -= numRows;
+        if (!impl.m_rowsLeft)
+        {
+            ++impl.m_subresource;
+            hr = impl.StartSubresource();
+        }
+    }
+
+    if (FAILED(hr))
+    {
+        impl.m_hr = hr;
+    }
+
+    return hr;
+}
+
+
+//--------------------------------------------------------------------------------------
+HRESULT DDSWriter::End() noexcept
+{
+    if (!pImpl)
+        return E_UNEXPECTED;
+
+    Impl& impl = *pImpl;
+
+    HRESULT hr = impl.m_hr;
+    if (SUCCEEDED(hr) && impl.m_subresource < impl.m_subresourceCount)
+    {
+        hr = E_UNEXPECTED;
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        hr = impl.Flush(true);
+    }
+
+    for (size_t half = 0; half < 2; ++half)
+    {
+        const HRESULT hrWait = impl.Wait(half);
+        if (SUCCEEDED(hr))
+        {
+            hr = hrWait;
+        }
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        // The last sector was padded
+        FILE_END_OF_FILE_INFO info = {};
+        info.EndOfFile.QuadPart = static_cast<LONGLONG>(impl.m_fileSize);
+        if (!SetFileInformationByHandle(impl.m_file.get(), FileEndOfFileInfo, &info, sizeof(info)))
+        {
+            hr = HRESULT_FROM_WIN32(GetLastError());
+        }
+    }
+
+    if (FAILED(hr))
+    {
+        Abort();
+        return hr;
+    }
+
+    pImpl.reset();
+
+    return S_OK;
+}
+
+
+//--------------------------------------------------------------------------------------
+void DDSWriter::Abort() noexcept
+{
+    if (!pImpl)
+        return;
+
+    std::ignore = pImpl->Wait(0);
+    std::ignore = pImpl->Wait(1);
+
+    if (pImpl->m_file)
+    {
+        FILE_DISPOSITION_INFO info = {};
+        info.DeleteFile = TRUE;
+        std::ignore = SetFileInformationByHandle(pImpl->m_file.get(), FileDispositionInfo, &info, sizeof(info));
+    }
+
+    pImpl.reset();
+}
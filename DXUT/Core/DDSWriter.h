@@ -0,0 +1,82 @@
+//--------------------------------------------------------------------------------------
+// File: DDSWriter.h
+//
+// Writes a DDS file a few rows at a time, without a Direct3D device and without holding
+// the whole texture in memory. SaveDDSTextureArrayToFile in ScreenGrab.h writes with it.
+//
+// Note this is useful as a light-weight runtime DDS writer. For a full-featured DDS file
+// reader, writer, and texture processing pipeline see the 'Texconv' sample and the
+// 'DirectXTex' library.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248926
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "DDSParser.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+
+namespace DirectX
+{
+    //----------------------------------------------------------------------------------
+    // Streams the subresources of a texture to a DDS file in file order: the mip levels
+    // of the first array item, then those of the next, as D3D11CalcSubresource numbers
+    // them. Rows are gathered into a small sector aligned buffer, and each half of it is
+    // written with unbuffered overlapped I/O while the other half fills. The file always
+    // has the 'DX10' header extension.
+    //----------------------------------------------------------------------------------
+    class DDSWriter
+    {
+    public:
+        DDSWriter() noexcept;
+
+        DDSWriter(DDSWriter&&) noexcept;
+        DDSWriter& operator= (DDSWriter&&) noexcept;
+
+        DDSWriter(DDSWriter const&) = delete;
+        DDSWriter& operator= (DDSWriter const&) = delete;
+
+        // Deletes the file if End was not reached
+        ~DDSWriter();
+
+        // Creates the file and writes the headers. Rows given in another format are
+        // converted with ConvertPixels, split across numThreads threads when there are
+        // enough of them, or one per logical processor for 0.
+        HRESULT __cdecl Begin(
+            _In_z_ const wchar_t* fileName,
+            _In_ const DDS_TEXTURE_DESC& desc,
+            _In_ unsigned int numThreads = 0) noexcept;
+
+        // Appends numRows rows to the subresource being written, which must be the one
+        // numbered subresource. Rows are rows of blocks for compressed formats, and the
+        // rows of each depth slice of a volume follow those of the slice before. Once
+        // every row of a subresource is written the next one begins. rowFormat of
+        // DXGI_FORMAT_UNKNOWN means the rows are already in the file's format.
+        HRESULT __cdecl WriteSubresourceRows(
+            _In_ uint32_t subresource,
+            _In_reads_bytes_(rowPitch * numRows) const uint8_t* rows,
+            _In_ size_t rowPitch,
+            _In_ size_t numRows,
+            _In_ DXGI_FORMAT rowFormat = DXGI_FORMAT_UNKNOWN) noexcept;
+
+        // Writes what remains and closes the file. Fails, deleting the file, if any row
+        // was not written.
+        HRESULT __cdecl End() noexcept;
+
+        // Closes and deletes the file
+        void __cdecl Abort() noexcept;
+
+    private:
+        class Impl;
+
+        std::unique_ptr<Impl> pImpl;
+    };
+}
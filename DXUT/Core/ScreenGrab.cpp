@@ -23,14 +23,22 @@
 
 // For 2D array textures and cubemaps, it captures only the first image in the array
 
+// SaveDDSTextureArrayToFile saves every mip level and array item, streamed through DDSWriter
+// from a staging texture the size of one subresource
+
 #include "ScreenGrab.h"
+#include "DDSWriter.h"
 
 #include <algorithm>
 #include <cassert>
+#include <condition_variable>
 #include <cstddef>
 #include <cstring>
 #include <memory>
+#include <mutex>
 #include <new>
+#include <string>
+#include <thread>
 #include <tuple>
 
 #include <wincodec.h>
@@ -42,6 +50,7 @@
 #pragma clang diagnostic ignored "-Wswitch-enum"
 #endif
 
+using namespace DirectX;
 using Microsoft::WRL::ComPtr;
 
 //--------------------------------------------------------------------------------------
@@ -774,479 +783,1245 @@ namespace
 
         return factory;
     }
-} // anonymous namespace
 
+    //--------------------------------------------------------------------------------------
+    // Copies the top level of a mapped staging texture to tightly packed rows
+    void CopyMappedPixels(
+        const D3D11_MAPPED_SUBRESOURCE& mapped,
+        _Out_writes_bytes_(rowPitch * rowCount) uint8_t* pixels,
+        size_t rowPitch,
+        size_t rowCount) noexcept
+    {
+        auto sptr = static_cast<const uint8_t*>(mapped.pData);
+        uint8_t* dptr = pixels;
 
-//--------------------------------------------------------------------------------------
-_Use_decl_annotations_
-HRESULT DirectX::SaveDDSTextureToFile(
-    ID3D11DeviceContext* pContext,
-    ID3D11Resource* pSource,
-    const wchar_t* fileName) noexcept
-{
-    if (!fileName)
-        return E_INVALIDARG;
-
-    D3D11_TEXTURE2D_DESC desc = {};
-    ComPtr<ID3D11Texture2D> pStaging;
-    HRESULT hr = CaptureTexture(pContext, pSource, desc, pStaging);
-    if (FAILED(hr))
-        return hr;
+        const size_t msize = std::min<size_t>(rowPitch, mapped.RowPitch);
+        for (size_t h = 0; h < rowCount; ++h)
+        {
+            memcpy_s(dptr, rowPitch, sptr, msize);
+            sptr += mapped.RowPitch;
+            dptr += rowPitch;
+        }
+    }
 
-    // Create file
-#if (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
-    ScopedHandle hFile(safe_handle(CreateFile2(fileName,
-        GENERIC_WRITE | DELETE, 0, CREATE_ALWAYS, nullptr)));
-#else
-    ScopedHandle hFile(safe_handle(CreateFileW(fileName,
-        GENERIC_WRITE | DELETE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr)));
-#endif
-    if (!hFile)
-        return HRESULT_FROM_WIN32(GetLastError());
 
-    auto_delete_file delonfail(hFile.get());
+    //--------------------------------------------------------------------------------------
+    // Writes the tightly packed pixels of the top level of a texture to a DDS file
+    HRESULT WriteDDSFile(
+        _In_z_ const wchar_t* fileName,
+        const D3D11_TEXTURE2D_DESC& desc,
+        _In_ const uint8_t* pixels) noexcept
+    {
+        // Setup header
+        constexpr size_t MAX_HEADER_SIZE = sizeof(uint32_t) + sizeof(DDS_HEADER) + sizeof(DDS_HEADER_DXT10);
+        uint8_t fileHeader[MAX_HEADER_SIZE] = {};
+
+        *reinterpret_cast<uint32_t*>(&fileHeader[0]) = DDS_MAGIC;
+
+        auto header = reinterpret_cast<DDS_HEADER*>(&fileHeader[0] + sizeof(uint32_t));
+        size_t headerSize = sizeof(uint32_t) + sizeof(DDS_HEADER);
+        header->size = sizeof(DDS_HEADER);
+        header->flags = DDS_HEADER_FLAGS_TEXTURE | DDS_HEADER_FLAGS_MIPMAP;
+        header->height = desc.Height;
+        header->width = desc.Width;
+        header->mipMapCount = 1;
+        header->caps = DDS_SURFACE_FLAGS_TEXTURE;
+
+        // Try to use a legacy .DDS pixel format for better tools support, otherwise fallback to 'DX10' header extension
+        DDS_HEADER_DXT10* extHeader = nullptr;
+        switch (desc.Format)
+        {
+        case DXGI_FORMAT_R8G8B8A8_UNORM:        memcpy_s(&header->ddspf, sizeof(header->ddspf), &DDSPF_A8B8G8R8, sizeof(DDS_PIXELFORMAT));    break;
+        case DXGI_FORMAT_R16G16_UNORM:          memcpy_s(&header->ddspf, sizeof(header->ddspf), &DDSPF_G16R16, sizeof(DDS_PIXELFORMAT));      break;
+        case DXGI_FORMAT_R8G8_UNORM:            memcpy_s(&header->ddspf, sizeof(header->ddspf), &DDSPF_A8L8, sizeof(DDS_PIXELFORMAT));        break;
+        case DXGI_FORMAT_R16_UNORM:             memcpy_s(&header->ddspf, sizeof(header->ddspf), &DDSPF_L16, sizeof(DDS_PIXELFORMAT));         break;
+        case DXGI_FORMAT_R8_UNORM:              memcpy_s(&header->ddspf, sizeof(header->ddspf), &DDSPF_L8, sizeof(DDS_PIXELFORMAT));          break;
+        case DXGI_FORMAT_A8_UNORM:              memcpy_s(&header->ddspf, sizeof(header->ddspf), &DDSPF_A8, sizeof(DDS_PIXELFORMAT));          break;
+        case DXGI_FORMAT_R8G8_B8G8_UNORM:       memcpy_s(&header->ddspf, sizeof(header->ddspf), &DDSPF_R8G8_B8G8, sizeof(DDS_PIXELFORMAT));   break;
+        case DXGI_FORMAT_G8R8_G8B8_UNORM:       memcpy_s(&header->ddspf, sizeof(header->ddspf), &DDSPF_G8R8_G8B8, sizeof(DDS_PIXELFORMAT));   break;
+        case DXGI_FORMAT_BC1_UNORM:             memcpy_s(&header->ddspf, sizeof(header->ddspf), &DDSPF_DXT1, sizeof(DDS_PIXELFORMAT));        break;
+        case DXGI_FORMAT_BC2_UNORM:             memcpy_s(&header->ddspf, sizeof(header->ddspf), &DDSPF_DXT3, sizeof(DDS_PIXELFORMAT));        break;
+        case DXGI_FORMAT_BC3_UNORM:             memcpy_s(&header->ddspf, sizeof(header->ddspf), &DDSPF_DXT5, sizeof(DDS_PIXELFORMAT));        break;
+        case DXGI_FORMAT_BC4_UNORM:             memcpy_s(&header->ddspf, sizeof(header->ddspf), &DDSPF_BC4_UNORM, sizeof(DDS_PIXELFORMAT));   break;
+        case DXGI_FORMAT_BC4_SNORM:             memcpy_s(&header->ddspf, sizeof(header->ddspf), &DDSPF_BC4_SNORM, sizeof(DDS_PIXELFORMAT));   break;
+        case DXGI_FORMAT_BC5_UNORM:             memcpy_s(&header->ddspf, sizeof(header->ddspf), &DDSPF_BC5_UNORM, sizeof(DDS_PIXELFORMAT));   break;
+        case DXGI_FORMAT_BC5_SNORM:             memcpy_s(&header->ddspf, sizeof(header->ddspf), &DDSPF_BC5_SNORM, sizeof(DDS_PIXELFORMAT));   break;
+        case DXGI_FORMAT_B5G6R5_UNORM:          memcpy_s(&header->ddspf, sizeof(header->ddspf), &DDSPF_R5G6B5, sizeof(DDS_PIXELFORMAT));      break;
+        case DXGI_FORMAT_B5G5R5A1_UNORM:        memcpy_s(&header->ddspf, sizeof(header->ddspf), &DDSPF_A1R5G5B5, sizeof(DDS_PIXELFORMAT));    break;
+        case DXGI_FORMAT_R8G8_SNORM:            memcpy_s(&header->ddspf, sizeof(header->ddspf), &DDSPF_V8U8, sizeof(DDS_PIXELFORMAT));        break;
+        case DXGI_FORMAT_R8G8B8A8_SNORM:        memcpy_s(&header->ddspf, sizeof(header->ddspf), &DDSPF_Q8W8V8U8, sizeof(DDS_PIXELFORMAT));    break;
+        case DXGI_FORMAT_R16G16_SNORM:          memcpy_s(&header->ddspf, sizeof(header->ddspf), &DDSPF_V16U16, sizeof(DDS_PIXELFORMAT));      break;
+        case DXGI_FORMAT_B8G8R8A8_UNORM:        memcpy_s(&header->ddspf, sizeof(header->ddspf), &DDSPF_A8R8G8B8, sizeof(DDS_PIXELFORMAT));    break; // DXGI 1.1
+        case DXGI_FORMAT_B8G8R8X8_UNORM:        memcpy_s(&header->ddspf, sizeof(header->ddspf), &DDSPF_X8R8G8B8, sizeof(DDS_PIXELFORMAT));    break; // DXGI 1.1
+        case DXGI_FORMAT_YUY2:                  memcpy_s(&header->ddspf, sizeof(header->ddspf), &DDSPF_YUY2, sizeof(DDS_PIXELFORMAT));        break; // DXGI 1.2
+        case DXGI_FORMAT_B4G4R4A4_UNORM:        memcpy_s(&header->ddspf, sizeof(header->ddspf), &DDSPF_A4R4G4B4, sizeof(DDS_PIXELFORMAT));    break; // DXGI 1.2
+
+        // Legacy D3DX formats using D3DFMT enum value as FourCC
+        case DXGI_FORMAT_R32G32B32A32_FLOAT:    header->ddspf.size = sizeof(DDS_PIXELFORMAT); header->ddspf.flags = DDS_FOURCC; header->ddspf.fourCC = 116; break; // D3DFMT_A32B32G32R32F
+        case DXGI_FORMAT_R16G16B16A16_FLOAT:    header->ddspf.size = sizeof(DDS_PIXELFORMAT); header->ddspf.flags = DDS_FOURCC; header->ddspf.fourCC = 113; break; // D3DFMT_A16B16G16R16F
+        case DXGI_FORMAT_R16G16B16A16_UNORM:    header->ddspf.size = sizeof(DDS_PIXELFORMAT); header->ddspf.flags = DDS_FOURCC; header->ddspf.fourCC = 36;  break; // D3DFMT_A16B16G16R16
+        case DXGI_FORMAT_R16G16B16A16_SNORM:    header->ddspf.size = sizeof(DDS_PIXELFORMAT); header->ddspf.flags = DDS_FOURCC; header->ddspf.fourCC = 110; break; // D3DFMT_Q16W16V16U16
+        case DXGI_FORMAT_R32G32_FLOAT:          header->ddspf.size = sizeof(DDS_PIXELFORMAT); header->ddspf.flags = DDS_FOURCC; header->ddspf.fourCC = 115; break; // D3DFMT_G32R32F
+        case DXGI_FORMAT_R16G16_FLOAT:          header->ddspf.size = sizeof(DDS_PIXELFORMAT); header->ddspf.flags = DDS_FOURCC; header->ddspf.fourCC = 112; break; // D3DFMT_G16R16F
+        case DXGI_FORMAT_R32_FLOAT:             header->ddspf.size = sizeof(DDS_PIXELFORMAT); header->ddspf.flags = DDS_FOURCC; header->ddspf.fourCC = 114; break; // D3DFMT_R32F
+        case DXGI_FORMAT_R16_FLOAT:             header->ddspf.size = sizeof(DDS_PIXELFORMAT); header->ddspf.flags = DDS_FOURCC; header->ddspf.fourCC = 111; break; // D3DFMT_R16F
 
-    // Setup header
-    constexpr size_t MAX_HEADER_SIZE = sizeof(uint32_t) + sizeof(DDS_HEADER) + sizeof(DDS_HEADER_DXT10);
-    uint8_t fileHeader[MAX_HEADER_SIZE] = {};
+        case DXGI_FORMAT_AI44:
+        case DXGI_FORMAT_IA44:
+        case DXGI_FORMAT_P8:
+        case DXGI_FORMAT_A8P8:
+            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
 
-    *reinterpret_cast<uint32_t*>(&fileHeader[0]) = DDS_MAGIC;
+        default:
+            memcpy_s(&header->ddspf, sizeof(header->ddspf), &DDSPF_DX10, sizeof(DDS_PIXELFORMAT));
 
-    auto header = reinterpret_cast<DDS_HEADER*>(&fileHeader[0] + sizeof(uint32_t));
-    size_t headerSize = sizeof(uint32_t) + sizeof(DDS_HEADER);
-    header->size = sizeof(DDS_HEADER);
-    header->flags = DDS_HEADER_FLAGS_TEXTURE | DDS_HEADER_FLAGS_MIPMAP;
-    header->height = desc.Height;
-    header->width = desc.Width;
-    header->mipMapCount = 1;
-    header->caps = DDS_SURFACE_FLAGS_TEXTURE;
+            headerSize += sizeof(DDS_HEADER_DXT10);
+            extHeader = reinterpret_cast<DDS_HEADER_DXT10*>(fileHeader + sizeof(uint32_t) + sizeof(DDS_HEADER));
+            extHeader->dxgiFormat = desc.Format;
+            extHeader->resourceDimension = D3D11_RESOURCE_DIMENSION_TEXTURE2D;
+            extHeader->arraySize = 1;
+            break;
+        }
 
-    // Try to use a legacy .DDS pixel format for better tools support, otherwise fallback to 'DX10' header extension
-    DDS_HEADER_DXT10* extHeader = nullptr;
-    switch (desc.Format)
-    {
-    case DXGI_FORMAT_R8G8B8A8_UNORM:        memcpy_s(&header->ddspf, sizeof(header->ddspf), &DDSPF_A8B8G8R8, sizeof(DDS_PIXELFORMAT));    break;
-    case DXGI_FORMAT_R16G16_UNORM:          memcpy_s(&header->ddspf, sizeof(header->ddspf), &DDSPF_G16R16, sizeof(DDS_PIXELFORMAT));      break;
-    case DXGI_FORMAT_R8G8_UNORM:            memcpy_s(&header->ddspf, sizeof(header->ddspf), &DDSPF_A8L8, sizeof(DDS_PIXELFORMAT));        break;
-    case DXGI_FORMAT_R16_UNORM:             memcpy_s(&header->ddspf, sizeof(header->ddspf), &DDSPF_L16, sizeof(DDS_PIXELFORMAT));         break;
-    case DXGI_FORMAT_R8_UNORM:              memcpy_s(&header->ddspf, sizeof(header->ddspf), &DDSPF_L8, sizeof(DDS_PIXELFORMAT));          break;
-    case DXGI_FORMAT_A8_UNORM:              memcpy_s(&header->ddspf, sizeof(header->ddspf), &DDSPF_A8, sizeof(DDS_PIXELFORMAT));          break;
-    case DXGI_FORMAT_R8G8_B8G8_UNORM:       memcpy_s(&header->ddspf, sizeof(header->ddspf), &DDSPF_R8G8_B8G8, sizeof(DDS_PIXELFORMAT));   break;
-    case DXGI_FORMAT_G8R8_G8B8_UNORM:       memcpy_s(&header->ddspf, sizeof(header->ddspf), &DDSPF_G8R8_G8B8, sizeof(DDS_PIXELFORMAT));   break;
-    case DXGI_FORMAT_BC1_UNORM:             memcpy_s(&header->ddspf, sizeof(header->ddspf), &DDSPF_DXT1, sizeof(DDS_PIXELFORMAT));        break;
-    case DXGI_FORMAT_BC2_UNORM:             memcpy_s(&header->ddspf, sizeof(header->ddspf), &DDSPF_DXT3, sizeof(DDS_PIXELFORMAT));        break;
-    case DXGI_FORMAT_BC3_UNORM:             memcpy_s(&header->ddspf, sizeof(header->ddspf), &DDSPF_DXT5, sizeof(DDS_PIXELFORMAT));        break;
-    case DXGI_FORMAT_BC4_UNORM:             memcpy_s(&header->ddspf, sizeof(header->ddspf), &DDSPF_BC4_UNORM, sizeof(DDS_PIXELFORMAT));   break;
-    case DXGI_FORMAT_BC4_SNORM:             memcpy_s(&header->ddspf, sizeof(header->ddspf), &DDSPF_BC4_SNORM, sizeof(DDS_PIXELFORMAT));   break;
-    case DXGI_FORMAT_BC5_UNORM:             memcpy_s(&header->ddspf, sizeof(header->ddspf), &DDSPF_BC5_UNORM, sizeof(DDS_PIXELFORMAT));   break;
-    case DXGI_FORMAT_BC5_SNORM:             memcpy_s(&header->ddspf, sizeof(header->ddspf), &DDSPF_BC5_SNORM, sizeof(DDS_PIXELFORMAT));   break;
-    case DXGI_FORMAT_B5G6R5_UNORM:          memcpy_s(&header->ddspf, sizeof(header->ddspf), &DDSPF_R5G6B5, sizeof(DDS_PIXELFORMAT));      break;
-    case DXGI_FORMAT_B5G5R5A1_UNORM:        memcpy_s(&header->ddspf, sizeof(header->ddspf), &DDSPF_A1R5G5B5, sizeof(DDS_PIXELFORMAT));    break;
-    case DXGI_FORMAT_R8G8_SNORM:            memcpy_s(&header->ddspf, sizeof(header->ddspf), &DDSPF_V8U8, sizeof(DDS_PIXELFORMAT));        break;
-    case DXGI_FORMAT_R8G8B8A8_SNORM:        memcpy_s(&header->ddspf, sizeof(header->ddspf), &DDSPF_Q8W8V8U8, sizeof(DDS_PIXELFORMAT));    break;
-    case DXGI_FORMAT_R16G16_SNORM:          memcpy_s(&header->ddspf, sizeof(header->ddspf), &DDSPF_V16U16, sizeof(DDS_PIXELFORMAT));      break;
-    case DXGI_FORMAT_B8G8R8A8_UNORM:        memcpy_s(&header->ddspf, sizeof(header->ddspf), &DDSPF_A8R8G8B8, sizeof(DDS_PIXELFORMAT));    break; // DXGI 1.1
-    case DXGI_FORMAT_B8G8R8X8_UNORM:        memcpy_s(&header->ddspf, sizeof(header->ddspf), &DDSPF_X8R8G8B8, sizeof(DDS_PIXELFORMAT));    break; // DXGI 1.1
-    case DXGI_FORMAT_YUY2:                  memcpy_s(&header->ddspf, sizeof(header->ddspf), &DDSPF_YUY2, sizeof(DDS_PIXELFORMAT));        break; // DXGI 1.2
-    case DXGI_FORMAT_B4G4R4A4_UNORM:        memcpy_s(&header->ddspf, sizeof(header->ddspf), &DDSPF_A4R4G4B4, sizeof(DDS_PIXELFORMAT));    break; // DXGI 1.2
-
-    // Legacy D3DX formats using D3DFMT enum value as FourCC
-    case DXGI_FORMAT_R32G32B32A32_FLOAT:    header->ddspf.size = sizeof(DDS_PIXELFORMAT); header->ddspf.flags = DDS_FOURCC; header->ddspf.fourCC = 116; break; // D3DFMT_A32B32G32R32F
-    case DXGI_FORMAT_R16G16B16A16_FLOAT:    header->ddspf.size = sizeof(DDS_PIXELFORMAT); header->ddspf.flags = DDS_FOURCC; header->ddspf.fourCC = 113; break; // D3DFMT_A16B16G16R16F
-    case DXGI_FORMAT_R16G16B16A16_UNORM:    header->ddspf.size = sizeof(DDS_PIXELFORMAT); header->ddspf.flags = DDS_FOURCC; header->ddspf.fourCC = 36;  break; // D3DFMT_A16B16G16R16
-    case DXGI_FORMAT_R16G16B16A16_SNORM:    header->ddspf.size = sizeof(DDS_PIXELFORMAT); header->ddspf.flags = DDS_FOURCC; header->ddspf.fourCC = 110; break; // D3DFMT_Q16W16V16U16
-    case DXGI_FORMAT_R32G32_FLOAT:          header->ddspf.size = sizeof(DDS_PIXELFORMAT); header->ddspf.flags = DDS_FOURCC; header->ddspf.fourCC = 115; break; // D3DFMT_G32R32F
-    case DXGI_FORMAT_R16G16_FLOAT:          header->ddspf.size = sizeof(DDS_PIXELFORMAT); header->ddspf.flags = DDS_FOURCC; header->ddspf.fourCC = 112; break; // D3DFMT_G16R16F
-    case DXGI_FORMAT_R32_FLOAT:             header->ddspf.size = sizeof(DDS_PIXELFORMAT); header->ddspf.flags = DDS_FOURCC; header->ddspf.fourCC = 114; break; // D3DFMT_R32F
-    case DXGI_FORMAT_R16_FLOAT:             header->ddspf.size = sizeof(DDS_PIXELFORMAT); header->ddspf.flags = DDS_FOURCC; header->ddspf.fourCC = 111; break; // D3DFMT_R16F
-
-    case DXGI_FORMAT_AI44:
-    case DXGI_FORMAT_IA44:
-    case DXGI_FORMAT_P8:
-    case DXGI_FORMAT_A8P8:
-        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+        size_t rowPitch, slicePitch, rowCount;
+        HRESULT hr = GetSurfaceInfo(desc.Width, desc.Height, desc.Format, &slicePitch, &rowPitch, &rowCount);
+        if (FAILED(hr))
+            return hr;
 
-    default:
-        memcpy_s(&header->ddspf, sizeof(header->ddspf), &DDSPF_DX10, sizeof(DDS_PIXELFORMAT));
+        if (rowPitch > UINT32_MAX || slicePitch > UINT32_MAX)
+            return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
 
-        headerSize += sizeof(DDS_HEADER_DXT10);
-        extHeader = reinterpret_cast<DDS_HEADER_DXT10*>(fileHeader + sizeof(uint32_t) + sizeof(DDS_HEADER));
-        extHeader->dxgiFormat = desc.Format;
-        extHeader->resourceDimension = D3D11_RESOURCE_DIMENSION_TEXTURE2D;
-        extHeader->arraySize = 1;
-        break;
-    }
+        if (IsCompressed(desc.Format))
+        {
+            header->flags |= DDS_HEADER_FLAGS_LINEARSIZE;
+            header->pitchOrLinearSize = static_cast<uint32_t>(slicePitch);
+        }
+        else
+        {
+            header->flags |= DDS_HEADER_FLAGS_PITCH;
+            header->pitchOrLinearSize = static_cast<uint32_t>(rowPitch);
+        }
 
-    size_t rowPitch, slicePitch, rowCount;
-    hr = GetSurfaceInfo(desc.Width, desc.Height, desc.Format, &slicePitch, &rowPitch, &rowCount);
-    if (FAILED(hr))
-        return hr;
+        // Create file
+    #if (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
+        ScopedHandle hFile(safe_handle(CreateFile2(fileName,
+            GENERIC_WRITE | DELETE, 0, CREATE_ALWAYS, nullptr)));
+    #else
+        ScopedHandle hFile(safe_handle(CreateFileW(fileName,
+            GENERIC_WRITE | DELETE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr)));
+    #endif
+        if (!hFile)
+            return HRESULT_FROM_WIN32(GetLastError());
 
-    if (rowPitch > UINT32_MAX || slicePitch > UINT32_MAX)
-        return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+        auto_delete_file delonfail(hFile.get());
 
-    if (IsCompressed(desc.Format))
-    {
-        header->flags |= DDS_HEADER_FLAGS_LINEARSIZE;
-        header->pitchOrLinearSize = static_cast<uint32_t>(slicePitch);
-    }
-    else
-    {
-        header->flags |= DDS_HEADER_FLAGS_PITCH;
-        header->pitchOrLinearSize = static_cast<uint32_t>(rowPitch);
-    }
+        // Write header & pixels
+        DWORD bytesWritten;
+        if (!WriteFile(hFile.get(), fileHeader, static_cast<DWORD>(headerSize), &bytesWritten, nullptr))
+            return HRESULT_FROM_WIN32(GetLastError());
 
-    // Setup pixels
-    std::unique_ptr<uint8_t[]> pixels(new (std::nothrow) uint8_t[slicePitch]);
-    if (!pixels)
-        return E_OUTOFMEMORY;
+        if (bytesWritten != headerSize)
+            return E_FAIL;
 
-    D3D11_MAPPED_SUBRESOURCE mapped;
-    hr = pContext->Map(pStaging.Get(), 0, D3D11_MAP_READ, 0, &mapped);
-    if (FAILED(hr))
-        return hr;
+        if (!WriteFile(hFile.get(), pixels, static_cast<DWORD>(slicePitch), &bytesWritten, nullptr))
+            return HRESULT_FROM_WIN32(GetLastError());
 
-    auto sptr = static_cast<const uint8_t*>(mapped.pData);
-    if (!sptr)
-    {
-        pContext->Unmap(pStaging.Get(), 0);
-        return E_POINTER;
-    }
+        if (bytesWritten != slicePitch)
+            return E_FAIL;
 
-    uint8_t* dptr = pixels.get();
+        delonfail.clear();
 
-    const size_t msize = std::min<size_t>(rowPitch, mapped.RowPitch);
-    for (size_t h = 0; h < rowCount; ++h)
-    {
-        memcpy_s(dptr, rowPitch, sptr, msize);
-        sptr += mapped.RowPitch;
-        dptr += rowPitch;
+        return S_OK;
     }
 
-    pContext->Unmap(pStaging.Get(), 0);
 
-    // Write header & pixels
-    DWORD bytesWritten;
-    if (!WriteFile(hFile.get(), fileHeader, static_cast<DWORD>(headerSize), &bytesWritten, nullptr))
-        return HRESULT_FROM_WIN32(GetLastError());
+    //--------------------------------------------------------------------------------------
+    // Encodes the top level of a texture to an image file with WIC
+    HRESULT WriteWICFile(
+        _In_z_ const wchar_t* fileName,
+        const D3D11_TEXTURE2D_DESC& desc,
+        _In_ const uint8_t* pixels,
+        size_t rowPitch,
+        REFGUID guidContainerFormat,
+        _In_opt_ const GUID* targetFormat,
+        const std::function<void(IPropertyBag2*)>& setCustomProps,
+        bool forceSRGB) noexcept
+    {
+        // Determine source format's WIC equivalent
+        WICPixelFormatGUID pfGuid = {};
+        bool sRGB = forceSRGB;
+        switch (desc.Format)
+        {
+        case DXGI_FORMAT_R32G32B32A32_FLOAT:            pfGuid = GUID_WICPixelFormat128bppRGBAFloat; break;
+        case DXGI_FORMAT_R16G16B16A16_FLOAT:            pfGuid = GUID_WICPixelFormat64bppRGBAHalf; break;
+        case DXGI_FORMAT_R16G16B16A16_UNORM:            pfGuid = GUID_WICPixelFormat64bppRGBA; break;
+        case DXGI_FORMAT_R10G10B10_XR_BIAS_A2_UNORM:    pfGuid = GUID_WICPixelFormat32bppRGBA1010102XR; break; // DXGI 1.1
+        case DXGI_FORMAT_R10G10B10A2_UNORM:             pfGuid = GUID_WICPixelFormat32bppRGBA1010102; break;
+        case DXGI_FORMAT_B5G5R5A1_UNORM:                pfGuid = GUID_WICPixelFormat16bppBGRA5551; break;
+        case DXGI_FORMAT_B5G6R5_UNORM:                  pfGuid = GUID_WICPixelFormat16bppBGR565; break;
+        case DXGI_FORMAT_R32_FLOAT:                     pfGuid = GUID_WICPixelFormat32bppGrayFloat; break;
+        case DXGI_FORMAT_R16_FLOAT:                     pfGuid = GUID_WICPixelFormat16bppGrayHalf; break;
+        case DXGI_FORMAT_R16_UNORM:                     pfGuid = GUID_WICPixelFormat16bppGray; break;
+        case DXGI_FORMAT_R8_UNORM:                      pfGuid = GUID_WICPixelFormat8bppGray; break;
+        case DXGI_FORMAT_A8_UNORM:                      pfGuid = GUID_WICPixelFormat8bppAlpha; break;
 
-    if (bytesWritten != headerSize)
-        return E_FAIL;
+        case DXGI_FORMAT_R8G8B8A8_UNORM:
+            pfGuid = GUID_WICPixelFormat32bppRGBA;
+            break;
 
-    if (!WriteFile(hFile.get(), pixels.get(), static_cast<DWORD>(slicePitch), &bytesWritten, nullptr))
-        return HRESULT_FROM_WIN32(GetLastError());
+        case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+            pfGuid = GUID_WICPixelFormat32bppRGBA;
+            sRGB = true;
+            break;
 
-    if (bytesWritten != slicePitch)
-        return E_FAIL;
+        case DXGI_FORMAT_B8G8R8A8_UNORM: // DXGI 1.1
+            pfGuid = GUID_WICPixelFormat32bppBGRA;
+            break;
 
-    delonfail.clear();
+        case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB: // DXGI 1.1
+            pfGuid = GUID_WICPixelFormat32bppBGRA;
+            sRGB = true;
+            break;
 
-    return S_OK;
-}
+        case DXGI_FORMAT_B8G8R8X8_UNORM: // DXGI 1.1
+            pfGuid = GUID_WICPixelFormat32bppBGR;
+            break;
 
-//--------------------------------------------------------------------------------------
-_Use_decl_annotations_
-HRESULT DirectX::SaveWICTextureToFile(
-    ID3D11DeviceContext* pContext,
-    ID3D11Resource* pSource,
-    REFGUID guidContainerFormat,
-    const wchar_t* fileName,
-    const GUID* targetFormat,
-    std::function<void(IPropertyBag2*)> setCustomProps,
-    bool forceSRGB)
-{
-    if (!fileName)
-        return E_INVALIDARG;
+        case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB: // DXGI 1.1
+            pfGuid = GUID_WICPixelFormat32bppBGR;
+            sRGB = true;
+            break;
 
-    D3D11_TEXTURE2D_DESC desc = {};
-    ComPtr<ID3D11Texture2D> pStaging;
-    HRESULT hr = CaptureTexture(pContext, pSource, desc, pStaging);
-    if (FAILED(hr))
-        return hr;
+        default:
+            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+        }
 
-    // Determine source format's WIC equivalent
-    WICPixelFormatGUID pfGuid = {};
-    bool sRGB = forceSRGB;
-    switch (desc.Format)
-    {
-    case DXGI_FORMAT_R32G32B32A32_FLOAT:            pfGuid = GUID_WICPixelFormat128bppRGBAFloat; break;
-    case DXGI_FORMAT_R16G16B16A16_FLOAT:            pfGuid = GUID_WICPixelFormat64bppRGBAHalf; break;
-    case DXGI_FORMAT_R16G16B16A16_UNORM:            pfGuid = GUID_WICPixelFormat64bppRGBA; break;
-    case DXGI_FORMAT_R10G10B10_XR_BIAS_A2_UNORM:    pfGuid = GUID_WICPixelFormat32bppRGBA1010102XR; break; // DXGI 1.1
-    case DXGI_FORMAT_R10G10B10A2_UNORM:             pfGuid = GUID_WICPixelFormat32bppRGBA1010102; break;
-    case DXGI_FORMAT_B5G5R5A1_UNORM:                pfGuid = GUID_WICPixelFormat16bppBGRA5551; break;
-    case DXGI_FORMAT_B5G6R5_UNORM:                  pfGuid = GUID_WICPixelFormat16bppBGR565; break;
-    case DXGI_FORMAT_R32_FLOAT:                     pfGuid = GUID_WICPixelFormat32bppGrayFloat; break;
-    case DXGI_FORMAT_R16_FLOAT:                     pfGuid = GUID_WICPixelFormat16bppGrayHalf; break;
-    case DXGI_FORMAT_R16_UNORM:                     pfGuid = GUID_WICPixelFormat16bppGray; break;
-    case DXGI_FORMAT_R8_UNORM:                      pfGuid = GUID_WICPixelFormat8bppGray; break;
-    case DXGI_FORMAT_A8_UNORM:                      pfGuid = GUID_WICPixelFormat8bppAlpha; break;
-
-    case DXGI_FORMAT_R8G8B8A8_UNORM:
-        pfGuid = GUID_WICPixelFormat32bppRGBA;
-        break;
-
-    case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
-        pfGuid = GUID_WICPixelFormat32bppRGBA;
-        sRGB = true;
-        break;
-
-    case DXGI_FORMAT_B8G8R8A8_UNORM: // DXGI 1.1
-        pfGuid = GUID_WICPixelFormat32bppBGRA;
-        break;
-
-    case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB: // DXGI 1.1
-        pfGuid = GUID_WICPixelFormat32bppBGRA;
-        sRGB = true;
-        break;
-
-    case DXGI_FORMAT_B8G8R8X8_UNORM: // DXGI 1.1
-        pfGuid = GUID_WICPixelFormat32bppBGR;
-        break;
-
-    case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB: // DXGI 1.1
-        pfGuid = GUID_WICPixelFormat32bppBGR;
-        sRGB = true;
-        break;
-
-    default:
-        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-    }
+        const uint64_t imageSize = uint64_t(rowPitch) * uint64_t(desc.Height);
+        if (rowPitch > UINT32_MAX || imageSize > UINT32_MAX)
+            return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
 
-    auto pWIC = GetWIC();
-    if (!pWIC)
-        return E_NOINTERFACE;
+        auto pWIC = GetWIC();
+        if (!pWIC)
+            return E_NOINTERFACE;
 
-    ComPtr<IWICStream> stream;
-    hr = pWIC->CreateStream(stream.GetAddressOf());
-    if (FAILED(hr))
-        return hr;
+        ComPtr<IWICStream> stream;
+        HRESULT hr = pWIC->CreateStream(stream.GetAddressOf());
+        if (FAILED(hr))
+            return hr;
 
-    hr = stream->InitializeFromFilename(fileName, GENERIC_WRITE);
-    if (FAILED(hr))
-        return hr;
+        hr = stream->InitializeFromFilename(fileName, GENERIC_WRITE);
+        if (FAILED(hr))
+            return hr;
 
-    auto_delete_file_wic delonfail(stream, fileName);
+        auto_delete_file_wic delonfail(stream, fileName);
 
-    ComPtr<IWICBitmapEncoder> encoder;
-    hr = pWIC->CreateEncoder(guidContainerFormat, nullptr, encoder.GetAddressOf());
-    if (FAILED(hr))
-        return hr;
+        ComPtr<IWICBitmapEncoder> encoder;
+        hr = pWIC->CreateEncoder(guidContainerFormat, nullptr, encoder.GetAddressOf());
+        if (FAILED(hr))
+            return hr;
 
-    hr = encoder->Initialize(stream.Get(), WICBitmapEncoderNoCache);
-    if (FAILED(hr))
-        return hr;
+        hr = encoder->Initialize(stream.Get(), WICBitmapEncoderNoCache);
+        if (FAILED(hr))
+            return hr;
 
-    ComPtr<IWICBitmapFrameEncode> frame;
-    ComPtr<IPropertyBag2> props;
-    hr = encoder->CreateNewFrame(frame.GetAddressOf(), props.GetAddressOf());
-    if (FAILED(hr))
-        return hr;
+        ComPtr<IWICBitmapFrameEncode> frame;
+        ComPtr<IPropertyBag2> props;
+        hr = encoder->CreateNewFrame(frame.GetAddressOf(), props.GetAddressOf());
+        if (FAILED(hr))
+            return hr;
 
-    if (targetFormat && memcmp(&guidContainerFormat, &GUID_ContainerFormatBmp, sizeof(WICPixelFormatGUID)) == 0 && g_WIC2)
-    {
-        // Opt-in to the WIC2 support for writing 32-bit Windows BMP files with an alpha channel
-        PROPBAG2 option = {};
-        option.pstrName = const_cast<wchar_t*>(L"EnableV5Header32bppBGRA");
-
-        VARIANT varValue;
-        varValue.vt = VT_BOOL;
-        varValue.boolVal = VARIANT_TRUE;
-        std::ignore = props->Write(1, &option, &varValue);
-    }
+        if (targetFormat && memcmp(&guidContainerFormat, &GUID_ContainerFormatBmp, sizeof(WICPixelFormatGUID)) == 0 && g_WIC2)
+        {
+            // Opt-in to the WIC2 support for writing 32-bit Windows BMP files with an alpha channel
+            PROPBAG2 option = {};
+            option.pstrName = const_cast<wchar_t*>(L"EnableV5Header32bppBGRA");
+
+            VARIANT varValue;
+            varValue.vt = VT_BOOL;
+            varValue.boolVal = VARIANT_TRUE;
+            std::ignore = props->Write(1, &option, &varValue);
+        }
 
-    if (setCustomProps)
-    {
-        setCustomProps(props.Get());
-    }
+        if (setCustomProps)
+        {
+            setCustomProps(props.Get());
+        }
 
-    hr = frame->Initialize(props.Get());
-    if (FAILED(hr))
-        return hr;
+        hr = frame->Initialize(props.Get());
+        if (FAILED(hr))
+            return hr;
 
-    hr = frame->SetSize(desc.Width, desc.Height);
-    if (FAILED(hr))
-        return hr;
+        hr = frame->SetSize(desc.Width, desc.Height);
+        if (FAILED(hr))
+            return hr;
 
-    hr = frame->SetResolution(72, 72);
-    if (FAILED(hr))
-        return hr;
+        hr = frame->SetResolution(72, 72);
+        if (FAILED(hr))
+            return hr;
 
-    // Pick a target format
-    WICPixelFormatGUID targetGuid = {};
-    if (targetFormat)
-    {
-        targetGuid = *targetFormat;
-    }
-    else
-    {
-        // Screenshots don't typically include the alpha channel of the render target
-        switch (desc.Format)
+        // Pick a target format
+        WICPixelFormatGUID targetGuid = {};
+        if (targetFormat)
         {
-        #if (_WIN32_WINNT >= _WIN32_WINNT_WIN8) || defined(_WIN7_PLATFORM_UPDATE)
-        case DXGI_FORMAT_R32G32B32A32_FLOAT:
-        case DXGI_FORMAT_R16G16B16A16_FLOAT:
-            if (g_WIC2)
-            {
-                targetGuid = GUID_WICPixelFormat96bppRGBFloat;
-            }
-            else
+            targetGuid = *targetFormat;
+        }
+        else
+        {
+            // Screenshots don't typically include the alpha channel of the render target
+            switch (desc.Format)
             {
+            #if (_WIN32_WINNT >= _WIN32_WINNT_WIN8) || defined(_WIN7_PLATFORM_UPDATE)
+            case DXGI_FORMAT_R32G32B32A32_FLOAT:
+            case DXGI_FORMAT_R16G16B16A16_FLOAT:
+                if (g_WIC2)
+                {
+                    targetGuid = GUID_WICPixelFormat96bppRGBFloat;
+                }
+                else
+                {
+                    targetGuid = GUID_WICPixelFormat24bppBGR;
+                }
+                break;
+            #endif
+
+            case DXGI_FORMAT_R16G16B16A16_UNORM: targetGuid = GUID_WICPixelFormat48bppBGR; break;
+            case DXGI_FORMAT_B5G5R5A1_UNORM:     targetGuid = GUID_WICPixelFormat16bppBGR555; break;
+            case DXGI_FORMAT_B5G6R5_UNORM:       targetGuid = GUID_WICPixelFormat16bppBGR565; break;
+
+            case DXGI_FORMAT_R32_FLOAT:
+            case DXGI_FORMAT_R16_FLOAT:
+            case DXGI_FORMAT_R16_UNORM:
+            case DXGI_FORMAT_R8_UNORM:
+            case DXGI_FORMAT_A8_UNORM:
+                targetGuid = GUID_WICPixelFormat8bppGray;
+                break;
+
+            default:
                 targetGuid = GUID_WICPixelFormat24bppBGR;
+                break;
             }
-            break;
-        #endif
-
-        case DXGI_FORMAT_R16G16B16A16_UNORM: targetGuid = GUID_WICPixelFormat48bppBGR; break;
-        case DXGI_FORMAT_B5G5R5A1_UNORM:     targetGuid = GUID_WICPixelFormat16bppBGR555; break;
-        case DXGI_FORMAT_B5G6R5_UNORM:       targetGuid = GUID_WICPixelFormat16bppBGR565; break;
+        }
 
-        case DXGI_FORMAT_R32_FLOAT:
-        case DXGI_FORMAT_R16_FLOAT:
-        case DXGI_FORMAT_R16_UNORM:
-        case DXGI_FORMAT_R8_UNORM:
-        case DXGI_FORMAT_A8_UNORM:
-            targetGuid = GUID_WICPixelFormat8bppGray;
-            break;
+        hr = frame->SetPixelFormat(&targetGuid);
+        if (FAILED(hr))
+            return hr;
 
-        default:
-            targetGuid = GUID_WICPixelFormat24bppBGR;
-            break;
+        if (targetFormat && memcmp(targetFormat, &targetGuid, sizeof(WICPixelFormatGUID)) != 0)
+        {
+            // Requested output pixel format is not supported by the WIC codec
+            return E_FAIL;
         }
-    }
 
-    hr = frame->SetPixelFormat(&targetGuid);
-    if (FAILED(hr))
-        return hr;
-
-    if (targetFormat && memcmp(targetFormat, &targetGuid, sizeof(WICPixelFormatGUID)) != 0)
-    {
-        // Requested output pixel format is not supported by the WIC codec
-        return E_FAIL;
-    }
+        // Encode WIC metadata
+        ComPtr<IWICMetadataQueryWriter> metawriter;
+        if (SUCCEEDED(frame->GetMetadataQueryWriter(metawriter.GetAddressOf())))
+        {
+            PROPVARIANT value;
+            PropVariantInit(&value);
 
-    // Encode WIC metadata
-    ComPtr<IWICMetadataQueryWriter> metawriter;
-    if (SUCCEEDED(frame->GetMetadataQueryWriter(metawriter.GetAddressOf())))
-    {
-        PROPVARIANT value;
-        PropVariantInit(&value);
+            value.vt = VT_LPSTR;
+            value.pszVal = const_cast<char*>("DirectXTK");
 
-        value.vt = VT_LPSTR;
-        value.pszVal = const_cast<char*>("DirectXTK");
+            if (memcmp(&guidContainerFormat, &GUID_ContainerFormatPng, sizeof(GUID)) == 0)
+            {
+                // Set Software name
+                std::ignore = metawriter->SetMetadataByName(L"/tEXt/{str=Software}", &value);
 
-        if (memcmp(&guidContainerFormat, &GUID_ContainerFormatPng, sizeof(GUID)) == 0)
-        {
-            // Set Software name
-            std::ignore = metawriter->SetMetadataByName(L"/tEXt/{str=Software}", &value);
+                // Set sRGB chunk
+                if (sRGB)
+                {
+                    value.vt = VT_UI1;
+                    value.bVal = 0;
+                    std::ignore = metawriter->SetMetadataByName(L"/sRGB/RenderingIntent", &value);
+                }
+                else
+                {
+                    // add gAMA chunk with gamma 1.0
+                    value.vt = VT_UI4;
+                    value.uintVal = 100000; // gama value * 100,000 -- i.e. gamma 1.0
+                    std::ignore = metawriter->SetMetadataByName(L"/gAMA/ImageGamma", &value);
 
-            // Set sRGB chunk
-            if (sRGB)
-            {
-                value.vt = VT_UI1;
-                value.bVal = 0;
-                std::ignore = metawriter->SetMetadataByName(L"/sRGB/RenderingIntent", &value);
+                    // remove sRGB chunk which is added by default.
+                    std::ignore = metawriter->RemoveMetadataByName(L"/sRGB/RenderingIntent");
+                }
             }
             else
             {
-                // add gAMA chunk with gamma 1.0
-                value.vt = VT_UI4;
-                value.uintVal = 100000; // gama value * 100,000 -- i.e. gamma 1.0
-                std::ignore = metawriter->SetMetadataByName(L"/gAMA/ImageGamma", &value);
+                // Set Software name
+                std::ignore = metawriter->SetMetadataByName(L"System.ApplicationName", &value);
 
-                // remove sRGB chunk which is added by default.
-                std::ignore = metawriter->RemoveMetadataByName(L"/sRGB/RenderingIntent");
+                if (sRGB)
+                {
+                    // Set EXIF Colorspace of sRGB
+                    value.vt = VT_UI2;
+                    value.uiVal = 1;
+                    std::ignore = metawriter->SetMetadataByName(L"System.Image.ColorSpace", &value);
+                }
             }
         }
-        else
+
+        if (memcmp(&targetGuid, &pfGuid, sizeof(WICPixelFormatGUID)) != 0)
         {
-            // Set Software name
-            std::ignore = metawriter->SetMetadataByName(L"System.ApplicationName", &value);
+            // Conversion required to write
+            ComPtr<IWICBitmap> source;
+            hr = pWIC->CreateBitmapFromMemory(desc.Width, desc.Height,
+                pfGuid,
+                static_cast<UINT>(rowPitch), static_cast<UINT>(imageSize),
+                const_cast<BYTE*>(pixels), source.GetAddressOf());
+            if (FAILED(hr))
+                return hr;
 
-            if (sRGB)
-            {
-                // Set EXIF Colorspace of sRGB
-                value.vt = VT_UI2;
-                value.uiVal = 1;
-                std::ignore = metawriter->SetMetadataByName(L"System.Image.ColorSpace", &value);
-            }
-        }
-    }
+            ComPtr<IWICFormatConverter> FC;
+            hr = pWIC->CreateFormatConverter(FC.GetAddressOf());
+            if (FAILED(hr))
+                return hr;
 
-    D3D11_MAPPED_SUBRESOURCE mapped;
-    hr = pContext->Map(pStaging.Get(), 0, D3D11_MAP_READ, 0, &mapped);
-    if (FAILED(hr))
-        return hr;
+            BOOL canConvert = FALSE;
+            hr = FC->CanConvert(pfGuid, targetGuid, &canConvert);
+            if (FAILED(hr) || !canConvert)
+                return E_UNEXPECTED;
 
-    const uint64_t imageSize = uint64_t(mapped.RowPitch) * uint64_t(desc.Height);
-    if (imageSize > UINT32_MAX)
-    {
-        pContext->Unmap(pStaging.Get(), 0);
-        return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
-    }
+            hr = FC->Initialize(source.Get(), targetGuid, WICBitmapDitherTypeNone, nullptr, 0, WICBitmapPaletteTypeMedianCut);
+            if (FAILED(hr))
+                return hr;
 
-    if (memcmp(&targetGuid, &pfGuid, sizeof(WICPixelFormatGUID)) != 0)
-    {
-        // Conversion required to write
-        ComPtr<IWICBitmap> source;
-        hr = pWIC->CreateBitmapFromMemory(desc.Width, desc.Height,
-            pfGuid,
-            mapped.RowPitch, static_cast<UINT>(imageSize),
-            static_cast<BYTE*>(mapped.pData), source.GetAddressOf());
-        if (FAILED(hr))
+            WICRect rect = { 0, 0, static_cast<INT>(desc.Width), static_cast<INT>(desc.Height) };
+            hr = frame->WriteSource(FC.Get(), &rect);
+        }
+        else
         {
-            pContext->Unmap(pStaging.Get(), 0);
-            return hr;
+            // No conversion required
+            hr = frame->WritePixels(desc.Height,
+                static_cast<UINT>(rowPitch), static_cast<UINT>(imageSize),
+                const_cast<BYTE*>(pixels));
         }
 
-        ComPtr<IWICFormatConverter> FC;
-        hr = pWIC->CreateFormatConverter(FC.GetAddressOf());
         if (FAILED(hr))
-        {
-            pContext->Unmap(pStaging.Get(), 0);
             return hr;
-        }
 
-        BOOL canConvert = FALSE;
-        hr = FC->CanConvert(pfGuid, targetGuid, &canConvert);
-        if (FAILED(hr) || !canConvert)
-        {
-            pContext->Unmap(pStaging.Get(), 0);
-            return E_UNEXPECTED;
-        }
+        hr = frame->Commit();
+        if (FAILED(hr))
+            return hr;
 
-        hr = FC->Initialize(source.Get(), targetGuid, WICBitmapDitherTypeNone, nullptr, 0, WICBitmapPaletteTypeMedianCut);
+        hr = encoder->Commit();
         if (FAILED(hr))
-        {
-            pContext->Unmap(pStaging.Get(), 0);
             return hr;
-        }
 
-        WICRect rect = { 0, 0, static_cast<INT>(desc.Width), static_cast<INT>(desc.Height) };
-        hr = frame->WriteSource(FC.Get(), &rect);
-    }
-    else
-    {
-        // No conversion required
-        hr = frame->WritePixels(desc.Height,
-            mapped.RowPitch, static_cast<UINT>(imageSize),
-            static_cast<BYTE*>(mapped.pData));
+        delonfail.clear();
+
+        return S_OK;
     }
+} // anonymous namespace
 
-    pContext->Unmap(pStaging.Get(), 0);
 
-    if (FAILED(hr))
-        return hr;
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::SaveDDSTextureToFile(
+    ID3D11DeviceContext* pContext,
+    ID3D11Resource* pSource,
+    const wchar_t* fileName) noexcept
+{
+    if (!fileName)
+        return E_INVALIDARG;
 
-    hr = frame->Commit();
+    D3D11_TEXTURE2D_DESC desc = {};
+    ComPtr<ID3D11Texture2D> pStaging;
+    HRESULT hr = CaptureTexture(pContext, pSource, desc, pStaging);
+    if (FAILED(hr))
+        return hr;
+
+    size_t rowPitch, slicePitch, rowCount;
+    hr = GetSurfaceInfo(desc.Width, desc.Height, desc.Format, &slicePitch, &rowPitch, &rowCount);
+    if (FAILED(hr))
+        return hr;
+
+    if (rowPitch > UINT32_MAX || slicePitch > UINT32_MAX)
+        return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+    // Setup pixels
+    std::unique_ptr<uint8_t[]> pixels(new (std::nothrow) uint8_t[slicePitch]);
+    if (!pixels)
+        return E_OUTOFMEMORY;
+
+    D3D11_MAPPED_SUBRESOURCE mapped;
+    hr = pContext->Map(pStaging.Get(), 0, D3D11_MAP_READ, 0, &mapped);
+    if (FAILED(hr))
+        return hr;
+
+    if (!mapped.pData)
+    {
+        pContext->Unmap(pStaging.Get(), 0);
+        return E_POINTER;
+    }
+
+    CopyMappedPixels(mapped, pixels.get(), rowPitch, rowCount);
+
+    pContext->Unmap(pStaging.Get(), 0);
+
+    return WriteDDSFile(fileName, desc, pixels.get());
+}
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::SaveDDSTextureArrayToFile(
+    ID3D11DeviceContext* pContext,
+    ID3D11Resource* pSource,
+    const wchar_t* fileName) noexcept
+{
+    if (!pContext || !pSource || !fileName)
+        return E_INVALIDARG;
+
+    D3D11_RESOURCE_DIMENSION resType = D3D11_RESOURCE_DIMENSION_UNKNOWN;
+    pSource->GetType(&resType);
+
+    if (resType != D3D11_RESOURCE_DIMENSION_TEXTURE2D)
+        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+    ComPtr<ID3D11Texture2D> pTexture;
+    HRESULT hr = pSource->QueryInterface(IID_ID3D11Texture2D, reinterpret_cast<void**>(pTexture.GetAddressOf()));
+    if (FAILED(hr))
+        return hr;
+
+    assert(pTexture);
+
+    D3D11_TEXTURE2D_DESC desc = {};
+    pTexture->GetDesc(&desc);
+
+    // Unlike CaptureTexture, each subresource in turn is copied into a staging texture of
+    // one level and one item, so the copy never takes more than the top level of one item.
+    // A staging source that can already be read is mapped as is.
+    const bool direct = (desc.Usage == D3D11_USAGE_STAGING)
+        && (desc.CPUAccessFlags & D3D11_CPU_ACCESS_READ)
+        && (desc.SampleDesc.Count == 1);
+
+    ComPtr<ID3D11Texture2D> pStaging;
+    ComPtr<ID3D11Texture2D> pResolve;
+    const DXGI_FORMAT resolveFormat = EnsureNotTypeless(desc.Format);
+    if (!direct)
+    {
+        ComPtr<ID3D11Device> d3dDevice;
+        pContext->GetDevice(d3dDevice.GetAddressOf());
+
+        D3D11_TEXTURE2D_DESC itemDesc = desc;
+        itemDesc.MipLevels = 1;
+        itemDesc.ArraySize = 1;
+        itemDesc.SampleDesc.Count = 1;
+        itemDesc.SampleDesc.Quality = 0;
+        itemDesc.MiscFlags = 0;
+
+        if (desc.SampleDesc.Count > 1)
+        {
+            // MSAA content must be resolved before being copied to a staging texture
+            UINT support = 0;
+            hr = d3dDevice->CheckFormatSupport(resolveFormat, &support);
+            if (FAILED(hr))
+                return hr;
+
+            if (!(support & D3D11_FORMAT_SUPPORT_MULTISAMPLE_RESOLVE))
+                return E_FAIL;
+
+            hr = d3dDevice->CreateTexture2D(&itemDesc, nullptr, pResolve.GetAddressOf());
+            if (FAILED(hr))
+                return hr;
+
+            assert(pResolve);
+        }
+
+        itemDesc.BindFlags = 0;
+        itemDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+        itemDesc.Usage = D3D11_USAGE_STAGING;
+
+        hr = d3dDevice->CreateTexture2D(&itemDesc, nullptr, pStaging.GetAddressOf());
+        if (FAILED(hr))
+            return hr;
+
+        assert(pStaging);
+    }
+
+    DDS_TEXTURE_DESC ddsDesc = {};
+    ddsDesc.dimension = DDS_DIMENSION_TEXTURE2D;
+    ddsDesc.format = desc.Format;
+    ddsDesc.width = desc.Width;
+    ddsDesc.height = desc.Height;
+    ddsDesc.depth = 1;
+    ddsDesc.mipLevels = desc.MipLevels;
+    ddsDesc.arraySize = desc.ArraySize;
+    ddsDesc.isCubeMap = (desc.MiscFlags & D3D11_RESOURCE_MISC_TEXTURECUBE) != 0;
+    ddsDesc.alphaMode = DDS_ALPHA_MODE_UNKNOWN;
+
+    DDSWriter writer;
+    hr = writer.Begin(fileName, ddsDesc);
+    if (FAILED(hr))
+        return hr;
+
+    // Subresources are copied and mapped one at a time, in file order
+    for (UINT item = 0; item < desc.ArraySize; ++item)
+    {
+        for (UINT level = 0; level < desc.MipLevels; ++level)
+        {
+            size_t rowCount;
+            hr = GetSurfaceInfo(std::max<UINT>(desc.Width >> level, 1), std::max<UINT>(desc.Height >> level, 1), desc.Format,
+                nullptr, nullptr, &rowCount);
+            if (FAILED(hr))
+                return hr;
+
+            const UINT index = D3D11CalcSubresource(level, item, desc.MipLevels);
+
+            ID3D11Texture2D* pRead = pTexture.Get();
+            UINT readIndex = index;
+            if (!direct)
+            {
+                // Smaller levels land in the top left corner of the staging texture
+                if (pResolve)
+                {
+                    pContext->ResolveSubresource(pResolve.Get(), 0, pSource, index, resolveFormat);
+                    pContext->CopySubresourceRegion(pStaging.Get(), 0, 0, 0, 0, pResolve.Get(), 0, nullptr);
+                }
+                else
+                {
+                    pContext->CopySubresourceRegion(pStaging.Get(), 0, 0, 0, 0, pSource, index, nullptr);
+                }
+
+                pRead = pStaging.Get();
+                readIndex = 0;
+            }
+
+            D3D11_MAPPED_SUBRESOURCE mapped;
+            hr = pContext->Map(pRead, readIndex, D3D11_MAP_READ, 0, &mapped);
+            if (FAILED(hr))
+                return hr;
+
+            if (!mapped.pData)
+            {
+                pContext->Unmap(pRead, readIndex);
+                return E_POINTER;
+            }
+
+            hr = writer.WriteSubresourceRows(index, static_cast<const uint8_t*>(mapped.pData), mapped.RowPitch, rowCount);
+
+            pContext->Unmap(pRead, readIndex);
+
+            if (FAILED(hr))
+                return hr;
+        }
+    }
+
+    return writer.End();
+}
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::SaveWICTextureToFile(
+    ID3D11DeviceContext* pContext,
+    ID3D11Resource* pSource,
+    REFGUID guidContainerFormat,
+    const wchar_t* fileName,
+    const GUID* targetFormat,
+    std::function<void(IPropertyBag2*)> setCustomProps,
+    bool forceSRGB)
+{
+    if (!fileName)
+        return E_INVALIDARG;
+
+    D3D11_TEXTURE2D_DESC desc = {};
+    ComPtr<ID3D11Texture2D> pStaging;
+    HRESULT hr = CaptureTexture(pContext, pSource, desc, pStaging);
+    if (FAILED(hr))
+        return hr;
+
+    D3D11_MAPPED_SUBRESOURCE mapped;
+    hr = pContext->Map(pStaging.Get(), 0, D3D11_MAP_READ, 0, &mapped);
+    if (FAILED(hr))
+        return hr;
+
+    if (!mapped.pData)
+    {
+        pContext->Unmap(pStaging.Get(), 0);
+        return E_POINTER;
+    }
+
+    hr = WriteWICFile(fileName, desc,
+        static_cast<const uint8_t*>(mapped.pData), mapped.RowPitch,
+        guidContainerFormat, targetFormat, setCustomProps, forceSRGB);
+
+    pContext->Unmap(pStaging.Get(), 0);
+
+    return hr;
+}
+
+
+//--------------------------------------------------------------------------------------
+// ScreenGrabQueue
+//--------------------------------------------------------------------------------------
+namespace
+{
+    // A capture moves through the states in order, then back to free
+    enum CaptureState : uint32_t
+    {
+        CAPTURE_FREE = 0,
+        CAPTURE_COPYING,        // waiting for the GPU to finish the copy to the staging texture
+        CAPTURE_MAPPED,         // mapped and waiting for the encoder
+        CAPTURE_DONE,           // written by the encoder, waiting to be unmapped
+    };
+
+    struct Capture
+    {
+        ComPtr<ID3D11Texture2D>             staging;
+        ComPtr<ID3D11Texture2D>             resolve;    // for MSAA sources
+        D3D11_TEXTURE2D_DESC                desc;       // of the staging texture
+        D3D11_MAPPED_SUBRESOURCE            mapped;
+        HRESULT                             result;     // of the Map
+        CaptureState                        state;
+
+        std::wstring                        fileName;
+        bool                                wic;
+        GUID                                containerFormat;
+        GUID                                targetFormat;
+        bool                                hasTargetFormat;
+        std::function<void(IPropertyBag2*)> setCustomProps;
+        bool                                forceSRGB;
+    };
+}
+
+class ScreenGrabQueue::Impl
+{
+public:
+    Impl() noexcept :
+        m_count(0),
+        m_next(0),
+        m_poll(0),
+        m_retire(0),
+        m_encode(0),
+        m_shutdown(false),
+        m_written(0),
+        m_failed(0),
+        m_dropped(0)
+    {
+    }
+
+    void Encoder();
+
+    HRESULT Queue(ID3D11Resource* pSource, size_t& index) noexcept;
+    void Poll(UINT mapFlags) noexcept;
+    void Retire() noexcept;
+
+    ComPtr<ID3D11Device>            m_device;
+    ComPtr<ID3D11DeviceContext>     m_context;
+    std::thread                     m_thread;
+
+    std::unique_ptr<Capture[]>      m_captures; // a ring, used in order
+    size_t                          m_count;
+    size_t                          m_next;     // the next to queue
+    size_t                          m_poll;     // the oldest copying
+    size_t                          m_retire;   // the oldest not free
+    size_t                          m_encode;   // the next for the encoder
+
+    std::mutex                      m_mutex;
+    std::condition_variable         m_work;
+    std::condition_variable         m_done;
+    bool                            m_shutdown;
+    uint64_t                        m_written;
+    uint64_t                        m_failed;
+    uint64_t                        m_dropped;
+};
+
+
+//--------------------------------------------------------------------------------------
+void ScreenGrabQueue::Impl::Encoder()
+{
+    // WIC is used from this thread
+    const HRESULT hrCOM = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+    // Reused to pack the rows of DDS captures whose mapped pitch is padded
+    std::unique_ptr<uint8_t[]> packed;
+    size_t packedSize = 0;
+
+    for (;;)
+    {
+        Capture* capture = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_work.wait(lock, [&] { return m_shutdown || m_captures[m_encode].state == CAPTURE_MAPPED; });
+
+            if (m_captures[m_encode].state != CAPTURE_MAPPED)
+                break;
+
+            capture = &m_captures[m_encode];
+            m_encode = (m_encode + 1) % m_count;
+        }
+
+        HRESULT hr = capture->result;
+        if (SUCCEEDED(hr) && FAILED(hrCOM) && capture->wic)
+        {
+            hr = hrCOM;
+        }
+
+        if (SUCCEEDED(hr))
+        {
+            const auto& desc = capture->desc;
+            auto pixels = static_cast<const uint8_t*>(capture->mapped.pData);
+
+            if (capture->wic)
+            {
+                hr = WriteWICFile(capture->fileName.c_str(), desc,
+                    pixels, capture->mapped.RowPitch,
+                    capture->containerFormat,
+                    capture->hasTargetFormat ? &capture->targetFormat : nullptr,
+                    capture->setCustomProps,
+                    capture->forceSRGB);
+            }
+            else
+            {
+                size_t rowPitch, slicePitch, rowCount;
+                hr = GetSurfaceInfo(desc.Width, desc.Height, desc.Format, &slicePitch, &rowPitch, &rowCount);
+                if (SUCCEEDED(hr) && rowPitch != capture->mapped.RowPitch)
+                {
+                    if (packedSize < slicePitch)
+                    {
+                        packed.reset(new (std::nothrow) uint8_t[slicePitch]);
+                        packedSize = packed ? slicePitch : 0;
+                    }
+
+                    if (packed)
+                    {
+                        CopyMappedPixels(capture->mapped, packed.get(), rowPitch, rowCount);
+                        pixels = packed.get();
+                    }
+                    else
+                    {
+                        hr = E_OUTOFMEMORY;
+                    }
+                }
+
+                if (SUCCEEDED(hr))
+                {
+                    hr = WriteDDSFile(capture->fileName.c_str(), desc, pixels);
+                }
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        capture->state = CAPTURE_DONE;
+        if (SUCCEEDED(hr))
+        {
+            ++m_written;
+        }
+        else
+        {
+            ++m_failed;
+        }
+        m_done.notify_all();
+    }
+
+    if (SUCCEEDED(hrCOM))
+    {
+        CoUninitialize();
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Copies the top level of pSource to the next staging texture in the ring, recreating
+// it when the source has changed
+HRESULT ScreenGrabQueue::Impl::Queue(ID3D11Resource* pSource, size_t& index) noexcept
+{
+    D3D11_RESOURCE_DIMENSION resType = D3D11_RESOURCE_DIMENSION_UNKNOWN;
+    pSource->GetType(&resType);
+
+    if (resType != D3D11_RESOURCE_DIMENSION_TEXTURE2D)
+        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+    ComPtr<ID3D11Texture2D> pTexture;
+    HRESULT hr = pSource->QueryInterface(IID_ID3D11Texture2D, reinterpret_cast<void**>(pTexture.GetAddressOf()));
+    if (FAILED(hr))
+        return hr;
+
+    D3D11_TEXTURE2D_DESC srcDesc = {};
+    pTexture->GetDesc(&srcDesc);
+
+    // Slots are freed in order, so if the next is busy the ring is full
+    Retire();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_captures[m_next].state != CAPTURE_FREE)
+        {
+            ++m_dropped;
+            return HRESULT_FROM_WIN32(ERROR_BUSY);
+        }
+    }
+
+    Capture& capture = m_captures[m_next];
+
+    D3D11_TEXTURE2D_DESC desc = {};
+    desc.Width = srcDesc.Width;
+    desc.Height = srcDesc.Height;
+    desc.MipLevels = 1;
+    desc.ArraySize = 1;
+    desc.Format = srcDesc.Format;
+    desc.SampleDesc.Count = 1;
+    desc.Usage = D3D11_USAGE_STAGING;
+    desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+
+    if (!capture.staging || memcmp(&capture.desc, &desc, sizeof(desc)) != 0)
+    {
+        capture.staging.Reset();
+        capture.resolve.Reset();
+
+        hr = m_device->CreateTexture2D(&desc, nullptr, capture.staging.GetAddressOf());
+        if (FAILED(hr))
+            return hr;
+
+        capture.desc = desc;
+    }
+
+    if (srcDesc.SampleDesc.Count > 1)
+    {
+        // MSAA content must be resolved before being copied to a staging texture
+        const DXGI_FORMAT fmt = EnsureNotTypeless(desc.Format);
+
+        if (!capture.resolve)
+        {
+            UINT support = 0;
+            hr = m_device->CheckFormatSupport(fmt, &support);
+            if (FAILED(hr))
+                return hr;
+
+            if (!(support & D3D11_FORMAT_SUPPORT_MULTISAMPLE_RESOLVE))
+                return E_FAIL;
+
+            D3D11_TEXTURE2D_DESC resolveDesc = desc;
+            resolveDesc.Usage = D3D11_USAGE_DEFAULT;
+            resolveDesc.CPUAccessFlags = 0;
+
+            hr = m_device->CreateTexture2D(&resolveDesc, nullptr, capture.resolve.GetAddressOf());
+            if (FAILED(hr))
+                return hr;
+        }
+
+        m_context->ResolveSubresource(capture.resolve.Get(), 0, pSource, 0, fmt);
+        m_context->CopySubresourceRegion(capture.staging.Get(), 0, 0, 0, 0, capture.resolve.Get(), 0, nullptr);
+    }
+    else
+    {
+        m_context->CopySubresourceRegion(capture.staging.Get(), 0, 0, 0, 0, pSource, 0, nullptr);
+    }
+
+    index = m_next;
+    return S_OK;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Maps the copies the GPU has finished, oldest first, and hands them to the encoder
+void ScreenGrabQueue::Impl::Poll(UINT mapFlags) noexcept
+{
+    for (;;)
+    {
+        Capture& capture = m_captures[m_poll];
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (capture.state != CAPTURE_COPYING)
+                return;
+        }
+
+        capture.result = m_context->Map(capture.staging.Get(), 0, D3D11_MAP_READ, mapFlags, &capture.mapped);
+        if (capture.result == DXGI_ERROR_WAS_STILL_DRAWING)
+            return;
+
+        if (SUCCEEDED(capture.result) && !capture.mapped.pData)
+        {
+            m_context->Unmap(capture.staging.Get(), 0);
+            capture.result = E_POINTER;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            capture.state = CAPTURE_MAPPED;
+        }
+        m_work.notify_one();
+
+        m_poll = (m_poll + 1) % m_count;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Unmaps and frees the captures the encoder has written, oldest first
+void ScreenGrabQueue::Impl::Retire() noexcept
+{
+    for (;;)
+    {
+        Capture& capture = m_captures[m_retire];
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (capture.state != CAPTURE_DONE)
+                return;
+        }
+
+        if (SUCCEEDED(capture.result))
+        {
+            m_context->Unmap(capture.staging.Get(), 0);
+        }
+
+        capture.mapped = {};
+        capture.setCustomProps = nullptr;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            capture.state = CAPTURE_FREE;
+        }
+
+        m_retire = (m_retire + 1) % m_count;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+ScreenGrabQueue::ScreenGrabQueue() noexcept
+{
+}
+
+ScreenGrabQueue::ScreenGrabQueue(ScreenGrabQueue&&) noexcept = default;
+
+ScreenGrabQueue& ScreenGrabQueue::operator= (ScreenGrabQueue&& moveFrom) noexcept
+{
+    if (this != &moveFrom)
+    {
+        // Joins the encoder thread and unmaps the captures of the queue being replaced
+        Shutdown();
+        pImpl = std::move(moveFrom.pImpl);
+    }
+    return *this;
+}
+
+ScreenGrabQueue::~ScreenGrabQueue()
+{
+    Shutdown();
+}
+
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT ScreenGrabQueue::Initialize(ID3D11DeviceContext* pContext, unsigned int maxCaptures) noexcept
+{
+    if (pImpl)
+        return E_UNEXPECTED;
+
+    if (!pContext || !maxCaptures)
+        return E_INVALIDARG;
+
+    // Map with D3D11_MAP_FLAG_DO_NOT_WAIT needs the immediate context
+    if (pContext->GetType() != D3D11_DEVICE_CONTEXT_IMMEDIATE)
+        return E_INVALIDARG;
+
+    std::unique_ptr<Impl> impl(new (std::nothrow) Impl);
+    if (!impl)
+        return E_OUTOFMEMORY;
+
+    impl->m_captures.reset(new (std::nothrow) Capture[maxCaptures]);
+    if (!impl->m_captures)
+        return E_OUTOFMEMORY;
+
+    impl->m_count = maxCaptures;
+    for (size_t i = 0; i < impl->m_count; ++i)
+    {
+        auto& capture = impl->m_captures[i];
+        capture.desc = {};
+        capture.mapped = {};
+        capture.result = S_OK;
+        capture.state = CAPTURE_FREE;
+        capture.wic = false;
+        capture.containerFormat = {};
+        capture.targetFormat = {};
+        capture.hasTargetFormat = false;
+        capture.forceSRGB = false;
+    }
+
+    impl->m_context = pContext;
+    pContext->GetDevice(impl->m_device.GetAddressOf());
+
+    pImpl = std::move(impl);
+
+    try
+    {
+        pImpl->m_thread = std::thread(&Impl::Encoder, pImpl.get());
+    }
+    catch (...)
+    {
+        pImpl.reset();
+        return E_FAIL;
+    }
+
+    return S_OK;
+}
+
+
+//--------------------------------------------------------------------------------------
+void ScreenGrabQueue::Shutdown() noexcept
+{
+    if (!pImpl)
+        return;
+
+    Flush();
+
+    {
+        std::lock_guard<std::mutex> lock(pImpl->m_mutex);
+        pImpl->m_shutdown = true;
+    }
+    pImpl->m_work.notify_one();
+
+    pImpl->m_thread.join();
+
+    pImpl.reset();
+}
+
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT ScreenGrabQueue::QueueDDSCapture(ID3D11Resource* pSource, const wchar_t* fileName) noexcept
+{
+    if (!pImpl)
+        return E_UNEXPECTED;
+
+    if (!pSource || !fileName)
+        return E_INVALIDARG;
+
+    size_t index = 0;
+    HRESULT hr = pImpl->Queue(pSource, index);
     if (FAILED(hr))
         return hr;
 
-    hr = encoder->Commit();
+    Capture& capture = pImpl->m_captures[index];
+    try
+    {
+        capture.fileName = fileName;
+    }
+    catch (...)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    capture.wic = false;
+    capture.hasTargetFormat = false;
+    capture.setCustomProps = nullptr;
+    capture.forceSRGB = false;
+
+    {
+        std::lock_guard<std::mutex> lock(pImpl->m_mutex);
+        capture.state = CAPTURE_COPYING;
+    }
+
+    pImpl->m_next = (index + 1) % pImpl->m_count;
+
+    return S_OK;
+}
+
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT ScreenGrabQueue::QueueWICCapture(
+    ID3D11Resource* pSource,
+    REFGUID guidContainerFormat,
+    const wchar_t* fileName,
+    const GUID* targetFormat,
+    std::function<void(IPropertyBag2*)> setCustomProps,
+    bool forceSRGB)
+{
+    if (!pImpl)
+        return E_UNEXPECTED;
+
+    if (!pSource || !fileName)
+        return E_INVALIDARG;
+
+    size_t index = 0;
+    HRESULT hr = pImpl->Queue(pSource, index);
     if (FAILED(hr))
         return hr;
 
-    delonfail.clear();
+    Capture& capture = pImpl->m_captures[index];
+    capture.fileName = fileName;
+    capture.wic = true;
+    capture.containerFormat = guidContainerFormat;
+    capture.hasTargetFormat = (targetFormat != nullptr);
+    if (targetFormat)
+    {
+        capture.targetFormat = *targetFormat;
+    }
+    capture.setCustomProps = std::move(setCustomProps);
+    capture.forceSRGB = forceSRGB;
+
+    {
+        std::lock_guard<std::mutex> lock(pImpl->m_mutex);
+        capture.state = CAPTURE_COPYING;
+    }
+
+    pImpl->m_next = (index + 1) % pImpl->m_count;
 
     return S_OK;
 }
+
+
+//--------------------------------------------------------------------------------------
+void ScreenGrabQueue::Update() noexcept
+{
+    if (!pImpl)
+        return;
+
+    pImpl->Retire();
+    pImpl->Poll(D3D11_MAP_FLAG_DO_NOT_WAIT);
+}
+
+
+//--------------------------------------------------------------------------------------
+void ScreenGrabQueue::Flush() noexcept
+{
+    if (!pImpl)
+        return;
+
+    pImpl->Poll(0);
+
+    {
+        std::unique_lock<std::mutex> lock(pImpl->m_mutex);
+        pImpl->m_done.wait(lock, [&]
+            {
+                for (size_t i = 0; i < pImpl->m_count; ++i)
+                {
+                    if (pImpl->m_captures[i].state == CAPTURE_MAPPED)
+                        return false;
+                }
+                return true;
+            });
+    }
+
+    pImpl->Retire();
+}
+
+
+//--------------------------------------------------------------------------------------
+uint64_t ScreenGrabQueue::GetWrittenCount() const noexcept
+{
+    if (!pImpl)
+        return 0;
+
+    std::lock_guard<std::mutex> lock(pImpl->m_mutex);
+    return pImpl->m_written;
+}
+
+uint64_t ScreenGrabQueue::GetFailedCount() const noexcept
+{
+    if (!pImpl)
+        return 0;
+
+    std::lock_guard<std::mutex> lock(pImpl->m_mutex);
+    return pImpl->m_failed;
+}
+
+uint64_t ScreenGrabQueue::GetDroppedCount() const noexcept
+{
+    if (!pImpl)
+        return 0;
+
+    std::lock_guard<std::mutex> lock(pImpl->m_mutex);
+    return pImpl->m_dropped;
+}
@@ -25,7 +25,9 @@
 #include <OCIdl.h>
 #endif
 
+#include <cstdint>
 #include <functional>
+#include <memory>
 
 
 namespace DirectX
@@ -35,6 +37,16 @@ namespace DirectX
         _In_ ID3D11Resource* pSource,
         _In_z_ const wchar_t* fileName) noexcept;
 
+    // Saves every mip level and array item of a 2D texture or cubemap, where
+    // SaveDDSTextureToFile saves only the first. Each subresource is copied, mapped and
+    // written in turn, so staging memory is that of the top level of one item, at the
+    // cost of waiting on the GPU once per subresource. The file always has the 'DX10'
+    // header extension.
+    HRESULT __cdecl SaveDDSTextureArrayToFile(
+        _In_ ID3D11DeviceContext* pContext,
+        _In_ ID3D11Resource* pSource,
+        _In_z_ const wchar_t* fileName) noexcept;
+
     HRESULT __cdecl SaveWICTextureToFile(
         _In_ ID3D11DeviceContext* pContext,
         _In_ ID3D11Resource* pSource,
@@ -43,4 +55,64 @@ namespace DirectX
         _In_opt_ const GUID* targetFormat = nullptr,
         _In_opt_ std::function<void __cdecl(IPropertyBag2*)> setCustomProps = nullptr,
         _In_ bool forceSRGB = false);
+
+    //----------------------------------------------------------------------------------
+    // Saves captures of 2D textures without stalling the render thread. Each capture
+    // copies the top level of the texture to one of a small ring of staging textures.
+    // Update, called once per frame, maps the staging textures whose copies the GPU has
+    // finished, and a background thread writes them to files straight from the mapped
+    // memory, as SaveDDSTextureToFile and SaveWICTextureToFile would. Call every method
+    // from the thread that uses the immediate context.
+    //----------------------------------------------------------------------------------
+    class ScreenGrabQueue
+    {
+    public:
+        ScreenGrabQueue() noexcept;
+
+        ScreenGrabQueue(ScreenGrabQueue&&) noexcept;
+        ScreenGrabQueue& operator= (ScreenGrabQueue&&) noexcept;
+
+        ScreenGrabQueue(ScreenGrabQueue const&) = delete;
+        ScreenGrabQueue& operator= (ScreenGrabQueue const&) = delete;
+
+        ~ScreenGrabQueue();
+
+        // pContext must be the immediate context. Up to maxCaptures captures are in flight
+        // at once, each holding a staging texture the size of its source.
+        HRESULT __cdecl Initialize(
+            _In_ ID3D11DeviceContext* pContext,
+            _In_ unsigned int maxCaptures = 4) noexcept;
+
+        // Waits for the captures in flight to be written, as Flush does
+        void __cdecl Shutdown() noexcept;
+
+        // When every staging texture is in flight the capture is dropped and these return
+        // HRESULT_FROM_WIN32(ERROR_BUSY). Failures to write the file are only counted.
+        HRESULT __cdecl QueueDDSCapture(
+            _In_ ID3D11Resource* pSource,
+            _In_z_ const wchar_t* fileName) noexcept;
+
+        HRESULT __cdecl QueueWICCapture(
+            _In_ ID3D11Resource* pSource,
+            _In_ REFGUID guidContainerFormat,
+            _In_z_ const wchar_t* fileName,
+            _In_opt_ const GUID* targetFormat = nullptr,
+            _In_opt_ std::function<void __cdecl(IPropertyBag2*)> setCustomProps = nullptr,
+            _In_ bool forceSRGB = false);
+
+        // Never waits for the GPU or the background thread
+        void __cdecl Update() noexcept;
+
+        // Waits for the GPU and the background thread to finish every capture queued so far
+        void __cdecl Flush() noexcept;
+
+        uint64_t __cdecl GetWrittenCount() const noexcept;
+        uint64_t __cdecl GetFailedCount() const noexcept;
+        uint64_t __cdecl GetDroppedCount() const noexcept;
+
+    private:
+        class Impl;
+
+        std::unique_ptr<Impl> pImpl;
+    };
 }
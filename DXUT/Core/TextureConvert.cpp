@@ -0,0 +1,1252 @@
+//--------------------------------------------------------------------------------------
+// File: TextureConvert.cpp
+//
+// Functions for converting pixels between DXGI formats and resizing them on the CPU,
+// without WIC or a Direct3D device
+//
+// For a full-featured texture processing pipeline see the 'Texconv' sample and the
+// 'DirectXTex' library.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248926
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <wsl/winadapter.h>
+#endif
+
+#include "TextureConvert.h"
+
+#include <DirectXMath.h>
+#include <DirectXPackedVector.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#ifdef __clang__
+#pragma clang diagnostic ignored "-Wcovered-switch-default"
+#pragma clang diagnostic ignored "-Wswitch-enum"
+#endif
+
+#ifndef ERROR_NOT_SUPPORTED
+#define ERROR_NOT_SUPPORTED 50L
+#endif
+
+#ifndef ERROR_ARITHMETIC_OVERFLOW
+#define ERROR_ARITHMETIC_OVERFLOW 534L
+#endif
+
+#ifndef _WIN32
+#include <cstdlib>
+#define _aligned_malloc(size, alignment) aligned_alloc(alignment, size)
+#define _aligned_free free
+#endif
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+namespace
+{
+    //--------------------------------------------------------------------------------------
+    // Scratch rows are read and written as XMVECTOR, which needs 16-byte alignment that
+    // operator new does not give before C++17 on 32-bit Windows
+    //--------------------------------------------------------------------------------------
+    struct aligned_deleter { void operator()(void* p) noexcept { _aligned_free(p); } };
+
+    using ScopedAlignedArrayXMVECTOR = std::unique_ptr<XMVECTOR[], aligned_deleter>;
+
+    ScopedAlignedArrayXMVECTOR make_AlignedArrayXMVECTOR(size_t count) noexcept
+    {
+        if (count > (SIZE_MAX / sizeof(XMVECTOR)))
+            return nullptr;
+
+        return ScopedAlignedArrayXMVECTOR(static_cast<XMVECTOR*>(_aligned_malloc(sizeof(XMVECTOR) * count, 16)));
+    }
+
+    //--------------------------------------------------------------------------------------
+    size_t BytesPerPixel(DXGI_FORMAT fmt) noexcept
+    {
+        switch (fmt)
+        {
+        case DXGI_FORMAT_R32G32B32A32_FLOAT:
+            return 16;
+
+        case DXGI_FORMAT_R32G32B32_FLOAT:
+            return 12;
+
+        case DXGI_FORMAT_R16G16B16A16_FLOAT:
+        case DXGI_FORMAT_R16G16B16A16_UNORM:
+            return 8;
+
+        case DXGI_FORMAT_R10G10B10A2_UNORM:
+        case DXGI_FORMAT_R8G8B8A8_UNORM:
+        case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+        case DXGI_FORMAT_B8G8R8A8_UNORM:
+        case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+        case DXGI_FORMAT_B8G8R8X8_UNORM:
+        case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+        case DXGI_FORMAT_R32_FLOAT:
+            return 4;
+
+        case DXGI_FORMAT_B5G6R5_UNORM:
+        case DXGI_FORMAT_B5G5R5A1_UNORM:
+        case DXGI_FORMAT_R16_FLOAT:
+        case DXGI_FORMAT_R16_UNORM:
+            return 2;
+
+        case DXGI_FORMAT_R8_UNORM:
+        case DXGI_FORMAT_A8_UNORM:
+            return 1;
+
+        default:
+            return 0;
+        }
+    }
+
+    //--------------------------------------------------------------------------------------
+    bool IsSRGB(DXGI_FORMAT fmt) noexcept
+    {
+        switch (fmt)
+        {
+        case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+        case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+        case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+            return true;
+
+        default:
+            return false;
+        }
+    }
+
+    //--------------------------------------------------------------------------------------
+    // sRGB transfer tables for 8-bit channels. Encoding looks up the linear value quantized
+    // to 14 bits, which is finer than an 8-bit step everywhere on the curve.
+    //--------------------------------------------------------------------------------------
+    constexpr size_t c_EncodeTableSize = 16384;
+
+    struct SRGBTables
+    {
+        float decode[256];
+        uint8_t encode[c_EncodeTableSize];
+
+        SRGBTables() noexcept
+        {
+            for (size_t i = 0; i < 256; ++i)
+            {
+                const float c = float(i) / 255.f;
+                decode[i] = (c <= 0.04045f) ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+            }
+
+            for (size_t i = 0; i < c_EncodeTableSize; ++i)
+            {
+                const float l = (float(i) + 0.5f) / float(c_EncodeTableSize);
+                const float c = (l <= 0.0031308f) ? l * 12.92f : 1.055f * std::pow(l, 1.f / 2.4f) - 0.055f;
+                encode[i] = static_cast<uint8_t>(std::min(c * 255.f + 0.5f, 255.f));
+            }
+        }
+    };
+
+    const SRGBTables& GetSRGBTables() noexcept
+    {
+        static const SRGBTables s_tables;
+        return s_tables;
+    }
+
+    inline uint8_t EncodeSRGB(const SRGBTables& tables, float l) noexcept
+    {
+        const float i = std::min(std::max(l, 0.f), 1.f) * float(c_EncodeTableSize);
+        return tables.encode[std::min(static_cast<size_t>(i), c_EncodeTableSize - 1)];
+    }
+
+    //--------------------------------------------------------------------------------------
+    // Reads a row of pixels as RGBA, linear for _SRGB formats
+    //--------------------------------------------------------------------------------------
+    void LoadScanline(
+        _Out_writes_(width) XMVECTOR* out,
+        _In_reads_bytes_(width * BytesPerPixel(fmt)) const uint8_t* src,
+        size_t width,
+        DXGI_FORMAT fmt) noexcept
+    {
+        switch (fmt)
+        {
+        case DXGI_FORMAT_R32G32B32A32_FLOAT:
+            {
+                auto sPtr = reinterpret_cast<const XMFLOAT4*>(src);
+                for (size_t x = 0; x < width; ++x)
+                    out[x] = XMLoadFloat4(sPtr++);
+            }
+            break;
+
+        case DXGI_FORMAT_R32G32B32_FLOAT:
+            {
+                auto sPtr = reinterpret_cast<const XMFLOAT3*>(src);
+                for (size_t x = 0; x < width; ++x)
+                    out[x] = XMVectorSelect(g_XMIdentityR3, XMLoadFloat3(sPtr++), g_XMSelect1110);
+            }
+            break;
+
+        case DXGI_FORMAT_R16G16B16A16_FLOAT:
+            {
+                auto sPtr = reinterpret_cast<const XMHALF4*>(src);
+                for (size_t x = 0; x < width; ++x)
+                    out[x] = XMLoadHalf4(sPtr++);
+            }
+            break;
+
+        case DXGI_FORMAT_R16G16B16A16_UNORM:
+            {
+                auto sPtr = reinterpret_cast<const XMUSHORTN4*>(src);
+                for (size_t x = 0; x < width; ++x)
+                    out[x] = XMLoadUShortN4(sPtr++);
+            }
+            break;
+
+        case DXGI_FORMAT_R10G10B10A2_UNORM:
+            {
+                auto sPtr = reinterpret_cast<const XMUDECN4*>(src);
+                for (size_t x = 0; x < width; ++x)
+                    out[x] = XMLoadUDecN4(sPtr++);
+            }
+            break;
+
+        case DXGI_FORMAT_R8G8B8A8_UNORM:
+            {
+                auto sPtr = reinterpret_cast<const XMUBYTEN4*>(src);
+                for (size_t x = 0; x < width; ++x)
+                    out[x] = XMLoadUByteN4(sPtr++);
+            }
+            break;
+
+        case DXGI_FORMAT_B8G8R8A8_UNORM:
+            {
+                auto sPtr = reinterpret_cast<const XMCOLOR*>(src);
+                for (size_t x = 0; x < width; ++x)
+                    out[x] = XMLoadColor(sPtr++);
+            }
+            break;
+
+        case DXGI_FORMAT_B8G8R8X8_UNORM:
+            {
+                auto sPtr = reinterpret_cast<const XMCOLOR*>(src);
+                for (size_t x = 0; x < width; ++x)
+                    out[x] = XMVectorSelect(g_XMIdentityR3, XMLoadColor(sPtr++), g_XMSelect1110);
+            }
+            break;
+
+        case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+        case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+        case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+            {
+                auto& tables = GetSRGBTables();
+                const bool bgr = (fmt != DXGI_FORMAT_R8G8B8A8_UNORM_SRGB);
+                const bool opaque = (fmt == DXGI_FORMAT_B8G8R8X8_UNORM_SRGB);
+                const uint8_t* sPtr = src;
+                for (size_t x = 0; x < width; ++x, sPtr += 4)
+                {
+                    const float r = tables.decode[sPtr[bgr ? 2 : 0]];
+                    const float g = tables.decode[sPtr[1]];
+                    const float b = tables.decode[sPtr[bgr ? 0 : 2]];
+                    out[x] = XMVectorSet(r, g, b, opaque ? 1.f : float(sPtr[3]) * (1.f / 255.f));
+                }
+            }
+            break;
+
+        case DXGI_FORMAT_B5G6R5_UNORM:
+            {
+                auto sPtr = reinterpret_cast<const XMU565*>(src);
+                for (size_t x = 0; x < width; ++x)
+                {
+                    const XMVECTOR v = XMVectorSwizzle<2, 1, 0, 3>(XMLoadU565(sPtr++));
+                    out[x] = XMVectorSelect(g_XMIdentityR3, v, g_XMSelect1110);
+                }
+            }
+            break;
+
+        case DXGI_FORMAT_B5G5R5A1_UNORM:
+            {
+                auto sPtr = reinterpret_cast<const XMU555*>(src);
+                for (size_t x = 0; x < width; ++x)
+                    out[x] = XMVectorSwizzle<2, 1, 0, 3>(XMLoadU555(sPtr++));
+            }
+            break;
+
+        case DXGI_FORMAT_R32_FLOAT:
+            {
+                auto sPtr = reinterpret_cast<const float*>(src);
+                for (size_t x = 0; x < width; ++x)
+                    out[x] = XMVectorSet(*sPtr++, 0.f, 0.f, 1.f);
+            }
+            break;
+
+        case DXGI_FORMAT_R16_FLOAT:
+            {
+                auto sPtr = reinterpret_cast<const HALF*>(src);
+                for (size_t x = 0; x < width; ++x)
+                    out[x] = XMVectorSet(XMConvertHalfToFloat(*sPtr++), 0.f, 0.f, 1.f);
+            }
+            break;
+
+        case DXGI_FORMAT_R16_UNORM:
+            {
+                auto sPtr = reinterpret_cast<const uint16_t*>(src);
+                for (size_t x = 0; x < width; ++x)
+                    out[x] = XMVectorSet(float(*sPtr++) * (1.f / 65535.f), 0.f, 0.f, 1.f);
+            }
+            break;
+
+        case DXGI_FORMAT_R8_UNORM:
+            for (size_t x = 0; x < width; ++x)
+                out[x] = XMVectorSet(float(src[x]) * (1.f / 255.f), 0.f, 0.f, 1.f);
+            break;
+
+        case DXGI_FORMAT_A8_UNORM:
+            for (size_t x = 0; x < width; ++x)
+                out[x] = XMVectorSet(0.f, 0.f, 0.f, float(src[x]) * (1.f / 255.f));
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    //--------------------------------------------------------------------------------------
+    // Writes a row of RGBA pixels, encoding _SRGB formats. The packed stores saturate.
+    //--------------------------------------------------------------------------------------
+    void StoreScanline(
+        _Out_writes_bytes_(width * BytesPerPixel(fmt)) uint8_t* dst,
+        _In_reads_(width) const XMVECTOR* in,
+        size_t width,
+        DXGI_FORMAT fmt) noexcept
+    {
+        switch (fmt)
+        {
+        case DXGI_FORMAT_R32G32B32A32_FLOAT:
+            {
+                auto dPtr = reinterpret_cast<XMFLOAT4*>(dst);
+                for (size_t x = 0; x < width; ++x)
+                    XMStoreFloat4(dPtr++, in[x]);
+            }
+            break;
+
+        case DXGI_FORMAT_R32G32B32_FLOAT:
+            {
+                auto dPtr = reinterpret_cast<XMFLOAT3*>(dst);
+                for (size_t x = 0; x < width; ++x)
+                    XMStoreFloat3(dPtr++, in[x]);
+            }
+            break;
+
+        case DXGI_FORMAT_R16G16B16A16_FLOAT:
+            {
+                auto dPtr = reinterpret_cast<XMHALF4*>(dst);
+                for (size_t x = 0; x < width; ++x)
+                    XMStoreHalf4(dPtr++, in[x]);
+            }
+            break;
+
+        case DXGI_FORMAT_R16G16B16A16_UNORM:
+            {
+                auto dPtr = reinterpret_cast<XMUSHORTN4*>(dst);
+                for (size_t x = 0; x < width; ++x)
+                    XMStoreUShortN4(dPtr++, in[x]);
+            }
+            break;
+
+        case DXGI_FORMAT_R10G10B10A2_UNORM:
+            {
+                auto dPtr = reinterpret_cast<XMUDECN4*>(dst);
+                for (size_t x = 0; x < width; ++x)
+                    XMStoreUDecN4(dPtr++, in[x]);
+            }
+            break;
+
+        case DXGI_FORMAT_R8G8B8A8_UNORM:
+            {
+                auto dPtr = reinterpret_cast<XMUBYTEN4*>(dst);
+                for (size_t x = 0; x < width; ++x)
+                    XMStoreUByteN4(dPtr++, in[x]);
+            }
+            break;
+
+        case DXGI_FORMAT_B8G8R8A8_UNORM:
+            {
+                auto dPtr = reinterpret_cast<XMCOLOR*>(dst);
+                for (size_t x = 0; x < width; ++x)
+                    XMStoreColor(dPtr++, in[x]);
+            }
+            break;
+
+        case DXGI_FORMAT_B8G8R8X8_UNORM:
+            {
+                auto dPtr = reinterpret_cast<XMCOLOR*>(dst);
+                for (size_t x = 0; x < width; ++x)
+                    XMStoreColor(dPtr++, XMVectorSelect(g_XMIdentityR3, in[x], g_XMSelect1110));
+            }
+            break;
+
+        case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+        case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+        case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+            {
+                auto& tables = GetSRGBTables();
+                const bool bgr = (fmt != DXGI_FORMAT_R8G8B8A8_UNORM_SRGB);
+                const bool opaque = (fmt == DXGI_FORMAT_B8G8R8X8_UNORM_SRGB);
+                uint8_t* dPtr = dst;
+                for (size_t x = 0; x < width; ++x, dPtr += 4)
+                {
+                    XMFLOAT4A c;
+                    XMStoreFloat4A(&c, XMVectorSaturate(in[x]));
+                    dPtr[bgr ? 2 : 0] = EncodeSRGB(tables, c.x);
+                    dPtr[1] = EncodeSRGB(tables, c.y);
+                    dPtr[bgr ? 0 : 2] = EncodeSRGB(tables, c.z);
+                    dPtr[3] = opaque ? 255 : static_cast<uint8_t>(c.w * 255.f + 0.5f);
+                }
+            }
+            break;
+
+        case DXGI_FORMAT_B5G6R5_UNORM:
+            {
+                auto dPtr = reinterpret_cast<XMU565*>(dst);
+                for (size_t x = 0; x < width; ++x)
+                    XMStoreU565(dPtr++, XMVectorSwizzle<2, 1, 0, 3>(in[x]));
+            }
+            break;
+
+        case DXGI_FORMAT_B5G5R5A1_UNORM:
+            {
+                auto dPtr = reinterpret_cast<XMU555*>(dst);
+                for (size_t x = 0; x < width; ++x)
+                    XMStoreU555(dPtr++, XMVectorSwizzle<2, 1, 0, 3>(in[x]));
+            }
+            break;
+
+        case DXGI_FORMAT_R32_FLOAT:
+            {
+                auto dPtr = reinterpret_cast<float*>(dst);
+                for (size_t x = 0; x < width; ++x)
+                    *dPtr++ = XMVectorGetX(in[x]);
+            }
+            break;
+
+        case DXGI_FORMAT_R16_FLOAT:
+            {
+                auto dPtr = reinterpret_cast<HALF*>(dst);
+                for (size_t x = 0; x < width; ++x)
+                    *dPtr++ = XMConvertFloatToHalf(XMVectorGetX(in[x]));
+            }
+            break;
+
+        case DXGI_FORMAT_R16_UNORM:
+            {
+                auto dPtr = reinterpret_cast<uint16_t*>(dst);
+                for (size_t x = 0; x < width; ++x)
+                {
+                    const float v = std::min(std::max(XMVectorGetX(in[x]), 0.f), 1.f);
+                    *dPtr++ = static_cast<uint16_t>(v * 65535.f + 0.5f);
+                }
+            }
+            break;
+
+        case DXGI_FORMAT_R8_UNORM:
+            for (size_t x = 0; x < width; ++x)
+            {
+                const float v = std::min(std::max(XMVectorGetX(in[x]), 0.f), 1.f);
+                dst[x] = static_cast<uint8_t>(v * 255.f + 0.5f);
+            }
+            break;
+
+        case DXGI_FORMAT_A8_UNORM:
+            for (size_t x = 0; x < width; ++x)
+            {
+                const float v = std::min(std::max(XMVectorGetW(in[x]), 0.f), 1.f);
+                dst[x] = static_cast<uint8_t>(v * 255.f + 0.5f);
+            }
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    //--------------------------------------------------------------------------------------
+    // The 8-bit four channel formats convert among themselves without going through float
+    // when neither side needs its gamma changed: only red and blue swap, and X forces alpha.
+    //--------------------------------------------------------------------------------------
+    bool IsByteSwizzle(DXGI_FORMAT srcFormat, DXGI_FORMAT dstFormat, bool& swapRB, bool& opaque) noexcept
+    {
+        auto classify = [](DXGI_FORMAT fmt, bool& bgr, bool& x) noexcept -> bool
+        {
+            switch (fmt)
+            {
+            case DXGI_FORMAT_R8G8B8A8_UNORM:
+            case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+                bgr = false; x = false; return true;
+
+            case DXGI_FORMAT_B8G8R8A8_UNORM:
+            case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+                bgr = true; x = false; return true;
+
+            case DXGI_FORMAT_B8G8R8X8_UNORM:
+            case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+                bgr = true; x = true; return true;
+
+            default:
+                return false;
+            }
+        };
+
+        bool srcBGR, srcX, dstBGR, dstX;
+        if (!classify(srcFormat, srcBGR, srcX) || !classify(dstFormat, dstBGR, dstX))
+            return false;
+
+        if (IsSRGB(srcFormat) != IsSRGB(dstFormat))
+            return false;
+
+        swapRB = (srcBGR != dstBGR);
+        opaque = srcX || dstX;
+        return true;
+    }
+
+    void ByteSwizzle(
+        _Out_writes_(width) uint32_t* dst,
+        _In_reads_(width) const uint32_t* src,
+        size_t width,
+        bool swapRB,
+        bool opaque) noexcept
+    {
+        const uint32_t alpha = opaque ? 0xFF000000 : 0;
+
+        // Plain loops over 32-bit words, which the compiler vectorizes
+        if (swapRB)
+        {
+            for (size_t x = 0; x < width; ++x)
+            {
+                const uint32_t t = src[x];
+                dst[x] = (t & 0xFF00FF00) | ((t >> 16) & 0xFF) | ((t & 0xFF) << 16) | alpha;
+            }
+        }
+        else
+        {
+            for (size_t x = 0; x < width; ++x)
+            {
+                dst[x] = src[x] | alpha;
+            }
+        }
+    }
+
+    //--------------------------------------------------------------------------------------
+    // Resampling weights of one axis: destination pixel i takes count[i] source pixels
+    // starting at taps[first[i]]
+    //--------------------------------------------------------------------------------------
+    struct FilterTap
+    {
+        uint32_t index;
+        float weight;
+    };
+
+    struct Filter
+    {
+        std::vector<FilterTap> taps;
+        std::vector<uint32_t> first;
+        std::vector<uint32_t> count;
+    };
+
+    void CreateFilter(size_t srcSize, size_t dstSize, Filter& filter)
+    {
+        filter.taps.clear();
+        filter.first.resize(dstSize);
+        filter.count.resize(dstSize);
+
+        const double scale = double(srcSize) / double(dstSize);
+
+        if (srcSize > dstSize)
+        {
+            // Box covering the source area of the destination pixel, weighted by overlap
+            filter.taps.reserve(dstSize * (size_t(std::ceil(scale)) + 1));
+
+            for (size_t i = 0; i < dstSize; ++i)
+            {
+                const double x0 = double(i) * scale;
+                const double x1 = std::min(double(i + 1) * scale, double(srcSize));
+
+                filter.first[i] = static_cast<uint32_t>(filter.taps.size());
+
+                const size_t s1 = std::min(static_cast<size_t>(std::ceil(x1)), srcSize);
+                for (size_t s = static_cast<size_t>(x0); s < s1; ++s)
+                {
+                    const double overlap = std::min(double(s + 1), x1) - std::max(double(s), x0);
+                    if (overlap > 0.0)
+                    {
+                        filter.taps.push_back(FilterTap{ static_cast<uint32_t>(s), static_cast<float>(overlap / scale) });
+                    }
+                }
+
+                filter.count[i] = static_cast<uint32_t>(filter.taps.size()) - filter.first[i];
+            }
+        }
+        else
+        {
+            // Linear interpolation between the two nearest source pixel centers
+            filter.taps.reserve(dstSize * 2);
+
+            for (size_t i = 0; i < dstSize; ++i)
+            {
+                const double pos = std::max((double(i) + 0.5) * scale - 0.5, 0.0);
+                const size_t s0 = std::min(static_cast<size_t>(pos), srcSize - 1);
+                const size_t s1 = std::min(s0 + 1, srcSize - 1);
+                const auto t = static_cast<float>(pos - double(s0));
+
+                filter.first[i] = static_cast<uint32_t>(filter.taps.size());
+                if (s1 == s0 || t <= 0.f)
+                {
+                    filter.taps.push_back(FilterTap{ static_cast<uint32_t>(s0), 1.f });
+                }
+                else
+                {
+                    filter.taps.push_back(FilterTap{ static_cast<uint32_t>(s0), 1.f - t });
+                    filter.taps.push_back(FilterTap{ static_cast<uint32_t>(s1), t });
+                }
+
+                filter.count[i] = static_cast<uint32_t>(filter.taps.size()) - filter.first[i];
+            }
+        }
+    }
+
+    void ApplyFilter(
+        _Out_writes_(dstSize) XMVECTOR* out,
+        _In_ const XMVECTOR* in,
+        const Filter& filter,
+        size_t dstSize) noexcept
+    {
+        for (size_t i = 0; i < dstSize; ++i)
+        {
+            const FilterTap* tap = filter.taps.data() + filter.first[i];
+            XMVECTOR sum = XMVectorZero();
+            for (uint32_t k = 0; k < filter.count[i]; ++k, ++tap)
+            {
+                sum = XMVectorMultiplyAdd(in[tap->index], XMVectorReplicate(tap->weight), sum);
+            }
+            out[i] = sum;
+        }
+    }
+
+    //--------------------------------------------------------------------------------------
+    // Windowed sinc reduction over three destination pixels each side. The Kaiser window
+    // (alpha 4) keeps ringing low while staying sharper than the box.
+    //--------------------------------------------------------------------------------------
+    double BesselI0(double x) noexcept
+    {
+        const double q = x * x * 0.25;
+        double sum = 1.0;
+        double term = 1.0;
+        for (int k = 1; k < 32 && term > sum * 1e-9; ++k)
+        {
+            term *= q / double(k * k);
+            sum += term;
+        }
+        return sum;
+    }
+
+    void CreateKaiserFilter(size_t srcSize, size_t dstSize, Filter& filter)
+    {
+        if (srcSize <= dstSize)
+        {
+            CreateFilter(srcSize, dstSize, filter);
+            return;
+        }
+
+        constexpr double c_Width = 3.0;
+        constexpr double c_Alpha = 4.0;
+        constexpr double c_Pi = 3.14159265358979323846;
+
+        const double scale = double(srcSize) / double(dstSize);
+        const double radius = c_Width * scale;
+        const double norm = 1.0 / BesselI0(c_Alpha);
+
+        filter.taps.clear();
+        filter.taps.reserve(dstSize * (size_t(std::ceil(radius * 2.0)) + 1));
+        filter.first.resize(dstSize);
+        filter.count.resize(dstSize);
+
+        for (size_t i = 0; i < dstSize; ++i)
+        {
+            const double center = (double(i) + 0.5) * scale;
+            const auto s0 = static_cast<ptrdiff_t>(std::floor(center - radius));
+            const auto s1 = static_cast<ptrdiff_t>(std::ceil(center + radius));
+
+            const size_t first = filter.taps.size();
+            double total = 0.0;
+            for (ptrdiff_t s = s0; s < s1; ++s)
+            {
+                const double t = (double(s) + 0.5 - center) / scale;
+                const double u = t / c_Width;
+                if (u <= -1.0 || u >= 1.0)
+                    continue;
+
+                const double sinc = (t == 0.0) ? 1.0 : std::sin(c_Pi * t) / (c_Pi * t);
+                const double w = sinc * BesselI0(c_Alpha * std::sqrt(1.0 - u * u)) * norm;
+                total += w;
+
+                // Taps past the edges repeat the edge pixel
+                const auto index = static_cast<uint32_t>(std::min<ptrdiff_t>(std::max<ptrdiff_t>(s, 0), ptrdiff_t(srcSize) - 1));
+                if (filter.taps.size() > first && filter.taps.back().index == index)
+                {
+                    filter.taps.back().weight += static_cast<float>(w);
+                }
+                else
+                {
+                    filter.taps.push_back(FilterTap{ index, static_cast<float>(w) });
+                }
+            }
+
+            for (size_t k = first; k < filter.taps.size(); ++k)
+            {
+                filter.taps[k].weight = static_cast<float>(double(filter.taps[k].weight) / total);
+            }
+
+            filter.first[i] = static_cast<uint32_t>(first);
+            filter.count[i] = static_cast<uint32_t>(filter.taps.size() - first);
+        }
+    }
+
+    //--------------------------------------------------------------------------------------
+    // Filters destination rows [y0, y1) of a resize, so bands of rows can run on separate
+    // threads
+    //--------------------------------------------------------------------------------------
+    HRESULT ResizeRows(
+        _In_ const uint8_t* src, size_t srcRowPitch, DXGI_FORMAT srcFormat, size_t srcWidth,
+        _In_ uint8_t* dst, size_t dstRowPitch, DXGI_FORMAT dstFormat, size_t dstWidth,
+        const Filter& horz,
+        const Filter& vert,
+        size_t y0,
+        size_t y1) noexcept
+    {
+        // The source rows of a destination row are consecutive and move forward from one
+        // destination row to the next, so a ring of as many horizontally filtered rows as the
+        // widest vertical filter means no source row is filtered twice
+        size_t slots = 1;
+        for (size_t y = y0; y < y1; ++y)
+        {
+            slots = std::max<size_t>(slots, vert.count[y]);
+        }
+
+        // One source row, the ring of filtered rows and the vertical sum
+        auto scratch = make_AlignedArrayXMVECTOR(srcWidth + dstWidth * (slots + 1));
+        std::unique_ptr<size_t[]> rowIndex(new (std::nothrow) size_t[slots]);
+        if (!scratch || !rowIndex)
+            return E_OUTOFMEMORY;
+
+        XMVECTOR* srcRow = scratch.get();
+        XMVECTOR* rows = srcRow + srcWidth;
+        XMVECTOR* sum = rows + dstWidth * slots;
+        std::fill_n(rowIndex.get(), slots, SIZE_MAX);
+
+        const bool sameWidth = (srcWidth == dstWidth);
+
+        auto filteredRow = [&](size_t y) noexcept -> const XMVECTOR*
+        {
+            const size_t slot = y % slots;
+            XMVECTOR* row = rows + slot * dstWidth;
+            if (rowIndex[slot] != y)
+            {
+                if (sameWidth)
+                {
+                    LoadScanline(row, src + y * srcRowPitch, srcWidth, srcFormat);
+                }
+                else
+                {
+                    LoadScanline(srcRow, src + y * srcRowPitch, srcWidth, srcFormat);
+                    ApplyFilter(row, srcRow, horz, dstWidth);
+                }
+                rowIndex[slot] = y;
+            }
+            return row;
+        };
+
+        for (size_t y = y0; y < y1; ++y)
+        {
+            const FilterTap* tap = vert.taps.data() + vert.first[y];
+            const uint32_t count = vert.count[y];
+
+            if (count == 1 && tap->weight == 1.f)
+            {
+                StoreScanline(dst + y * dstRowPitch, filteredRow(tap->index), dstWidth, dstFormat);
+                continue;
+            }
+
+            for (size_t x = 0; x < dstWidth; ++x)
+                sum[x] = XMVectorZero();
+
+            for (uint32_t k = 0; k < count; ++k, ++tap)
+            {
+                const XMVECTOR* row = filteredRow(tap->index);
+                const XMVECTOR weight = XMVectorReplicate(tap->weight);
+                for (size_t x = 0; x < dstWidth; ++x)
+                {
+                    sum[x] = XMVectorMultiplyAdd(row[x], weight, sum[x]);
+                }
+            }
+
+            StoreScanline(dst + y * dstRowPitch, sum, dstWidth, dstFormat);
+        }
+
+        return S_OK;
+    }
+
+    //--------------------------------------------------------------------------------------
+    HRESULT ResizeImage(
+        _In_ const uint8_t* src, size_t srcRowPitch, DXGI_FORMAT srcFormat, size_t srcWidth, size_t srcHeight,
+        _In_ uint8_t* dst, size_t dstRowPitch, DXGI_FORMAT dstFormat, size_t dstWidth, size_t dstHeight)
+    {
+        Filter horz;
+        Filter vert;
+        CreateFilter(srcWidth, dstWidth, horz);
+        CreateFilter(srcHeight, dstHeight, vert);
+
+        return ResizeRows(src, srcRowPitch, srcFormat, srcWidth,
+            dst, dstRowPitch, dstFormat, dstWidth,
+            horz, vert, 0, dstHeight);
+    }
+
+    //--------------------------------------------------------------------------------------
+    // Runs rowFunc over bands of [0, height) on up to numThreads threads, the calling one
+    // included. Bands are at least c_MinBandPixels, so small mip levels stay on one thread.
+    //--------------------------------------------------------------------------------------
+    constexpr size_t c_MinBandPixels = 64 * 1024;
+
+    template<typename RowFunc>
+    HRESULT ParallelRows(size_t width, size_t height, unsigned int numThreads, RowFunc rowFunc)
+    {
+        const size_t bands = std::min<size_t>({ numThreads, height, std::max<size_t>(1, (width * height) / c_MinBandPixels) });
+        if (bands <= 1)
+            return rowFunc(size_t(0), height);
+
+        std::vector<HRESULT> results(bands, S_OK);
+        std::vector<std::thread> threads;
+        threads.reserve(bands - 1);
+
+        for (size_t band = 1; band < bands; ++band)
+        {
+            const size_t y0 = height * band / bands;
+            const size_t y1 = height * (band + 1) / bands;
+            try
+            {
+                threads.emplace_back([&rowFunc, &results, band, y0, y1]() noexcept
+                    {
+                        results[band] = rowFunc(y0, y1);
+                    });
+            }
+            catch (const std::system_error&)
+            {
+                results[band] = rowFunc(y0, y1);
+            }
+        }
+
+        results[0] = rowFunc(size_t(0), height / bands);
+
+        for (auto& t : threads)
+        {
+            t.join();
+        }
+
+        for (const HRESULT hr : results)
+        {
+            if (FAILED(hr))
+                return hr;
+        }
+
+        return S_OK;
+    }
+
+    //--------------------------------------------------------------------------------------
+    // Alpha test coverage: the fraction of pixels with alpha above the reference
+    //--------------------------------------------------------------------------------------
+    bool HasAlpha(DXGI_FORMAT fmt) noexcept
+    {
+        switch (fmt)
+        {
+        case DXGI_FORMAT_R32G32B32A32_FLOAT:
+        case DXGI_FORMAT_R16G16B16A16_FLOAT:
+        case DXGI_FORMAT_R16G16B16A16_UNORM:
+        case DXGI_FORMAT_R10G10B10A2_UNORM:
+        case DXGI_FORMAT_R8G8B8A8_UNORM:
+        case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+        case DXGI_FORMAT_B8G8R8A8_UNORM:
+        case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+        case DXGI_FORMAT_B5G5R5A1_UNORM:
+        case DXGI_FORMAT_A8_UNORM:
+            return true;
+
+        default:
+            return false;
+        }
+    }
+
+    HRESULT GetAlphaCoverage(
+        _In_ const uint8_t* pixels, size_t rowPitch, DXGI_FORMAT fmt, size_t width, size_t height,
+        float alphaReference,
+        _Out_ float& coverage) noexcept
+    {
+        coverage = 0.f;
+
+        auto scanline = make_AlignedArrayXMVECTOR(width);
+        if (!scanline)
+            return E_OUTOFMEMORY;
+
+        size_t covered = 0;
+        for (size_t y = 0; y < height; ++y)
+        {
+            LoadScanline(scanline.get(), pixels + y * rowPitch, width, fmt);
+            for (size_t x = 0; x < width; ++x)
+            {
+                if (XMVectorGetW(scanline[x]) > alphaReference)
+                    ++covered;
+            }
+        }
+
+        coverage = float(double(covered) / double(width * height));
+        return S_OK;
+    }
+
+    //--------------------------------------------------------------------------------------
+    // Scales the alpha of a mip level so its coverage matches the top level. The scale puts
+    // the reference between the alpha values just inside and just outside the covered count,
+    // found from a histogram at 16-bit precision, which is exact for the unorm formats.
+    //--------------------------------------------------------------------------------------
+    void ScaleAlphaForCoverage(
+        _In_ uint8_t* pixels, size_t rowPitch, DXGI_FORMAT fmt, size_t width, size_t height,
+        float alphaReference,
+        float coverage)
+    {
+        constexpr size_t c_Bins = 65536;
+
+        std::vector<uint32_t> histogram(c_Bins, 0);
+
+        auto scanline = make_AlignedArrayXMVECTOR(width);
+        if (!scanline)
+            throw std::bad_alloc();
+
+        for (size_t y = 0; y < height; ++y)
+        {
+            LoadScanline(scanline.get(), pixels + y * rowPitch, width, fmt);
+            for (size_t x = 0; x < width; ++x)
+            {
+                const float a = std::min(std::max(XMVectorGetW(scanline[x]), 0.f), 1.f);
+                ++histogram[static_cast<size_t>(a * float(c_Bins - 1) + 0.5f)];
+            }
+        }
+
+        // The covered pixels are the 'covered' largest alpha values
+        const size_t count = width * height;
+        const auto covered = std::min(static_cast<size_t>(double(coverage) * double(count) + 0.5), count);
+
+        // Walking down from the largest alpha, the bin that reaches the covered count is kept
+        // or left out, whichever lands nearer to it
+        size_t inside = c_Bins;
+        size_t outside = 0;
+        size_t total = 0;
+        bool reached = false;
+        for (size_t bin = c_Bins; bin-- > 0; )
+        {
+            if (!histogram[bin])
+                continue;
+
+            const size_t next = total + histogram[bin];
+            if (reached || (next > covered && (next - covered) > (covered - total)))
+            {
+                outside = bin;
+                break;
+            }
+
+            total = next;
+            inside = bin;
+            reached = (total >= covered);
+        }
+
+        float threshold;
+        if (inside == c_Bins)
+        {
+            // Nothing is covered: the largest alpha goes to the reference
+            threshold = float(outside) / float(c_Bins - 1);
+        }
+        else
+        {
+            threshold = (float(inside) + float(outside)) * 0.5f / float(c_Bins - 1);
+        }
+
+        const float scale = alphaReference / std::max(threshold, 1.f / 1024.f);
+        if (std::fabs(scale - 1.f) < 1e-4f)
+            return;
+
+        const XMVECTOR mul = XMVectorSet(1.f, 1.f, 1.f, scale);
+        for (size_t y = 0; y < height; ++y)
+        {
+            uint8_t* row = pixels + y * rowPitch;
+            LoadScanline(scanline.get(), row, width, fmt);
+            for (size_t x = 0; x < width; ++x)
+            {
+                scanline[x] = XMVectorMultiply(scanline[x], mul);
+            }
+            StoreScanline(row, scanline.get(), width, fmt);
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+bool DirectX::IsConvertFormatSupported(DXGI_FORMAT fmt) noexcept
+{
+    return BytesPerPixel(fmt) != 0;
+}
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::ConvertPixels(
+    const uint8_t* src,
+    size_t srcRowPitch,
+    DXGI_FORMAT srcFormat,
+    uint8_t* dst,
+    size_t dstRowPitch,
+    DXGI_FORMAT dstFormat,
+    size_t width,
+    size_t height) noexcept
+{
+    if (!src || !dst || !width || !height)
+        return E_INVALIDARG;
+
+    const size_t srcBpp = BytesPerPixel(srcFormat);
+    const size_t dstBpp = BytesPerPixel(dstFormat);
+    if (!srcBpp || !dstBpp)
+        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+    if (width > UINT32_MAX || height > UINT32_MAX)
+        return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+    if (srcRowPitch < width * srcBpp || dstRowPitch < width * dstBpp)
+        return E_INVALIDARG;
+
+    if (srcFormat == dstFormat)
+    {
+        for (size_t y = 0; y < height; ++y)
+        {
+            memcpy(dst + y * dstRowPitch, src + y * srcRowPitch, width * dstBpp);
+        }
+        return S_OK;
+    }
+
+    bool swapRB = false;
+    bool opaque = false;
+    if (IsByteSwizzle(srcFormat, dstFormat, swapRB, opaque))
+    {
+        for (size_t y = 0; y < height; ++y)
+        {
+            ByteSwizzle(reinterpret_cast<uint32_t*>(dst + y * dstRowPitch),
+                reinterpret_cast<const uint32_t*>(src + y * srcRowPitch),
+                width, swapRB, opaque);
+        }
+        return S_OK;
+    }
+
+    auto scanline = make_AlignedArrayXMVECTOR(width);
+    if (!scanline)
+        return E_OUTOFMEMORY;
+
+    for (size_t y = 0; y < height; ++y)
+    {
+        LoadScanline(scanline.get(), src + y * srcRowPitch, width, srcFormat);
+        StoreScanline(dst + y * dstRowPitch, scanline.get(), width, dstFormat);
+    }
+
+    return S_OK;
+}
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::ResizePixels(
+    const uint8_t* src,
+    size_t srcRowPitch,
+    DXGI_FORMAT srcFormat,
+    size_t srcWidth,
+    size_t srcHeight,
+    uint8_t* dst,
+    size_t dstRowPitch,
+    DXGI_FORMAT dstFormat,
+    size_t dstWidth,
+    size_t dstHeight) noexcept
+{
+    if (!src || !dst || !srcWidth || !srcHeight || !dstWidth || !dstHeight)
+        return E_INVALIDARG;
+
+    if (srcWidth == dstWidth && srcHeight == dstHeight)
+    {
+        return ConvertPixels(src, srcRowPitch, srcFormat, dst, dstRowPitch, dstFormat, dstWidth, dstHeight);
+    }
+
+    const size_t srcBpp = BytesPerPixel(srcFormat);
+    const size_t dstBpp = BytesPerPixel(dstFormat);
+    if (!srcBpp || !dstBpp)
+        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+    if (srcWidth > UINT32_MAX || srcHeight > UINT32_MAX || dstWidth > UINT32_MAX || dstHeight > UINT32_MAX)
+        return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+    if (srcRowPitch < srcWidth * srcBpp || dstRowPitch < dstWidth * dstBpp)
+        return E_INVALIDARG;
+
+    try
+    {
+        return ResizeImage(src, srcRowPitch, srcFormat, srcWidth, srcHeight,
+            dst, dstRowPitch, dstFormat, dstWidth, dstHeight);
+    }
+    catch (const std::bad_alloc&)
+    {
+        return E_OUTOFMEMORY;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+size_t DirectX::CountMipLevels(size_t width, size_t height) noexcept
+{
+    size_t mipLevels = 1;
+    while (width > 1 || height > 1)
+    {
+        width = std::max<size_t>(width >> 1, 1);
+        height = std::max<size_t>(height >> 1, 1);
+        ++mipLevels;
+    }
+    return mipLevels;
+}
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::GenerateMipChain(
+    DXGI_FORMAT format,
+    size_t width,
+    size_t height,
+    size_t mipLevels,
+    const MIP_LEVEL_DATA* levels,
+    MIP_FILTER filter,
+    float alphaReference,
+    unsigned int numThreads) noexcept
+{
+    if (!levels || !width || !height || !mipLevels)
+        return E_INVALIDARG;
+
+    const size_t bpp = BytesPerPixel(format);
+    if (!bpp)
+        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+    if (width > UINT32_MAX || height > UINT32_MAX)
+        return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+    if (mipLevels > CountMipLevels(width, height))
+        return E_INVALIDARG;
+
+    size_t w = width;
+    size_t h = height;
+    for (size_t level = 0; level < mipLevels; ++level)
+    {
+        if (!levels[level].pixels || levels[level].rowPitch < w * bpp)
+            return E_INVALIDARG;
+
+        w = std::max<size_t>(w >> 1, 1);
+        h = std::max<size_t>(h >> 1, 1);
+    }
+
+    if (!numThreads)
+    {
+        numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    try
+    {
+        const bool coverage = (alphaReference > 0.f) && HasAlpha(format);
+
+        float topCoverage = 0.f;
+        if (coverage)
+        {
+            HRESULT hr = GetAlphaCoverage(levels[0].pixels, levels[0].rowPitch, format, width, height, alphaReference, topCoverage);
+            if (FAILED(hr))
+                return hr;
+        }
+
+        Filter horz;
+        Filter vert;
+
+        size_t srcWidth = width;
+        size_t srcHeight = height;
+        for (size_t level = 1; level < mipLevels; ++level)
+        {
+            const size_t dstWidth = std::max<size_t>(srcWidth >> 1, 1);
+            const size_t dstHeight = std::max<size_t>(srcHeight >> 1, 1);
+
+            if (filter == MIP_FILTER_KAISER)
+            {
+                CreateKaiserFilter(srcWidth, dstWidth, horz);
+                CreateKaiserFilter(srcHeight, dstHeight, vert);
+            }
+            else
+            {
+                CreateFilter(srcWidth, dstWidth, horz);
+                CreateFilter(srcHeight, dstHeight, vert);
+            }
+
+            // Each level is filtered from the one above it, so only the rows of a level run
+            // in parallel
+            const MIP_LEVEL_DATA& src = levels[level - 1];
+            const MIP_LEVEL_DATA& dst = levels[level];
+            HRESULT hr = ParallelRows(dstWidth, dstHeight, numThreads,
+                [&](size_t y0, size_t y1) noexcept
+                {
+                    return ResizeRows(src.pixels, src.rowPitch, format, srcWidth,
+                        dst.pixels, dst.rowPitch, format, dstWidth,
+                        horz, vert, y0, y1);
+                });
+            if (FAILED(hr))
+                return hr;
+
+            srcWidth = dstWidth;
+            srcHeight = dstHeight;
+        }
+
+        // Scaled once the chain is done, so every level is filtered from unscaled alpha
+        if (coverage)
+        {
+            srcWidth = width;
+            srcHeight = height;
+            for (size_t level = 1; level < mipLevels; ++level)
+            {
+                srcWidth = std::max<size_t>(srcWidth >> 1, 1);
+                srcHeight = std::max<size_t>(srcHeight >> 1, 1);
+
+                ScaleAlphaForCoverage(levels[level].pixels, levels[level].rowPitch, format, srcWidth, srcHeight,
+                    alphaReference, topCoverage);
+            }
+        }
+    }
+    catch (const std::bad_alloc&)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    return S_OK;
+}
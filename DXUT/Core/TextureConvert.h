@@ -0,0 +1,97 @@
+//--------------------------------------------------------------------------------------
+// File: TextureConvert.h
+//
+// Functions for converting pixels between DXGI formats and resizing them on the CPU,
+// without WIC or a Direct3D device. The texture loaders use them in place of
+// IWICFormatConverter and IWICBitmapScaler where the formats allow.
+//
+// For a full-featured texture processing pipeline see the 'Texconv' sample and the
+// 'DirectXTex' library.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248926
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#ifdef _WIN32
+#include <dxgiformat.h>
+#else
+#include <wsl/winadapter.h>
+#include <directx/dxgiformat.h>
+#endif
+
+#include <cstddef>
+#include <cstdint>
+
+
+namespace DirectX
+{
+    // True for the formats ConvertPixels and ResizePixels can read and write
+    bool __cdecl IsConvertFormatSupported(_In_ DXGI_FORMAT fmt) noexcept;
+
+    // Converts width by height pixels. _SRGB formats are decoded to linear on the way in and
+    // encoded on the way out, so converting between an _SRGB format and a plain one changes
+    // the values; pass the plain format for both to keep them.
+    HRESULT __cdecl ConvertPixels(
+        _In_reads_bytes_(srcRowPitch * height) const uint8_t* src,
+        _In_ size_t srcRowPitch,
+        _In_ DXGI_FORMAT srcFormat,
+        _Out_writes_bytes_(dstRowPitch * height) uint8_t* dst,
+        _In_ size_t dstRowPitch,
+        _In_ DXGI_FORMAT dstFormat,
+        _In_ size_t width,
+        _In_ size_t height) noexcept;
+
+    // Resizes and converts as ConvertPixels does. A destination pixel of a reduced axis is the
+    // average of the source area it covers, as WIC's Fant interpolation, and enlarged axes are
+    // interpolated linearly. _SRGB formats are filtered in linear light.
+    HRESULT __cdecl ResizePixels(
+        _In_reads_bytes_(srcRowPitch * srcHeight) const uint8_t* src,
+        _In_ size_t srcRowPitch,
+        _In_ DXGI_FORMAT srcFormat,
+        _In_ size_t srcWidth,
+        _In_ size_t srcHeight,
+        _Out_writes_bytes_(dstRowPitch * dstHeight) uint8_t* dst,
+        _In_ size_t dstRowPitch,
+        _In_ DXGI_FORMAT dstFormat,
+        _In_ size_t dstWidth,
+        _In_ size_t dstHeight) noexcept;
+
+    enum MIP_FILTER : uint32_t
+    {
+        // Average of the area each pixel covers in the level above
+        MIP_FILTER_BOX = 0,
+
+        // Kaiser windowed sinc, sharper than the box with little ringing
+        MIP_FILTER_KAISER = 1,
+    };
+
+    struct MIP_LEVEL_DATA
+    {
+        uint8_t* pixels;
+        size_t rowPitch;
+    };
+
+    // Levels in a full chain down to 1 by 1
+    size_t __cdecl CountMipLevels(_In_ size_t width, _In_ size_t height) noexcept;
+
+    // Fills levels 1 to mipLevels - 1 from level 0, each from the level above, halving each
+    // dimension down to 1. _SRGB formats are filtered in linear light. With an alphaReference
+    // above zero the alpha of every level is scaled so the fraction of pixels whose alpha is
+    // above it matches level 0, which keeps alpha tested cutouts from thinning out. The rows
+    // of each large enough level are split across numThreads threads, or one per logical
+    // processor for 0.
+    HRESULT __cdecl GenerateMipChain(
+        _In_ DXGI_FORMAT format,
+        _In_ size_t width,
+        _In_ size_t height,
+        _In_ size_t mipLevels,
+        _In_reads_(mipLevels) const MIP_LEVEL_DATA* levels,
+        _In_ MIP_FILTER filter = MIP_FILTER_BOX,
+        _In_ float alphaReference = 0.f,
+        _In_ unsigned int numThreads = 0) noexcept;
+}
@@ -27,6 +27,7 @@
 // For now, we just load the first frame (note: DirectXTex supports multi-frame images)
 
 #include "WICTextureLoader.h"
+#include "TextureConvert.h"
 
 #include <dxgiformat.h>
 
@@ -354,6 +355,139 @@ namespace
     }
 
 
+    //---------------------------------------------------------------------------------
+    // True when the frame's own format cannot go to ConvertPixels and ResizePixels as is.
+    // They read the single channel gray formats as red and write red to them, where WIC
+    // replicates gray and takes the luminance of color, so gray only goes to gray.
+    //---------------------------------------------------------------------------------
+    bool NeedsDecode(DXGI_FORMAT sourceFormat, DXGI_FORMAT targetFormat) noexcept
+    {
+        auto isGray = [](DXGI_FORMAT format) noexcept
+        {
+            return format == DXGI_FORMAT_R32_FLOAT
+                || format == DXGI_FORMAT_R16_FLOAT
+                || format == DXGI_FORMAT_R16_UNORM
+                || format == DXGI_FORMAT_R8_UNORM;
+        };
+
+        return !IsConvertFormatSupported(sourceFormat)
+            || (isGray(sourceFormat) != isGray(targetFormat))
+            || ((sourceFormat == DXGI_FORMAT_A8_UNORM) != (targetFormat == DXGI_FORMAT_A8_UNORM));
+    }
+
+    //---------------------------------------------------------------------------------
+    // Size of the full size copy of the frame CopyConvertedPixels makes, or zero when the
+    // conversion or resize is left to IWICFormatConverter and IWICBitmapScaler
+    //---------------------------------------------------------------------------------
+    size_t GetConvertSourceSize(
+        REFGUID pixelFormat,
+        UINT width,
+        UINT height,
+        REFGUID convertGUID,
+        bool resize,
+        _Out_ size_t& sourceRowPitch) noexcept
+    {
+        sourceRowPitch = 0;
+
+        const DXGI_FORMAT targetFormat = WICToDXGI(convertGUID);
+        if (!IsConvertFormatSupported(targetFormat))
+            return 0;
+
+        const bool decode = NeedsDecode(WICToDXGI(pixelFormat), targetFormat);
+        if (decode && !resize)
+        {
+            // A format converter alone does this in one pass
+            return 0;
+        }
+
+        const size_t bpp = WICBitsPerPixel(decode ? convertGUID : pixelFormat);
+        if (!bpp)
+            return 0;
+
+        const uint64_t rowBytes = (uint64_t(width) * uint64_t(bpp) + 7u) / 8u;
+        const uint64_t numBytes = rowBytes * uint64_t(height);
+
+        if (rowBytes > UINT32_MAX || numBytes > UINT32_MAX)
+            return 0;
+
+        sourceRowPitch = static_cast<size_t>(rowBytes);
+        return static_cast<size_t>(numBytes);
+    }
+
+    //---------------------------------------------------------------------------------
+    // Copies the frame at twidth by theight in the format of convertGUID with
+    // ConvertPixels or ResizePixels. A frame in a format they cannot take as is goes
+    // through a format converter at full size first.
+    //---------------------------------------------------------------------------------
+    HRESULT CopyConvertedPixels(
+        _In_ IWICBitmapFrameDecode* frame,
+        REFGUID pixelFormat,
+        UINT width,
+        UINT height,
+        REFGUID convertGUID,
+        UINT twidth,
+        UINT theight,
+        size_t sourceRowPitch,
+        size_t sourceSize,
+        size_t rowPitch,
+        _Out_writes_bytes_(rowPitch * theight) uint8_t* pixels) noexcept
+    {
+        const DXGI_FORMAT targetFormat = WICToDXGI(convertGUID);
+
+        DXGI_FORMAT sourceFormat = WICToDXGI(pixelFormat);
+        const bool decode = NeedsDecode(sourceFormat, targetFormat);
+        if (decode)
+        {
+            sourceFormat = targetFormat;
+        }
+
+        std::unique_ptr<uint8_t[]> source(new (std::nothrow) uint8_t[sourceSize]);
+        if (!source)
+            return E_OUTOFMEMORY;
+
+        HRESULT hr;
+        if (decode)
+        {
+            auto pWIC = GetWIC();
+            if (!pWIC)
+                return E_NOINTERFACE;
+
+            ComPtr<IWICFormatConverter> FC;
+            hr = pWIC->CreateFormatConverter(FC.GetAddressOf());
+            if (FAILED(hr))
+                return hr;
+
+            BOOL canConvert = FALSE;
+            hr = FC->CanConvert(pixelFormat, convertGUID, &canConvert);
+            if (FAILED(hr) || !canConvert)
+            {
+                return E_UNEXPECTED;
+            }
+
+            hr = FC->Initialize(frame, convertGUID, WICBitmapDitherTypeErrorDiffusion, nullptr, 0, WICBitmapPaletteTypeMedianCut);
+            if (FAILED(hr))
+                return hr;
+
+            hr = FC->CopyPixels(nullptr, static_cast<UINT>(sourceRowPitch), static_cast<UINT>(sourceSize), source.get());
+        }
+        else
+        {
+            hr = frame->CopyPixels(nullptr, static_cast<UINT>(sourceRowPitch), static_cast<UINT>(sourceSize), source.get());
+        }
+        if (FAILED(hr))
+            return hr;
+
+        if (twidth != width || theight != height)
+        {
+            return ResizePixels(source.get(), sourceRowPitch, sourceFormat, width, height,
+                pixels, rowPitch, targetFormat, twidth, theight);
+        }
+
+        return ConvertPixels(source.get(), sourceRowPitch, sourceFormat,
+            pixels, rowPitch, targetFormat, twidth, theight);
+    }
+
+
     //---------------------------------------------------------------------------------
     HRESULT CreateTextureFromWIC(_In_ ID3D11Device* d3dDevice,
         _In_opt_ ID3D11DeviceContext* d3dContext,
@@ -589,10 +723,34 @@ namespace
         auto const rowPitch = static_cast<size_t>(rowBytes);
         auto const imageSize = static_cast<size_t>(numBytes);
 
-        std::unique_ptr<uint8_t[]> temp(new (std::nothrow) uint8_t[imageSize]);
+        // The smaller mip levels follow the top one in temp when the chain is built on the CPU
+        const bool cpuMips = (loadFlags & WIC_LOADER_CPU_MIPS) && IsConvertFormatSupported(format);
+        const size_t mipLevels = (cpuMips) ? CountMipLevels(twidth, theight) : 1u;
+
+        uint64_t chainBytes = 0;
+        {
+            uint64_t w = twidth;
+            uint64_t h = theight;
+            for (size_t level = 0; level < mipLevels; ++level)
+            {
+                chainBytes += ((w * uint64_t(bpp) + 7u) / 8u) * h;
+                w = std::max<uint64_t>(w >> 1, 1);
+                h = std::max<uint64_t>(h >> 1, 1);
+            }
+        }
+
+        if (chainBytes > SIZE_MAX)
+            return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+        std::unique_ptr<uint8_t[]> temp(new (std::nothrow) uint8_t[static_cast<size_t>(chainBytes)]);
         if (!temp)
             return E_OUTOFMEMORY;
 
+        // Conversions and resizes between formats TextureConvert handles are done on the CPU
+        size_t sourceRowPitch = 0;
+        const size_t sourceSize = GetConvertSourceSize(pixelFormat, width, height, convertGUID,
+            (twidth != width || theight != height), sourceRowPitch);
+
         // Load image data
         if (memcmp(&convertGUID, &pixelFormat, sizeof(GUID)) == 0
             && twidth == width
@@ -603,6 +761,14 @@ namespace
             if (FAILED(hr))
                 return hr;
         }
+        else if (sourceSize > 0)
+        {
+            // Format conversion and/or resize without WIC
+            hr = CopyConvertedPixels(frame, pixelFormat, width, height, convertGUID, twidth, theight,
+                sourceRowPitch, sourceSize, rowPitch, temp.get());
+            if (FAILED(hr))
+                return hr;
+        }
         else if (twidth != width || theight != height)
         {
             // Resize
@@ -682,9 +848,47 @@ namespace
                 return hr;
         }
 
+        std::unique_ptr<D3D11_SUBRESOURCE_DATA[]> initData(new (std::nothrow) D3D11_SUBRESOURCE_DATA[mipLevels]);
+        if (!initData)
+            return E_OUTOFMEMORY;
+
+        initData[0].pSysMem = temp.get();
+        initData[0].SysMemPitch = static_cast<UINT>(rowPitch);
+        initData[0].SysMemSlicePitch = static_cast<UINT>(imageSize);
+
+        if (cpuMips)
+        {
+            std::unique_ptr<MIP_LEVEL_DATA[]> levels(new (std::nothrow) MIP_LEVEL_DATA[mipLevels]);
+            if (!levels)
+                return E_OUTOFMEMORY;
+
+            uint8_t* pixels = temp.get();
+            size_t w = twidth;
+            size_t h = theight;
+            for (size_t level = 0; level < mipLevels; ++level)
+            {
+                const size_t levelPitch = (w * bpp + 7u) / 8u;
+
+                levels[level].pixels = pixels;
+                levels[level].rowPitch = levelPitch;
+
+                initData[level].pSysMem = pixels;
+                initData[level].SysMemPitch = static_cast<UINT>(levelPitch);
+                initData[level].SysMemSlicePitch = static_cast<UINT>(levelPitch * h);
+
+                pixels += levelPitch * h;
+                w = std::max<size_t>(w >> 1, 1);
+                h = std::max<size_t>(h >> 1, 1);
+            }
+
+            hr = GenerateMipChain(format, twidth, theight, mipLevels, levels.get());
+            if (FAILED(hr))
+                return hr;
+        }
+
         // See if format is supported for auto-gen mipmaps (varies by feature level)
         bool autogen = false;
-        if (d3dContext && textureView) // Must have context and shader-view to auto generate mipmaps
+        if (!cpuMips && d3dContext && textureView) // Must have context and shader-view to auto generate mipmaps
         {
             UINT fmtSupport = 0;
             hr = d3dDevice->CheckFormatSupport(format, &fmtSupport);
@@ -698,7 +902,7 @@ namespace
         D3D11_TEXTURE2D_DESC desc = {};
         desc.Width = twidth;
         desc.Height = theight;
-        desc.MipLevels = (autogen) ? 0u : 1u;
+        desc.MipLevels = (autogen) ? 0u : static_cast<UINT>(mipLevels);
         desc.ArraySize = 1;
         desc.Format = format;
         desc.SampleDesc.Count = 1;
@@ -717,13 +921,8 @@ namespace
             desc.MiscFlags = miscFlags;
         }
 
-        D3D11_SUBRESOURCE_DATA initData;
-        initData.pSysMem = temp.get();
-        initData.SysMemPitch = static_cast<UINT>(rowPitch);
-        initData.SysMemSlicePitch = static_cast<UINT>(imageSize);
-
         ID3D11Texture2D* tex = nullptr;
-        hr = d3dDevice->CreateTexture2D(&desc, (autogen) ? nullptr : &initData, &tex);
+        hr = d3dDevice->CreateTexture2D(&desc, (autogen) ? nullptr : initData.get(), &tex);
         if (SUCCEEDED(hr) && tex)
         {
             if (textureView)
@@ -732,7 +931,7 @@ namespace
                 SRVDesc.Format = desc.Format;
 
                 SRVDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-                SRVDesc.Texture2D.MipLevels = (autogen) ? unsigned(-1) : 1u;
+                SRVDesc.Texture2D.MipLevels = (autogen) ? unsigned(-1) : static_cast<UINT>(mipLevels);
 
                 hr = d3dDevice->CreateShaderResourceView(tex, &SRVDesc, textureView);
                 if (FAILED(hr))
@@ -41,6 +41,7 @@ namespace DirectX
             WIC_LOADER_FIT_POW2 = 0x20,
             WIC_LOADER_MAKE_SQUARE = 0x40,
             WIC_LOADER_FORCE_RGBA32 = 0x80,
+            WIC_LOADER_CPU_MIPS = 0x100, // full mip chain from GenerateMipChain in TextureConvert.h
         };
     }
 
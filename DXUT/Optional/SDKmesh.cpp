@@ -13,10 +13,796 @@
 //--------------------------------------------------------------------------------------
 #include "DXUT.h"
 #include "SDKmesh.h"
+#include "SDKmeshCodec.h"
 #include "SDKmisc.h"
 
+#include <DirectXPackedVector.h>
+
+#include <atomic>
+#include <cctype>
+#include <cstddef>
+#include <thread>
+#include <utility>
+
 using namespace DirectX;
 
+namespace
+{
+    struct handle_closer { void operator()(HANDLE h) { if (h) CloseHandle(h); } };
+
+    typedef std::unique_ptr<void, handle_closer> ScopedHandle;
+
+    inline HANDLE safe_handle( HANDLE h ) { return (h == INVALID_HANDLE_VALUE) ? nullptr : h; }
+
+    // True if count elements of elementSize bytes starting at offset fit within limit
+    inline bool IsRangeValid( UINT64 offset, UINT64 count, UINT64 elementSize, UINT64 limit )
+    {
+        if( offset > limit )
+            return false;
+
+        return !elementSize || count <= ( limit - offset ) / elementSize;
+    }
+
+    inline bool IsLinkValid( UINT link, UINT count )
+    {
+        return ( link == INVALID_FRAME ) || ( link < count );
+    }
+
+    // Case-insensitive FNV-1a; names are not guaranteed to be terminated within MAX_FRAME_NAME
+    inline UINT HashFrameName( const char* pszName )
+    {
+        UINT hash = 2166136261u;
+        for( size_t i = 0; i < MAX_FRAME_NAME && pszName[i]; ++i )
+        {
+            hash ^= static_cast<UINT>( tolower( static_cast<unsigned char>( pszName[i] ) ) );
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+    // Smallest-three quaternion components lie within [-1/sqrt(2), 1/sqrt(2)]
+    const float c_RotationComponentMax = 0.707106781f;
+    const float c_RotationComponentScale = 2.f * c_RotationComponentMax / 32767.f;
+
+    // Longest run of keys a compressed segment may replace; bounds the cost of key reduction
+    const UINT c_MaxKeySpan = 512;
+
+    inline USHORT QuantizeUnorm( float value, float maxValue )
+    {
+        float q = std::round( value );
+        return static_cast<USHORT>( std::max( 0.f, std::min( q, maxValue ) ) );
+    }
+
+    // Orientation of an animation key as a unit quaternion
+    inline XMVECTOR LoadKeyRotation( const SDKANIMATION_DATA& key )
+    {
+        XMVECTOR quat = XMLoadFloat4( &key.Orientation );
+        if ( XMVector4Equal( quat, g_XMZero ) )
+            quat = XMQuaternionIdentity();
+        return XMQuaternionNormalize( quat );
+    }
+
+    void EncodeRotation( FXMVECTOR quat, USHORT* pRotation )
+    {
+        XMFLOAT4 q;
+        XMStoreFloat4( &q, quat );
+        const float c[4] = { q.x, q.y, q.z, q.w };
+
+        UINT largest = 0;
+        for( UINT i = 1; i < 4; ++i )
+        {
+            if( fabsf( c[i] ) > fabsf( c[largest] ) )
+                largest = i;
+        }
+
+        // q and -q are the same rotation, so the dropped component is always made positive
+        const float sign = ( c[largest] < 0.f ) ? -1.f : 1.f;
+
+        for( UINT i = 0, j = 0; i < 4; ++i )
+        {
+            if( i != largest )
+                pRotation[j++] = QuantizeUnorm( ( c[i] * sign + c_RotationComponentMax ) / c_RotationComponentScale, 32767.f );
+        }
+
+        pRotation[0] |= static_cast<USHORT>( ( largest & 1 ) << 15 );
+        pRotation[1] |= static_cast<USHORT>( ( largest >> 1 ) << 15 );
+    }
+
+    inline XMVECTOR DecodeRotation( const SDKANIMATION_COMPRESSED_KEY& key )
+    {
+        PackedVector::XMUSHORT4 packed( key.Rotation[0] & 0x7FFF, key.Rotation[1] & 0x7FFF, key.Rotation[2], 0 );
+        XMVECTOR v = XMVectorMultiplyAdd( PackedVector::XMLoadUShort4( &packed ),
+                                          XMVectorReplicate( c_RotationComponentScale ),
+                                          XMVectorReplicate( -c_RotationComponentMax ) );
+
+        // Rebuild the dropped component from the unit length
+        XMVECTOR w = XMVectorSqrt( XMVectorMax( XMVectorSubtract( g_XMOne, XMVector3Dot( v, v ) ), g_XMZero ) );
+
+        switch( ( key.Rotation[0] >> 15 ) | ( ( key.Rotation[1] >> 15 ) << 1 ) )
+        {
+        case 0:  return XMVectorPermute<XM_PERMUTE_1X, XM_PERMUTE_0X, XM_PERMUTE_0Y, XM_PERMUTE_0Z>( v, w );
+        case 1:  return XMVectorPermute<XM_PERMUTE_0X, XM_PERMUTE_1X, XM_PERMUTE_0Y, XM_PERMUTE_0Z>( v, w );
+        case 2:  return XMVectorPermute<XM_PERMUTE_0X, XM_PERMUTE_0Y, XM_PERMUTE_1X, XM_PERMUTE_0Z>( v, w );
+        default: return XMVectorSelect( w, v, g_XMSelect1110 );
+        }
+    }
+
+    inline XMVECTOR DecodeTranslation( const SDKANIMATION_COMPRESSED_KEY& key, const SDKANIMATION_COMPRESSED_TRACK& track )
+    {
+        PackedVector::XMUSHORT4 packed( key.Translation[0], key.Translation[1], key.Translation[2], 0 );
+        return XMVectorMultiplyAdd( PackedVector::XMLoadUShort4( &packed ),
+                                    XMLoadFloat3( &track.TranslationScale ),
+                                    XMLoadFloat3( &track.TranslationMin ) );
+    }
+
+    // Extension of a version 102 file, or nullptr
+    inline const SDKMESH_HEADER_EXTENSION* GetHeaderExtension( const BYTE* pData )
+    {
+        if( reinterpret_cast<const SDKMESH_HEADER*>( pData )->Version != SDKMESH_FILE_VERSION_EXTENDED )
+            return nullptr;
+
+        return reinterpret_cast<const SDKMESH_HEADER_EXTENSION*>( pData + sizeof( SDKMESH_HEADER ) );
+    }
+
+    // Checks the meshlet tables lie within the static data and index only within each other
+    bool AreMeshletsValid( const BYTE* pData, UINT64 meshletOffset, UINT numSubsets, UINT64 staticSize )
+    {
+        if( !IsRangeValid( meshletOffset, 1, sizeof( SDKMESH_MESHLET_HEADER ), staticSize ) )
+            return false;
+
+        auto pHeader = reinterpret_cast<const SDKMESH_MESHLET_HEADER*>( pData + meshletOffset );
+        if( !IsRangeValid( pHeader->SubsetMeshletsOffset, numSubsets, sizeof( SDKMESH_SUBSET_MESHLETS ), staticSize )
+            || !IsRangeValid( pHeader->MeshletDataOffset, pHeader->NumMeshlets, sizeof( SDKMESH_MESHLET ), staticSize )
+            || !IsRangeValid( pHeader->VertexIndexOffset, pHeader->NumVertexIndices, sizeof( UINT ), staticSize )
+            || !IsRangeValid( pHeader->PrimitiveOffset, pHeader->NumPrimitives, sizeof( UINT ), staticSize ) )
+            return false;
+
+        auto pSubsetMeshlets = reinterpret_cast<const SDKMESH_SUBSET_MESHLETS*>( pData + pHeader->SubsetMeshletsOffset );
+        for( UINT i = 0; i < numSubsets; i++ )
+        {
+            if( !IsRangeValid( pSubsetMeshlets[i].FirstMeshlet, pSubsetMeshlets[i].NumMeshlets, 1, pHeader->NumMeshlets ) )
+                return false;
+        }
+
+        auto pMeshlets = reinterpret_cast<const SDKMESH_MESHLET*>( pData + pHeader->MeshletDataOffset );
+        auto pPrimitives = reinterpret_cast<const UINT*>( pData + pHeader->PrimitiveOffset );
+        for( UINT i = 0; i < pHeader->NumMeshlets; i++ )
+        {
+            auto& meshlet = pMeshlets[i];
+            if( meshlet.VertexCount > SDKMESH_MESHLET_MAX_VERTICES
+                || meshlet.PrimitiveCount > SDKMESH_MESHLET_MAX_PRIMITIVES
+                || !IsRangeValid( meshlet.VertexOffset, meshlet.VertexCount, 1, pHeader->NumVertexIndices )
+                || !IsRangeValid( meshlet.PrimitiveOffset, meshlet.PrimitiveCount, 1, pHeader->NumPrimitives ) )
+                return false;
+
+            for( UINT j = 0; j < meshlet.PrimitiveCount; j++ )
+            {
+                UINT primitive = pPrimitives[ meshlet.PrimitiveOffset + j ];
+                if( ( primitive & 0x3FF ) >= meshlet.VertexCount
+                    || ( ( primitive >> 10 ) & 0x3FF ) >= meshlet.VertexCount
+                    || ( ( primitive >> 20 ) & 0x3FF ) >= meshlet.VertexCount )
+                    return false;
+            }
+        }
+
+        return true;
+    }
+
+    struct VertexBlock
+    {
+        const BYTE* pEncoded;
+        const SDKMESH_VERTEX_BUFFER_HEADER* pHeader;
+        const SDKMESH_VERTEX_ENCODING* pEncoding;
+        UINT iBlock;
+        BYTE* pVertices;
+    };
+
+    //----------------------------------------------------------------------------------
+    // The blocks of every entropy coded buffer are independent, so they are shared out
+    // across up to numThreads threads (0 for one per processor), with the calling thread
+    // taking its turn
+    //----------------------------------------------------------------------------------
+    HRESULT DecodeVertexBlocks( const std::vector<VertexBlock>& blocks, size_t numThreads )
+    {
+        std::atomic<size_t> next( 0 );
+        std::atomic<bool> failed( false );
+
+        auto decode = [&]()
+        {
+            for( ;; )
+            {
+                size_t i = next.fetch_add( 1 );
+                if( i >= blocks.size() )
+                    return;
+
+                auto& block = blocks[i];
+                HRESULT hr = SDKMeshDecodeVertexBlock( block.pEncoded, static_cast<size_t>( block.pEncoding->EncodedBytes ),
+                                                       block.pHeader->NumVertices, static_cast<UINT>( block.pHeader->StrideBytes ),
+                                                       block.pEncoding->BlockVertices, block.iBlock, block.pVertices );
+                if( FAILED( hr ) )
+                    failed = true;
+            }
+        };
+
+        if( !numThreads )
+            numThreads = std::thread::hardware_concurrency();
+        numThreads = std::min<size_t>( numThreads, blocks.size() );
+
+        std::vector<std::thread> threads;
+        try
+        {
+            for( size_t i = 1; i < numThreads; ++i )
+            {
+                threads.emplace_back( decode );
+            }
+        }
+        catch( ... )
+        {
+            // Whatever threads did start still help; the rest is done here
+        }
+
+        decode();
+
+        for( auto& it : threads )
+        {
+            it.join();
+        }
+
+        return failed ? HRESULT_FROM_WIN32( ERROR_INVALID_DATA ) : S_OK;
+    }
+
+    //----------------------------------------------------------------------------------
+    // Decodes the entropy coded VBs of validated file data into one new[] allocation, which
+    // the caller owns. ppVertices[i] is set to VB i's decoded data, or nullptr if not coded.
+    //----------------------------------------------------------------------------------
+    HRESULT DecodeVertexBuffers( const BYTE* pData, size_t numThreads, BYTE*& pDecodedData, BYTE** ppVertices )
+    {
+        pDecodedData = nullptr;
+
+        auto pHeader = reinterpret_cast<const SDKMESH_HEADER*>( pData );
+        auto pVertexBufferArray = reinterpret_cast<const SDKMESH_VERTEX_BUFFER_HEADER*>( pData + pHeader->VertexStreamHeadersOffset );
+
+        const SDKMESH_VERTEX_ENCODING* pVertexEncoding = nullptr;
+        auto pExtension = GetHeaderExtension( pData );
+        if( pExtension && ( pExtension->Flags & SDKMESH_ENCODED_VERTICES ) )
+            pVertexEncoding = reinterpret_cast<const SDKMESH_VERTEX_ENCODING*>( pData + pExtension->VertexEncodingOffset );
+
+        size_t DecodedSize = 0;
+        for( UINT i = 0; i < pHeader->NumVertexBuffers; i++ )
+        {
+            ppVertices[i] = nullptr;
+            if( pVertexEncoding && pVertexEncoding[i].EncodedBytes )
+                DecodedSize += static_cast<size_t>( pVertexBufferArray[i].SizeBytes );
+        }
+
+        if( !pVertexEncoding )
+            return S_OK;
+
+        pDecodedData = new (std::nothrow) BYTE[ DecodedSize ];
+        if( !pDecodedData )
+            return E_OUTOFMEMORY;
+
+        std::vector<VertexBlock> blocks;
+        try
+        {
+            BYTE* pDecoded = pDecodedData;
+            for( UINT i = 0; i < pHeader->NumVertexBuffers; i++ )
+            {
+                if( !pVertexEncoding[i].EncodedBytes )
+                    continue;
+
+                const BYTE* pEncoded = pData + pVertexBufferArray[i].DataOffset;
+                for( UINT j = 0; j < pVertexEncoding[i].NumBlocks; j++ )
+                {
+                    VertexBlock block = { pEncoded, &pVertexBufferArray[i], &pVertexEncoding[i], j, pDecoded };
+                    blocks.push_back( block );
+                }
+
+                ppVertices[i] = pDecoded;
+                pDecoded += pVertexBufferArray[i].SizeBytes;
+            }
+        }
+        catch( const std::bad_alloc& )
+        {
+            return E_OUTOFMEMORY;
+        }
+
+        return DecodeVertexBlocks( blocks, numThreads );
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// SDKMeshData
+//--------------------------------------------------------------------------------------
+SDKMeshData::SDKMeshData() noexcept :
+    m_hMapping(nullptr),
+    m_pView(nullptr),
+    m_pData(nullptr),
+    m_DataBytes(0),
+    m_pHeader(nullptr),
+    m_pVertexBufferArray(nullptr),
+    m_pIndexBufferArray(nullptr),
+    m_pMeshArray(nullptr),
+    m_pSubsetArray(nullptr),
+    m_pFrameArray(nullptr),
+    m_pMaterialArray(nullptr),
+    m_pDecodedVertexData(nullptr),
+    m_ppDecodedVertices(nullptr)
+{
+}
+
+
+//--------------------------------------------------------------------------------------
+SDKMeshData::SDKMeshData( SDKMeshData&& moveFrom ) noexcept :
+    SDKMeshData()
+{
+    *this = std::move( moveFrom );
+}
+
+
+//--------------------------------------------------------------------------------------
+SDKMeshData& SDKMeshData::operator=( SDKMeshData&& moveFrom ) noexcept
+{
+    if( this != &moveFrom )
+    {
+        Close();
+
+        m_hMapping = moveFrom.m_hMapping;
+        m_pView = moveFrom.m_pView;
+        m_pData = moveFrom.m_pData;
+        m_DataBytes = moveFrom.m_DataBytes;
+        m_pHeader = moveFrom.m_pHeader;
+        m_pVertexBufferArray = moveFrom.m_pVertexBufferArray;
+        m_pIndexBufferArray = moveFrom.m_pIndexBufferArray;
+        m_pMeshArray = moveFrom.m_pMeshArray;
+        m_pSubsetArray = moveFrom.m_pSubsetArray;
+        m_pFrameArray = moveFrom.m_pFrameArray;
+        m_pMaterialArray = moveFrom.m_pMaterialArray;
+        m_pDecodedVertexData = moveFrom.m_pDecodedVertexData;
+        m_ppDecodedVertices = moveFrom.m_ppDecodedVertices;
+
+        // The mapping and the decoded vertices now belong to this object
+        moveFrom.m_hMapping = nullptr;
+        moveFrom.m_pView = nullptr;
+        moveFrom.m_pDecodedVertexData = nullptr;
+        moveFrom.m_ppDecodedVertices = nullptr;
+        moveFrom.Close();
+    }
+
+    return *this;
+}
+
+
+//--------------------------------------------------------------------------------------
+SDKMeshData::~SDKMeshData()
+{
+    Close();
+}
+
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT SDKMeshData::Open( LPCWSTR szFileName )
+{
+    Close();
+
+    ScopedHandle hFile( safe_handle( CreateFile( szFileName, FILE_READ_DATA, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                                 FILE_FLAG_RANDOM_ACCESS, nullptr ) ) );
+    if( !hFile )
+        return DXUTERR_MEDIANOTFOUND;
+
+    LARGE_INTEGER FileSize;
+    if( !GetFileSizeEx( hFile.get(), &FileSize ) )
+        return HRESULT_FROM_WIN32( GetLastError() );
+
+#ifndef _WIN64
+    if( FileSize.HighPart > 0 )
+        return E_OUTOFMEMORY;
+#endif
+
+    if( FileSize.QuadPart < static_cast<LONGLONG>( sizeof( SDKMESH_HEADER ) ) )
+        return E_FAIL;
+
+    // The mapping keeps the file open, so the handle can be released once it exists
+    m_hMapping = CreateFileMapping( hFile.get(), nullptr, PAGE_READONLY, 0, 0, nullptr );
+    if( !m_hMapping )
+        return HRESULT_FROM_WIN32( GetLastError() );
+
+    m_pView = MapViewOfFile( m_hMapping, FILE_MAP_READ, 0, 0, 0 );
+    if( !m_pView )
+    {
+        HRESULT hr = HRESULT_FROM_WIN32( GetLastError() );
+        Close();
+        return hr;
+    }
+
+    auto pData = static_cast<const BYTE*>( m_pView );
+    auto DataBytes = static_cast<size_t>( FileSize.QuadPart );
+
+    HRESULT hr = Validate( pData, DataBytes );
+    if( FAILED( hr ) )
+    {
+        Close();
+        return hr;
+    }
+
+    m_pData = pData;
+    m_DataBytes = DataBytes;
+    Parse();
+
+    return S_OK;
+}
+
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT SDKMeshData::Open( const BYTE* pData, size_t DataBytes )
+{
+    Close();
+
+    HRESULT hr = Validate( pData, DataBytes );
+    if( FAILED( hr ) )
+        return hr;
+
+    // The caller owns the memory and must keep it alive while this object is open
+    m_pData = pData;
+    m_DataBytes = DataBytes;
+    Parse();
+
+    return S_OK;
+}
+
+
+//--------------------------------------------------------------------------------------
+void SDKMeshData::Close()
+{
+    if( m_pView )
+    {
+        UnmapViewOfFile( m_pView );
+        m_pView = nullptr;
+    }
+
+    if( m_hMapping )
+    {
+        CloseHandle( m_hMapping );
+        m_hMapping = nullptr;
+    }
+
+    m_pData = nullptr;
+    m_DataBytes = 0;
+
+    m_pHeader = nullptr;
+    m_pVertexBufferArray = nullptr;
+    m_pIndexBufferArray = nullptr;
+    m_pMeshArray = nullptr;
+    m_pSubsetArray = nullptr;
+    m_pFrameArray = nullptr;
+    m_pMaterialArray = nullptr;
+
+    SAFE_DELETE_ARRAY( m_pDecodedVertexData );
+    SAFE_DELETE_ARRAY( m_ppDecodedVertices );
+}
+
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT SDKMeshData::Validate( const BYTE* pData, size_t DataBytes )
+{
+    if( !pData || DataBytes < sizeof( SDKMESH_HEADER ) )
+        return E_FAIL;
+
+    auto pHeader = reinterpret_cast<const SDKMESH_HEADER*>( pData );
+
+    if( pHeader->Version != SDKMESH_FILE_VERSION && pHeader->Version != SDKMESH_FILE_VERSION_EXTENDED )
+        return E_NOINTERFACE;
+
+    // Everything but the vertex and index payloads lives in the static part of the file
+    if( pHeader->HeaderSize < sizeof( SDKMESH_HEADER )
+        || !IsRangeValid( pHeader->HeaderSize, pHeader->NonBufferDataSize, 1, DataBytes ) )
+        return E_FAIL;
+
+    const UINT64 StaticSize = pHeader->HeaderSize + pHeader->NonBufferDataSize;
+
+    if( !IsRangeValid( pHeader->VertexStreamHeadersOffset, pHeader->NumVertexBuffers, sizeof( SDKMESH_VERTEX_BUFFER_HEADER ), StaticSize )
+        || !IsRangeValid( pHeader->IndexStreamHeadersOffset, pHeader->NumIndexBuffers, sizeof( SDKMESH_INDEX_BUFFER_HEADER ), StaticSize )
+        || !IsRangeValid( pHeader->MeshDataOffset, pHeader->NumMeshes, sizeof( SDKMESH_MESH ), StaticSize )
+        || !IsRangeValid( pHeader->SubsetDataOffset, pHeader->NumTotalSubsets, sizeof( SDKMESH_SUBSET ), StaticSize )
+        || !IsRangeValid( pHeader->FrameDataOffset, pHeader->NumFrames, sizeof( SDKMESH_FRAME ), StaticSize )
+        || !IsRangeValid( pHeader->MaterialDataOffset, pHeader->NumMaterials, sizeof( SDKMESH_MATERIAL ), StaticSize ) )
+        return E_FAIL;
+
+    const SDKMESH_VERTEX_ENCODING* pVertexEncoding = nullptr;
+    if( auto pExtension = GetHeaderExtension( pData ) )
+    {
+        if( pHeader->HeaderSize < sizeof( SDKMESH_HEADER ) + sizeof( SDKMESH_HEADER_EXTENSION ) )
+            return E_FAIL;
+
+        if( ( pExtension->Flags & SDKMESH_MESHLETS )
+            && !AreMeshletsValid( pData, pExtension->MeshletOffset, pHeader->NumTotalSubsets, StaticSize ) )
+            return E_FAIL;
+
+        if( ( pExtension->Flags & SDKMESH_QUANTIZED_VERTICES )
+            && !IsRangeValid( pExtension->VertexQuantizationOffset, pHeader->NumTotalSubsets, sizeof( SDKMESH_VERTEX_QUANTIZATION ), StaticSize ) )
+            return E_FAIL;
+
+        if( pExtension->Flags & SDKMESH_ENCODED_VERTICES )
+        {
+            if( !IsRangeValid( pExtension->VertexEncodingOffset, pHeader->NumVertexBuffers, sizeof( SDKMESH_VERTEX_ENCODING ), StaticSize ) )
+                return E_FAIL;
+
+            pVertexEncoding = reinterpret_cast<const SDKMESH_VERTEX_ENCODING*>( pData + pExtension->VertexEncodingOffset );
+        }
+    }
+
+    auto pVertexBufferArray = reinterpret_cast<const SDKMESH_VERTEX_BUFFER_HEADER*>( pData + pHeader->VertexStreamHeadersOffset );
+    for( UINT i = 0; i < pHeader->NumVertexBuffers; i++ )
+    {
+        auto& vb = pVertexBufferArray[i];
+        UINT64 StoredBytes = vb.SizeBytes;
+
+        // Coded buffers are decoded in place of SizeBytes, so that must hold exactly the vertices
+        if( pVertexEncoding && pVertexEncoding[i].EncodedBytes )
+        {
+            auto& encoding = pVertexEncoding[i];
+            if( !vb.StrideBytes
+                || vb.StrideBytes > UINT_MAX
+                || !IsRangeValid( 0, vb.NumVertices, vb.StrideBytes, vb.SizeBytes )
+                || vb.NumVertices * vb.StrideBytes != vb.SizeBytes
+                || encoding.NumBlocks != SDKMeshGetVertexBlockCount( vb.NumVertices, encoding.BlockVertices )
+                || !encoding.NumBlocks )
+                return E_FAIL;
+
+            StoredBytes = encoding.EncodedBytes;
+        }
+
+        if( vb.DataOffset < StaticSize
+            || !IsRangeValid( vb.DataOffset, StoredBytes, 1, DataBytes ) )
+            return E_FAIL;
+    }
+
+    auto pIndexBufferArray = reinterpret_cast<const SDKMESH_INDEX_BUFFER_HEADER*>( pData + pHeader->IndexStreamHeadersOffset );
+    for( UINT i = 0; i < pHeader->NumIndexBuffers; i++ )
+    {
+        if( pIndexBufferArray[i].DataOffset < StaticSize
+            || !IsRangeValid( pIndexBufferArray[i].DataOffset, pIndexBufferArray[i].SizeBytes, 1, DataBytes ) )
+            return E_FAIL;
+    }
+
+    auto pMeshArray = reinterpret_cast<const SDKMESH_MESH*>( pData + pHeader->MeshDataOffset );
+    for( UINT i = 0; i < pHeader->NumMeshes; i++ )
+    {
+        auto& mesh = pMeshArray[i];
+
+        if( mesh.NumVertexBuffers > MAX_VERTEX_STREAMS
+            || mesh.IndexBuffer >= pHeader->NumIndexBuffers
+            || !IsRangeValid( mesh.SubsetOffset, mesh.NumSubsets, sizeof( UINT ), StaticSize )
+            || !IsRangeValid( mesh.FrameInfluenceOffset, mesh.NumFrameInfluences, sizeof( UINT ), StaticSize ) )
+            return E_FAIL;
+
+        for( UINT j = 0; j < mesh.NumVertexBuffers; j++ )
+        {
+            if( mesh.VertexBuffers[j] >= pHeader->NumVertexBuffers )
+                return E_FAIL;
+        }
+
+        auto pSubsets = reinterpret_cast<const UINT*>( pData + mesh.SubsetOffset );
+        for( UINT j = 0; j < mesh.NumSubsets; j++ )
+        {
+            if( pSubsets[j] >= pHeader->NumTotalSubsets )
+                return E_FAIL;
+        }
+
+        auto pFrameInfluences = reinterpret_cast<const UINT*>( pData + mesh.FrameInfluenceOffset );
+        for( UINT j = 0; j < mesh.NumFrameInfluences; j++ )
+        {
+            if( pFrameInfluences[j] >= pHeader->NumFrames )
+                return E_FAIL;
+        }
+    }
+
+    auto pFrameArray = reinterpret_cast<const SDKMESH_FRAME*>( pData + pHeader->FrameDataOffset );
+    for( UINT i = 0; i < pHeader->NumFrames; i++ )
+    {
+        auto& frame = pFrameArray[i];
+
+        if( ( frame.Mesh != INVALID_MESH && frame.Mesh >= pHeader->NumMeshes )
+            || !IsLinkValid( frame.ParentFrame, pHeader->NumFrames )
+            || !IsLinkValid( frame.ChildFrame, pHeader->NumFrames )
+            || !IsLinkValid( frame.SiblingFrame, pHeader->NumFrames ) )
+            return E_FAIL;
+    }
+
+    return S_OK;
+}
+
+
+//--------------------------------------------------------------------------------------
+void SDKMeshData::Parse()
+{
+    m_pHeader = reinterpret_cast<const SDKMESH_HEADER*>( m_pData );
+
+    m_pVertexBufferArray = reinterpret_cast<const SDKMESH_VERTEX_BUFFER_HEADER*>( m_pData + m_pHeader->VertexStreamHeadersOffset );
+    m_pIndexBufferArray = reinterpret_cast<const SDKMESH_INDEX_BUFFER_HEADER*>( m_pData + m_pHeader->IndexStreamHeadersOffset );
+    m_pMeshArray = reinterpret_cast<const SDKMESH_MESH*>( m_pData + m_pHeader->MeshDataOffset );
+    m_pSubsetArray = reinterpret_cast<const SDKMESH_SUBSET*>( m_pData + m_pHeader->SubsetDataOffset );
+    m_pFrameArray = reinterpret_cast<const SDKMESH_FRAME*>( m_pData + m_pHeader->FrameDataOffset );
+    m_pMaterialArray = reinterpret_cast<const SDKMESH_MATERIAL*>( m_pData + m_pHeader->MaterialDataOffset );
+}
+
+
+//--------------------------------------------------------------------------------------
+size_t SDKMeshData::GetStaticDataSize() const
+{
+    if( !m_pHeader )
+        return 0;
+    return static_cast<size_t>( m_pHeader->HeaderSize + m_pHeader->NonBufferDataSize );
+}
+
+UINT SDKMeshData::GetNumVBs() const { return m_pHeader ? m_pHeader->NumVertexBuffers : 0; }
+UINT SDKMeshData::GetNumIBs() const { return m_pHeader ? m_pHeader->NumIndexBuffers : 0; }
+UINT SDKMeshData::GetNumMeshes() const { return m_pHeader ? m_pHeader->NumMeshes : 0; }
+UINT SDKMeshData::GetNumTotalSubsets() const { return m_pHeader ? m_pHeader->NumTotalSubsets : 0; }
+UINT SDKMeshData::GetNumFrames() const { return m_pHeader ? m_pHeader->NumFrames : 0; }
+UINT SDKMeshData::GetNumMaterials() const { return m_pHeader ? m_pHeader->NumMaterials : 0; }
+
+//--------------------------------------------------------------------------------------
+const SDKMESH_VERTEX_BUFFER_HEADER* SDKMeshData::GetVBHeader( _In_ UINT iVB ) const
+{
+    assert( iVB < GetNumVBs() );
+    return &m_pVertexBufferArray[ iVB ];
+}
+
+//--------------------------------------------------------------------------------------
+const SDKMESH_INDEX_BUFFER_HEADER* SDKMeshData::GetIBHeader( _In_ UINT iIB ) const
+{
+    assert( iIB < GetNumIBs() );
+    return &m_pIndexBufferArray[ iIB ];
+}
+
+//--------------------------------------------------------------------------------------
+const SDKMESH_MESH* SDKMeshData::GetMesh( _In_ UINT iMesh ) const
+{
+    assert( iMesh < GetNumMeshes() );
+    return &m_pMeshArray[ iMesh ];
+}
+
+//--------------------------------------------------------------------------------------
+const UINT* SDKMeshData::GetMeshSubsets( _In_ UINT iMesh ) const
+{
+    return reinterpret_cast<const UINT*>( m_pData + GetMesh( iMesh )->SubsetOffset );
+}
+
+//--------------------------------------------------------------------------------------
+const UINT* SDKMeshData::GetMeshFrameInfluences( _In_ UINT iMesh ) const
+{
+    return reinterpret_cast<const UINT*>( m_pData + GetMesh( iMesh )->FrameInfluenceOffset );
+}
+
+//--------------------------------------------------------------------------------------
+const SDKMESH_SUBSET* SDKMeshData::GetSubsetAt( _In_ UINT iSubset ) const
+{
+    assert( iSubset < GetNumTotalSubsets() );
+    return &m_pSubsetArray[ iSubset ];
+}
+
+//--------------------------------------------------------------------------------------
+const SDKMESH_SUBSET* SDKMeshData::GetSubset( _In_ UINT iMesh, _In_ UINT iSubset ) const
+{
+    assert( iSubset < GetMesh( iMesh )->NumSubsets );
+    return &m_pSubsetArray[ GetMeshSubsets( iMesh )[ iSubset ] ];
+}
+
+//--------------------------------------------------------------------------------------
+const SDKMESH_FRAME* SDKMeshData::GetFrame( _In_ UINT iFrame ) const
+{
+    assert( iFrame < GetNumFrames() );
+    return &m_pFrameArray[ iFrame ];
+}
+
+//--------------------------------------------------------------------------------------
+const SDKMESH_MATERIAL* SDKMeshData::GetMaterial( _In_ UINT iMaterial ) const
+{
+    assert( iMaterial < GetNumMaterials() );
+    return &m_pMaterialArray[ iMaterial ];
+}
+
+//--------------------------------------------------------------------------------------
+const BYTE* SDKMeshData::GetVertices( _In_ UINT iVB ) const
+{
+    return m_pData + GetVBHeader( iVB )->DataOffset;
+}
+
+//--------------------------------------------------------------------------------------
+const BYTE* SDKMeshData::GetIndices( _In_ UINT iIB ) const
+{
+    return m_pData + GetIBHeader( iIB )->DataOffset;
+}
+
+//--------------------------------------------------------------------------------------
+const SDKMESH_HEADER_EXTENSION* SDKMeshData::GetExtension() const
+{
+    return m_pData ? GetHeaderExtension( m_pData ) : nullptr;
+}
+
+//--------------------------------------------------------------------------------------
+const SDKMESH_VERTEX_QUANTIZATION* SDKMeshData::GetVertexQuantization( _In_ UINT iSubset ) const
+{
+    assert( iSubset < GetNumTotalSubsets() );
+    auto pExtension = GetExtension();
+    if( !pExtension || !( pExtension->Flags & SDKMESH_QUANTIZED_VERTICES ) )
+        return nullptr;
+    return reinterpret_cast<const SDKMESH_VERTEX_QUANTIZATION*>( m_pData + pExtension->VertexQuantizationOffset ) + iSubset;
+}
+
+//--------------------------------------------------------------------------------------
+const SDKMESH_VERTEX_ENCODING* SDKMeshData::GetVertexEncoding( _In_ UINT iVB ) const
+{
+    assert( iVB < GetNumVBs() );
+    auto pExtension = GetExtension();
+    if( !pExtension || !( pExtension->Flags & SDKMESH_ENCODED_VERTICES ) )
+        return nullptr;
+    auto pEncoding = reinterpret_cast<const SDKMESH_VERTEX_ENCODING*>( m_pData + pExtension->VertexEncodingOffset ) + iVB;
+    return pEncoding->EncodedBytes ? pEncoding : nullptr;
+}
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT SDKMeshData::DecodeVertices( UINT numThreads )
+{
+    if( !m_pHeader )
+        return E_UNEXPECTED;
+
+    if( m_ppDecodedVertices )
+        return S_OK;
+
+    BYTE** ppVertices = new (std::nothrow) BYTE*[ m_pHeader->NumVertexBuffers ];
+    if( !ppVertices )
+        return E_OUTOFMEMORY;
+
+    HRESULT hr = DecodeVertexBuffers( m_pData, numThreads, m_pDecodedVertexData, ppVertices );
+    if( FAILED( hr ) )
+    {
+        SAFE_DELETE_ARRAY( m_pDecodedVertexData );
+        delete[] ppVertices;
+        return hr;
+    }
+
+    m_ppDecodedVertices = ppVertices;
+    return S_OK;
+}
+
+//--------------------------------------------------------------------------------------
+size_t SDKMeshData::GetDecodedVertexSize() const
+{
+    size_t bytes = 0;
+    for( UINT i = 0; i < GetNumVBs(); i++ )
+    {
+        if( GetVertexEncoding( i ) )
+            bytes += static_cast<size_t>( m_pVertexBufferArray[i].SizeBytes );
+    }
+    return bytes;
+}
+
+//--------------------------------------------------------------------------------------
+const BYTE* SDKMeshData::GetDecodedVertices( _In_ UINT iVB ) const
+{
+    assert( iVB < GetNumVBs() );
+    return m_ppDecodedVertices ? m_ppDecodedVertices[ iVB ] : nullptr;
+}
+
+//--------------------------------------------------------------------------------------
+const SDKMESH_MESHLET_HEADER* SDKMeshData::GetMeshletHeader() const
+{
+    auto pExtension = GetExtension();
+    if( !pExtension || !( pExtension->Flags & SDKMESH_MESHLETS ) )
+        return nullptr;
+    return reinterpret_cast<const SDKMESH_MESHLET_HEADER*>( m_pData + pExtension->MeshletOffset );
+}
+
+
+//--------------------------------------------------------------------------------------
+// CDXUTSDKMesh
 //--------------------------------------------------------------------------------------
 _Use_decl_annotations_
 void CDXUTSDKMesh::LoadMaterials( ID3D11Device* pd3dDevice, SDKMESH_MATERIAL* pMaterials, UINT numMaterials,
@@ -178,12 +964,20 @@ HRESULT CDXUTSDKMesh::CreateFromFile( ID3D11Device* pDev11,
     // Find the path for the file
     V_RETURN( DXUTFindDXSDKMediaFileCch( m_strPathW, sizeof( m_strPathW ) / sizeof( WCHAR ), szFileName ) );
 
-    // Open the file
-    m_hFile = CreateFile( m_strPathW, FILE_READ_DATA, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN,
-                          nullptr );
-    if( INVALID_HANDLE_VALUE == m_hFile )
-        return DXUTERR_MEDIANOTFOUND;
+    // Map the file; the vertex and index data is used straight from the mapping
+    hr = m_MeshData.Open( m_strPathW );
+    if( FAILED( hr ) )
+        return hr;
+
+    return CreateFromMeshData( pDev11, pLoaderCallbacks11 );
+}
+
 
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT CDXUTSDKMesh::CreateFromMeshData( ID3D11Device* pDev11,
+                                          SDKMESH_CALLBACKS11* pLoaderCallbacks11 )
+{
     // Change the path to just the directory
     WCHAR* pLastBSlash = wcsrchr( m_strPathW, L'\\' );
     if( pLastBSlash )
@@ -193,36 +987,23 @@ HRESULT CDXUTSDKMesh::CreateFromFile( ID3D11Device* pDev11,
 
     WideCharToMultiByte( CP_ACP, 0, m_strPathW, -1, m_strPath, MAX_PATH, nullptr, FALSE );
 
-    // Get the file size
-    LARGE_INTEGER FileSize;
-    GetFileSizeEx( m_hFile, &FileSize );
-    UINT cBytes = FileSize.LowPart;
-
-    // Allocate memory
-    m_pStaticMeshData = new (std::nothrow) BYTE[ cBytes ];
-    if( !m_pStaticMeshData )
+    // Does nothing if the loader already decoded the vertices on a worker thread
+    HRESULT hr = m_MeshData.DecodeVertices();
+    if( FAILED( hr ) )
     {
-        CloseHandle( m_hFile );
-        return E_OUTOFMEMORY;
+        m_MeshData.Close();
+        return hr;
     }
 
-    // Read in the file
-    DWORD dwBytesRead;
-    if( !ReadFile( m_hFile, m_pStaticMeshData, cBytes, &dwBytesRead, nullptr ) )
-        hr = E_FAIL;
-
-    CloseHandle( m_hFile );
-
-    if( SUCCEEDED( hr ) )
-    {
-        hr = CreateFromMemory( pDev11,
-                               m_pStaticMeshData,
-                               cBytes,
-                               false,
-                               pLoaderCallbacks11 );
-        if( FAILED( hr ) )
-            delete []m_pStaticMeshData;
-    }
+    // Only the static data is copied since it gets patched with the runtime pointers. The mapping
+    // stays open until Destroy so GetRawVerticesAt/GetRawIndicesAt remain valid (and read-only).
+    hr = CreateFromMemory( pDev11,
+                           const_cast<BYTE*>( m_MeshData.GetData() ),
+                           m_MeshData.GetDataSize(),
+                           true,
+                           pLoaderCallbacks11 );
+    if( FAILED( hr ) )
+        m_MeshData.Close();
 
     return hr;
 }
@@ -234,13 +1015,11 @@ HRESULT CDXUTSDKMesh::CreateFromMemory( ID3D11Device* pDev11,
                                         bool bCopyStatic,
                                         SDKMESH_CALLBACKS11* pLoaderCallbacks11 )
 {
-    XMFLOAT3 lower; 
-    XMFLOAT3 upper; 
-    
     m_pDev11 = pDev11;
 
-    if ( DataBytes < sizeof(SDKMESH_HEADER) )
-        return E_FAIL;
+    HRESULT hr = SDKMeshData::Validate( pData, DataBytes );
+    if( FAILED( hr ) )
+        return hr;
 
     // Set outstanding resources to zero
     m_NumOutstandingResources = 0;
@@ -287,168 +1066,452 @@ HRESULT CDXUTSDKMesh::CreateFromMemory( ID3D11Device* pDev11,
     }
 
     // error condition
-    if( m_pMeshHeader->Version != SDKMESH_FILE_VERSION )
+    if( m_pMeshHeader->Version != SDKMESH_FILE_VERSION && m_pMeshHeader->Version != SDKMESH_FILE_VERSION_EXTENDED )
+    {
+        return E_NOINTERFACE;
+    }
+
+    const SDKMESH_VERTEX_ENCODING* pVertexEncoding = nullptr;
+    if( auto pExtension = GetHeaderExtension( m_pStaticMeshData ) )
+    {
+        if( pExtension->Flags & SDKMESH_QUANTIZED_VERTICES )
+            m_pVertexQuantization = ( SDKMESH_VERTEX_QUANTIZATION* )( m_pStaticMeshData + pExtension->VertexQuantizationOffset );
+
+        if( pExtension->Flags & SDKMESH_ENCODED_VERTICES )
+            pVertexEncoding = ( const SDKMESH_VERTEX_ENCODING* )( m_pStaticMeshData + pExtension->VertexEncodingOffset );
+
+        if( pExtension->Flags & SDKMESH_MESHLETS )
+        {
+            m_pMeshletHeader = ( SDKMESH_MESHLET_HEADER* )( m_pStaticMeshData + pExtension->MeshletOffset );
+            m_pSubsetMeshlets = ( SDKMESH_SUBSET_MESHLETS* )( m_pStaticMeshData + m_pMeshletHeader->SubsetMeshletsOffset );
+            m_pMeshlets = ( SDKMESH_MESHLET* )( m_pStaticMeshData + m_pMeshletHeader->MeshletDataOffset );
+        }
+    }
+
+    hr = BuildFrameNameIndex();
+    if( FAILED( hr ) )
+        return hr;
+
+    hr = BuildFrameOrder();
+    if( FAILED( hr ) )
+        return hr;
+
+    // Setup buffer data pointer
+    BYTE* pBufferData = pData + m_pMeshHeader->HeaderSize + m_pMeshHeader->NonBufferDataSize;
+
+    // Get the start of the buffer data
+    UINT64 BufferDataStart = m_pMeshHeader->HeaderSize + m_pMeshHeader->NonBufferDataSize;
+
+    // Create VBs
+    m_ppVertices = new (std::nothrow) BYTE*[m_pMeshHeader->NumVertexBuffers];
+    if ( !m_ppVertices )
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    // Entropy coded VBs are all decoded before any are created. A mapped file's are held by
+    // m_MeshData, decoded by CreateFromMeshData or already by CDXUTSDKMeshLoader's workers.
+    if( pVertexEncoding )
+    {
+        if( m_MeshData.IsOpen() && m_MeshData.GetData() == pData )
+        {
+            for( UINT i = 0; i < m_pMeshHeader->NumVertexBuffers; i++ )
+            {
+                m_ppVertices[i] = const_cast<BYTE*>( m_MeshData.GetDecodedVertices( i ) );
+            }
+        }
+        else
+        {
+            hr = DecodeVertexBuffers( pData, 0, m_pDecodedVertexData, m_ppVertices );
+            if( FAILED( hr ) )
+                return hr;
+        }
+    }
+
+    for( UINT i = 0; i < m_pMeshHeader->NumVertexBuffers; i++ )
+    {
+        BYTE* pVertices = nullptr;
+        if( pVertexEncoding && pVertexEncoding[i].EncodedBytes )
+            pVertices = m_ppVertices[i];
+        else
+            pVertices = ( BYTE* )( pBufferData + ( m_pVertexBufferArray[i].DataOffset - BufferDataStart ) );
+
+        if( pDev11 )
+            CreateVertexBuffer( pDev11, &m_pVertexBufferArray[i], pVertices, pLoaderCallbacks11 );
+
+        m_ppVertices[i] = pVertices;
+    }
+
+    // Create IBs
+    m_ppIndices = new (std::nothrow) BYTE*[m_pMeshHeader->NumIndexBuffers];
+    if ( !m_ppIndices )
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    for( UINT i = 0; i < m_pMeshHeader->NumIndexBuffers; i++ )
+    {
+        BYTE* pIndices = nullptr;
+        pIndices = ( BYTE* )( pBufferData + ( m_pIndexBufferArray[i].DataOffset - BufferDataStart ) );
+
+        if( pDev11 )
+            CreateIndexBuffer( pDev11, &m_pIndexBufferArray[i], pIndices, pLoaderCallbacks11 );
+
+        m_ppIndices[i] = pIndices;
+    }
+
+    // Load Materials
+    if( pDev11 )
+        LoadMaterials( pDev11, m_pMaterialArray, m_pMeshHeader->NumMaterials, pLoaderCallbacks11 );
+
+    // Create a place to store our bind pose frame matrices
+    m_pBindPoseFrameMatrices = new (std::nothrow) XMFLOAT4X4[ m_pMeshHeader->NumFrames ];
+    if( !m_pBindPoseFrameMatrices )
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    // The inverse bind pose is cached by TransformBindPose; until then it is identity
+    m_pInvBindPoseFrameMatrices = new (std::nothrow) XMFLOAT4X4[ m_pMeshHeader->NumFrames ];
+    if( !m_pInvBindPoseFrameMatrices )
+    {
+        return E_OUTOFMEMORY;
+    }
+    for( UINT i = 0; i < m_pMeshHeader->NumFrames; i++ )
+    {
+        XMStoreFloat4x4( &m_pInvBindPoseFrameMatrices[i], XMMatrixIdentity() );
+    }
+
+    // Create a place to store our transformed frame matrices
+    m_pTransformedFrameMatrices = new (std::nothrow) XMFLOAT4X4[ m_pMeshHeader->NumFrames ];
+    if( !m_pTransformedFrameMatrices )
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    m_pWorldPoseFrameMatrices = new (std::nothrow) XMFLOAT4X4[ m_pMeshHeader->NumFrames ];
+    if( !m_pWorldPoseFrameMatrices )
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    return BuildBoundingBoxes();
+}
+
+
+//--------------------------------------------------------------------------------------
+HRESULT CDXUTSDKMesh::BuildFrameNameIndex()
+{
+    m_FrameNameIndex.clear();
+
+    try
+    {
+        m_FrameNameIndex.reserve( m_pMeshHeader->NumFrames );
+        for( UINT i = 0; i < m_pMeshHeader->NumFrames; i++ )
+        {
+            m_FrameNameIndex.emplace_back( HashFrameName( m_pFrameArray[i].Name ), i );
+        }
+    }
+    catch( const std::bad_alloc& )
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    std::sort( m_FrameNameIndex.begin(), m_FrameNameIndex.end() );
+
+    return S_OK;
+}
+
+
+//--------------------------------------------------------------------------------------
+HRESULT CDXUTSDKMesh::BuildFrameOrder()
+{
+    m_FrameOrder.clear();
+    m_FrameParent.clear();
+
+    const UINT numFrames = m_pMeshHeader->NumFrames;
+    if( !numFrames )
+        return S_OK;
+
+    try
     {
-        return E_NOINTERFACE;
-    }
+        m_FrameOrder.reserve( numFrames );
+        m_FrameParent.reserve( numFrames );
 
-    // Setup buffer data pointer
-    BYTE* pBufferData = pData + m_pMeshHeader->HeaderSize + m_pMeshHeader->NonBufferDataSize;
+        std::vector<bool> visited( numFrames, false );
 
-    // Get the start of the buffer data
-    UINT64 BufferDataStart = m_pMeshHeader->HeaderSize + m_pMeshHeader->NonBufferDataSize;
+        // (frame, parent) pairs still to visit. A frame is only pushed once its parent has been
+        // visited, so every parent comes before its children; that is all the users of the order
+        // rely on. Frames reached more than once through malformed links are only visited once.
+        std::vector<std::pair<UINT, UINT>> stack;
+        stack.emplace_back( 0u, INVALID_FRAME );
 
-    // Create VBs
-    m_ppVertices = new (std::nothrow) BYTE*[m_pMeshHeader->NumVertexBuffers];
-    if ( !m_ppVertices )
+        while( !stack.empty() )
+        {
+            auto entry = stack.back();
+            stack.pop_back();
+
+            UINT iFrame = entry.first;
+            if( visited[ iFrame ] )
+                continue;   // malformed links would otherwise loop forever
+            visited[ iFrame ] = true;
+
+            m_FrameOrder.push_back( iFrame );
+            m_FrameParent.push_back( entry.second );
+
+            if( m_pFrameArray[iFrame].SiblingFrame != INVALID_FRAME )
+                stack.emplace_back( m_pFrameArray[iFrame].SiblingFrame, entry.second );
+
+            if( m_pFrameArray[iFrame].ChildFrame != INVALID_FRAME )
+                stack.emplace_back( m_pFrameArray[iFrame].ChildFrame, iFrame );
+        }
+    }
+    catch( const std::bad_alloc& )
     {
         return E_OUTOFMEMORY;
     }
-    for( UINT i = 0; i < m_pMeshHeader->NumVertexBuffers; i++ )
-    {
-        BYTE* pVertices = nullptr;
-        pVertices = ( BYTE* )( pBufferData + ( m_pVertexBufferArray[i].DataOffset - BufferDataStart ) );
 
-        if( pDev11 )
-            CreateVertexBuffer( pDev11, &m_pVertexBufferArray[i], pVertices, pLoaderCallbacks11 );
+    return S_OK;
+}
 
-        m_ppVertices[i] = pVertices;
-    }
+//--------------------------------------------------------------------------------------
+// Bounds of each subset from the vertices its indices reach (offset by VertexStart, as
+// DrawIndexed does), merged into the bounds of each mesh. Also lays out the draw list and
+// the grouped bounds that CullSubsets tests.
+//--------------------------------------------------------------------------------------
+HRESULT CDXUTSDKMesh::BuildBoundingBoxes()
+{
+    const UINT numSubsets = m_pMeshHeader->NumTotalSubsets;
 
-    // Create IBs
-    m_ppIndices = new (std::nothrow) BYTE*[m_pMeshHeader->NumIndexBuffers];
-    if ( !m_ppIndices )
+    try
+    {
+        m_SubsetBBoxCenters.assign( numSubsets, XMFLOAT3( 0.f, 0.f, 0.f ) );
+        m_SubsetBBoxExtents.assign( numSubsets, XMFLOAT3( 0.f, 0.f, 0.f ) );
+    }
+    catch( const std::bad_alloc& )
     {
         return E_OUTOFMEMORY;
     }
 
-    for( UINT i = 0; i < m_pMeshHeader->NumIndexBuffers; i++ )
+    for( UINT meshi = 0; meshi < m_pMeshHeader->NumMeshes; ++meshi )
     {
-        BYTE* pIndices = nullptr;
-        pIndices = ( BYTE* )( pBufferData + ( m_pIndexBufferArray[i].DataOffset - BufferDataStart ) );
+        auto currentMesh = &m_pMeshArray[meshi];
 
-        if( pDev11 )
-            CreateIndexBuffer( pDev11, &m_pIndexBufferArray[i], pIndices, pLoaderCallbacks11 );
+        XMVECTOR meshLower = g_XMFltMax;
+        XMVECTOR meshUpper = XMVectorNegate( g_XMFltMax );
+        bool bMeshEmpty = true;
 
-        m_ppIndices[i] = pIndices;
+        if( currentMesh->NumVertexBuffers > 0 )
+        {
+            auto& vbHeader = m_pVertexBufferArray[ currentMesh->VertexBuffers[0] ];
+            auto& ibHeader = m_pIndexBufferArray[ currentMesh->IndexBuffer ];
+
+            // Positions lead the vertex unless the declaration says otherwise. Quantized positions
+            // are relative to each subset (see SDKMESH_VERTEX_QUANTIZATION)
+            UINT64 positionOffset = 0;
+            bool bQuantized = false;
+            for( UINT e = 0; e < MAX_VERTEX_ELEMENTS && vbHeader.Decl[e].Stream != 0xFF; e++ )
+            {
+                if( vbHeader.Decl[e].Usage == D3DDECLUSAGE_POSITION && !vbHeader.Decl[e].UsageIndex )
+                {
+                    positionOffset = vbHeader.Decl[e].Offset;
+                    bQuantized = ( m_pVertexQuantization && vbHeader.Decl[e].Type == D3DDECLTYPE_USHORT4N );
+                    break;
+                }
+            }
+
+            const BYTE* pVertices = m_ppVertices[ currentMesh->VertexBuffers[0] ];
+            const BYTE* pIndices = m_ppIndices[ currentMesh->IndexBuffer ];
+            const UINT64 stride = vbHeader.StrideBytes;
+            const UINT64 numIndices = ibHeader.NumIndices;
+            const bool b16Bit = ( ibHeader.IndexType == IT_16BIT );
+
+            UINT64 numVertices = vbHeader.NumVertices;
+            if( positionOffset + ( bQuantized ? sizeof( PackedVector::XMUSHORTN4 ) : sizeof( XMFLOAT3 ) ) > stride )
+                numVertices = 0;
+
+            for( UINT subset = 0; subset < currentMesh->NumSubsets; subset++ )
+            {
+                UINT iSubset = currentMesh->pSubsets[subset];
+                auto pSubset = &m_pSubsetArray[iSubset];
+                if( pSubset->VertexStart >= numVertices || pSubset->IndexStart >= numIndices )
+                    continue;
+
+                XMVECTOR positionScale = g_XMOne;
+                XMVECTOR positionBias = g_XMZero;
+                if( bQuantized )
+                {
+                    positionScale = XMLoadFloat3( &m_pVertexQuantization[iSubset].PositionScale );
+                    positionBias = XMLoadFloat3( &m_pVertexQuantization[iSubset].PositionOffset );
+                }
+
+                XMVECTOR lower = g_XMFltMax;
+                XMVECTOR upper = XMVectorNegate( g_XMFltMax );
+                bool bEmpty = true;
+
+                UINT64 indexEnd = pSubset->IndexStart + std::min( pSubset->IndexCount, numIndices - pSubset->IndexStart );
+                for( UINT64 i = pSubset->IndexStart; i < indexEnd; ++i )
+                {
+                    UINT64 index = pSubset->VertexStart;
+                    if( b16Bit )
+                        index += reinterpret_cast<const USHORT*>( pIndices )[i];
+                    else
+                        index += reinterpret_cast<const UINT*>( pIndices )[i];
+                    if( index >= numVertices )
+                        continue;
+
+                    const BYTE* pPosition = pVertices + index * stride + positionOffset;
+                    XMVECTOR pos;
+                    if( bQuantized )
+                        pos = XMVectorMultiplyAdd( PackedVector::XMLoadUShortN4( reinterpret_cast<const PackedVector::XMUSHORTN4*>( pPosition ) ),
+                                                   positionScale, positionBias );
+                    else
+                        pos = XMLoadFloat3( reinterpret_cast<const XMFLOAT3*>( pPosition ) );
+
+                    lower = XMVectorMin( lower, pos );
+                    upper = XMVectorMax( upper, pos );
+                    bEmpty = false;
+                }
+
+                if( bEmpty )
+                    continue;
+
+                XMStoreFloat3( &m_SubsetBBoxCenters[iSubset], XMVectorScale( XMVectorAdd( lower, upper ), 0.5f ) );
+                XMStoreFloat3( &m_SubsetBBoxExtents[iSubset], XMVectorScale( XMVectorSubtract( upper, lower ), 0.5f ) );
+
+                meshLower = XMVectorMin( meshLower, lower );
+                meshUpper = XMVectorMax( meshUpper, upper );
+                bMeshEmpty = false;
+            }
+        }
+
+        if( bMeshEmpty )
+        {
+            meshLower = meshUpper = g_XMZero;
+        }
+
+        XMStoreFloat3( &currentMesh->BoundingBoxCenter, XMVectorScale( XMVectorAdd( meshLower, meshUpper ), 0.5f ) );
+        XMStoreFloat3( &currentMesh->BoundingBoxExtents, XMVectorScale( XMVectorSubtract( meshUpper, meshLower ), 0.5f ) );
     }
 
-    // Load Materials
-    if( pDev11 )
-        LoadMaterials( pDev11, m_pMaterialArray, m_pMeshHeader->NumMaterials, pLoaderCallbacks11 );
+    // The subsets in the order RenderFrame draws them, with nothing culled yet
+    try
+    {
+        m_DrawList.clear();
+        for( UINT iFrame : m_FrameOrder )
+        {
+            UINT iMesh = m_pFrameArray[iFrame].Mesh;
+            if( iMesh == INVALID_MESH )
+                continue;
 
-    // Create a place to store our bind pose frame matrices
-    m_pBindPoseFrameMatrices = new (std::nothrow) XMFLOAT4X4[ m_pMeshHeader->NumFrames ];
-    if( !m_pBindPoseFrameMatrices )
+            for( UINT subset = 0; subset < m_pMeshArray[iMesh].NumSubsets; subset++ )
+            {
+                m_DrawList.push_back( SDKMESH_SUBSET_DRAW{ iMesh, subset } );
+            }
+        }
+
+        m_DrawBounds.assign( ( ( m_DrawList.size() + 3 ) / 4 ) * 6, XMFLOAT4( 0.f, 0.f, 0.f, 0.f ) );
+        m_VisibleDraws = m_DrawList;
+    }
+    catch( const std::bad_alloc& )
     {
         return E_OUTOFMEMORY;
     }
 
-    // Create a place to store our transformed frame matrices
-    m_pTransformedFrameMatrices = new (std::nothrow) XMFLOAT4X4[ m_pMeshHeader->NumFrames ];
-    if( !m_pTransformedFrameMatrices )
+    for( size_t i = 0; i < m_DrawList.size(); ++i )
     {
-        return E_OUTOFMEMORY;
+        UINT iSubset = m_pMeshArray[ m_DrawList[i].Mesh ].pSubsets[ m_DrawList[i].Subset ];
+        auto& center = m_SubsetBBoxCenters[iSubset];
+        auto& extents = m_SubsetBBoxExtents[iSubset];
+
+        auto pGroup = reinterpret_cast<float*>( &m_DrawBounds[ ( i / 4 ) * 6 ] );
+        size_t lane = i % 4;
+        pGroup[ lane ] = center.x;
+        pGroup[ 4 + lane ] = center.y;
+        pGroup[ 8 + lane ] = center.z;
+        pGroup[ 12 + lane ] = extents.x;
+        pGroup[ 16 + lane ] = extents.y;
+        pGroup[ 20 + lane ] = extents.z;
     }
 
-    m_pWorldPoseFrameMatrices = new (std::nothrow) XMFLOAT4X4[ m_pMeshHeader->NumFrames ];
-    if( !m_pWorldPoseFrameMatrices )
+    return S_OK;
+}
+
+
+//--------------------------------------------------------------------------------------
+// local transform of a frame at the given point in the animation
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+XMMATRIX CDXUTSDKMesh::GetLocalFrameTransform( UINT iFrame, const AnimationSample& sample ) const
+{
+    UINT iAnimation = m_pFrameArray[iFrame].AnimationDataIndex;
+    if( INVALID_ANIMATION_DATA == iAnimation )
+        return XMLoadFloat4x4( &m_pFrameArray[iFrame].Matrix );
+
+    XMVECTOR quat;
+    XMVECTOR translation;
+
+    if( !m_AnimationTracks.empty() )
     {
-        return E_OUTOFMEMORY;
-    }
+        // Key times are counted from the first key played (key 1), and the last key of each track
+        // sits at NumAnimationKeys - 1, where playback wraps around
+        auto& track = m_AnimationTracks[ iAnimation ];
+        auto pTimes = &m_AnimationKeyTimes[ track.FirstKey ];
+        auto pKeys = &m_AnimationKeys[ track.FirstKey ];
 
-    SDKMESH_SUBSET* pSubset = nullptr;
-    D3D11_PRIMITIVE_TOPOLOGY PrimType;
-
-    // update bounding volume 
-    SDKMESH_MESH* currentMesh = &m_pMeshArray[0];
-    for (UINT meshi=0; meshi < m_pMeshHeader->NumMeshes; ++meshi) {
-        lower.x = FLT_MAX; lower.y = FLT_MAX; lower.z = FLT_MAX;
-        upper.x = -FLT_MAX; upper.y = -FLT_MAX; upper.z = -FLT_MAX;
-        currentMesh = GetMesh( meshi );
-        INT indsize;
-        if (m_pIndexBufferArray[currentMesh->IndexBuffer].IndexType == IT_16BIT ) {
-            indsize = 2;
-        }else {
-            indsize = 4;        
-        }
+        UINT iPosition = sample.Key0 - 1;
+        UINT iKey = static_cast<UINT>( std::upper_bound( pTimes, pTimes + track.NumKeys, iPosition ) - pTimes ) - 1;
+        iKey = std::min( iKey, track.NumKeys - 2 );
 
-        for( UINT subset = 0; subset < currentMesh->NumSubsets; subset++ )
-        {
-            pSubset = GetSubset( meshi, subset ); //&m_pSubsetArray[ currentMesh->pSubsets[subset] ];
+        float fSpan = static_cast<float>( pTimes[iKey + 1] - pTimes[iKey] );
+        float fLerp = ( static_cast<float>( iPosition - pTimes[iKey] ) + sample.Lerp ) / fSpan;
 
-            PrimType = GetPrimitiveType11( ( SDKMESH_PRIMITIVE_TYPE )pSubset->PrimitiveType );
-            assert( PrimType == D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST );// only triangle lists are handled.
+        quat = XMQuaternionSlerp( DecodeRotation( pKeys[iKey] ), DecodeRotation( pKeys[iKey + 1] ), fLerp );
+        translation = XMVectorLerp( DecodeTranslation( pKeys[iKey], track ), DecodeTranslation( pKeys[iKey + 1], track ), fLerp );
+    }
+    else
+    {
+        auto pFrameData = &m_pAnimationFrameData[ iAnimation ];
+        auto pData = &pFrameData->pAnimationData[ sample.Key0 ];
 
-            UINT IndexCount = ( UINT )pSubset->IndexCount;
-            UINT IndexStart = ( UINT )pSubset->IndexStart;
+        quat = LoadKeyRotation( *pData );
+        translation = XMLoadFloat3( &pData->Translation );
 
-            /*if( bAdjacent )
-            {
-                IndexCount *= 2;
-                IndexStart *= 2;
-            }*/
-     
-        //BYTE* pIndices = nullptr;
-            //m_ppIndices[i]
-            UINT *ind = ( UINT * )m_ppIndices[currentMesh->IndexBuffer];
-            float *verts =  ( float* )m_ppVertices[currentMesh->VertexBuffers[0]];
-            UINT stride = (UINT)m_pVertexBufferArray[currentMesh->VertexBuffers[0]].StrideBytes;
-            assert (stride % 4 == 0);
-            stride /=4;
-            for (UINT vertind = IndexStart; vertind < IndexStart + IndexCount; ++vertind) {
-                UINT current_ind=0;
-                if (indsize == 2) {
-                    UINT ind_div2 = vertind / 2;
-                    current_ind = ind[ind_div2];
-                    if (vertind %2 ==0) {
-                        current_ind = current_ind << 16;
-                        current_ind = current_ind >> 16;
-                    }else {
-                        current_ind = current_ind >> 16;
-                    }
-                }else {
-                    current_ind = ind[vertind];
-                }
-                XMFLOAT3 *pt = (XMFLOAT3*)&(verts[stride * current_ind]);
-                if (pt->x < lower.x) {
-                    lower.x = pt->x;
-                }
-                if (pt->y < lower.y) {
-                    lower.y = pt->y;
-                }
-                if (pt->z < lower.z) {
-                    lower.z = pt->z;
-                }
-                if (pt->x > upper.x) {
-                    upper.x = pt->x;
-                }
-                if (pt->y > upper.y) {
-                    upper.y = pt->y;
-                }
-                if (pt->z > upper.z) {
-                    upper.z = pt->z;
-                }
-                //BYTE** m_ppVertices;
-                //BYTE** m_ppIndices;
-            }
-            //pd3dDeviceContext->DrawIndexed( IndexCount, IndexStart, VertexStart );
+        if( sample.Lerp > 0.f )
+        {
+            auto pNext = &pFrameData->pAnimationData[ sample.Key1 ];
+            quat = XMQuaternionSlerp( quat, LoadKeyRotation( *pNext ), sample.Lerp );
+            translation = XMVectorLerp( translation, XMLoadFloat3( &pNext->Translation ), sample.Lerp );
         }
+    }
+
+    // Rotation, then translation (scaling is ignored, as in TransformFrame)
+    XMMATRIX mLocal = XMMatrixRotationQuaternion( XMQuaternionNormalize( quat ) );
+    mLocal.r[3] = XMVectorSelect( g_XMIdentityR3, translation, g_XMSelect1110 );
+    return mLocal;
+}
+
 
-        XMFLOAT3 half( ( upper.x - lower.x ) * 0.5f,
-                       ( upper.y - lower.y ) * 0.5f,
-                       ( upper.z - lower.z ) * 0.5f );
+//--------------------------------------------------------------------------------------
+// transform the bind pose with a linear pass over the flattened hierarchy
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+void CDXUTSDKMesh::TransformBindPose( CXMMATRIX world )
+{
+    if( !m_pBindPoseFrameMatrices )
+        return;
 
-        currentMesh->BoundingBoxCenter.x = lower.x + half.x;
-        currentMesh->BoundingBoxCenter.y = lower.y + half.y;
-        currentMesh->BoundingBoxCenter.z = lower.z + half.z;
+    for( size_t i = 0; i < m_FrameOrder.size(); ++i )
+    {
+        UINT iFrame = m_FrameOrder[i];
+        UINT iParent = m_FrameParent[i];
 
-        currentMesh->BoundingBoxExtents = half;
+        XMMATRIX mParent = ( iParent == INVALID_FRAME ) ? world : XMLoadFloat4x4( &m_pBindPoseFrameMatrices[iParent] );
+        XMMATRIX mLocalWorld = XMMatrixMultiply( XMLoadFloat4x4( &m_pFrameArray[iFrame].Matrix ), mParent );
 
+        XMStoreFloat4x4( &m_pBindPoseFrameMatrices[iFrame], mLocalWorld );
+        XMStoreFloat4x4( &m_pInvBindPoseFrameMatrices[iFrame], XMMatrixInverse( nullptr, mLocalWorld ) );
     }
-    // Update 
-        
-    return S_OK;
 }
 
 
@@ -465,6 +1528,7 @@ void CDXUTSDKMesh::TransformBindPoseFrame( UINT iFrame, CXMMATRIX parentWorld )
     XMMATRIX m = XMLoadFloat4x4( &m_pFrameArray[iFrame].Matrix );
     XMMATRIX mLocalWorld = XMMatrixMultiply( m, parentWorld );
     XMStoreFloat4x4( &m_pBindPoseFrameMatrices[iFrame], mLocalWorld );
+    XMStoreFloat4x4( &m_pInvBindPoseFrameMatrices[iFrame], XMMatrixInverse( nullptr, mLocalWorld ) );
 
     // Transform our siblings
     if( m_pFrameArray[iFrame].SiblingFrame != INVALID_FRAME )
@@ -486,31 +1550,8 @@ void CDXUTSDKMesh::TransformBindPoseFrame( UINT iFrame, CXMMATRIX parentWorld )
 _Use_decl_annotations_
 void CDXUTSDKMesh::TransformFrame( UINT iFrame, CXMMATRIX parentWorld, double fTime )
 {
-    // Get the tick data
-    XMMATRIX mLocalTransform;
-
-    UINT iTick = GetAnimationKeyFromTime( fTime );
-
-    if( INVALID_ANIMATION_DATA != m_pFrameArray[iFrame].AnimationDataIndex )
-    {
-        auto pFrameData = &m_pAnimationFrameData[ m_pFrameArray[iFrame].AnimationDataIndex ];
-        auto pData = &pFrameData->pAnimationData[ iTick ];
-
-        // turn it into a matrix (Ignore scaling for now)
-        XMFLOAT3 parentPos = pData->Translation;
-        XMMATRIX mTranslate = XMMatrixTranslation( parentPos.x, parentPos.y, parentPos.z );
-
-        XMVECTOR quat = XMVectorSet( pData->Orientation.x, pData->Orientation.y, pData->Orientation.z, pData->Orientation.w );
-        if ( XMVector4Equal( quat, g_XMZero ) )
-            quat = XMQuaternionIdentity();
-        quat = XMQuaternionNormalize( quat );
-        XMMATRIX mQuat = XMMatrixRotationQuaternion( quat );
-        mLocalTransform = ( mQuat * mTranslate );
-    }
-    else
-    {
-        mLocalTransform = XMLoadFloat4x4( &m_pFrameArray[iFrame].Matrix );
-    }
+    // Get the tick data (Ignore scaling for now)
+    XMMATRIX mLocalTransform = GetLocalFrameTransform( iFrame, GetAnimationSample( fTime, false ) );
 
     // Transform ourselves
     XMMATRIX mLocalWorld = XMMatrixMultiply( mLocalTransform, parentWorld );
@@ -541,40 +1582,48 @@ void CDXUTSDKMesh::TransformFrameAbsolute( UINT iFrame, double fTime )
 
     if( INVALID_ANIMATION_DATA != m_pFrameArray[iFrame].AnimationDataIndex )
     {
-        auto pFrameData = &m_pAnimationFrameData[ m_pFrameArray[iFrame].AnimationDataIndex ];
-        auto pData = &pFrameData->pAnimationData[ iTick ];
-        auto pDataOrig = &pFrameData->pAnimationData[ 0 ];
+        XMStoreFloat4x4( &m_pTransformedFrameMatrices[iFrame], GetAbsoluteFrameTransform( iFrame, iTick ) );
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// absolute transformation of an animated frame from its first key to the given key
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+XMMATRIX CDXUTSDKMesh::GetAbsoluteFrameTransform( UINT iFrame, UINT iTick ) const
+{
+    auto pFrameData = &m_pAnimationFrameData[ m_pFrameArray[iFrame].AnimationDataIndex ];
+    auto pData = &pFrameData->pAnimationData[ iTick ];
+    auto pDataOrig = &pFrameData->pAnimationData[ 0 ];
 
-        XMMATRIX mTrans1 = XMMatrixTranslation( -pDataOrig->Translation.x, -pDataOrig->Translation.y, -pDataOrig->Translation.z );
-        XMMATRIX mTrans2 = XMMatrixTranslation( pData->Translation.x, pData->Translation.y, pData->Translation.z );
+    XMMATRIX mTrans1 = XMMatrixTranslation( -pDataOrig->Translation.x, -pDataOrig->Translation.y, -pDataOrig->Translation.z );
+    XMMATRIX mTrans2 = XMMatrixTranslation( pData->Translation.x, pData->Translation.y, pData->Translation.z );
 
-        XMVECTOR quat1 = XMVectorSet( pDataOrig->Orientation.x, pDataOrig->Orientation.y, pDataOrig->Orientation.z, pDataOrig->Orientation.w );
-        quat1 = XMQuaternionInverse( quat1 );
-        XMMATRIX mRot1 = XMMatrixRotationQuaternion( quat1 );
-        XMMATRIX mInvTo = mTrans1 * mRot1;
+    XMVECTOR quat1 = XMVectorSet( pDataOrig->Orientation.x, pDataOrig->Orientation.y, pDataOrig->Orientation.z, pDataOrig->Orientation.w );
+    quat1 = XMQuaternionInverse( quat1 );
+    XMMATRIX mRot1 = XMMatrixRotationQuaternion( quat1 );
+    XMMATRIX mInvTo = mTrans1 * mRot1;
 
-        XMVECTOR quat2 = XMVectorSet( pData->Orientation.x, pData->Orientation.y, pData->Orientation.z, pData->Orientation.w );
-        XMMATRIX mRot2 = XMMatrixRotationQuaternion( quat2 );
-        XMMATRIX mFrom = mRot2 * mTrans2;
+    XMVECTOR quat2 = XMVectorSet( pData->Orientation.x, pData->Orientation.y, pData->Orientation.z, pData->Orientation.w );
+    XMMATRIX mRot2 = XMMatrixRotationQuaternion( quat2 );
+    XMMATRIX mFrom = mRot2 * mTrans2;
 
-        XMMATRIX mOutput = mInvTo * mFrom;
-        XMStoreFloat4x4( &m_pTransformedFrameMatrices[iFrame], mOutput );
-    }
+    return mInvTo * mFrom;
 }
 
 #define MAX_D3D11_VERTEX_STREAMS D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT
 
+//--------------------------------------------------------------------------------------
+// Binds the vertex and index buffers of a mesh; false if they are not ready to draw
 //--------------------------------------------------------------------------------------
 _Use_decl_annotations_
-void CDXUTSDKMesh::RenderMesh( UINT iMesh,
-                               bool bAdjacent,
-                               ID3D11DeviceContext* pd3dDeviceContext,
-                               UINT iDiffuseSlot,
-                               UINT iNormalSlot,
-                               UINT iSpecularSlot )
+bool CDXUTSDKMesh::BindMesh( UINT iMesh,
+                             bool bAdjacent,
+                             ID3D11DeviceContext* pd3dDeviceContext )
 {
     if( 0 < GetOutstandingBufferResources() )
-        return;
+        return false;
 
     auto pMesh = &m_pMeshArray[iMesh];
 
@@ -583,7 +1632,7 @@ void CDXUTSDKMesh::RenderMesh( UINT iMesh,
     ID3D11Buffer* pVB[MAX_D3D11_VERTEX_STREAMS];
 
     if( pMesh->NumVertexBuffers > MAX_D3D11_VERTEX_STREAMS )
-        return;
+        return false;
 
     for( UINT64 i = 0; i < pMesh->NumVertexBuffers; i++ )
     {
@@ -613,54 +1662,80 @@ void CDXUTSDKMesh::RenderMesh( UINT iMesh,
     pd3dDeviceContext->IASetVertexBuffers( 0, pMesh->NumVertexBuffers, pVB, Strides, Offsets );
     pd3dDeviceContext->IASetIndexBuffer( pIB, ibFormat, 0 );
 
-    SDKMESH_SUBSET* pSubset = nullptr;
-    SDKMESH_MATERIAL* pMat = nullptr;
-    D3D11_PRIMITIVE_TOPOLOGY PrimType;
+    return true;
+}
 
-    for( UINT subset = 0; subset < pMesh->NumSubsets; subset++ )
-    {
-        pSubset = &m_pSubsetArray[ pMesh->pSubsets[subset] ];
+//--------------------------------------------------------------------------------------
+// Draws one subset of the mesh last bound by BindMesh
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+void CDXUTSDKMesh::RenderSubset( UINT iMesh,
+                                 UINT iSubset,
+                                 bool bAdjacent,
+                                 ID3D11DeviceContext* pd3dDeviceContext,
+                                 UINT iDiffuseSlot,
+                                 UINT iNormalSlot,
+                                 UINT iSpecularSlot )
+{
+    auto pSubset = &m_pSubsetArray[ m_pMeshArray[iMesh].pSubsets[iSubset] ];
 
-        PrimType = GetPrimitiveType11( ( SDKMESH_PRIMITIVE_TYPE )pSubset->PrimitiveType );
-        if( bAdjacent )
+    D3D11_PRIMITIVE_TOPOLOGY PrimType = GetPrimitiveType11( ( SDKMESH_PRIMITIVE_TYPE )pSubset->PrimitiveType );
+    if( bAdjacent )
+    {
+        switch( PrimType )
         {
-            switch( PrimType )
-            {
-            case D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST:
-                PrimType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST_ADJ;
-                break;
-            case D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP:
-                PrimType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP_ADJ;
-                break;
-            case D3D11_PRIMITIVE_TOPOLOGY_LINELIST:
-                PrimType = D3D11_PRIMITIVE_TOPOLOGY_LINELIST_ADJ;
-                break;
-            case D3D11_PRIMITIVE_TOPOLOGY_LINESTRIP:
-                PrimType = D3D11_PRIMITIVE_TOPOLOGY_LINESTRIP_ADJ;
-                break;
-            }
+        case D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST:
+            PrimType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST_ADJ;
+            break;
+        case D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP:
+            PrimType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP_ADJ;
+            break;
+        case D3D11_PRIMITIVE_TOPOLOGY_LINELIST:
+            PrimType = D3D11_PRIMITIVE_TOPOLOGY_LINELIST_ADJ;
+            break;
+        case D3D11_PRIMITIVE_TOPOLOGY_LINESTRIP:
+            PrimType = D3D11_PRIMITIVE_TOPOLOGY_LINESTRIP_ADJ;
+            break;
         }
+    }
 
-        pd3dDeviceContext->IASetPrimitiveTopology( PrimType );
+    pd3dDeviceContext->IASetPrimitiveTopology( PrimType );
 
-        pMat = &m_pMaterialArray[ pSubset->MaterialID ];
-        if( iDiffuseSlot != INVALID_SAMPLER_SLOT && !IsErrorResource( pMat->pDiffuseRV11 ) )
-            pd3dDeviceContext->PSSetShaderResources( iDiffuseSlot, 1, &pMat->pDiffuseRV11 );
-        if( iNormalSlot != INVALID_SAMPLER_SLOT && !IsErrorResource( pMat->pNormalRV11 ) )
-            pd3dDeviceContext->PSSetShaderResources( iNormalSlot, 1, &pMat->pNormalRV11 );
-        if( iSpecularSlot != INVALID_SAMPLER_SLOT && !IsErrorResource( pMat->pSpecularRV11 ) )
-            pd3dDeviceContext->PSSetShaderResources( iSpecularSlot, 1, &pMat->pSpecularRV11 );
+    auto pMat = &m_pMaterialArray[ pSubset->MaterialID ];
+    if( iDiffuseSlot != INVALID_SAMPLER_SLOT && !IsErrorResource( pMat->pDiffuseRV11 ) )
+        pd3dDeviceContext->PSSetShaderResources( iDiffuseSlot, 1, &pMat->pDiffuseRV11 );
+    if( iNormalSlot != INVALID_SAMPLER_SLOT && !IsErrorResource( pMat->pNormalRV11 ) )
+        pd3dDeviceContext->PSSetShaderResources( iNormalSlot, 1, &pMat->pNormalRV11 );
+    if( iSpecularSlot != INVALID_SAMPLER_SLOT && !IsErrorResource( pMat->pSpecularRV11 ) )
+        pd3dDeviceContext->PSSetShaderResources( iSpecularSlot, 1, &pMat->pSpecularRV11 );
 
-        UINT IndexCount = ( UINT )pSubset->IndexCount;
-        UINT IndexStart = ( UINT )pSubset->IndexStart;
-        UINT VertexStart = ( UINT )pSubset->VertexStart;
-        if( bAdjacent )
-        {
-            IndexCount *= 2;
-            IndexStart *= 2;
-        }
+    UINT IndexCount = ( UINT )pSubset->IndexCount;
+    UINT IndexStart = ( UINT )pSubset->IndexStart;
+    UINT VertexStart = ( UINT )pSubset->VertexStart;
+    if( bAdjacent )
+    {
+        IndexCount *= 2;
+        IndexStart *= 2;
+    }
 
-        pd3dDeviceContext->DrawIndexed( IndexCount, IndexStart, VertexStart );
+    pd3dDeviceContext->DrawIndexed( IndexCount, IndexStart, VertexStart );
+}
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+void CDXUTSDKMesh::RenderMesh( UINT iMesh,
+                               bool bAdjacent,
+                               ID3D11DeviceContext* pd3dDeviceContext,
+                               UINT iDiffuseSlot,
+                               UINT iNormalSlot,
+                               UINT iSpecularSlot )
+{
+    if( !BindMesh( iMesh, bAdjacent, pd3dDeviceContext ) )
+        return;
+
+    for( UINT subset = 0; subset < m_pMeshArray[iMesh].NumSubsets; subset++ )
+    {
+        RenderSubset( iMesh, subset, bAdjacent, pd3dDeviceContext, iDiffuseSlot, iNormalSlot, iSpecularSlot );
     }
 }
 
@@ -701,7 +1776,6 @@ void CDXUTSDKMesh::RenderFrame( UINT iFrame,
 CDXUTSDKMesh::CDXUTSDKMesh() noexcept :
     m_NumOutstandingResources(0),
     m_bLoading(false),
-    m_hFile(0),
     m_pDev11(nullptr),
     m_pStaticMeshData(nullptr),
     m_pHeapData(nullptr),
@@ -718,11 +1792,18 @@ CDXUTSDKMesh::CDXUTSDKMesh() noexcept :
     m_pFrameArray(nullptr),
     m_pMaterialArray(nullptr),
     m_pAdjacencyIndexBufferArray(nullptr),
+    m_pVertexQuantization(nullptr),
+    m_pDecodedVertexData(nullptr),
+    m_pMeshletHeader(nullptr),
+    m_pSubsetMeshlets(nullptr),
+    m_pMeshlets(nullptr),
     m_pAnimationHeader(nullptr),
     m_pAnimationFrameData(nullptr),
     m_pBindPoseFrameMatrices(nullptr),
+    m_pInvBindPoseFrameMatrices(nullptr),
     m_pTransformedFrameMatrices(nullptr),
-    m_pWorldPoseFrameMatrices(nullptr)
+    m_pWorldPoseFrameMatrices(nullptr),
+    m_MeshletCullStats{}
 {
 }
 
@@ -747,6 +1828,21 @@ HRESULT CDXUTSDKMesh::Create( ID3D11Device* pDev11, BYTE* pData, size_t DataByte
     return CreateFromMemory( pDev11, pData, DataBytes, bCopyStatic, pLoaderCallbacks );
 }
 
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT CDXUTSDKMesh::Create( ID3D11Device* pDev11, LPCWSTR szFilePath, SDKMeshData&& meshData, SDKMESH_CALLBACKS11* pLoaderCallbacks )
+{
+    if( !szFilePath || !meshData.IsOpen() )
+        return E_INVALIDARG;
+
+    if( wcscpy_s( m_strPathW, MAX_PATH, szFilePath ) )
+        return E_INVALIDARG;
+
+    m_MeshData = std::move( meshData );
+
+    return CreateFromMeshData( pDev11, pLoaderCallbacks );
+}
+
 
 //--------------------------------------------------------------------------------------
 HRESULT CDXUTSDKMesh::LoadAnimation( _In_z_ const WCHAR* szFileName )
@@ -798,6 +1894,10 @@ HRESULT CDXUTSDKMesh::LoadAnimation( _In_z_ const WCHAR* szFileName )
     }
 
     // pointer fixup
+    m_AnimationTracks.clear();
+    m_AnimationKeyTimes.clear();
+    m_AnimationKeys.clear();
+
     m_pAnimationHeader = ( SDKANIMATION_FILE_HEADER* )m_pAnimationData;
     m_pAnimationFrameData = ( SDKANIMATION_FRAME_DATA* )( m_pAnimationData + m_pAnimationHeader->AnimationDataOffset );
 
@@ -817,6 +1917,161 @@ HRESULT CDXUTSDKMesh::LoadAnimation( _In_z_ const WCHAR* szFileName )
     return S_OK;
 }
 
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT CDXUTSDKMesh::CompressAnimation( float fRotationTolerance, float fTranslationTolerance )
+{
+    if( fRotationTolerance < 0.f || fTranslationTolerance < 0.f )
+        return E_INVALIDARG;
+
+    if( !m_pAnimationHeader )
+        return E_UNEXPECTED;
+
+    if( !m_AnimationTracks.empty() )
+        return S_FALSE;
+
+    const UINT numKeys = m_pAnimationHeader->NumAnimationKeys;
+    if( FTT_RELATIVE != m_pAnimationHeader->FrameTransformType || numKeys < 2 || numKeys - 1 > USHRT_MAX )
+        return HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED );
+
+    // Each track covers the keys played (1 to numKeys - 1) and ends with key 1 again at time
+    // lastKey, so that sampling never has to wrap
+    const UINT numFrames = m_pAnimationHeader->NumFrames;
+    const UINT lastKey = numKeys - 1;
+    const float fMinDot = cosf( fRotationTolerance * 0.5f );
+    const float fMaxDistSq = fTranslationTolerance * fTranslationTolerance;
+
+    std::vector<SDKANIMATION_COMPRESSED_TRACK> tracks;
+    std::vector<USHORT> keyTimes;
+    std::vector<SDKANIMATION_COMPRESSED_KEY> keys;
+
+    try
+    {
+        tracks.resize( numFrames );
+
+        std::vector<SDKANIMATION_COMPRESSED_KEY> encoded( lastKey + 1 );
+        std::vector<XMFLOAT4> rotations( lastKey + 1 );
+        std::vector<XMFLOAT3> translations( lastKey + 1 );
+
+        for( UINT iTrack = 0; iTrack < numFrames; ++iTrack )
+        {
+            auto pData = m_pAnimationFrameData[iTrack].pAnimationData;
+            auto& track = tracks[iTrack];
+
+            // Per-track translation range
+            XMVECTOR vMin = g_XMFltMax;
+            XMVECTOR vMax = XMVectorNegate( g_XMFltMax );
+            for( UINT t = 0; t < lastKey; ++t )
+            {
+                XMVECTOR pos = XMLoadFloat3( &pData[t + 1].Translation );
+                vMin = XMVectorMin( vMin, pos );
+                vMax = XMVectorMax( vMax, pos );
+            }
+
+            XMVECTOR vScale = XMVectorScale( XMVectorSubtract( vMax, vMin ), 1.f / 65535.f );
+            XMVECTOR vInvScale = XMVectorSelect( XMVectorReciprocal( vScale ), g_XMZero, XMVectorEqual( vScale, g_XMZero ) );
+            XMStoreFloat3( &track.TranslationMin, vMin );
+            XMStoreFloat3( &track.TranslationScale, vScale );
+
+            // Quantize every key, keeping the decoded values to measure the reduction against
+            for( UINT t = 0; t <= lastKey; ++t )
+            {
+                auto& key = pData[ ( t < lastKey ) ? t + 1 : 1 ];
+
+                EncodeRotation( LoadKeyRotation( key ), encoded[t].Rotation );
+
+                XMFLOAT3 q;
+                XMStoreFloat3( &q, XMVectorMultiply( XMVectorSubtract( XMLoadFloat3( &key.Translation ), vMin ), vInvScale ) );
+                encoded[t].Translation[0] = QuantizeUnorm( q.x, 65535.f );
+                encoded[t].Translation[1] = QuantizeUnorm( q.y, 65535.f );
+                encoded[t].Translation[2] = QuantizeUnorm( q.z, 65535.f );
+
+                XMStoreFloat4( &rotations[t], DecodeRotation( encoded[t] ) );
+                XMStoreFloat3( &translations[t], DecodeTranslation( encoded[t], track ) );
+            }
+
+            // True if interpolating between keys iStart and iEnd reproduces every key in between
+            auto segmentFits = [&]( UINT iStart, UINT iEnd ) -> bool
+            {
+                XMVECTOR q0 = XMLoadFloat4( &rotations[iStart] );
+                XMVECTOR q1 = XMLoadFloat4( &rotations[iEnd] );
+                XMVECTOR t0 = XMLoadFloat3( &translations[iStart] );
+                XMVECTOR t1 = XMLoadFloat3( &translations[iEnd] );
+
+                float fInvSpan = 1.f / static_cast<float>( iEnd - iStart );
+                for( UINT t = iStart + 1; t < iEnd; ++t )
+                {
+                    float fLerp = static_cast<float>( t - iStart ) * fInvSpan;
+
+                    XMVECTOR quat = XMQuaternionNormalize( XMQuaternionSlerp( q0, q1, fLerp ) );
+                    if( fabsf( XMVectorGetX( XMQuaternionDot( quat, XMLoadFloat4( &rotations[t] ) ) ) ) < fMinDot )
+                        return false;
+
+                    XMVECTOR delta = XMVectorSubtract( XMVectorLerp( t0, t1, fLerp ), XMLoadFloat3( &translations[t] ) );
+                    if( XMVectorGetX( XMVector3LengthSq( delta ) ) > fMaxDistSq )
+                        return false;
+                }
+                return true;
+            };
+
+            // Greedy key reduction: each segment grows for as long as it still fits
+            track.FirstKey = static_cast<UINT>( keys.size() );
+            keyTimes.push_back( 0 );
+            keys.push_back( encoded[0] );
+
+            for( UINT iStart = 0; iStart < lastKey; )
+            {
+                UINT iEnd = iStart + 1;
+                while( iEnd < lastKey && ( iEnd + 1 - iStart ) <= c_MaxKeySpan && segmentFits( iStart, iEnd + 1 ) )
+                    ++iEnd;
+
+                keyTimes.push_back( static_cast<USHORT>( iEnd ) );
+                keys.push_back( encoded[iEnd] );
+                iStart = iEnd;
+            }
+
+            track.NumKeys = static_cast<UINT>( keys.size() ) - track.FirstKey;
+        }
+
+        keyTimes.shrink_to_fit();
+        keys.shrink_to_fit();
+    }
+    catch( const std::bad_alloc& )
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    // Only the header and frame table of the original animation are still needed
+    size_t frameBytes = sizeof( SDKANIMATION_FRAME_DATA ) * numFrames;
+    auto pAnimationData = new (std::nothrow) BYTE[ sizeof( SDKANIMATION_FILE_HEADER ) + frameBytes ];
+    if( !pAnimationData )
+        return E_OUTOFMEMORY;
+
+    memcpy( pAnimationData, m_pAnimationHeader, sizeof( SDKANIMATION_FILE_HEADER ) );
+    memcpy( pAnimationData + sizeof( SDKANIMATION_FILE_HEADER ), m_pAnimationFrameData, frameBytes );
+
+    SAFE_DELETE_ARRAY( m_pAnimationData );
+    m_pAnimationData = pAnimationData;
+
+    m_pAnimationHeader = ( SDKANIMATION_FILE_HEADER* )m_pAnimationData;
+    m_pAnimationHeader->AnimationDataOffset = sizeof( SDKANIMATION_FILE_HEADER );
+    m_pAnimationHeader->AnimationDataSize = frameBytes;
+
+    m_pAnimationFrameData = ( SDKANIMATION_FRAME_DATA* )( m_pAnimationData + sizeof( SDKANIMATION_FILE_HEADER ) );
+    for( UINT i = 0; i < numFrames; i++ )
+    {
+        m_pAnimationFrameData[i].pAnimationData = nullptr;
+    }
+
+    m_AnimationTracks = std::move( tracks );
+    m_AnimationKeyTimes = std::move( keyTimes );
+    m_AnimationKeys = std::move( keys );
+
+    return S_OK;
+}
+
+
 //--------------------------------------------------------------------------------------
 void CDXUTSDKMesh::Destroy()
 {
@@ -877,13 +2132,36 @@ void CDXUTSDKMesh::Destroy()
 
     SAFE_DELETE_ARRAY( m_pHeapData );
     m_pStaticMeshData = nullptr;
+    m_MeshData.Close();
     SAFE_DELETE_ARRAY( m_pAnimationData );
     SAFE_DELETE_ARRAY( m_pBindPoseFrameMatrices );
+    SAFE_DELETE_ARRAY( m_pInvBindPoseFrameMatrices );
     SAFE_DELETE_ARRAY( m_pTransformedFrameMatrices );
     SAFE_DELETE_ARRAY( m_pWorldPoseFrameMatrices );
 
     SAFE_DELETE_ARRAY( m_ppVertices );
     SAFE_DELETE_ARRAY( m_ppIndices );
+    SAFE_DELETE_ARRAY( m_pDecodedVertexData );
+    m_pVertexQuantization = nullptr;
+    m_pMeshletHeader = nullptr;
+    m_pSubsetMeshlets = nullptr;
+    m_pMeshlets = nullptr;
+
+    m_FrameNameIndex.clear();
+    m_FrameOrder.clear();
+    m_FrameParent.clear();
+
+    m_SubsetBBoxCenters.clear();
+    m_SubsetBBoxExtents.clear();
+    m_DrawList.clear();
+    m_DrawBounds.clear();
+    m_VisibleDraws.clear();
+    m_VisibleMeshlets.clear();
+    m_MeshletCullStats = {};
+
+    m_AnimationTracks.clear();
+    m_AnimationKeyTimes.clear();
+    m_AnimationKeys.clear();
 
     m_pMeshHeader = nullptr;
     m_pVertexBufferArray = nullptr;
@@ -904,26 +2182,57 @@ void CDXUTSDKMesh::Destroy()
 //--------------------------------------------------------------------------------------
 _Use_decl_annotations_
 void CDXUTSDKMesh::TransformMesh( CXMMATRIX world, double fTime )
+{
+    if( !m_pWorldPoseFrameMatrices )
+        return;
+
+    EvaluatePose( world, fTime, m_pWorldPoseFrameMatrices, m_pTransformedFrameMatrices );
+}
+
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+void CDXUTSDKMesh::TransformMesh( CDXUTSDKMeshPose& pose, CXMMATRIX world, double fTime ) const
+{
+    if( !pose.m_pWorldPoseFrameMatrices || pose.m_NumFrames != GetNumFrames() )
+        return;
+
+    EvaluatePose( world, fTime, pose.m_pWorldPoseFrameMatrices, pose.m_pTransformedFrameMatrices );
+}
+
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+void CDXUTSDKMesh::EvaluatePose( CXMMATRIX world, double fTime, XMFLOAT4X4* pWorldPose, XMFLOAT4X4* pTransformed ) const
 {
     if( !m_pAnimationHeader || FTT_RELATIVE == m_pAnimationHeader->FrameTransformType )
     {
-        TransformFrame( 0, world, fTime );
+        AnimationSample sample = GetAnimationSample( fTime, true );
 
-        // For each frame, move the transform to the bind pose, then
-        // move it to the final position
-        for( UINT i = 0; i < m_pMeshHeader->NumFrames; i++ )
+        // Parents always precede their children, so a single pass yields every world matrix. Each
+        // frame is then moved to the bind pose and on to its final position.
+        for( size_t i = 0; i < m_FrameOrder.size(); ++i )
         {
-            XMMATRIX m = XMLoadFloat4x4( &m_pBindPoseFrameMatrices[i] );
-            XMMATRIX mInvBindPose = XMMatrixInverse( nullptr, m );
-            m = XMLoadFloat4x4( &m_pTransformedFrameMatrices[i] );
-            XMMATRIX mFinal = mInvBindPose * m;
-            XMStoreFloat4x4( &m_pTransformedFrameMatrices[i], mFinal );
+            UINT iFrame = m_FrameOrder[i];
+            UINT iParent = m_FrameParent[i];
+
+            XMMATRIX mParent = ( iParent == INVALID_FRAME ) ? world : XMLoadFloat4x4( &pWorldPose[iParent] );
+            XMMATRIX mLocalWorld = XMMatrixMultiply( GetLocalFrameTransform( iFrame, sample ), mParent );
+            XMStoreFloat4x4( &pWorldPose[iFrame], mLocalWorld );
+
+            XMMATRIX mInvBindPose = XMLoadFloat4x4( &m_pInvBindPoseFrameMatrices[iFrame] );
+            XMStoreFloat4x4( &pTransformed[iFrame], XMMatrixMultiply( mInvBindPose, mLocalWorld ) );
         }
     }
     else if( FTT_ABSOLUTE == m_pAnimationHeader->FrameTransformType )
     {
+        UINT iTick = GetAnimationKeyFromTime( fTime );
+
         for( UINT i = 0; i < m_pAnimationHeader->NumFrames; i++ )
-            TransformFrameAbsolute( i, fTime );
+        {
+            if( INVALID_ANIMATION_DATA != m_pFrameArray[i].AnimationDataIndex )
+                XMStoreFloat4x4( &pTransformed[i], GetAbsoluteFrameTransform( i, iTick ) );
+        }
     }
 }
 
@@ -948,6 +2257,225 @@ void CDXUTSDKMesh::RenderAdjacent( ID3D11DeviceContext* pd3dDeviceContext,
     RenderFrame( 0, true, pd3dDeviceContext, iDiffuseSlot, iNormalSlot, iSpecularSlot );
 }
 
+//--------------------------------------------------------------------------------------
+// Tests four boxes against each clip plane at a time. The planes come from the columns of
+// worldViewProjection (D3D clip space, 0 <= z <= w) and so are in model space; a box is
+// outside a plane when its centre lies further behind it than the box's projected radius.
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+UINT CDXUTSDKMesh::CullSubsets( CXMMATRIX worldViewProjection )
+{
+    m_VisibleDraws.clear();
+    if( m_DrawList.empty() )
+        return 0;
+
+    XMMATRIX columns = XMMatrixTranspose( worldViewProjection );
+    const XMVECTOR planes[6] =
+    {
+        XMVectorAdd( columns.r[3], columns.r[0] ),        // left
+        XMVectorSubtract( columns.r[3], columns.r[0] ),   // right
+        XMVectorAdd( columns.r[3], columns.r[1] ),        // bottom
+        XMVectorSubtract( columns.r[3], columns.r[1] ),   // top
+        columns.r[2],                                     // near
+        XMVectorSubtract( columns.r[3], columns.r[2] ),   // far
+    };
+
+    XMVECTOR planeX[6], planeY[6], planeZ[6], planeW[6];
+    XMVECTOR absX[6], absY[6], absZ[6];
+    for( size_t p = 0; p < 6; ++p )
+    {
+        planeX[p] = XMVectorSplatX( planes[p] );
+        planeY[p] = XMVectorSplatY( planes[p] );
+        planeZ[p] = XMVectorSplatZ( planes[p] );
+        planeW[p] = XMVectorSplatW( planes[p] );
+        absX[p] = XMVectorAbs( planeX[p] );
+        absY[p] = XMVectorAbs( planeY[p] );
+        absZ[p] = XMVectorAbs( planeZ[p] );
+    }
+
+    const size_t numDraws = m_DrawList.size();
+    for( size_t first = 0; first < numDraws; first += 4 )
+    {
+        auto pGroup = &m_DrawBounds[ ( first / 4 ) * 6 ];
+        XMVECTOR centerX = XMLoadFloat4( &pGroup[0] );
+        XMVECTOR centerY = XMLoadFloat4( &pGroup[1] );
+        XMVECTOR centerZ = XMLoadFloat4( &pGroup[2] );
+        XMVECTOR extentsX = XMLoadFloat4( &pGroup[3] );
+        XMVECTOR extentsY = XMLoadFloat4( &pGroup[4] );
+        XMVECTOR extentsZ = XMLoadFloat4( &pGroup[5] );
+
+        XMVECTOR outside = XMVectorFalseInt();
+        for( size_t p = 0; p < 6; ++p )
+        {
+            XMVECTOR distance = XMVectorMultiplyAdd( centerX, planeX[p],
+                                XMVectorMultiplyAdd( centerY, planeY[p],
+                                XMVectorMultiplyAdd( centerZ, planeZ[p], planeW[p] ) ) );
+            XMVECTOR radius = XMVectorMultiplyAdd( extentsX, absX[p],
+                              XMVectorMultiplyAdd( extentsY, absY[p], XMVectorMultiply( extentsZ, absZ[p] ) ) );
+            outside = XMVectorOrInt( outside, XMVectorLess( XMVectorAdd( distance, radius ), g_XMZero ) );
+        }
+
+        XMUINT4 mask;
+        XMStoreUInt4( &mask, outside );
+        const UINT lanes[4] = { mask.x, mask.y, mask.z, mask.w };
+
+        size_t count = std::min<size_t>( 4, numDraws - first );
+        for( size_t lane = 0; lane < count; ++lane )
+        {
+            if( !lanes[lane] )
+                m_VisibleDraws.push_back( m_DrawList[ first + lane ] );
+        }
+    }
+
+    return static_cast<UINT>( m_VisibleDraws.size() );
+}
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+void CDXUTSDKMesh::RenderVisible( ID3D11DeviceContext* pd3dDeviceContext,
+                                  UINT iDiffuseSlot,
+                                  UINT iNormalSlot,
+                                  UINT iSpecularSlot )
+{
+    if( !m_pStaticMeshData )
+        return;
+
+    UINT iBoundMesh = INVALID_MESH;
+    for( auto& draw : m_VisibleDraws )
+    {
+        if( draw.Mesh != iBoundMesh )
+        {
+            if( !BindMesh( draw.Mesh, false, pd3dDeviceContext ) )
+                return;
+            iBoundMesh = draw.Mesh;
+        }
+
+        RenderSubset( draw.Mesh, draw.Subset, false, pd3dDeviceContext, iDiffuseSlot, iNormalSlot, iSpecularSlot );
+    }
+}
+
+//--------------------------------------------------------------------------------------
+UINT CDXUTSDKMesh::GetNumDrawSubsets() const
+{
+    return static_cast<UINT>( m_DrawList.size() );
+}
+
+//--------------------------------------------------------------------------------------
+UINT CDXUTSDKMesh::GetNumVisibleSubsets() const
+{
+    return static_cast<UINT>( m_VisibleDraws.size() );
+}
+
+//--------------------------------------------------------------------------------------
+const SDKMESH_SUBSET_DRAW* CDXUTSDKMesh::GetVisibleSubsets() const
+{
+    return m_VisibleDraws.data();
+}
+
+//--------------------------------------------------------------------------------------
+// Share of the subsets Render would draw that the last CullSubsets rejected, from 0 to 100
+//--------------------------------------------------------------------------------------
+float CDXUTSDKMesh::GetCulledPercentage() const
+{
+    if( m_DrawList.empty() )
+        return 0.f;
+
+    return 100.f * float( m_DrawList.size() - m_VisibleDraws.size() ) / float( m_DrawList.size() );
+}
+
+//--------------------------------------------------------------------------------------
+bool CDXUTSDKMesh::HasMeshlets() const
+{
+    return m_pMeshletHeader != nullptr;
+}
+
+//--------------------------------------------------------------------------------------
+// The sphere test uses normalized planes, so the distance compares with the radius. The
+// cone test is conservative for every point of the sphere: the meshlet faces away when
+// the direction from the eye to any of its points is within 90 degrees of every normal.
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+UINT CDXUTSDKMesh::CullMeshlets( CXMMATRIX worldViewProjection, FXMVECTOR eyePosition )
+{
+    m_VisibleMeshlets.clear();
+    m_MeshletCullStats = {};
+    if( !m_pMeshletHeader )
+        return 0;
+
+    XMMATRIX columns = XMMatrixTranspose( worldViewProjection );
+    const XMVECTOR planes[6] =
+    {
+        XMPlaneNormalize( XMVectorAdd( columns.r[3], columns.r[0] ) ),
+        XMPlaneNormalize( XMVectorSubtract( columns.r[3], columns.r[0] ) ),
+        XMPlaneNormalize( XMVectorAdd( columns.r[3], columns.r[1] ) ),
+        XMPlaneNormalize( XMVectorSubtract( columns.r[3], columns.r[1] ) ),
+        XMPlaneNormalize( columns.r[2] ),
+        XMPlaneNormalize( XMVectorSubtract( columns.r[3], columns.r[2] ) ),
+    };
+
+    for( auto& draw : m_VisibleDraws )
+    {
+        auto& range = m_pSubsetMeshlets[ m_pMeshArray[ draw.Mesh ].pSubsets[ draw.Subset ] ];
+
+        for( UINT i = range.FirstMeshlet; i < range.FirstMeshlet + range.NumMeshlets; ++i )
+        {
+            auto& meshlet = m_pMeshlets[i];
+            ++m_MeshletCullStats.Tested;
+
+            XMVECTOR center = XMVectorSetW( XMLoadFloat4( &meshlet.BoundingSphere ), 1.f );
+            XMVECTOR radius = XMVectorReplicate( meshlet.BoundingSphere.w );
+
+            XMVECTOR outside = XMVectorFalseInt();
+            for( size_t p = 0; p < 6; ++p )
+            {
+                outside = XMVectorOrInt( outside, XMVectorLess( XMVector4Dot( planes[p], center ), XMVectorNegate( radius ) ) );
+            }
+
+            if( XMVectorGetIntX( outside ) )
+            {
+                ++m_MeshletCullStats.OutsideFrustum;
+                continue;
+            }
+
+            if( meshlet.ConeCutoff < 1.f )
+            {
+                XMVECTOR view = XMVectorSubtract( center, eyePosition );
+                XMVECTOR cutoff = XMVectorReplicate( meshlet.ConeCutoff );
+                XMVECTOR facing = XMVector3Dot( view, XMLoadFloat3( &meshlet.ConeAxis ) );
+                XMVECTOR limit = XMVectorMultiplyAdd( cutoff, XMVector3Length( view ),
+                                                      XMVectorMultiplyAdd( cutoff, radius, radius ) );
+                if( XMVector3GreaterOrEqual( facing, limit ) )
+                {
+                    ++m_MeshletCullStats.BackFacing;
+                    continue;
+                }
+            }
+
+            m_VisibleMeshlets.push_back( SDKMESH_MESHLET_DRAW{ draw.Mesh, draw.Subset, i } );
+        }
+    }
+
+    return static_cast<UINT>( m_VisibleMeshlets.size() );
+}
+
+//--------------------------------------------------------------------------------------
+UINT CDXUTSDKMesh::GetNumVisibleMeshlets() const
+{
+    return static_cast<UINT>( m_VisibleMeshlets.size() );
+}
+
+//--------------------------------------------------------------------------------------
+const SDKMESH_MESHLET_DRAW* CDXUTSDKMesh::GetVisibleMeshlets() const
+{
+    return m_VisibleMeshlets.data();
+}
+
+//--------------------------------------------------------------------------------------
+SDKMESH_MESHLET_CULL_STATS CDXUTSDKMesh::GetMeshletCullStats() const
+{
+    return m_MeshletCullStats;
+}
+
 
 //--------------------------------------------------------------------------------------
 D3D11_PRIMITIVE_TOPOLOGY CDXUTSDKMesh::GetPrimitiveType11( _In_ SDKMESH_PRIMITIVE_TYPE PrimType )
@@ -1136,14 +2664,29 @@ SDKMESH_FRAME* CDXUTSDKMesh::GetFrame( _In_ UINT iFrame ) const
 //--------------------------------------------------------------------------------------
 SDKMESH_FRAME* CDXUTSDKMesh::FindFrame( _In_z_ const char* pszName ) const
 {
-    for( UINT i = 0; i < m_pMeshHeader->NumFrames; i++ )
+    UINT iFrame = FindFrameIndex( pszName );
+    if( iFrame == INVALID_FRAME )
+        return nullptr;
+    return &m_pFrameArray[ iFrame ];
+}
+
+//--------------------------------------------------------------------------------------
+UINT CDXUTSDKMesh::FindFrameIndex( _In_z_ const char* pszName ) const
+{
+    if( !pszName )
+        return INVALID_FRAME;
+
+    // Frames sharing a hash are ordered by index, so the first match is the same frame a linear search would find
+    UINT hash = HashFrameName( pszName );
+    auto it = std::lower_bound( m_FrameNameIndex.cbegin(), m_FrameNameIndex.cend(), std::make_pair( hash, 0u ) );
+    for( ; it != m_FrameNameIndex.cend() && it->first == hash; ++it )
     {
-        if( _stricmp( m_pFrameArray[i].Name, pszName ) == 0 )
+        if( _strnicmp( m_pFrameArray[ it->second ].Name, pszName, MAX_FRAME_NAME ) == 0 )
         {
-            return &m_pFrameArray[i];
+            return it->second;
         }
     }
-    return nullptr;
+    return INVALID_FRAME;
 }
 
 //--------------------------------------------------------------------------------------
@@ -1170,6 +2713,78 @@ XMVECTOR CDXUTSDKMesh::GetMeshBBoxExtents( _In_ UINT iMesh ) const
     return XMLoadFloat3( &m_pMeshArray[iMesh].BoundingBoxExtents );
 }
 
+//--------------------------------------------------------------------------------------
+XMVECTOR CDXUTSDKMesh::GetSubsetBBoxCenter( _In_ UINT iMesh, _In_ UINT iSubset ) const
+{
+    return XMLoadFloat3( &m_SubsetBBoxCenters[ m_pMeshArray[iMesh].pSubsets[iSubset] ] );
+}
+
+//--------------------------------------------------------------------------------------
+XMVECTOR CDXUTSDKMesh::GetSubsetBBoxExtents( _In_ UINT iMesh, _In_ UINT iSubset ) const
+{
+    return XMLoadFloat3( &m_SubsetBBoxExtents[ m_pMeshArray[iMesh].pSubsets[iSubset] ] );
+}
+
+//--------------------------------------------------------------------------------------
+XMMATRIX CDXUTSDKMesh::GetSubsetPositionTransform( _In_ UINT iMesh, _In_ UINT iSubset ) const
+{
+    if( !m_pVertexQuantization )
+        return XMMatrixIdentity();
+
+    auto& quantization = m_pVertexQuantization[ m_pMeshArray[ iMesh ].pSubsets[ iSubset ] ];
+    XMMATRIX transform = XMMatrixScalingFromVector( XMLoadFloat3( &quantization.PositionScale ) );
+    transform.r[3] = XMVectorSetW( XMLoadFloat3( &quantization.PositionOffset ), 1.f );
+    return transform;
+}
+
+//--------------------------------------------------------------------------------------
+bool CDXUTSDKMesh::HasQuantizedVertices() const
+{
+    return m_pVertexQuantization != nullptr;
+}
+
+//--------------------------------------------------------------------------------------
+UINT CDXUTSDKMesh::GetNumMeshlets( _In_ UINT iMesh, _In_ UINT iSubset ) const
+{
+    if( !m_pSubsetMeshlets )
+        return 0;
+
+    return m_pSubsetMeshlets[ m_pMeshArray[ iMesh ].pSubsets[ iSubset ] ].NumMeshlets;
+}
+
+//--------------------------------------------------------------------------------------
+const SDKMESH_MESHLET* CDXUTSDKMesh::GetMeshlets( _In_ UINT iMesh, _In_ UINT iSubset ) const
+{
+    if( !m_pSubsetMeshlets )
+        return nullptr;
+
+    return m_pMeshlets + m_pSubsetMeshlets[ m_pMeshArray[ iMesh ].pSubsets[ iSubset ] ].FirstMeshlet;
+}
+
+//--------------------------------------------------------------------------------------
+const SDKMESH_MESHLET* CDXUTSDKMesh::GetMeshlets() const
+{
+    return m_pMeshlets;
+}
+
+//--------------------------------------------------------------------------------------
+const UINT* CDXUTSDKMesh::GetMeshletVertexIndices() const
+{
+    if( !m_pMeshletHeader )
+        return nullptr;
+
+    return reinterpret_cast<const UINT*>( m_pStaticMeshData + m_pMeshletHeader->VertexIndexOffset );
+}
+
+//--------------------------------------------------------------------------------------
+const UINT* CDXUTSDKMesh::GetMeshletPrimitives() const
+{
+    if( !m_pMeshletHeader )
+        return nullptr;
+
+    return reinterpret_cast<const UINT*>( m_pStaticMeshData + m_pMeshletHeader->PrimitiveOffset );
+}
+
 //--------------------------------------------------------------------------------------
 UINT CDXUTSDKMesh::GetOutstandingResources() const
 {
@@ -1284,7 +2899,7 @@ XMMATRIX CDXUTSDKMesh::GetInfluenceMatrix( _In_ UINT iFrameIndex ) const
 //--------------------------------------------------------------------------------------
 UINT CDXUTSDKMesh::GetAnimationKeyFromTime( _In_ double fTime ) const
 {
-    if( !m_pAnimationHeader )
+    if( !m_pAnimationHeader || m_pAnimationHeader->NumAnimationKeys < 2 )
     {
         return 0;
     }
@@ -1297,6 +2912,38 @@ UINT CDXUTSDKMesh::GetAnimationKeyFromTime( _In_ double fTime ) const
     return iTick;
 }
 
+//--------------------------------------------------------------------------------------
+// Key 0 is not played; playback loops over keys 1 to NumAnimationKeys - 1, blending from the
+// last key back into key 1
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+CDXUTSDKMesh::AnimationSample CDXUTSDKMesh::GetAnimationSample( double fTime, bool bInterpolate ) const
+{
+    AnimationSample sample = { 0, 0, 0.f };
+
+    if( !bInterpolate )
+    {
+        sample.Key0 = sample.Key1 = GetAnimationKeyFromTime( fTime );
+        return sample;
+    }
+
+    if( !m_pAnimationHeader || m_pAnimationHeader->NumAnimationKeys < 2 )
+        return sample;
+
+    UINT numPlayed = m_pAnimationHeader->NumAnimationKeys - 1;
+
+    double fPosition = fmod( m_pAnimationHeader->AnimationFPS * fTime, double( numPlayed ) );
+    if( fPosition < 0 )
+        fPosition += numPlayed;
+
+    UINT iKey = std::min( static_cast<UINT>( fPosition ), numPlayed - 1 );
+
+    sample.Key0 = iKey + 1;
+    sample.Key1 = ( iKey + 1 ) % numPlayed + 1;
+    sample.Lerp = std::min( static_cast<float>( fPosition - iKey ), 1.f );
+    return sample;
+}
+
 _Use_decl_annotations_
 bool CDXUTSDKMesh::GetAnimationProperties( UINT* pNumKeys, float* pFrameTime ) const
 {
@@ -1312,3 +2959,102 @@ bool CDXUTSDKMesh::GetAnimationProperties( UINT* pNumKeys, float* pFrameTime ) c
 
     return true;
 }
+
+
+//--------------------------------------------------------------------------------------
+bool CDXUTSDKMesh::IsAnimationCompressed() const
+{
+    return !m_AnimationTracks.empty();
+}
+
+
+//--------------------------------------------------------------------------------------
+size_t CDXUTSDKMesh::GetAnimationDataSize() const
+{
+    if( !m_pAnimationHeader )
+        return 0;
+
+    return static_cast<size_t>( sizeof( SDKANIMATION_FILE_HEADER ) + m_pAnimationHeader->AnimationDataSize )
+        + m_AnimationTracks.size() * sizeof( SDKANIMATION_COMPRESSED_TRACK )
+        + m_AnimationKeyTimes.size() * sizeof( USHORT )
+        + m_AnimationKeys.size() * sizeof( SDKANIMATION_COMPRESSED_KEY );
+}
+
+
+//--------------------------------------------------------------------------------------
+// CDXUTSDKMeshPose
+//--------------------------------------------------------------------------------------
+CDXUTSDKMeshPose::CDXUTSDKMeshPose() noexcept :
+    m_NumFrames(0),
+    m_pWorldPoseFrameMatrices(nullptr),
+    m_pTransformedFrameMatrices(nullptr)
+{
+}
+
+
+//--------------------------------------------------------------------------------------
+CDXUTSDKMeshPose::~CDXUTSDKMeshPose()
+{
+    Destroy();
+}
+
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT CDXUTSDKMeshPose::Create( const CDXUTSDKMesh& mesh )
+{
+    Destroy();
+
+    UINT numFrames = mesh.GetNumFrames();
+    if( !numFrames )
+        return E_INVALIDARG;
+
+    // Both arrays share one allocation so that each instance's matrices are contiguous
+    m_pWorldPoseFrameMatrices = new (std::nothrow) XMFLOAT4X4[ size_t( numFrames ) * 2 ];
+    if( !m_pWorldPoseFrameMatrices )
+        return E_OUTOFMEMORY;
+
+    m_pTransformedFrameMatrices = m_pWorldPoseFrameMatrices + numFrames;
+    m_NumFrames = numFrames;
+
+    for( size_t i = 0; i < size_t( numFrames ) * 2; ++i )
+    {
+        XMStoreFloat4x4( &m_pWorldPoseFrameMatrices[i], XMMatrixIdentity() );
+    }
+
+    return S_OK;
+}
+
+
+//--------------------------------------------------------------------------------------
+void CDXUTSDKMeshPose::Destroy()
+{
+    SAFE_DELETE_ARRAY( m_pWorldPoseFrameMatrices );
+    m_pTransformedFrameMatrices = nullptr;
+    m_NumFrames = 0;
+}
+
+
+//--------------------------------------------------------------------------------------
+XMMATRIX CDXUTSDKMeshPose::GetWorldMatrix( _In_ UINT iFrameIndex ) const
+{
+    assert( iFrameIndex < m_NumFrames );
+    return XMLoadFloat4x4( &m_pWorldPoseFrameMatrices[iFrameIndex] );
+}
+
+
+//--------------------------------------------------------------------------------------
+XMMATRIX CDXUTSDKMeshPose::GetInfluenceMatrix( _In_ UINT iFrameIndex ) const
+{
+    assert( iFrameIndex < m_NumFrames );
+    return XMLoadFloat4x4( &m_pTransformedFrameMatrices[iFrameIndex] );
+}
+
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+XMMATRIX CDXUTSDKMeshPose::GetMeshInfluenceMatrix( const CDXUTSDKMesh& mesh, UINT iMesh, UINT iInfluence ) const
+{
+    UINT iFrame = mesh.GetMesh( iMesh )->pFrameInfluences[ iInfluence ];
+    return GetInfluenceMatrix( iFrame );
+}
@@ -21,6 +21,7 @@
 // Hard Defines for the various structures
 //--------------------------------------------------------------------------------------
 #define SDKMESH_FILE_VERSION 101
+#define SDKMESH_FILE_VERSION_EXTENDED 102   // adds SDKMESH_HEADER_EXTENSION
 #define MAX_VERTEX_ELEMENTS 32
 #define MAX_VERTEX_STREAMS 16
 #define MAX_FRAME_NAME 100
@@ -35,6 +36,8 @@
 #define INVALID_SUBSET ((UINT)-1)
 #define INVALID_ANIMATION_DATA ((UINT)-1)
 #define INVALID_SAMPLER_SLOT ((UINT)-1)
+#define SDKMESH_MESHLET_MAX_VERTICES 64
+#define SDKMESH_MESHLET_MAX_PRIMITIVES 124
 #define ERROR_RESOURCE_VALUE 1
 
 template<typename TYPE> BOOL IsErrorResource( TYPE data )
@@ -67,6 +70,13 @@ enum SDKMESH_INDEX_TYPE
     IT_32BIT,
 };
 
+enum SDKMESH_EXTENSION_FLAGS
+{
+    SDKMESH_QUANTIZED_VERTICES = 0x1,
+    SDKMESH_ENCODED_VERTICES = 0x2,
+    SDKMESH_MESHLETS = 0x4,
+};
+
 enum FRAME_TRANSFORM_TYPE
 {
     FTT_RELATIVE = 0,
@@ -104,6 +114,69 @@ struct SDKMESH_HEADER
     UINT64 MaterialDataOffset;
 };
 
+// Version 102 files (written by sdkmeshtool) follow SDKMESH_HEADER with this, within HeaderSize
+struct SDKMESH_HEADER_EXTENSION
+{
+    UINT Flags;                         // SDKMESH_EXTENSION_FLAGS
+    UINT Reserved;
+    UINT64 VertexQuantizationOffset;    // NumTotalSubsets SDKMESH_VERTEX_QUANTIZATION, if SDKMESH_QUANTIZED_VERTICES
+    UINT64 VertexEncodingOffset;        // NumVertexBuffers SDKMESH_VERTEX_ENCODING, if SDKMESH_ENCODED_VERTICES
+    UINT64 MeshletOffset;               // SDKMESH_MESHLET_HEADER, if SDKMESH_MESHLETS
+};
+
+// Quantized positions are D3DDECLTYPE_USHORT4N relative to the bounds of the vertices the subset
+// draws, so position = unorm * PositionScale + PositionOffset. Normals, tangents and binormals are
+// octahedral D3DDECLTYPE_SHORT2N (see SDKMeshDecodeOctahedral) and texture coordinates
+// D3DDECLTYPE_FLOAT16_2.
+struct SDKMESH_VERTEX_QUANTIZATION
+{
+    DirectX::XMFLOAT3 PositionScale;
+    DirectX::XMFLOAT3 PositionOffset;
+};
+
+// Entropy coded buffers store EncodedBytes at DataOffset (see SDKMeshEncodeVertices); SizeBytes
+// is still the size once decoded. EncodedBytes of zero means the buffer is stored as is.
+struct SDKMESH_VERTEX_ENCODING
+{
+    UINT64 EncodedBytes;
+    UINT BlockVertices;
+    UINT NumBlocks;
+};
+
+// The index range of each triangle list subset split into meshlets of at most
+// SDKMESH_MESHLET_MAX_VERTICES vertices and SDKMESH_MESHLET_MAX_PRIMITIVES triangles
+struct SDKMESH_MESHLET_HEADER
+{
+    UINT NumMeshlets;
+    UINT NumVertexIndices;
+    UINT NumPrimitives;
+    UINT Reserved;
+    UINT64 SubsetMeshletsOffset;        // NumTotalSubsets SDKMESH_SUBSET_MESHLETS
+    UINT64 MeshletDataOffset;           // NumMeshlets SDKMESH_MESHLET
+    UINT64 VertexIndexOffset;           // NumVertexIndices UINT, relative to VertexStart as in the index buffer
+    UINT64 PrimitiveOffset;             // NumPrimitives UINT, each three 10-bit indices into the meshlet's vertices
+};
+
+struct SDKMESH_SUBSET_MESHLETS
+{
+    UINT FirstMeshlet;
+    UINT NumMeshlets;                   // zero for subsets that are not triangle lists
+};
+
+// The cone bounds the triangle normals, so the meshlet faces away from any viewpoint within
+// the cone behind it (see CDXUTSDKMesh::CullMeshlets). ConeCutoff is the sine of the widest
+// angle between ConeAxis and a normal, or 1 when the triangles face too many ways.
+struct SDKMESH_MESHLET
+{
+    UINT VertexOffset;
+    UINT VertexCount;
+    UINT PrimitiveOffset;
+    UINT PrimitiveCount;
+    DirectX::XMFLOAT4 BoundingSphere;   // model space centre and radius
+    DirectX::XMFLOAT3 ConeAxis;
+    float ConeCutoff;
+};
+
 struct SDKMESH_VERTEX_BUFFER_HEADER
 {
     UINT64 NumVertices;
@@ -269,6 +342,123 @@ static_assert( sizeof(SDKMESH_MATERIAL) == 1256, "SDK Mesh structure size incorr
 static_assert( sizeof(SDKANIMATION_FILE_HEADER) == 40, "SDK Mesh structure size incorrect" );
 static_assert( sizeof(SDKANIMATION_DATA) == 40, "SDK Mesh structure size incorrect" );
 static_assert( sizeof(SDKANIMATION_FRAME_DATA) == 112, "SDK Mesh structure size incorrect" );
+static_assert( sizeof(SDKMESH_HEADER_EXTENSION) == 32, "SDK Mesh structure size incorrect" );
+static_assert( sizeof(SDKMESH_VERTEX_QUANTIZATION) == 24, "SDK Mesh structure size incorrect" );
+static_assert( sizeof(SDKMESH_VERTEX_ENCODING) == 16, "SDK Mesh structure size incorrect" );
+static_assert( sizeof(SDKMESH_MESHLET_HEADER) == 48, "SDK Mesh structure size incorrect" );
+static_assert( sizeof(SDKMESH_SUBSET_MESHLETS) == 8, "SDK Mesh structure size incorrect" );
+static_assert( sizeof(SDKMESH_MESHLET) == 48, "SDK Mesh structure size incorrect" );
+
+//--------------------------------------------------------------------------------------
+// In-memory compressed animation (see CDXUTSDKMesh::CompressAnimation)
+//--------------------------------------------------------------------------------------
+
+// The rotation keeps the three smallest quaternion components in 15 bits each, with the index
+// of the dropped (largest) component in the top bits of Rotation[0] and Rotation[1]. The
+// translation is quantized to 16 bits over the range of its track.
+struct SDKANIMATION_COMPRESSED_KEY
+{
+    USHORT Rotation[3];
+    USHORT Translation[3];
+};
+
+// One animated frame. Its keys start at FirstKey, and the key times (in animation keys from the
+// start of playback) are held in a parallel array.
+struct SDKANIMATION_COMPRESSED_TRACK
+{
+    UINT FirstKey;
+    UINT NumKeys;
+    DirectX::XMFLOAT3 TranslationMin;
+    DirectX::XMFLOAT3 TranslationScale;
+};
+
+//--------------------------------------------------------------------------------------
+// SDKMeshData class.  Device-independent, read-only view of an sdkmesh file.  The file is
+// memory-mapped (or the caller's buffer is wrapped) and validated, but nothing is copied or
+// patched, so the union members of the structures still hold the file offsets. Only entropy
+// coded vertices, once decoded, are held in memory of its own.
+//--------------------------------------------------------------------------------------
+class SDKMeshData
+{
+public:
+    SDKMeshData() noexcept;
+    SDKMeshData( SDKMeshData&& moveFrom ) noexcept;
+    SDKMeshData& operator=( SDKMeshData&& moveFrom ) noexcept;
+    ~SDKMeshData();
+
+    SDKMeshData( const SDKMeshData& ) = delete;
+    SDKMeshData& operator=( const SDKMeshData& ) = delete;
+
+    HRESULT Open( _In_z_ LPCWSTR szFileName );
+    HRESULT Open( _In_reads_bytes_(DataBytes) const BYTE* pData, _In_ size_t DataBytes );
+    void Close();
+
+    // Checks that the header, the tables and every offset they contain lie within the data
+    static HRESULT Validate( _In_reads_bytes_(DataBytes) const BYTE* pData, _In_ size_t DataBytes );
+
+    bool IsOpen() const { return m_pHeader != nullptr; }
+    const BYTE* GetData() const { return m_pData; }
+    size_t GetDataSize() const { return m_DataBytes; }
+    size_t GetStaticDataSize() const;
+
+    const SDKMESH_HEADER* GetHeader() const { return m_pHeader; }
+    UINT GetNumVBs() const;
+    UINT GetNumIBs() const;
+    UINT GetNumMeshes() const;
+    UINT GetNumTotalSubsets() const;
+    UINT GetNumFrames() const;
+    UINT GetNumMaterials() const;
+
+    const SDKMESH_VERTEX_BUFFER_HEADER* GetVBHeader( _In_ UINT iVB ) const;
+    const SDKMESH_INDEX_BUFFER_HEADER*  GetIBHeader( _In_ UINT iIB ) const;
+    const SDKMESH_MESH*                 GetMesh( _In_ UINT iMesh ) const;
+    const UINT*                         GetMeshSubsets( _In_ UINT iMesh ) const;
+    const UINT*                         GetMeshFrameInfluences( _In_ UINT iMesh ) const;
+    const SDKMESH_SUBSET*               GetSubsetAt( _In_ UINT iSubset ) const;
+    const SDKMESH_SUBSET*               GetSubset( _In_ UINT iMesh, _In_ UINT iSubset ) const;
+    const SDKMESH_FRAME*                GetFrame( _In_ UINT iFrame ) const;
+    const SDKMESH_MATERIAL*             GetMaterial( _In_ UINT iMaterial ) const;
+
+    // Vertex and index payloads, GetVBHeader/GetIBHeader()->SizeBytes long. Vertices with an
+    // encoding are instead EncodedBytes of entropy coded data.
+    const BYTE* GetVertices( _In_ UINT iVB ) const;
+    const BYTE* GetIndices( _In_ UINT iIB ) const;
+
+    // Version 102 data; each returns nullptr when the file does not have it
+    const SDKMESH_HEADER_EXTENSION*     GetExtension() const;
+    const SDKMESH_VERTEX_QUANTIZATION*  GetVertexQuantization( _In_ UINT iSubset ) const;
+    const SDKMESH_VERTEX_ENCODING*      GetVertexEncoding( _In_ UINT iVB ) const;
+    const SDKMESH_MESHLET_HEADER*       GetMeshletHeader() const;
+
+    // Decodes the entropy coded vertex buffers, if any, on up to numThreads threads (0 for one
+    // per processor). CDXUTSDKMeshLoader does this on its worker threads; Create does it
+    // otherwise. Does nothing once the vertices are decoded.
+    HRESULT DecodeVertices( _In_ UINT numThreads = 0 );
+
+    // Bytes DecodeVertices allocates, and the decoded data of a coded VB (nullptr until decoded)
+    size_t GetDecodedVertexSize() const;
+    const BYTE* GetDecodedVertices( _In_ UINT iVB ) const;
+
+private:
+    void Parse();
+
+    HANDLE m_hMapping;
+    const void* m_pView;
+
+    const BYTE* m_pData;
+    size_t m_DataBytes;
+
+    const SDKMESH_HEADER* m_pHeader;
+    const SDKMESH_VERTEX_BUFFER_HEADER* m_pVertexBufferArray;
+    const SDKMESH_INDEX_BUFFER_HEADER* m_pIndexBufferArray;
+    const SDKMESH_MESH* m_pMeshArray;
+    const SDKMESH_SUBSET* m_pSubsetArray;
+    const SDKMESH_FRAME* m_pFrameArray;
+    const SDKMESH_MATERIAL* m_pMaterialArray;
+
+    BYTE* m_pDecodedVertexData;
+    BYTE** m_ppDecodedVertices;
+};
 
 #ifndef _CONVERTER_APP_
 
@@ -289,6 +479,34 @@ struct SDKMESH_CALLBACKS11
     void* pContext;
 };
 
+class CDXUTSDKMeshPose;
+
+//--------------------------------------------------------------------------------------
+// Subset left to draw by CDXUTSDKMesh::CullSubsets
+//--------------------------------------------------------------------------------------
+struct SDKMESH_SUBSET_DRAW
+{
+    UINT Mesh;
+    UINT Subset;    // index into the subsets of the mesh, as for GetSubset
+};
+
+//--------------------------------------------------------------------------------------
+// Meshlet left to draw by CDXUTSDKMesh::CullMeshlets
+//--------------------------------------------------------------------------------------
+struct SDKMESH_MESHLET_DRAW
+{
+    UINT Mesh;
+    UINT Subset;
+    UINT Meshlet;   // index into GetMeshlets()
+};
+
+struct SDKMESH_MESHLET_CULL_STATS
+{
+    UINT Tested;
+    UINT OutsideFrustum;
+    UINT BackFacing;
+};
+
 //--------------------------------------------------------------------------------------
 // CDXUTSDKMesh class.  This class reads the sdkmesh file format for use by the samples
 //--------------------------------------------------------------------------------------
@@ -298,9 +516,12 @@ private:
     UINT m_NumOutstandingResources;
     bool m_bLoading;
     //BYTE*                         m_pBufferData;
-    HANDLE m_hFile;
     std::vector<BYTE*> m_MappedPointers;
     ID3D11Device* m_pDev11;
+    SDKMeshData m_MeshData;
+
+    // (case-insensitive name hash, frame index) pairs sorted for FindFrameIndex
+    std::vector<std::pair<UINT, UINT>> m_FrameNameIndex;
 
 protected:
     //These are the pointers to the two chunks of data loaded in from the mesh file
@@ -326,14 +547,64 @@ protected:
     // Adjacency information (not part of the m_pStaticMeshData, so it must be created and destroyed separately )
     SDKMESH_INDEX_BUFFER_HEADER* m_pAdjacencyIndexBufferArray;
 
+    // Version 102 data; entropy coded vertex buffers are decoded into m_pDecodedVertexData
+    SDKMESH_VERTEX_QUANTIZATION* m_pVertexQuantization;
+    BYTE* m_pDecodedVertexData;
+    SDKMESH_MESHLET_HEADER* m_pMeshletHeader;
+    SDKMESH_SUBSET_MESHLETS* m_pSubsetMeshlets;
+    SDKMESH_MESHLET* m_pMeshlets;
+
     //Animation
     SDKANIMATION_FILE_HEADER* m_pAnimationHeader;
     SDKANIMATION_FRAME_DATA* m_pAnimationFrameData;
     DirectX::XMFLOAT4X4* m_pBindPoseFrameMatrices;
+    DirectX::XMFLOAT4X4* m_pInvBindPoseFrameMatrices;
     DirectX::XMFLOAT4X4* m_pTransformedFrameMatrices;
     DirectX::XMFLOAT4X4* m_pWorldPoseFrameMatrices;
 
+    // Frames reachable from frame 0 in depth-first order, so every parent precedes its children.
+    // m_FrameParent holds the parent of each entry, or INVALID_FRAME for the roots.
+    std::vector<UINT> m_FrameOrder;
+    std::vector<UINT> m_FrameParent;
+
+    // Compressed animation; when present, m_pAnimationData no longer holds any keys
+    std::vector<SDKANIMATION_COMPRESSED_TRACK> m_AnimationTracks;
+    std::vector<USHORT> m_AnimationKeyTimes;
+    std::vector<SDKANIMATION_COMPRESSED_KEY> m_AnimationKeys;
+
+    // Model space bounds of each subset, indexed like m_pSubsetArray
+    std::vector<DirectX::XMFLOAT3> m_SubsetBBoxCenters;
+    std::vector<DirectX::XMFLOAT3> m_SubsetBBoxExtents;
+
+    // Every subset Render draws, in the same order. m_DrawBounds holds their boxes four at a time
+    // as centre x, y, z then extents x, y, z, for CullSubsets to test a group per plane at once.
+    std::vector<SDKMESH_SUBSET_DRAW> m_DrawList;
+    std::vector<DirectX::XMFLOAT4> m_DrawBounds;
+    std::vector<SDKMESH_SUBSET_DRAW> m_VisibleDraws;
+    std::vector<SDKMESH_MESHLET_DRAW> m_VisibleMeshlets;
+    SDKMESH_MESHLET_CULL_STATS m_MeshletCullStats;
+
+    // Point in the animation between keys Key0 and Key1, with Lerp the weight of Key1
+    struct AnimationSample
+    {
+        UINT Key0;
+        UINT Key1;
+        float Lerp;
+    };
+
 protected:
+    HRESULT BuildFrameNameIndex();
+    HRESULT BuildFrameOrder();
+    HRESULT BuildBoundingBoxes();
+    AnimationSample GetAnimationSample( _In_ double fTime, _In_ bool bInterpolate ) const;
+    DirectX::XMMATRIX GetLocalFrameTransform( _In_ UINT iFrame, _In_ const AnimationSample& sample ) const;
+    DirectX::XMMATRIX GetAbsoluteFrameTransform( _In_ UINT iFrame, _In_ UINT iTick ) const;
+
+    // Evaluates the animation at fTime into the given world pose and skinning matrix arrays
+    void EvaluatePose( _In_ DirectX::CXMMATRIX world, _In_ double fTime,
+                       _Out_writes_(m_pMeshHeader->NumFrames) DirectX::XMFLOAT4X4* pWorldPose,
+                       _Out_writes_(m_pMeshHeader->NumFrames) DirectX::XMFLOAT4X4* pTransformed ) const;
+
     void LoadMaterials( _In_ ID3D11Device* pd3dDevice, _In_reads_(NumMaterials) SDKMESH_MATERIAL* pMaterials,
                         _In_ UINT NumMaterials, _In_opt_ SDKMESH_CALLBACKS11* pLoaderCallbacks = nullptr );
 
@@ -355,12 +626,26 @@ protected:
                                       _In_ bool bCopyStatic,
                                       _In_opt_ SDKMESH_CALLBACKS11* pLoaderCallbacks11 = nullptr );
 
+    // Creates the mesh from m_MeshData, with m_strPathW holding the full path of the file
+    HRESULT CreateFromMeshData( _In_opt_ ID3D11Device* pDev11,
+                                _In_opt_ SDKMESH_CALLBACKS11* pLoaderCallbacks11 = nullptr );
+
     //frame manipulation
     void TransformBindPoseFrame( _In_ UINT iFrame, _In_ DirectX::CXMMATRIX parentWorld );
     void TransformFrame( _In_ UINT iFrame, _In_ DirectX::CXMMATRIX parentWorld, _In_ double fTime );
     void TransformFrameAbsolute( _In_ UINT iFrame, _In_ double fTime );
 
     //Direct3D 11 rendering helpers
+    bool BindMesh( _In_ UINT iMesh,
+                   _In_ bool bAdjacent,
+                   _In_ ID3D11DeviceContext* pd3dDeviceContext );
+    void RenderSubset( _In_ UINT iMesh,
+                       _In_ UINT iSubset,
+                       _In_ bool bAdjacent,
+                       _In_ ID3D11DeviceContext* pd3dDeviceContext,
+                       _In_ UINT iDiffuseSlot,
+                       _In_ UINT iNormalSlot,
+                       _In_ UINT iSpecularSlot );
     void RenderMesh( _In_ UINT iMesh,
                      _In_ bool bAdjacent,
                      _In_ ID3D11DeviceContext* pd3dDeviceContext,
@@ -381,13 +666,25 @@ public:
     virtual HRESULT Create( _In_ ID3D11Device* pDev11, _In_z_ LPCWSTR szFileName, _In_opt_ SDKMESH_CALLBACKS11* pLoaderCallbacks = nullptr );
     virtual HRESULT Create( _In_ ID3D11Device* pDev11, BYTE* pData, size_t DataBytes, _In_ bool bCopyStatic=false,
                             _In_opt_ SDKMESH_CALLBACKS11* pLoaderCallbacks = nullptr );
+    // Takes ownership of an already opened SDKMeshData; szFilePath is the resolved path of the file
+    virtual HRESULT Create( _In_ ID3D11Device* pDev11, _In_z_ LPCWSTR szFilePath, _Inout_ SDKMeshData&& meshData,
+                            _In_opt_ SDKMESH_CALLBACKS11* pLoaderCallbacks = nullptr );
     virtual HRESULT LoadAnimation( _In_z_ const WCHAR* szFileName );
     virtual void Destroy();
 
+    // Quantizes the loaded animation, then drops the keys that interpolating between the keys kept
+    // reproduces to within fRotationTolerance (radians) and fTranslationTolerance (model units).
+    // Only relative animations can be compressed; returns S_FALSE if already compressed.
+    HRESULT CompressAnimation( _In_ float fRotationTolerance = 0.0005f, _In_ float fTranslationTolerance = 0.0001f );
+
     //Frame manipulation
-    void TransformBindPose( _In_ DirectX::CXMMATRIX world ) { TransformBindPoseFrame( 0, world ); };
+    void TransformBindPose( _In_ DirectX::CXMMATRIX world );
     void TransformMesh( _In_ DirectX::CXMMATRIX world, _In_ double fTime );
 
+    // Evaluates the animation into a per-instance pose without modifying the mesh, so any number of
+    // threads may do so at once. The inverse bind pose comes from the last call to TransformBindPose.
+    void TransformMesh( _Inout_ CDXUTSDKMeshPose& pose, _In_ DirectX::CXMMATRIX world, _In_ double fTime ) const;
+
     //Direct3D 11 Rendering
     virtual void Render( _In_ ID3D11DeviceContext* pd3dDeviceContext,
                          _In_ UINT iDiffuseSlot = INVALID_SAMPLER_SLOT,
@@ -398,6 +695,30 @@ public:
                                  _In_ UINT iNormalSlot = INVALID_SAMPLER_SLOT,
                                  _In_ UINT iSpecularSlot = INVALID_SAMPLER_SLOT );
 
+    // Frustum culling against the bounds of each subset, taken from the vertices at load. The boxes
+    // do not follow the animation, so this suits static meshes (or a matrix whose frustum is grown
+    // to cover the motion). CullSubsets keeps the subsets whose box meets the view volume of
+    // worldViewProjection, in Render order, and returns how many; RenderVisible draws just those.
+    UINT CullSubsets( _In_ DirectX::CXMMATRIX worldViewProjection );
+    void RenderVisible( _In_ ID3D11DeviceContext* pd3dDeviceContext,
+                        _In_ UINT iDiffuseSlot = INVALID_SAMPLER_SLOT,
+                        _In_ UINT iNormalSlot = INVALID_SAMPLER_SLOT,
+                        _In_ UINT iSpecularSlot = INVALID_SAMPLER_SLOT );
+    UINT GetNumDrawSubsets() const;
+    UINT GetNumVisibleSubsets() const;
+    const SDKMESH_SUBSET_DRAW* GetVisibleSubsets() const;
+    float GetCulledPercentage() const;
+
+    // Meshlets from sdkmeshtool -m, finer grained than the subsets. CullMeshlets tests those of
+    // the subsets CullSubsets kept (or of every subset, before the first CullSubsets) and keeps
+    // the ones whose sphere meets the view volume and that have a triangle facing eyePosition,
+    // given in model space. Clockwise triangles are taken as front facing, as for Render.
+    bool HasMeshlets() const;
+    UINT CullMeshlets( _In_ DirectX::CXMMATRIX worldViewProjection, _In_ DirectX::FXMVECTOR eyePosition );
+    UINT GetNumVisibleMeshlets() const;
+    const SDKMESH_MESHLET_DRAW* GetVisibleMeshlets() const;
+    SDKMESH_MESHLET_CULL_STATS GetMeshletCullStats() const;
+
     //Helpers (D3D11 specific)
     static D3D11_PRIMITIVE_TOPOLOGY GetPrimitiveType11( _In_ SDKMESH_PRIMITIVE_TYPE PrimType );
     DXGI_FORMAT GetIBFormat11( _In_ UINT iMesh ) const;
@@ -429,10 +750,26 @@ public:
     UINT              GetNumFrames() const;
     SDKMESH_FRAME*    GetFrame( _In_ UINT iFrame ) const; 
     SDKMESH_FRAME*    FindFrame( _In_z_ const char* pszName ) const;
+    UINT              FindFrameIndex( _In_z_ const char* pszName ) const;
     UINT64            GetNumVertices( _In_ UINT iMesh, _In_ UINT iVB ) const;
     UINT64            GetNumIndices( _In_ UINT iMesh ) const;
     DirectX::XMVECTOR GetMeshBBoxCenter( _In_ UINT iMesh ) const;
     DirectX::XMVECTOR GetMeshBBoxExtents( _In_ UINT iMesh ) const;
+    DirectX::XMVECTOR GetSubsetBBoxCenter( _In_ UINT iMesh, _In_ UINT iSubset ) const;
+    DirectX::XMVECTOR GetSubsetBBoxExtents( _In_ UINT iMesh, _In_ UINT iSubset ) const;
+
+    // Quantized positions load as [0,1]; this maps them back to model space, so it goes in front
+    // of the world matrix when drawing the subset. Identity unless HasQuantizedVertices.
+    DirectX::XMMATRIX GetSubsetPositionTransform( _In_ UINT iMesh, _In_ UINT iSubset ) const;
+    bool              HasQuantizedVertices() const;
+
+    // Meshlets of a subset, with the tables their offsets index; nullptr unless HasMeshlets
+    UINT                   GetNumMeshlets( _In_ UINT iMesh, _In_ UINT iSubset ) const;
+    const SDKMESH_MESHLET* GetMeshlets( _In_ UINT iMesh, _In_ UINT iSubset ) const;
+    const SDKMESH_MESHLET* GetMeshlets() const;
+    const UINT*            GetMeshletVertexIndices() const;
+    const UINT*            GetMeshletPrimitives() const;
+
     UINT              GetOutstandingResources() const;
     UINT              GetOutstandingBufferResources() const;
     bool              CheckLoadDone();
@@ -448,6 +785,38 @@ public:
     DirectX::XMMATRIX GetWorldMatrix( _In_ UINT iFrameIndex ) const;
     DirectX::XMMATRIX GetInfluenceMatrix( _In_ UINT iFrameIndex ) const;
     bool              GetAnimationProperties( _Out_ UINT* pNumKeys, _Out_ float* pFrameTime ) const;
+    bool              IsAnimationCompressed() const;
+    size_t            GetAnimationDataSize() const;
+};
+
+//--------------------------------------------------------------------------------------
+// CDXUTSDKMeshPose class.  Per-instance frame matrices, so that many instances can share
+// one CDXUTSDKMesh and its animation
+//--------------------------------------------------------------------------------------
+class CDXUTSDKMeshPose
+{
+public:
+    CDXUTSDKMeshPose() noexcept;
+    ~CDXUTSDKMeshPose();
+
+    CDXUTSDKMeshPose( const CDXUTSDKMeshPose& ) = delete;
+    CDXUTSDKMeshPose& operator=( const CDXUTSDKMeshPose& ) = delete;
+
+    // Sizes the pose for the frames of the mesh; every matrix starts as the identity
+    HRESULT Create( _In_ const CDXUTSDKMesh& mesh );
+    void Destroy();
+
+    UINT GetNumFrames() const { return m_NumFrames; }
+    DirectX::XMMATRIX GetWorldMatrix( _In_ UINT iFrameIndex ) const;
+    DirectX::XMMATRIX GetInfluenceMatrix( _In_ UINT iFrameIndex ) const;
+    DirectX::XMMATRIX GetMeshInfluenceMatrix( _In_ const CDXUTSDKMesh& mesh, _In_ UINT iMesh, _In_ UINT iInfluence ) const;
+
+private:
+    friend class CDXUTSDKMesh;
+
+    UINT m_NumFrames;
+    DirectX::XMFLOAT4X4* m_pWorldPoseFrameMatrices;
+    DirectX::XMFLOAT4X4* m_pTransformedFrameMatrices;
 };
 
 #endif
@@ -0,0 +1,281 @@
+//--------------------------------------------------------------------------------------
+// File: SDKMeshAnimator.cpp
+//
+// Evaluates the animation poses of many CDXUTSDKMesh instances in parallel
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=320437
+//--------------------------------------------------------------------------------------
+#include "DXUT.h"
+#include "SDKmeshAnimator.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+using namespace DirectX;
+
+namespace
+{
+    // Instances claimed by a thread at a time; enough to amortise the shared counter while still
+    // balancing uneven skeletons across the threads
+    const size_t c_BatchSize = 8;
+
+    struct PoseOrder
+    {
+        const CDXUTSDKMesh* pMesh;
+        UINT key;
+        UINT index;
+
+        bool operator<( const PoseOrder& other ) const
+        {
+            if( pMesh != other.pMesh )
+                return std::less<const CDXUTSDKMesh*>()( pMesh, other.pMesh );
+            if( key != other.key )
+                return key < other.key;
+            return index < other.index;
+        }
+    };
+
+    inline void UpdatePose( const SDKMESH_POSE_UPDATE& update )
+    {
+        update.pMesh->TransformMesh( *update.pPose, XMLoadFloat4x4( &update.World ), update.fTime );
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+class CDXUTSDKMeshAnimator::Impl
+{
+public:
+    Impl() noexcept :
+        m_pUpdates(nullptr),
+        m_numBatches(0),
+        m_nextBatch(0),
+        m_generation(0),
+        m_busy(0),
+        m_shutdown(false)
+    {
+    }
+
+    void Worker();
+    void RunBatches();
+
+    std::vector<PoseOrder> m_order;
+    const SDKMESH_POSE_UPDATE* m_pUpdates;
+    size_t m_numBatches;
+    std::atomic<size_t> m_nextBatch;
+
+    std::mutex m_mutex;
+    std::condition_variable m_workAvailable;
+    std::condition_variable m_workDone;
+    std::vector<std::thread> m_threads;
+
+    UINT64 m_generation;
+    size_t m_busy;
+    bool m_shutdown;
+};
+
+
+//--------------------------------------------------------------------------------------
+void CDXUTSDKMeshAnimator::Impl::Worker()
+{
+    UINT64 generation = 0;
+
+    for( ;; )
+    {
+        {
+            std::unique_lock<std::mutex> lock( m_mutex );
+            m_workAvailable.wait( lock, [&] { return m_shutdown || m_generation != generation; } );
+            if( m_shutdown )
+                return;
+
+            generation = m_generation;
+        }
+
+        RunBatches();
+
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            --m_busy;
+        }
+        m_workDone.notify_all();
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Claims batches of the sorted instances until none remain
+//--------------------------------------------------------------------------------------
+void CDXUTSDKMeshAnimator::Impl::RunBatches()
+{
+    const size_t count = m_order.size();
+
+    for( ;; )
+    {
+        size_t batch = m_nextBatch.fetch_add( 1 );
+        if( batch >= m_numBatches )
+            return;
+
+        size_t end = std::min( count, ( batch + 1 ) * c_BatchSize );
+        for( size_t i = batch * c_BatchSize; i < end; ++i )
+        {
+            UpdatePose( m_pUpdates[ m_order[i].index ] );
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+CDXUTSDKMeshAnimator::CDXUTSDKMeshAnimator() noexcept
+{
+}
+
+
+//--------------------------------------------------------------------------------------
+CDXUTSDKMeshAnimator::~CDXUTSDKMeshAnimator()
+{
+    Shutdown();
+}
+
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT CDXUTSDKMeshAnimator::Initialize( UINT numThreads )
+{
+    if( pImpl )
+        return E_UNEXPECTED;
+
+    if( !numThreads )
+    {
+        UINT cpus = std::thread::hardware_concurrency();
+        numThreads = ( cpus > 1 ) ? ( cpus - 1 ) : 1;
+    }
+
+    std::unique_ptr<Impl> impl( new (std::nothrow) Impl );
+    if( !impl )
+        return E_OUTOFMEMORY;
+
+    pImpl = std::move( impl );
+
+    try
+    {
+        pImpl->m_threads.reserve( numThreads );
+        for( UINT i = 0; i < numThreads; ++i )
+        {
+            pImpl->m_threads.emplace_back( &Impl::Worker, pImpl.get() );
+        }
+    }
+    catch( ... )
+    {
+        Shutdown();
+        return E_FAIL;
+    }
+
+    return S_OK;
+}
+
+
+//--------------------------------------------------------------------------------------
+void CDXUTSDKMeshAnimator::Shutdown()
+{
+    if( !pImpl )
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock( pImpl->m_mutex );
+        pImpl->m_shutdown = true;
+    }
+    pImpl->m_workAvailable.notify_all();
+
+    for( auto& it : pImpl->m_threads )
+    {
+        it.join();
+    }
+
+    pImpl.reset();
+}
+
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT CDXUTSDKMeshAnimator::Update( const SDKMESH_POSE_UPDATE* pUpdates, size_t count )
+{
+    if( !count )
+        return S_OK;
+
+    if( !pUpdates || count > UINT_MAX )
+        return E_INVALIDARG;
+
+    for( size_t i = 0; i < count; ++i )
+    {
+        if( !pUpdates[i].pMesh || !pUpdates[i].pPose )
+            return E_INVALIDARG;
+    }
+
+    if( !pImpl )
+    {
+        for( size_t i = 0; i < count; ++i )
+        {
+            UpdatePose( pUpdates[i] );
+        }
+        return S_OK;
+    }
+
+    try
+    {
+        pImpl->m_order.resize( count );
+    }
+    catch( const std::bad_alloc& )
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    for( size_t i = 0; i < count; ++i )
+    {
+        auto& order = pImpl->m_order[i];
+        order.pMesh = pUpdates[i].pMesh;
+        order.key = pUpdates[i].pMesh->GetAnimationKeyFromTime( pUpdates[i].fTime );
+        order.index = static_cast<UINT>( i );
+    }
+    std::sort( pImpl->m_order.begin(), pImpl->m_order.end() );
+
+    pImpl->m_pUpdates = pUpdates;
+    pImpl->m_numBatches = ( count + c_BatchSize - 1 ) / c_BatchSize;
+    pImpl->m_nextBatch = 0;
+
+    // Not worth waking the workers for a single batch
+    bool useWorkers = !pImpl->m_threads.empty() && pImpl->m_numBatches > 1;
+    if( useWorkers )
+    {
+        {
+            std::lock_guard<std::mutex> lock( pImpl->m_mutex );
+            ++pImpl->m_generation;
+            pImpl->m_busy = pImpl->m_threads.size();
+        }
+        pImpl->m_workAvailable.notify_all();
+    }
+
+    pImpl->RunBatches();
+
+    if( useWorkers )
+    {
+        std::unique_lock<std::mutex> lock( pImpl->m_mutex );
+        pImpl->m_workDone.wait( lock, [this] { return !pImpl->m_busy; } );
+    }
+
+    pImpl->m_pUpdates = nullptr;
+
+    return S_OK;
+}
+
+
+//--------------------------------------------------------------------------------------
+UINT CDXUTSDKMeshAnimator::GetNumThreads() const
+{
+    return pImpl ? static_cast<UINT>( pImpl->m_threads.size() ) : 0;
+}
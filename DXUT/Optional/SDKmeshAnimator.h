@@ -0,0 +1,54 @@
+//--------------------------------------------------------------------------------------
+// File: SDKMeshAnimator.h
+//
+// Evaluates the animation poses of many CDXUTSDKMesh instances in parallel. Each instance
+// keeps its own CDXUTSDKMeshPose, so any number of them can share one mesh.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=320437
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include "SDKmesh.h"
+
+#include <memory>
+
+struct SDKMESH_POSE_UPDATE
+{
+    const CDXUTSDKMesh* pMesh;
+    CDXUTSDKMeshPose* pPose;
+    DirectX::XMFLOAT4X4 World;
+    double fTime;
+};
+
+//--------------------------------------------------------------------------------------
+// CDXUTSDKMeshAnimator class.  Spreads pose updates across a pool of worker threads
+//--------------------------------------------------------------------------------------
+class CDXUTSDKMeshAnimator
+{
+public:
+    CDXUTSDKMeshAnimator() noexcept;
+    ~CDXUTSDKMeshAnimator();
+
+    CDXUTSDKMeshAnimator( const CDXUTSDKMeshAnimator& ) = delete;
+    CDXUTSDKMeshAnimator& operator=( const CDXUTSDKMeshAnimator& ) = delete;
+
+    // numThreads of 0 uses one worker per logical processor, less one for the calling thread
+    HRESULT Initialize( _In_ UINT numThreads = 0 );
+    void Shutdown();
+
+    // Evaluates every pose and returns once all are done; the calling thread does its share of the
+    // work. Instances are grouped by mesh (and so by animation clip) and ordered by animation key,
+    // so that each worker reads the same keys for consecutive instances. Without Initialize, the
+    // poses are evaluated on the calling thread. Call from one thread at a time.
+    HRESULT Update( _In_reads_(count) const SDKMESH_POSE_UPDATE* pUpdates, _In_ size_t count );
+
+    UINT GetNumThreads() const;
+
+private:
+    class Impl;
+
+    std::unique_ptr<Impl> pImpl;
+};
@@ -0,0 +1,429 @@
+//--------------------------------------------------------------------------------------
+// File: SDKMeshCodec.cpp
+//
+// Vertex encodings used by version 102 .sdkmesh files
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=320437
+//--------------------------------------------------------------------------------------
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+
+#include "SDKmeshCodec.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <new>
+
+using namespace DirectX;
+
+namespace
+{
+    enum BLOCK_MODE : BYTE
+    {
+        BLOCK_STORED = 0,   // vertices as is
+        BLOCK_CODED,        // rANS coded byte planes
+    };
+
+    // rANS with 12-bit probabilities and a 32-bit state renormalized a byte at a time
+    const UINT c_ProbBits = 12;
+    const UINT c_ProbScale = 1u << c_ProbBits;
+    const UINT c_StateLow = 1u << 23;
+
+    const size_t c_BitmapBytes = 256 / 8;
+
+    inline bool IsPresent( const BYTE* pBitmap, UINT symbol )
+    {
+        return ( pBitmap[ symbol >> 3 ] & ( 1u << ( symbol & 7 ) ) ) != 0;
+    }
+
+    inline void WriteUInt( BYTE* pDest, UINT value )
+    {
+        memcpy( pDest, &value, sizeof( UINT ) );
+    }
+
+    inline UINT ReadUInt( const BYTE* pSrc )
+    {
+        UINT value;
+        memcpy( &value, pSrc, sizeof( UINT ) );
+        return value;
+    }
+
+    //----------------------------------------------------------------------------------
+    // Scales the symbol counts to sum to c_ProbScale, keeping every symbol present
+    //----------------------------------------------------------------------------------
+    void NormalizeFrequencies( const UINT* pCounts, UINT total, UINT* pFreqs )
+    {
+        UINT sum = 0;
+        UINT largest = 0;
+        for( UINT s = 0; s < 256; ++s )
+        {
+            if( !pCounts[s] )
+            {
+                pFreqs[s] = 0;
+                continue;
+            }
+
+            pFreqs[s] = std::max( 1u, static_cast<UINT>( UINT64( pCounts[s] ) * c_ProbScale / total ) );
+            sum += pFreqs[s];
+
+            if( pCounts[s] > pCounts[largest] )
+                largest = s;
+        }
+
+        if( sum < c_ProbScale )
+            pFreqs[largest] += c_ProbScale - sum;
+
+        // Rounding small symbols up to 1 can overshoot; take it back from the most frequent
+        while( sum > c_ProbScale )
+        {
+            UINT s = static_cast<UINT>( std::max_element( pFreqs, pFreqs + 256 ) - pFreqs );
+            UINT take = std::min( pFreqs[s] - 1, sum - c_ProbScale );
+            pFreqs[s] -= take;
+            sum -= take;
+        }
+    }
+
+    //----------------------------------------------------------------------------------
+    // Codes one byte plane: presence bitmap, frequencies, coded size and the rANS bytes
+    //----------------------------------------------------------------------------------
+    void EncodePlane( const BYTE* pSymbols, size_t count, std::vector<BYTE>& output, std::vector<BYTE>& scratch )
+    {
+        UINT counts[256] = {};
+        for( size_t i = 0; i < count; ++i )
+        {
+            ++counts[ pSymbols[i] ];
+        }
+
+        UINT freqs[256];
+        NormalizeFrequencies( counts, static_cast<UINT>( count ), freqs );
+
+        UINT starts[256];
+        BYTE bitmap[c_BitmapBytes] = {};
+        for( UINT s = 0, start = 0; s < 256; ++s )
+        {
+            starts[s] = start;
+            start += freqs[s];
+            if( freqs[s] )
+                bitmap[ s >> 3 ] |= static_cast<BYTE>( 1u << ( s & 7 ) );
+        }
+
+        output.insert( output.end(), bitmap, bitmap + c_BitmapBytes );
+        for( UINT s = 0; s < 256; ++s )
+        {
+            if( freqs[s] )
+            {
+                // Stored less one, since a lone symbol has the whole range
+                USHORT f = static_cast<USHORT>( freqs[s] - 1 );
+                output.push_back( static_cast<BYTE>( f & 0xFF ) );
+                output.push_back( static_cast<BYTE>( f >> 8 ) );
+            }
+        }
+
+        // rANS codes in reverse, so the bytes are written back to front
+        scratch.resize( count * 2 + 16 );
+        BYTE* pEnd = scratch.data() + scratch.size();
+        BYTE* ptr = pEnd;
+
+        UINT x = c_StateLow;
+        for( size_t i = count; i-- > 0; )
+        {
+            const UINT f = freqs[ pSymbols[i] ];
+            const UINT xMax = ( ( c_StateLow >> c_ProbBits ) << 8 ) * f;
+            while( x >= xMax )
+            {
+                *--ptr = static_cast<BYTE>( x & 0xFF );
+                x >>= 8;
+            }
+            x = ( ( x / f ) << c_ProbBits ) + ( x % f ) + starts[ pSymbols[i] ];
+        }
+
+        ptr -= sizeof( UINT );
+        WriteUInt( ptr, x );
+
+        const UINT codedBytes = static_cast<UINT>( pEnd - ptr );
+        BYTE header[ sizeof( UINT ) ];
+        WriteUInt( header, codedBytes );
+        output.insert( output.end(), header, header + sizeof( UINT ) );
+        output.insert( output.end(), ptr, pEnd );
+    }
+
+    //----------------------------------------------------------------------------------
+    // Decodes one byte plane, undoing the delta coding into every stride'th byte of pDest
+    //----------------------------------------------------------------------------------
+    HRESULT DecodePlane( const BYTE*& ptr, const BYTE* pEnd, size_t count, size_t stride, BYTE* pDest )
+    {
+        if( size_t( pEnd - ptr ) < c_BitmapBytes )
+            return HRESULT_FROM_WIN32( ERROR_INVALID_DATA );
+
+        const BYTE* pBitmap = ptr;
+        ptr += c_BitmapBytes;
+
+        UINT freqs[256];
+        UINT starts[256];
+        UINT total = 0;
+        for( UINT s = 0; s < 256; ++s )
+        {
+            freqs[s] = 0;
+            starts[s] = total;
+
+            if( IsPresent( pBitmap, s ) )
+            {
+                if( pEnd - ptr < 2 )
+                    return HRESULT_FROM_WIN32( ERROR_INVALID_DATA );
+
+                freqs[s] = ( UINT( ptr[0] ) | ( UINT( ptr[1] ) << 8 ) ) + 1;
+                ptr += 2;
+                total += freqs[s];
+            }
+        }
+
+        if( total != c_ProbScale || size_t( pEnd - ptr ) < sizeof( UINT ) * 2 )
+            return HRESULT_FROM_WIN32( ERROR_INVALID_DATA );
+
+        BYTE symbols[ c_ProbScale ];
+        for( UINT s = 0; s < 256; ++s )
+        {
+            memset( symbols + starts[s], static_cast<int>( s ), freqs[s] );
+        }
+
+        const UINT codedBytes = ReadUInt( ptr );
+        ptr += sizeof( UINT );
+        if( codedBytes < sizeof( UINT ) || size_t( pEnd - ptr ) < codedBytes )
+            return HRESULT_FROM_WIN32( ERROR_INVALID_DATA );
+
+        const BYTE* pCoded = ptr + sizeof( UINT );
+        const BYTE* pCodedEnd = ptr + codedBytes;
+        UINT x = ReadUInt( ptr );
+        ptr = pCodedEnd;
+
+        BYTE value = 0;
+        for( size_t i = 0; i < count; ++i )
+        {
+            const UINT slot = x & ( c_ProbScale - 1 );
+            const BYTE s = symbols[ slot ];
+            x = freqs[s] * ( x >> c_ProbBits ) + slot - starts[s];
+            while( x < c_StateLow )
+            {
+                if( pCoded == pCodedEnd )
+                    return HRESULT_FROM_WIN32( ERROR_INVALID_DATA );
+                x = ( x << 8 ) | *pCoded++;
+            }
+
+            value = static_cast<BYTE>( value + s );
+            pDest[ i * stride ] = value;
+        }
+
+        return S_OK;
+    }
+
+    inline XMVECTOR DecodeOctahedral( float x, float y )
+    {
+        float z = 1.f - fabsf( x ) - fabsf( y );
+        float t = std::max( -z, 0.f );
+        x += ( x >= 0.f ) ? -t : t;
+        y += ( y >= 0.f ) ? -t : t;
+        return XMVector3Normalize( XMVectorSet( x, y, z, 0.f ) );
+    }
+
+    inline float SnormToFloat( short value )
+    {
+        return std::max( float( value ) / 32767.f, -1.f );
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+UINT SDKMeshGetVertexBlockCount( UINT64 numVertices, UINT blockVertices )
+{
+    if( !blockVertices )
+        return 0;
+
+    return static_cast<UINT>( ( numVertices + blockVertices - 1 ) / blockVertices );
+}
+
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT SDKMeshEncodeVertices( const BYTE* pVertices, UINT64 numVertices, UINT stride, UINT blockVertices,
+                               std::vector<BYTE>& encoded )
+{
+    if( !pVertices || !stride || !blockVertices || numVertices > UINT_MAX )
+        return E_INVALIDARG;
+
+    const UINT numBlocks = SDKMeshGetVertexBlockCount( numVertices, blockVertices );
+
+    try
+    {
+        encoded.clear();
+        encoded.resize( sizeof( UINT ) * ( numBlocks + 1 ) );
+
+        std::vector<BYTE> planes;
+        std::vector<BYTE> coded;
+        std::vector<BYTE> scratch;
+
+        for( UINT iBlock = 0; iBlock < numBlocks; ++iBlock )
+        {
+            const size_t first = size_t( iBlock ) * blockVertices;
+            const size_t count = std::min<size_t>( blockVertices, size_t( numVertices ) - first );
+            const BYTE* pBlock = pVertices + first * stride;
+
+            // Byte planes of the differences between consecutive vertices
+            planes.resize( count * stride );
+            for( size_t k = 0; k < stride; ++k )
+            {
+                BYTE* pPlane = planes.data() + k * count;
+                BYTE prev = 0;
+                for( size_t i = 0; i < count; ++i )
+                {
+                    BYTE value = pBlock[ i * stride + k ];
+                    pPlane[i] = static_cast<BYTE>( value - prev );
+                    prev = value;
+                }
+            }
+
+            coded.clear();
+            coded.push_back( BLOCK_CODED );
+            for( size_t k = 0; k < stride; ++k )
+            {
+                EncodePlane( planes.data() + k * count, count, coded, scratch );
+            }
+
+            if( encoded.size() > UINT_MAX )
+                return HRESULT_FROM_WIN32( ERROR_FILE_TOO_LARGE );
+
+            WriteUInt( encoded.data() + sizeof( UINT ) * iBlock, static_cast<UINT>( encoded.size() ) );
+
+            if( coded.size() < count * stride + 1 )
+            {
+                encoded.insert( encoded.end(), coded.begin(), coded.end() );
+            }
+            else
+            {
+                encoded.push_back( BLOCK_STORED );
+                encoded.insert( encoded.end(), pBlock, pBlock + count * stride );
+            }
+        }
+
+        if( encoded.size() > UINT_MAX )
+            return HRESULT_FROM_WIN32( ERROR_FILE_TOO_LARGE );
+
+        WriteUInt( encoded.data() + sizeof( UINT ) * numBlocks, static_cast<UINT>( encoded.size() ) );
+    }
+    catch( const std::bad_alloc& )
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    return S_OK;
+}
+
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT SDKMeshDecodeVertexBlock( const BYTE* pEncoded, size_t encodedBytes, UINT64 numVertices, UINT stride,
+                                  UINT blockVertices, UINT iBlock, BYTE* pVertices )
+{
+    const UINT numBlocks = SDKMeshGetVertexBlockCount( numVertices, blockVertices );
+    if( !pEncoded || !pVertices || !stride || iBlock >= numBlocks )
+        return E_INVALIDARG;
+
+    if( encodedBytes < sizeof( UINT ) * ( size_t( numBlocks ) + 1 ) )
+        return HRESULT_FROM_WIN32( ERROR_INVALID_DATA );
+
+    const UINT start = ReadUInt( pEncoded + sizeof( UINT ) * iBlock );
+    const UINT end = ReadUInt( pEncoded + sizeof( UINT ) * ( iBlock + 1 ) );
+    if( start >= end || end > encodedBytes )
+        return HRESULT_FROM_WIN32( ERROR_INVALID_DATA );
+
+    const size_t first = size_t( iBlock ) * blockVertices;
+    const size_t count = std::min<size_t>( blockVertices, size_t( numVertices ) - first );
+    BYTE* pBlock = pVertices + first * stride;
+
+    const BYTE* ptr = pEncoded + start + 1;
+    const BYTE* pEnd = pEncoded + end;
+
+    switch( pEncoded[ start ] )
+    {
+    case BLOCK_STORED:
+        if( size_t( pEnd - ptr ) != count * stride )
+            return HRESULT_FROM_WIN32( ERROR_INVALID_DATA );
+        memcpy( pBlock, ptr, count * stride );
+        return S_OK;
+
+    case BLOCK_CODED:
+        for( size_t k = 0; k < stride; ++k )
+        {
+            HRESULT hr = DecodePlane( ptr, pEnd, count, stride, pBlock + k );
+            if( FAILED( hr ) )
+                return hr;
+        }
+        return S_OK;
+
+    default:
+        return HRESULT_FROM_WIN32( ERROR_INVALID_DATA );
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+void SDKMeshEncodeOctahedral( FXMVECTOR normal, short* pEncoded )
+{
+    XMFLOAT3 n;
+    XMStoreFloat3( &n, normal );
+
+    float l1 = fabsf( n.x ) + fabsf( n.y ) + fabsf( n.z );
+    if( l1 <= 0.f )
+    {
+        pEncoded[0] = pEncoded[1] = 0;
+        return;
+    }
+
+    float x = n.x / l1;
+    float y = n.y / l1;
+    if( n.z < 0.f )
+    {
+        float ox = x;
+        x = ( 1.f - fabsf( y ) ) * ( ( ox >= 0.f ) ? 1.f : -1.f );
+        y = ( 1.f - fabsf( ox ) ) * ( ( y >= 0.f ) ? 1.f : -1.f );
+    }
+
+    XMVECTOR target = XMVector3Normalize( normal );
+    float bestDot = -2.f;
+
+    const float fx = std::floor( x * 32767.f );
+    const float fy = std::floor( y * 32767.f );
+    for( UINT i = 0; i < 4; ++i )
+    {
+        float qx = std::max( -32767.f, std::min( fx + float( i & 1 ), 32767.f ) );
+        float qy = std::max( -32767.f, std::min( fy + float( i >> 1 ), 32767.f ) );
+
+        float dot = XMVectorGetX( XMVector3Dot( DecodeOctahedral( qx / 32767.f, qy / 32767.f ), target ) );
+        if( dot > bestDot )
+        {
+            bestDot = dot;
+            pEncoded[0] = static_cast<short>( qx );
+            pEncoded[1] = static_cast<short>( qy );
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+XMVECTOR SDKMeshDecodeOctahedral( const short* pEncoded )
+{
+    return DecodeOctahedral( SnormToFloat( pEncoded[0] ), SnormToFloat( pEncoded[1] ) );
+}
@@ -0,0 +1,40 @@
+//--------------------------------------------------------------------------------------
+// File: SDKMeshCodec.h
+//
+// Vertex encodings used by version 102 .sdkmesh files (see SDKMESH_HEADER_EXTENSION).
+// Shared by the loader in SDKmesh.cpp and by sdkmeshtool, so it does not depend on DXUT.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=320437
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <DirectXMath.h>
+
+#include <vector>
+
+//--------------------------------------------------------------------------------------
+// Entropy coded vertex buffers. Each byte of the vertex is delta coded against the previous
+// vertex and the resulting byte planes are rANS coded. Blocks of blockVertices vertices are
+// coded independently, so the blocks of a buffer can be decoded by several threads at once.
+// The stream starts with numBlocks + 1 UINT offsets to the blocks, the last being its size.
+//--------------------------------------------------------------------------------------
+UINT SDKMeshGetVertexBlockCount( _In_ UINT64 numVertices, _In_ UINT blockVertices );
+
+HRESULT SDKMeshEncodeVertices( _In_reads_bytes_(numVertices * stride) const BYTE* pVertices,
+                               _In_ UINT64 numVertices, _In_ UINT stride, _In_ UINT blockVertices,
+                               _Inout_ std::vector<BYTE>& encoded );
+
+// Decodes block iBlock of the stream into its place in pVertices, which holds the whole buffer
+HRESULT SDKMeshDecodeVertexBlock( _In_reads_bytes_(encodedBytes) const BYTE* pEncoded, _In_ size_t encodedBytes,
+                                  _In_ UINT64 numVertices, _In_ UINT stride, _In_ UINT blockVertices, _In_ UINT iBlock,
+                                  _Out_writes_bytes_(numVertices * stride) BYTE* pVertices );
+
+//--------------------------------------------------------------------------------------
+// Octahedral unit vectors, as stored in D3DDECLTYPE_SHORT2N normals, tangents and binormals.
+// The encoder picks whichever rounding of the two components decodes closest to the input.
+//--------------------------------------------------------------------------------------
+void SDKMeshEncodeOctahedral( _In_ DirectX::FXMVECTOR normal, _Out_writes_(2) short* pEncoded );
+DirectX::XMVECTOR SDKMeshDecodeOctahedral( _In_reads_(2) const short* pEncoded );
@@ -0,0 +1,404 @@
+//--------------------------------------------------------------------------------------
+// File: SDKMeshLoader.cpp
+//
+// Asynchronous loader for many .sdkmesh files at once
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=320437
+//--------------------------------------------------------------------------------------
+#include "DXUT.h"
+#include "SDKmeshLoader.h"
+#include "SDKmisc.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+    const size_t c_PageSize = 4096;
+
+    struct LoadRequest
+    {
+        CDXUTSDKMesh* pMesh;
+        WCHAR szFileName[MAX_PATH];
+        WCHAR szFilePath[MAX_PATH];
+        LPSDKMESHLOADED pCallback;
+        void* pContext;
+        SDKMESH_CALLBACKS11* pLoaderCallbacks;
+        SDKMeshData data;
+        size_t bytesReserved;
+        HRESULT hr;
+        std::promise<HRESULT> promise;
+
+        LoadRequest() :
+            pMesh(nullptr),
+            szFileName{},
+            szFilePath{},
+            pCallback(nullptr),
+            pContext(nullptr),
+            pLoaderCallbacks(nullptr),
+            bytesReserved(0),
+            hr(S_OK)
+        {
+        }
+    };
+
+    // Brings the whole mapping into memory so the render thread never stalls on disk reads
+    void PageIn( const SDKMeshData& data )
+    {
+        auto pData = data.GetData();
+        size_t bytes = data.GetDataSize();
+
+#if (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
+        WIN32_MEMORY_RANGE_ENTRY range = { const_cast<BYTE*>( pData ), bytes };
+        std::ignore = PrefetchVirtualMemory( GetCurrentProcess(), 1, &range, 0 );
+#endif
+
+        volatile BYTE sink = 0;
+        for( size_t offset = 0; offset < bytes; offset += c_PageSize )
+        {
+            sink ^= pData[ offset ];
+        }
+        std::ignore = sink;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+class CDXUTSDKMeshLoader::Impl
+{
+public:
+    Impl() noexcept :
+        m_pDev11(nullptr),
+        m_budgetBytes(0),
+        m_bytesInFlight(0),
+        m_outstanding(0),
+        m_shutdown(false)
+    {
+    }
+
+    void Worker();
+    void Complete( std::unique_ptr<LoadRequest> request );
+
+    ID3D11Device* m_pDev11;
+    size_t m_budgetBytes;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_workAvailable;
+    std::condition_variable m_budgetAvailable;
+    std::condition_variable m_loadParsed;
+
+    std::deque<std::unique_ptr<LoadRequest>> m_pending;
+    std::deque<std::unique_ptr<LoadRequest>> m_parsed;
+    std::vector<std::thread> m_threads;
+
+    size_t m_bytesInFlight;
+    UINT m_outstanding;
+    bool m_shutdown;
+};
+
+
+//--------------------------------------------------------------------------------------
+void CDXUTSDKMeshLoader::Impl::Worker()
+{
+    for( ;; )
+    {
+        std::unique_ptr<LoadRequest> request;
+
+        {
+            std::unique_lock<std::mutex> lock( m_mutex );
+            m_workAvailable.wait( lock, [this] { return m_shutdown || !m_pending.empty(); } );
+            if( m_shutdown )
+                return;
+
+            request = std::move( m_pending.front() );
+            m_pending.pop_front();
+        }
+
+        request->hr = DXUTFindDXSDKMediaFileCch( request->szFilePath, MAX_PATH, request->szFileName );
+        if( SUCCEEDED( request->hr ) )
+            request->hr = request->data.Open( request->szFilePath );
+
+        if( SUCCEEDED( request->hr ) )
+        {
+            // Mapping only reserves address space; hold off paging in and decoding until the budget
+            // allows. A single load larger than the whole budget still proceeds once nothing else is
+            // in flight.
+            size_t bytes = request->data.GetDataSize() + request->data.GetDecodedVertexSize();
+
+            {
+                std::unique_lock<std::mutex> lock( m_mutex );
+                m_budgetAvailable.wait( lock, [&] {
+                    return m_shutdown || !m_bytesInFlight || ( m_bytesInFlight + bytes <= m_budgetBytes ); } );
+
+                if( m_shutdown )
+                {
+                    request->hr = E_ABORT;
+                }
+                else
+                {
+                    m_bytesInFlight += bytes;
+                    request->bytesReserved = bytes;
+                }
+            }
+
+            // The workers already run in parallel, so each decodes its mesh on its own thread
+            if( SUCCEEDED( request->hr ) )
+            {
+                PageIn( request->data );
+                request->hr = request->data.DecodeVertices( 1 );
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            m_parsed.push_back( std::move( request ) );
+        }
+        m_loadParsed.notify_all();
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+void CDXUTSDKMeshLoader::Impl::Complete( std::unique_ptr<LoadRequest> request )
+{
+    HRESULT hr = request->hr;
+    if( SUCCEEDED( hr ) )
+    {
+        hr = request->pMesh->Create( m_pDev11, request->szFilePath, std::move( request->data ), request->pLoaderCallbacks );
+    }
+    request->data.Close();
+
+    request->pMesh->SetLoading( false );
+
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        m_bytesInFlight -= request->bytesReserved;
+        --m_outstanding;
+    }
+    m_budgetAvailable.notify_all();
+
+    if( request->pCallback )
+        request->pCallback( hr, request->pMesh, request->pContext );
+
+    request->promise.set_value( hr );
+}
+
+
+//--------------------------------------------------------------------------------------
+CDXUTSDKMeshLoader::CDXUTSDKMeshLoader() noexcept
+{
+}
+
+
+//--------------------------------------------------------------------------------------
+CDXUTSDKMeshLoader::~CDXUTSDKMeshLoader()
+{
+    Shutdown();
+}
+
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT CDXUTSDKMeshLoader::Initialize( ID3D11Device* pDev11, UINT numThreads, size_t budgetBytes )
+{
+    if( !pDev11 || !budgetBytes )
+        return E_INVALIDARG;
+
+    if( pImpl )
+        return E_UNEXPECTED;
+
+    if( !numThreads )
+    {
+        UINT cpus = std::thread::hardware_concurrency();
+        numThreads = ( cpus > 1 ) ? ( cpus - 1 ) : 1;
+    }
+
+    std::unique_ptr<Impl> impl( new (std::nothrow) Impl );
+    if( !impl )
+        return E_OUTOFMEMORY;
+
+    impl->m_pDev11 = pDev11;
+    impl->m_budgetBytes = budgetBytes;
+
+    pImpl = std::move( impl );
+
+    try
+    {
+        pImpl->m_threads.reserve( numThreads );
+        for( UINT i = 0; i < numThreads; ++i )
+        {
+            pImpl->m_threads.emplace_back( &Impl::Worker, pImpl.get() );
+        }
+    }
+    catch( ... )
+    {
+        Shutdown();
+        return E_FAIL;
+    }
+
+    return S_OK;
+}
+
+
+//--------------------------------------------------------------------------------------
+void CDXUTSDKMeshLoader::Shutdown()
+{
+    if( !pImpl )
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock( pImpl->m_mutex );
+        pImpl->m_shutdown = true;
+    }
+    pImpl->m_workAvailable.notify_all();
+    pImpl->m_budgetAvailable.notify_all();
+
+    for( auto& it : pImpl->m_threads )
+    {
+        it.join();
+    }
+
+    // No workers remain, so everything left can be finished from this thread
+    for( auto& it : pImpl->m_parsed )
+    {
+        it->hr = E_ABORT;
+    }
+    for( auto& it : pImpl->m_pending )
+    {
+        it->hr = E_ABORT;
+        pImpl->m_parsed.push_back( std::move( it ) );
+    }
+    pImpl->m_pending.clear();
+
+    while( !pImpl->m_parsed.empty() )
+    {
+        auto request = std::move( pImpl->m_parsed.front() );
+        pImpl->m_parsed.pop_front();
+        pImpl->Complete( std::move( request ) );
+    }
+
+    pImpl.reset();
+}
+
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+std::future<HRESULT> CDXUTSDKMeshLoader::Load( CDXUTSDKMesh* pMesh,
+                                               LPCWSTR szFileName,
+                                               LPSDKMESHLOADED pCallback,
+                                               void* pContext,
+                                               SDKMESH_CALLBACKS11* pLoaderCallbacks )
+{
+    std::promise<HRESULT> failed;
+
+    if( !pImpl || !pMesh || !szFileName )
+    {
+        failed.set_value( pImpl ? E_INVALIDARG : E_UNEXPECTED );
+        return failed.get_future();
+    }
+
+    std::unique_ptr<LoadRequest> request( new (std::nothrow) LoadRequest );
+    if( !request )
+    {
+        failed.set_value( E_OUTOFMEMORY );
+        return failed.get_future();
+    }
+
+    if( wcscpy_s( request->szFileName, MAX_PATH, szFileName ) )
+    {
+        failed.set_value( E_INVALIDARG );
+        return failed.get_future();
+    }
+
+    request->pMesh = pMesh;
+    request->pCallback = pCallback;
+    request->pContext = pContext;
+    request->pLoaderCallbacks = pLoaderCallbacks;
+
+    auto future = request->promise.get_future();
+
+    pMesh->SetLoading( true );
+
+    {
+        std::lock_guard<std::mutex> lock( pImpl->m_mutex );
+        pImpl->m_pending.push_back( std::move( request ) );
+        ++pImpl->m_outstanding;
+    }
+    pImpl->m_workAvailable.notify_one();
+
+    return future;
+}
+
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+UINT CDXUTSDKMeshLoader::ProcessCompleted( UINT maxMeshes )
+{
+    if( !pImpl )
+        return 0;
+
+    UINT count = 0;
+    while( count < maxMeshes )
+    {
+        std::unique_ptr<LoadRequest> request;
+
+        {
+            std::lock_guard<std::mutex> lock( pImpl->m_mutex );
+            if( pImpl->m_parsed.empty() )
+                break;
+
+            request = std::move( pImpl->m_parsed.front() );
+            pImpl->m_parsed.pop_front();
+        }
+
+        pImpl->Complete( std::move( request ) );
+        ++count;
+    }
+
+    return count;
+}
+
+
+//--------------------------------------------------------------------------------------
+void CDXUTSDKMeshLoader::WaitAll()
+{
+    if( !pImpl )
+        return;
+
+    for( ;; )
+    {
+        ProcessCompleted();
+
+        std::unique_lock<std::mutex> lock( pImpl->m_mutex );
+        pImpl->m_loadParsed.wait( lock, [this] { return !pImpl->m_parsed.empty() || !pImpl->m_outstanding; } );
+        if( !pImpl->m_outstanding )
+            return;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+UINT CDXUTSDKMeshLoader::GetOutstandingLoads() const
+{
+    if( !pImpl )
+        return 0;
+
+    std::lock_guard<std::mutex> lock( pImpl->m_mutex );
+    return pImpl->m_outstanding;
+}
+
+
+//--------------------------------------------------------------------------------------
+size_t CDXUTSDKMeshLoader::GetBytesInFlight() const
+{
+    if( !pImpl )
+        return 0;
+
+    std::lock_guard<std::mutex> lock( pImpl->m_mutex );
+    return pImpl->m_bytesInFlight;
+}
@@ -0,0 +1,66 @@
+//--------------------------------------------------------------------------------------
+// File: SDKMeshLoader.h
+//
+// Asynchronous loader for many .sdkmesh files at once. Worker threads find, map, validate
+// and page in the files and decode their entropy coded vertices; the Direct3D resources and
+// materials are then created on the thread that calls ProcessCompleted, since the DXUT
+// resource cache and the immediate context are not thread-safe.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=320437
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include "SDKmesh.h"
+
+#include <future>
+#include <memory>
+
+typedef void ( CALLBACK*LPSDKMESHLOADED )( _In_ HRESULT hr, _In_ CDXUTSDKMesh* pMesh, _In_opt_ void* pContext );
+
+//--------------------------------------------------------------------------------------
+// CDXUTSDKMeshLoader class.  Queues CDXUTSDKMesh loads onto a pool of worker threads
+//--------------------------------------------------------------------------------------
+class CDXUTSDKMeshLoader
+{
+public:
+    static const size_t DEFAULT_MEMORY_BUDGET = 256 * 1024 * 1024;
+
+    CDXUTSDKMeshLoader() noexcept;
+    ~CDXUTSDKMeshLoader();
+
+    CDXUTSDKMeshLoader( const CDXUTSDKMeshLoader& ) = delete;
+    CDXUTSDKMeshLoader& operator=( const CDXUTSDKMeshLoader& ) = delete;
+
+    // numThreads of 0 uses one worker per logical processor, less one for the render thread.
+    // Loads that have been paged in but not yet completed are held to budgetBytes in total.
+    HRESULT Initialize( _In_ ID3D11Device* pDev11, _In_ UINT numThreads = 0, _In_ size_t budgetBytes = DEFAULT_MEMORY_BUDGET );
+
+    // Stops the workers; loads that have not completed finish with E_ABORT
+    void Shutdown();
+
+    // Queues a load. The mesh reports IsLoading() until the load completes, at which point the
+    // callback is invoked and the future becomes ready. Both happen inside ProcessCompleted or
+    // WaitAll, so do not block on the future from the thread that pumps the loader.
+    std::future<HRESULT> Load( _In_ CDXUTSDKMesh* pMesh,
+                               _In_z_ LPCWSTR szFileName,
+                               _In_opt_ LPSDKMESHLOADED pCallback = nullptr,
+                               _In_opt_ void* pContext = nullptr,
+                               _In_opt_ SDKMESH_CALLBACKS11* pLoaderCallbacks = nullptr );
+
+    // Creates the device resources for up to maxMeshes parsed loads; returns the number completed
+    UINT ProcessCompleted( _In_ UINT maxMeshes = UINT_MAX );
+
+    // Processes loads until none are outstanding
+    void WaitAll();
+
+    UINT GetOutstandingLoads() const;
+    size_t GetBytesInFlight() const;
+
+private:
+    class Impl;
+
+    std::unique_ptr<Impl> pImpl;
+};
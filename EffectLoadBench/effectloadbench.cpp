@@ -0,0 +1,286 @@
+//--------------------------------------------------------------------------------------
+// File: effectloadbench.cpp
+//
+// Command-line benchmark for D3DX11CreateEffectFromMemory. It times loading one large
+// compiled effect on a WARP device. The effect is either an .fxo file given with -f, or
+// one generated and compiled here with fx_5_0. The generated effect has one structure
+// type per material, eight materials per constant buffer, a semantic and annotations on
+// every variable, and one technique per constant buffer.
+//
+// The Effects 11 sources are compiled into the tool. EffectLoadBench_2019.vcxproj uses
+// the default string hash, and EffectLoadBenchLegacyHash_2019.vcxproj defines
+// D3DX11_FX_LEGACY_HASH. Run both on the same .fxo to compare them: write it once with
+// -o, then load it with -f in each build.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/p/?LinkId=271568
+//--------------------------------------------------------------------------------------
+
+#pragma warning(push)
+#pragma warning(disable : 4005)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#define NODRAWTEXT
+#define NOGDI
+#define NOBITMAP
+#define NOMCX
+#define NOSERVICE
+#define NOHELP
+#pragma warning(pop)
+
+#include <Windows.h>
+
+#include <d3d11_1.h>
+#include <d3dcompiler.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cwchar>
+#include <string>
+#include <vector>
+
+#include <wrl/client.h>
+
+#include "d3dx11effect.h"
+
+#pragma comment(lib, "d3d11.lib")
+
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+    constexpr uint32_t DEFAULT_MATERIAL_COUNT = 2048;
+    constexpr uint32_t DEFAULT_REPEAT_COUNT = 10;
+    constexpr uint32_t MATERIALS_PER_CBUFFER = 8;
+
+    //----------------------------------------------------------------------------------
+    // Timer
+    //----------------------------------------------------------------------------------
+    double GetMilliseconds()
+    {
+        static LARGE_INTEGER frequency = {};
+        if (!frequency.QuadPart)
+            QueryPerformanceFrequency(&frequency);
+
+        LARGE_INTEGER counter;
+        QueryPerformanceCounter(&counter);
+        return double(counter.QuadPart) * 1000.0 / double(frequency.QuadPart);
+    }
+
+    //----------------------------------------------------------------------------------
+    // Effect source: the member names repeat in every structure, like the members of a
+    // material library, so most strings are pooled many times over
+    //----------------------------------------------------------------------------------
+    std::string GenerateEffectSource(uint32_t materialCount)
+    {
+        std::string source;
+        char line[512];
+
+        for (uint32_t i = 0; i < materialCount; ++i)
+        {
+            sprintf_s(line,
+                "struct Material%u\n"
+                "{\n"
+                "    float4 Diffuse;\n"
+                "    float4 Specular;\n"
+                "    float3 Emissive;\n"
+                "    float  Power;\n"
+                "    float2 UVOffset;\n"
+                "    float2 UVScale;\n"
+                "    float  Roughness;\n"
+                "    float  Metalness;\n"
+                "    float  Layer%u;\n"
+                "};\n", i, i % 64);
+            source += line;
+        }
+
+        const uint32_t cbufferCount = (materialCount + MATERIALS_PER_CBUFFER - 1) / MATERIALS_PER_CBUFFER;
+
+        for (uint32_t cb = 0; cb < cbufferCount; ++cb)
+        {
+            sprintf_s(line, "cbuffer cbMaterials%u\n{\n    float4x4 g_World%u : WORLD%u < string UIName = \"World %u\"; >;\n", cb, cb, cb, cb);
+            source += line;
+
+            for (uint32_t i = cb * MATERIALS_PER_CBUFFER; i < std::min(materialCount, (cb + 1) * MATERIALS_PER_CBUFFER); ++i)
+            {
+                sprintf_s(line,
+                    "    Material%u g_Material%u : MATERIAL%u < string UIName = \"Material %u\"; string UIWidget = \"Color\"; float UIMin = 0.0; float UIMax = 1.0; >;\n",
+                    i, i, i, i);
+                source += line;
+            }
+
+            sprintf_s(line,
+                "};\n"
+                "float4 VS%u(float4 pos : POSITION) : SV_Position { return mul(pos, g_World%u); }\n"
+                "float4 PS%u() : SV_Target { return g_Material%u.Diffuse; }\n"
+                "technique11 Draw%u < string Category = \"Materials\"; >\n"
+                "{\n"
+                "    pass P0\n"
+                "    {\n"
+                "        SetVertexShader(CompileShader(vs_5_0, VS%u()));\n"
+                "        SetPixelShader(CompileShader(ps_5_0, PS%u()));\n"
+                "    }\n"
+                "}\n", cb, cb, cb, cb * MATERIALS_PER_CBUFFER, cb, cb, cb);
+            source += line;
+        }
+
+        return source;
+    }
+
+    //----------------------------------------------------------------------------------
+    void PrintUsage()
+    {
+        wprintf(L"Usage: effectloadbench <options>\n");
+        wprintf(L"\n");
+        wprintf(L"   -f <filename>       load this compiled effect instead of generating one\n");
+        wprintf(L"   -o <filename>       write the compiled effect to this file\n");
+        wprintf(L"   -n <count>          materials in the generated effect (defaults to %u)\n", DEFAULT_MATERIAL_COUNT);
+        wprintf(L"   -r <count>          number of loads (defaults to %u)\n", DEFAULT_REPEAT_COUNT);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Entry-point
+//--------------------------------------------------------------------------------------
+#pragma prefast(disable : 28198, "Command-line tool, frees all memory on exit")
+
+int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
+{
+    const wchar_t* inputFile = nullptr;
+    const wchar_t* outputFile = nullptr;
+    uint32_t materialCount = DEFAULT_MATERIAL_COUNT;
+    uint32_t repeatCount = DEFAULT_REPEAT_COUNT;
+
+    for (int iArg = 1; iArg < argc; iArg++)
+    {
+        const wchar_t* pArg = argv[iArg];
+        if ((('-' != pArg[0]) && ('/' != pArg[0])) || (iArg + 1 >= argc))
+        {
+            PrintUsage();
+            return 1;
+        }
+
+        pArg++;
+        const wchar_t* pValue = argv[++iArg];
+        if (!_wcsicmp(pArg, L"f"))
+        {
+            inputFile = pValue;
+        }
+        else if (!_wcsicmp(pArg, L"o"))
+        {
+            outputFile = pValue;
+        }
+        else if (!_wcsicmp(pArg, L"n"))
+        {
+            if (swscanf_s(pValue, L"%u", &materialCount) != 1 || !materialCount || materialCount > 65536)
+            {
+                wprintf(L"Invalid value specified with -n (%ls), must be 1 to 65536\n", pValue);
+                return 1;
+            }
+        }
+        else if (!_wcsicmp(pArg, L"r"))
+        {
+            if (swscanf_s(pValue, L"%u", &repeatCount) != 1 || !repeatCount)
+            {
+                wprintf(L"Invalid value specified with -r (%ls)\n", pValue);
+                return 1;
+            }
+        }
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+#ifdef D3DX11_FX_LEGACY_HASH
+    wprintf(L"string hash: legacy (D3DX11_FX_LEGACY_HASH)\n");
+#else
+    wprintf(L"string hash: default\n");
+#endif
+
+    ComPtr<ID3DBlob> blob;
+    HRESULT hr = S_OK;
+
+    if (inputFile)
+    {
+        hr = D3DReadFileToBlob(inputFile, blob.GetAddressOf());
+        if (FAILED(hr))
+        {
+            wprintf(L"ERROR: Failed to read %ls (%08X)\n", inputFile, static_cast<unsigned int>(hr));
+            return 1;
+        }
+    }
+    else
+    {
+        const std::string source = GenerateEffectSource(materialCount);
+
+        wprintf(L"compiling a generated effect with %u materials...\n", materialCount);
+
+        ComPtr<ID3DBlob> errors;
+        hr = D3DCompile(source.c_str(), source.size(), "effectloadbench", nullptr, nullptr, "", "fx_5_0", 0, 0, blob.GetAddressOf(), errors.GetAddressOf());
+        if (FAILED(hr))
+        {
+            wprintf(L"ERROR: Failed to compile the generated effect (%08X)\n", static_cast<unsigned int>(hr));
+            if (errors)
+                wprintf(L"%hs\n", static_cast<const char*>(errors->GetBufferPointer()));
+            return 1;
+        }
+    }
+
+    if (outputFile)
+    {
+        hr = D3DWriteBlobToFile(blob.Get(), outputFile, TRUE);
+        if (FAILED(hr))
+        {
+            wprintf(L"ERROR: Failed to write %ls (%08X)\n", outputFile, static_cast<unsigned int>(hr));
+            return 1;
+        }
+    }
+
+    ComPtr<ID3D11Device> device;
+    hr = D3D11CreateDevice(nullptr, D3D_DRIVER_TYPE_WARP, nullptr, 0, nullptr, 0, D3D11_SDK_VERSION, device.GetAddressOf(), nullptr, nullptr);
+    if (FAILED(hr))
+    {
+        wprintf(L"ERROR: Failed to create a WARP device (%08X)\n", static_cast<unsigned int>(hr));
+        return 1;
+    }
+
+    // The first load also pays for WARP compiling the shaders, so it is reported apart
+    std::vector<double> times;
+    times.reserve(repeatCount + 1);
+
+    D3DX11_EFFECT_DESC desc = {};
+
+    for (uint32_t run = 0; run <= repeatCount; ++run)
+    {
+        ComPtr<ID3DX11Effect> effect;
+
+        const double start = GetMilliseconds();
+        hr = D3DX11CreateEffectFromMemory(blob->GetBufferPointer(), blob->GetBufferSize(), 0, device.Get(), effect.GetAddressOf());
+        times.push_back(GetMilliseconds() - start);
+
+        if (FAILED(hr))
+        {
+            wprintf(L"ERROR: D3DX11CreateEffectFromMemory failed (%08X)\n", static_cast<unsigned int>(hr));
+            return 1;
+        }
+
+        if (!run)
+            effect->GetDesc(&desc);
+    }
+
+    wprintf(L"%zu byte effect: %u constant buffers, %u variables, %u techniques\n",
+        blob->GetBufferSize(), desc.ConstantBuffers, desc.GlobalVariables, desc.Techniques);
+    wprintf(L"  first load   %9.2f ms\n", times[0]);
+
+    std::sort(times.begin() + 1, times.end());
+    wprintf(L"  best         %9.2f ms\n", times[1]);
+    wprintf(L"  median       %9.2f ms (of %u loads)\n", times[1 + repeatCount / 2], repeatCount);
+
+    return 0;
+}
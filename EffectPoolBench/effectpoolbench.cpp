@@ -0,0 +1,276 @@
+//--------------------------------------------------------------------------------------
+// File: effectpoolbench.cpp
+//
+// Command-line benchmark for the hash tables behind the Effects 11 string and type
+// pools. Names are pooled the way CEffectLoader::LoadStringAndAddToPool does it: hash,
+// find, and copy to the pooled heap and add if missing. Each unique name is referenced
+// about four times, as variable, member, semantic and type names are in a large effect.
+// CEffectHashTableWithPrivateHeap, which the pools use, is timed against
+// CEffectOpenHashTable, which the name indices use, for the whole load and for the
+// lookups alone.
+// The same names are then indexed the way CEffect::BuildNameIndex does it: the names
+// already sit in the effect's data, and the table only keeps pointers to them.
+// Both tables are also checked to find every name, and only those names.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/p/?LinkId=271568
+//--------------------------------------------------------------------------------------
+
+#include "pchfx.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cwchar>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    constexpr uint32_t DEFAULT_REPEAT_COUNT = 5;
+
+    bool AreStringsEqual(const LPCSTR &pStr1, const LPCSTR &pStr2) { return strcmp(pStr1, pStr2) == 0; }
+
+    typedef CEffectHashTableWithPrivateHeap<LPCSTR, AreStringsEqual> CChainedTable;
+    typedef CEffectOpenHashTable<LPCSTR, AreStringsEqual> COpenTable;
+
+    //----------------------------------------------------------------------------------
+    // Timer
+    //----------------------------------------------------------------------------------
+    double GetMilliseconds()
+    {
+        static LARGE_INTEGER frequency = {};
+        if (!frequency.QuadPart)
+            QueryPerformanceFrequency(&frequency);
+
+        LARGE_INTEGER counter;
+        QueryPerformanceCounter(&counter);
+        return double(counter.QuadPart) * 1000.0 / double(frequency.QuadPart);
+    }
+
+    struct Timings
+    {
+        double load;
+        double lookups;
+    };
+
+    // Same steps as CEffectLoader::LoadStringAndAddToPool, or as CEffect::AddNameToIndex
+    // when the name is not copied
+    template<typename Table>
+    HRESULT PoolString(Table &table, CDataBlockStore &heap, LPCSTR pName, bool copyName)
+    {
+        HRESULT hr = S_OK;
+        uint32_t len = (uint32_t)strlen(pName);
+        uint32_t hash = ComputeHash((const uint8_t *)pName, len);
+        typename Table::CIterator iter;
+
+        if (FAILED(table.FindValueWithHash(pName, hash, &iter)))
+        {
+            if (copyName)
+            {
+                char *pString;
+                VN( pString = static_cast<char *>(heap.Allocate(len + 1)) );
+                memcpy(pString, pName, len + 1);
+                pName = pString;
+            }
+            VH( table.AddValueWithHash(pName, hash) );
+        }
+
+    lExit:
+        return hr;
+    }
+
+    // The chained table takes its entries from the pooled heap, as the pointer mapping tables do
+    void SetPrivateHeap(CChainedTable &table, CDataBlockStore &heap) { table.SetPrivateHeap(&heap); }
+    void SetPrivateHeap(COpenTable &, CDataBlockStore &) {}
+
+    template<typename Table>
+    HRESULT Run(const std::vector<std::string> &references, size_t uniqueCount, bool pooled, Timings &timings)
+    {
+        HRESULT hr = S_OK;
+        CDataBlockStore heap;
+        CDataBlockStore effectData;
+        Table table;
+        std::vector<LPCSTR> names;
+        std::vector<uint32_t> hashes;
+        typename Table::CIterator iter;
+        size_t found = 0;
+        size_t entries = 0;
+        double start;
+
+        heap.EnableAlignment();
+
+        // Names that are indexed rather than pooled already sit in the effect's data,
+        // away from the table's entries
+        names.reserve(references.size());
+        for (const auto &reference : references)
+        {
+            if (pooled)
+            {
+                names.push_back(reference.c_str());
+            }
+            else
+            {
+                char *pString;
+                VN( pString = static_cast<char *>(effectData.Allocate((uint32_t)reference.size() + 1)) );
+                memcpy(pString, reference.c_str(), reference.size() + 1);
+                names.push_back(pString);
+            }
+        }
+
+        start = GetMilliseconds();
+
+        SetPrivateHeap(table, heap);
+        VH( table.AutoGrow() );
+
+        for (LPCSTR pName : names)
+        {
+            VH( PoolString(table, heap, pName, pooled) );
+        }
+
+        timings.load = GetMilliseconds() - start;
+
+        // Lookups alone, with the hashes computed beforehand
+        hashes.reserve(references.size());
+        for (const auto &reference : references)
+        {
+            hashes.push_back(ComputeHash(reference.c_str()));
+        }
+
+        start = GetMilliseconds();
+
+        for (size_t i = 0; i < references.size(); ++ i)
+        {
+            if (SUCCEEDED(table.FindValueWithHash(references[i].c_str(), hashes[i], &iter)))
+            {
+                ++ found;
+            }
+        }
+
+        timings.lookups = GetMilliseconds() - start;
+
+        for (table.GetFirstEntry(&iter); !table.PastEnd(&iter); table.GetNextEntry(&iter))
+        {
+            ++ entries;
+        }
+
+        VB( found == references.size() );
+        VB( entries == uniqueCount );
+
+        // Names that were never added must not be found
+        for (size_t i = 0; i < uniqueCount; ++ i)
+        {
+            std::string missing = references[i] + "_";
+            VB( FAILED(table.FindValueWithHash(missing.c_str(), ComputeHash(missing.c_str()), &iter)) );
+        }
+
+    lExit:
+        return hr;
+    }
+
+    template<typename Table>
+    HRESULT BestOf(uint32_t repeatCount, const std::vector<std::string> &references, size_t uniqueCount, bool pooled, Timings &best)
+    {
+        HRESULT hr = S_OK;
+
+        for (uint32_t run = 0; run < repeatCount; ++ run)
+        {
+            Timings timings;
+            VH( Run<Table>(references, uniqueCount, pooled, timings) );
+
+            if (!run || timings.load < best.load)
+                best.load = timings.load;
+            if (!run || timings.lookups < best.lookups)
+                best.lookups = timings.lookups;
+        }
+
+    lExit:
+        return hr;
+    }
+
+    //----------------------------------------------------------------------------------
+    void PrintUsage()
+    {
+        wprintf(L"Usage: effectpoolbench <options>\n");
+        wprintf(L"\n");
+        wprintf(L"   -r <count>          number of runs, the best is reported (defaults to %u)\n", DEFAULT_REPEAT_COUNT);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Entry-point
+//--------------------------------------------------------------------------------------
+#pragma prefast(disable : 28198, "Command-line tool, frees all memory on exit")
+
+int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
+{
+    uint32_t repeatCount = DEFAULT_REPEAT_COUNT;
+
+    if (argc == 3 && (argv[1][0] == L'-' || argv[1][0] == L'/') && !_wcsicmp(argv[1] + 1, L"r"))
+    {
+        if (swscanf_s(argv[2], L"%u", &repeatCount) != 1 || !repeatCount)
+        {
+            wprintf(L"Invalid value specified with -r (%ls)\n", argv[2]);
+            return 1;
+        }
+    }
+    else if (argc != 1)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    static const size_t s_uniqueCounts[] = { 500, 5000, 50000 };
+
+    std::mt19937 rng(46);
+
+    wprintf(L"best of %u runs                       chained table           open table\n", repeatCount);
+    wprintf(L"       unique / references           load    lookups        load    lookups\n");
+
+    for (size_t uniqueCount : s_uniqueCounts)
+    {
+        // Groups of 8 names share a prefix, like the members of one structure
+        std::vector<std::string> names;
+        names.reserve(uniqueCount);
+        while (names.size() < uniqueCount)
+        {
+            std::string name = "g_Material" + std::to_string(names.size() / 8) + "_Param" + std::to_string(rng() % 100000);
+            if (std::find(names.end() - std::min<size_t>(names.size(), 8), names.end(), name) == names.end())
+            {
+                names.push_back(name);
+            }
+        }
+
+        std::vector<std::string> references(names);
+        references.reserve(uniqueCount * 4);
+        while (references.size() < uniqueCount * 4)
+        {
+            references.push_back(names[rng() % uniqueCount]);
+        }
+
+        for (int pass = 0; pass < 2; ++ pass)
+        {
+            bool pooled = (pass == 0);
+            Timings chained = {};
+            Timings open = {};
+            HRESULT hr = BestOf<CChainedTable>(repeatCount, references, uniqueCount, pooled, chained);
+            if (SUCCEEDED(hr))
+            {
+                hr = BestOf<COpenTable>(repeatCount, references, uniqueCount, pooled, open);
+            }
+            if (FAILED(hr))
+            {
+                wprintf(L"ERROR: %zu names were not %ls correctly (%08X)\n", uniqueCount, pooled ? L"pooled" : L"indexed", static_cast<unsigned int>(hr));
+                return 1;
+            }
+
+            wprintf(L"%-6ls %6zu / %6zu         %8.2f ms %7.2f ms   %8.2f ms %7.2f ms\n",
+                pooled ? L"pool" : L"index", uniqueCount, references.size(), chained.load, chained.lookups, open.load, open.lookups);
+        }
+    }
+
+    return 0;
+}
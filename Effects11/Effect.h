@@ -348,6 +348,7 @@ struct SBaseBlock
 
 struct STechnique : public ID3DX11EffectTechnique
 {
+    CEffect     *pEffect;
     char        *pName;
 
     uint32_t    PassCount;
@@ -377,6 +378,7 @@ struct STechnique : public ID3DX11EffectTechnique
 
 struct SGroup : public ID3DX11EffectGroup
 {
+    CEffect     *pEffect;
     char        *pName;
 
     uint32_t    TechniqueCount;
@@ -585,6 +587,17 @@ typedef SShaderDependency<SShaderResource*, ID3D11ShaderResourceView*> SShaderRe
 typedef SShaderDependency<SUnorderedAccessView*, ID3D11UnorderedAccessView*> SUnorderedAccessViewDependency;
 typedef SShaderDependency<SInterface*, ID3D11ClassInstance*> SInterfaceDependency;
 
+enum EShaderStage
+{
+    ESS_Vertex,
+    ESS_Hull,
+    ESS_Domain,
+    ESS_Geometry,
+    ESS_Pixel,
+    ESS_Compute,
+    ESS_Count
+};
+
 // Shader VTables are used to eliminate branching in ApplyShaderBlock.
 // The effect owns one D3DShaderVTables for each shader stage
 struct SD3DShaderVTable
@@ -594,6 +607,7 @@ struct SD3DShaderVTable
     void ( __stdcall ID3D11DeviceContext::*pSetSamplers)(uint32_t Offset, uint32_t NumSamplers, ID3D11SamplerState*const* pSamplers);
     void ( __stdcall ID3D11DeviceContext::*pSetShaderResources)(uint32_t Offset, uint32_t NumResources, ID3D11ShaderResourceView *const *pResources);
     HRESULT ( __stdcall ID3D11Device::*pCreateShader)(const void *pShaderBlob, size_t ShaderBlobSize, ID3D11ClassLinkage* pClassLinkage, ID3D11DeviceChild **ppShader);
+    EShaderStage Stage;
 };
 
 
@@ -832,6 +846,10 @@ struct SConstantBuffer : public TUncastableVariable<ID3DX11EffectConstantBuffer>
 
     CEffect                 *pEffect;
 
+    // Register-aligned byte range written since the last upload; valid while IsDirty is set
+    uint32_t                DirtyStart;
+    uint32_t                DirtyEnd;
+
     SConstantBuffer() noexcept :
         pD3DObject(nullptr),
         TBuffer{},
@@ -852,12 +870,38 @@ struct SConstantBuffer : public TUncastableVariable<ID3DX11EffectConstantBuffer>
         IsSingle(false),
         IsNonUpdatable(false),
         pMemberData(nullptr),
-        pEffect(nullptr)
+        pEffect(nullptr),
+        DirtyStart(0),
+        DirtyEnd(0)
     {
     }
 
     bool ClonedSingle() const;
 
+    // Marks [Offset, Offset + Count) for upload on the next apply, widened to whole registers
+    void DirtyRange(_In_ uint32_t Offset, _In_ uint32_t Count)
+    {
+        if (Count == 0)
+            return;
+
+        uint32_t start = Offset & ~(SType::c_RegisterSize - 1);
+        uint32_t end = std::min<uint32_t>((Offset + Count + SType::c_RegisterSize - 1) & ~(SType::c_RegisterSize - 1), Size);
+
+        if (!IsDirty)
+        {
+            DirtyStart = start;
+            DirtyEnd = end;
+            IsDirty = true;
+        }
+        else
+        {
+            DirtyStart = std::min<uint32_t>(DirtyStart, start);
+            DirtyEnd = std::max<uint32_t>(DirtyEnd, end);
+        }
+    }
+
+    void DirtyAll() { DirtyRange(0, Size); }
+
     // ID3DX11EffectConstantBuffer interface
     STDMETHOD_(bool, IsValid)() override;
     STDMETHOD_(ID3DX11EffectType*, GetType)() override;
@@ -1062,6 +1106,95 @@ public:
 };
 
 
+//////////////////////////////////////////////////////////////////////////
+// SEffectStateCache - what effects last bound on one device context
+//////////////////////////////////////////////////////////////////////////
+
+// Attached to the context as private data (D3DX11EnableEffectStateCache), so
+// that every effect applied on the context sees the others' bindings.
+// Pointers are compared, never dereferenced, and the cache holds no
+// references. Most recorded objects are held by the context, so they cannot
+// be destroyed and their addresses reused while recorded. Shader resource
+// views are the exception: the runtime binds NULL instead of a view whose
+// resource is bound as an output, and a view released by the application
+// after that could be replaced by another at the same address. Such views
+// are recorded as unknown (ForgetOutputShaderResources), so they are always
+// bound again.
+struct SEffectStateCache : public IUnknown
+{
+    struct SStage
+    {
+        ID3D11DeviceChild           *pShader;
+        uint32_t                    ClassInstanceCount;
+        ID3D11Buffer                *pConstantBuffers[D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT];
+        ID3D11SamplerState          *pSamplers[D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT];
+        ID3D11ShaderResourceView    *pShaderResources[D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT];
+    };
+
+    struct SState
+    {
+        ID3D11BlendState            *pBlendState;
+        FLOAT                       BlendFactor[4];
+        uint32_t                    SampleMask;
+        ID3D11DepthStencilState     *pDepthStencilState;
+        uint32_t                    StencilRef;
+        ID3D11RasterizerState       *pRasterizerState;
+        uint32_t                    RenderTargetViewCount;
+        ID3D11RenderTargetView      *pRenderTargetViews[D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT];
+        ID3D11DepthStencilView      *pDepthStencilView;
+        SStage                      Stages[ESS_Count];
+    };
+
+    SState          State;
+    volatile long   RefCount;
+
+    // Resources of the context's render targets, depth stencil and the UAVs
+    // shader model 5 can use; read from the context when the count is UINT32_MAX
+    ID3D11Resource  *pOutputResources[D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT + 1 + 2 * D3D11_PS_CS_UAV_REGISTER_COUNT];
+    uint32_t        OutputResourceCount;
+
+    // Number of caches alive; Apply does not look for one while this is 0
+    static volatile long s_CacheCount;
+
+    SEffectStateCache() noexcept;
+    virtual ~SEffectStateCache();
+
+    // Forgets every binding (all bits set: no pointer, count or NaN factor matches)
+    void Invalidate()
+    {
+        memset(&State, 0xff, sizeof(State));
+        InvalidateOutputs();
+    }
+
+    // Binding outputs can unbind the same resources from shader inputs
+    void InvalidateShaderResources()
+    {
+        for (size_t i = 0; i < ESS_Count; ++ i)
+        {
+            memset(State.Stages[i].pShaderResources, 0xff, sizeof(State.Stages[i].pShaderResources));
+        }
+    }
+
+    void InvalidateRenderTargets()
+    {
+        State.RenderTargetViewCount = UINT32_MAX;
+        InvalidateOutputs();
+    }
+
+    void InvalidateOutputs() { OutputResourceCount = UINT32_MAX; }
+
+    // Marks the recorded views whose resource is bound as an output as unknown
+    void ForgetOutputShaderResources(_In_ ID3D11DeviceContext *pContext,
+                                     _Inout_updates_(Count) ID3D11ShaderResourceView **ppSlots, _In_ uint32_t Count);
+
+    static SEffectStateCache *Find(_In_ ID3D11DeviceContext *pContext);
+
+    // IUnknown
+    STDMETHOD(QueryInterface)(REFIID iid, _COM_Outptr_ LPVOID *ppv) override;
+    STDMETHOD_(ULONG, AddRef)() override;
+    STDMETHOD_(ULONG, Release)() override;
+};
+
 class CEffect : public ID3DX11Effect
 {
     friend struct SBaseBlock;
@@ -1146,6 +1279,24 @@ protected:
     ID3D11DeviceContext     *m_pContext;
     ID3D11ClassLinkage      *m_pClassLinkage;
 
+    // Set alongside m_pContext when a state cache is attached to it
+    SEffectStateCache       *m_pStateCache;
+
+    // Set alongside m_pContext, holding a reference, when constant buffers are
+    // updated on it with UpdateSubresource1
+    ID3D11DeviceContext1    *m_pContext1;
+
+    // Set when the driver takes UpdateSubresource1 boxes on constant buffers
+    // (D3D11_FEATURE_D3D11_OPTIONS), and when it also does so on deferred
+    // contexts without runtime emulation (D3D11_FEATURE_THREADING)
+    bool                    m_PartialCBUpdates;
+    bool                    m_DeferredPartialCBUpdates;
+
+    // A CB whose changed span covers at least this fraction of it (out of 16) is uploaded whole
+    static const uint32_t   c_WholeCBUploadSixteenths = 8;
+
+    D3DX11_EFFECT_RUNTIME_STATS m_RuntimeStats;
+
     // Master lists of reflection interfaces
     CEffectVectorOwner<SSingleElementType> m_pTypeInterfaces;
     CEffectVectorOwner<SMember>            m_pMemberInterfaces;
@@ -1175,10 +1326,64 @@ protected:
 
     HRESULT OptimizeTypes(_Inout_ CPointerMappingTable *pMappingTable, _In_ bool Cloning = false);
 
+    //////////////////////////////////////////////////////////////////////////    
+    // Name lookup
+
+    // Maps a name within one array (the variables, CBs or groups, a group's
+    // techniques, a technique's passes or a block of annotations) to its index;
+    // the array itself is the scope.  Only the first of duplicate names is kept,
+    // which is the one a linear scan would find.
+    struct SNameIndexEntry
+    {
+        const void  *pScope;
+        LPCSTR      pName;
+        uint32_t    Index;
+    };
+
+    static bool AreNamesEqual(const SNameIndexEntry &Entry1, const SNameIndexEntry &Entry2) { return Entry1.pScope == Entry2.pScope && strcmp(Entry1.pName, Entry2.pName) == 0; }
+    static bool AreSemanticsEqual(const SNameIndexEntry &Entry1, const SNameIndexEntry &Entry2) { return Entry1.pScope == Entry2.pScope && _stricmp(Entry1.pName, Entry2.pName) == 0; }
+
+    typedef CEffectOpenHashTable<SNameIndexEntry, AreNamesEqual> CNameHashTable;
+    typedef CEffectOpenHashTable<SNameIndexEntry, AreSemanticsEqual> CSemanticHashTable;
+
+    // Scopes smaller than this are scanned; strcmp on a handful of names
+    // is cheaper than hashing
+    static const uint32_t c_MinIndexedScope = 8;
+
+    // The entries point at the current names, so the indices are rebuilt
+    // whenever the effect's data moves (loading, cloning) and deleted by
+    // Optimize(), which removes the names
+    CNameHashTable          *m_pNameIndex;
+    CSemanticHashTable      *m_pSemanticIndex;
+
+    static uint32_t ComputeNameHash(_In_ const void *pScope, _In_ uint32_t NameHash) { return NameHash ^ ((uint32_t)((UINT_PTR)pScope >> 4) * 0x9e3779b1); }
+
+    HRESULT BuildNameIndex();
+    void FreeNameIndex();
+    HRESULT AddNameToIndex(_In_ const void *pScope, _In_opt_z_ LPCSTR pName, _In_ uint32_t Index);
+
+    template<typename T>
+    HRESULT AddNamesToIndex(_In_reads_(Count) const T *pScope, _In_ uint32_t Count)
+    {
+        HRESULT hr = S_OK;
+
+        if (Count >= c_MinIndexedScope)
+        {
+            for (uint32_t i = 0; i < Count; ++ i)
+            {
+                VA( AddNameToIndex(pScope, pScope[i].pName, i), 0 );
+            }
+        }
+
+        return hr;
+    }
+
 
     //////////////////////////////////////////////////////////////////////////    
     // Runtime (performance critical)
     
+    void CheckAndUpdateCB(_In_ SConstantBuffer *pCB);
+    void UploadCB(_In_ SConstantBuffer *pCB);
     void ApplyShaderBlock(_In_ SShaderBlock *pBlock);
     bool ApplyRenderStateBlock(_In_ SBaseBlock *pBlock);
     bool ApplySamplerBlock(_In_ SSamplerBlock *pBlock);
@@ -1223,6 +1428,34 @@ public:
     HRESULT BindToDevice(_In_ ID3D11Device *pDevice, _In_z_ LPCSTR srcName );
 
     Timer GetCurrentTime() const { return m_LocalTimer; }
+
+    // Index of the first of the Count elements of pScope named pName, or Count if there is none
+    template<typename T>
+    uint32_t FindNameInScope(_In_reads_(Count) const T *pScope, _In_ uint32_t Count, _In_z_ LPCSTR pName)
+    {
+        if (nullptr != m_pNameIndex && Count >= c_MinIndexedScope)
+        {
+            SNameIndexEntry entry = { pScope, pName, 0 };
+            CNameHashTable::CIterator iter;
+
+            if (SUCCEEDED(m_pNameIndex->FindValueWithHash(entry, ComputeNameHash(pScope, ComputeHash(pName)), &iter)))
+            {
+                return iter.GetData().Index;
+            }
+            return Count;
+        }
+
+        uint32_t  i;
+        for (i = 0; i < Count; ++ i)
+        {
+            if (nullptr != pScope[i].pName &&
+                strcmp(pScope[i].pName, pName) == 0)
+            {
+                break;
+            }
+        }
+        return i;
+    }
     
     bool IsReflectionData(void *pData) const { return m_pReflection->m_Heap.IsInHeap(pData); }
     bool IsRuntimeData(void *pData) const { return m_Heap.IsInHeap(pData); }
@@ -1261,6 +1494,8 @@ public:
     STDMETHOD(Optimize)() override;
     STDMETHOD_(bool, IsOptimized)() override;
 
+    STDMETHOD(GetRuntimeStats)(_Out_ D3DX11_EFFECT_RUNTIME_STATS *pStats, _In_ bool Reset) override;
+
     //////////////////////////////////////////////////////////////////////////    
     // New reflection helpers
 
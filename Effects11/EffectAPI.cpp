@@ -318,3 +318,195 @@ lExit:
     }
     return hr;
 }
+
+
+//-------------------------------------------------------------------------------------
+// Effect state cache
+//-------------------------------------------------------------------------------------
+
+// {4B1C1D6E-7A53-4E0F-9C2E-52F8B3A6D9E1}
+static const GUID GUID_EffectStateCache = { 0x4b1c1d6e, 0x7a53, 0x4e0f, { 0x9c, 0x2e, 0x52, 0xf8, 0xb3, 0xa6, 0xd9, 0xe1 } };
+
+namespace D3DX11Effects
+{
+
+volatile long SEffectStateCache::s_CacheCount = 0;
+
+SEffectStateCache::SEffectStateCache() noexcept :
+    RefCount(1)
+{
+    Invalidate();
+    InterlockedIncrement(&s_CacheCount);
+}
+
+SEffectStateCache::~SEffectStateCache()
+{
+    InterlockedDecrement(&s_CacheCount);
+}
+
+// Adds the resource of a view returned by a Get call, and releases the view
+static void AddOutputResource(_Inout_ SEffectStateCache *pCache, _In_opt_ ID3D11View *pView)
+{
+    if (pView)
+    {
+        ID3D11Resource *pResource = nullptr;
+        pView->GetResource(&pResource);
+        assert(pCache->OutputResourceCount < _countof(pCache->pOutputResources));
+        pCache->pOutputResources[pCache->OutputResourceCount++] = pResource;
+
+        // Only the address is kept; the bound view holds the resource
+        pResource->Release();
+        pView->Release();
+    }
+}
+
+_Use_decl_annotations_
+void SEffectStateCache::ForgetOutputShaderResources(ID3D11DeviceContext *pContext, ID3D11ShaderResourceView **ppSlots, uint32_t Count)
+{
+    if (OutputResourceCount == UINT32_MAX)
+    {
+        ID3D11RenderTargetView *pRTVs[D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT] = {};
+        ID3D11DepthStencilView *pDSV = nullptr;
+        ID3D11UnorderedAccessView *pUAVs[2 * D3D11_PS_CS_UAV_REGISTER_COUNT] = {};
+        pContext->OMGetRenderTargets(D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT, pRTVs, &pDSV);
+        pContext->OMGetRenderTargetsAndUnorderedAccessViews(0, nullptr, nullptr, 0, D3D11_PS_CS_UAV_REGISTER_COUNT, pUAVs);
+        pContext->CSGetUnorderedAccessViews(0, D3D11_PS_CS_UAV_REGISTER_COUNT, pUAVs + D3D11_PS_CS_UAV_REGISTER_COUNT);
+
+        OutputResourceCount = 0;
+        for (size_t i = 0; i < _countof(pRTVs); ++ i)
+        {
+            AddOutputResource(this, pRTVs[i]);
+        }
+        AddOutputResource(this, pDSV);
+        for (size_t i = 0; i < _countof(pUAVs); ++ i)
+        {
+            AddOutputResource(this, pUAVs[i]);
+        }
+    }
+
+    if (OutputResourceCount == 0)
+    {
+        return;
+    }
+
+    for (uint32_t i = 0; i < Count; ++ i)
+    {
+        if (!ppSlots[i])
+        {
+            continue;
+        }
+
+        ID3D11Resource *pResource = nullptr;
+        ppSlots[i]->GetResource(&pResource);
+        pResource->Release();
+
+        for (uint32_t j = 0; j < OutputResourceCount; ++ j)
+        {
+            if (pOutputResources[j] == pResource)
+            {
+                // The runtime bound NULL; all bits set never matches a view
+                ppSlots[i] = reinterpret_cast<ID3D11ShaderResourceView*>(UINTPTR_MAX);
+                break;
+            }
+        }
+    }
+}
+
+_Use_decl_annotations_
+SEffectStateCache *SEffectStateCache::Find(ID3D11DeviceContext *pContext)
+{
+    if (s_CacheCount == 0)
+    {
+        return nullptr;
+    }
+
+    IUnknown *pUnknown = nullptr;
+    UINT size = sizeof(pUnknown);
+    if (FAILED(pContext->GetPrivateData(GUID_EffectStateCache, &size, &pUnknown)) || !pUnknown)
+    {
+        return nullptr;
+    }
+
+    // The context keeps its own reference for as long as the cache is attached
+    pUnknown->Release();
+    return static_cast<SEffectStateCache*>(pUnknown);
+}
+
+_Use_decl_annotations_
+HRESULT SEffectStateCache::QueryInterface(REFIID iid, LPVOID *ppv)
+{
+    if (!ppv)
+    {
+        return E_INVALIDARG;
+    }
+
+    if (IsEqualIID(iid, IID_IUnknown))
+    {
+        *ppv = static_cast<IUnknown*>(this);
+        AddRef();
+        return S_OK;
+    }
+
+    *ppv = nullptr;
+    return E_NOINTERFACE;
+}
+
+ULONG SEffectStateCache::AddRef()
+{
+    return InterlockedIncrement(&RefCount);
+}
+
+ULONG SEffectStateCache::Release()
+{
+    long refCount = InterlockedDecrement(&RefCount);
+    if (refCount == 0)
+    {
+        delete this;
+    }
+    return refCount;
+}
+
+}
+
+//-------------------------------------------------------------------------------------
+
+_Use_decl_annotations_
+HRESULT WINAPI D3DX11EnableEffectStateCache( ID3D11DeviceContext *pContext, bool Enable )
+{
+    if (!pContext)
+    {
+        DPF(0, "D3DX11EnableEffectStateCache: pContext cannot be nullptr");
+        return E_INVALIDARG;
+    }
+
+    if (!Enable)
+    {
+        return pContext->SetPrivateDataInterface(GUID_EffectStateCache, nullptr);
+    }
+
+    HRESULT hr = S_OK;
+    SEffectStateCache *pCache = SEffectStateCache::Find(pContext);
+
+    if (pCache)
+    {
+        pCache->Invalidate();
+        return S_OK;
+    }
+
+    VN( pCache = new SEffectStateCache );
+    VH( pContext->SetPrivateDataInterface(GUID_EffectStateCache, pCache) );
+
+lExit:
+    SAFE_RELEASE(pCache);
+    return hr;
+}
+
+_Use_decl_annotations_
+void WINAPI D3DX11InvalidateEffectStateCache( ID3D11DeviceContext *pContext )
+{
+    SEffectStateCache *pCache = pContext ? SEffectStateCache::Find(pContext) : nullptr;
+    if (pCache)
+    {
+        pCache->Invalidate();
+    }
+}
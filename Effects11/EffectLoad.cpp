@@ -35,12 +35,14 @@ SDepthStencilView g_NullDepthStencilView;
 // 3) SetSamplers
 // 4) SetShaderResources
 // 5) CreateShader
+// 6) Stage
 SD3DShaderVTable g_vtPS = {
     (void (__stdcall ID3D11DeviceContext::*)(ID3D11DeviceChild*, ID3D11ClassInstance*const*, uint32_t)) &ID3D11DeviceContext::PSSetShader,
     &ID3D11DeviceContext::PSSetConstantBuffers,
     &ID3D11DeviceContext::PSSetSamplers,
     &ID3D11DeviceContext::PSSetShaderResources,
-    (HRESULT (__stdcall ID3D11Device::*)(const void *, size_t, ID3D11ClassLinkage*, ID3D11DeviceChild **)) &ID3D11Device::CreatePixelShader
+    (HRESULT (__stdcall ID3D11Device::*)(const void *, size_t, ID3D11ClassLinkage*, ID3D11DeviceChild **)) &ID3D11Device::CreatePixelShader,
+    ESS_Pixel
 };
 
 SD3DShaderVTable g_vtVS = {
@@ -48,7 +50,8 @@ SD3DShaderVTable g_vtVS = {
     &ID3D11DeviceContext::VSSetConstantBuffers,
     &ID3D11DeviceContext::VSSetSamplers,
     &ID3D11DeviceContext::VSSetShaderResources,
-    (HRESULT (__stdcall ID3D11Device::*)(const void *, size_t, ID3D11ClassLinkage*, ID3D11DeviceChild **)) &ID3D11Device::CreateVertexShader
+    (HRESULT (__stdcall ID3D11Device::*)(const void *, size_t, ID3D11ClassLinkage*, ID3D11DeviceChild **)) &ID3D11Device::CreateVertexShader,
+    ESS_Vertex
 };
 
 SD3DShaderVTable g_vtGS = {
@@ -56,7 +59,8 @@ SD3DShaderVTable g_vtGS = {
     &ID3D11DeviceContext::GSSetConstantBuffers,
     &ID3D11DeviceContext::GSSetSamplers,
     &ID3D11DeviceContext::GSSetShaderResources,
-    (HRESULT (__stdcall ID3D11Device::*)(const void *, size_t, ID3D11ClassLinkage*, ID3D11DeviceChild **)) &ID3D11Device::CreateGeometryShader
+    (HRESULT (__stdcall ID3D11Device::*)(const void *, size_t, ID3D11ClassLinkage*, ID3D11DeviceChild **)) &ID3D11Device::CreateGeometryShader,
+    ESS_Geometry
 };
 
 SD3DShaderVTable g_vtHS = {
@@ -64,7 +68,8 @@ SD3DShaderVTable g_vtHS = {
     &ID3D11DeviceContext::HSSetConstantBuffers,
     &ID3D11DeviceContext::HSSetSamplers,
     &ID3D11DeviceContext::HSSetShaderResources,
-    (HRESULT (__stdcall ID3D11Device::*)(const void *, size_t, ID3D11ClassLinkage*, ID3D11DeviceChild **)) &ID3D11Device::CreateHullShader
+    (HRESULT (__stdcall ID3D11Device::*)(const void *, size_t, ID3D11ClassLinkage*, ID3D11DeviceChild **)) &ID3D11Device::CreateHullShader,
+    ESS_Hull
 };
 
 SD3DShaderVTable g_vtDS = {
@@ -72,7 +77,8 @@ SD3DShaderVTable g_vtDS = {
     &ID3D11DeviceContext::DSSetConstantBuffers,
     &ID3D11DeviceContext::DSSetSamplers,
     &ID3D11DeviceContext::DSSetShaderResources,
-    (HRESULT (__stdcall ID3D11Device::*)(const void *, size_t, ID3D11ClassLinkage*, ID3D11DeviceChild **)) &ID3D11Device::CreateDomainShader
+    (HRESULT (__stdcall ID3D11Device::*)(const void *, size_t, ID3D11ClassLinkage*, ID3D11DeviceChild **)) &ID3D11Device::CreateDomainShader,
+    ESS_Domain
 };
 
 SD3DShaderVTable g_vtCS = {
@@ -80,7 +86,8 @@ SD3DShaderVTable g_vtCS = {
     &ID3D11DeviceContext::CSSetConstantBuffers,
     &ID3D11DeviceContext::CSSetSamplers,
     &ID3D11DeviceContext::CSSetShaderResources,
-    (HRESULT (__stdcall ID3D11Device::*)(const void *, size_t, ID3D11ClassLinkage*, ID3D11DeviceChild **)) &ID3D11Device::CreateComputeShader
+    (HRESULT (__stdcall ID3D11Device::*)(const void *, size_t, ID3D11ClassLinkage*, ID3D11DeviceChild **)) &ID3D11Device::CreateComputeShader,
+    ESS_Compute
 };
 
 SShaderBlock g_NullVS(&g_vtVS);
@@ -882,6 +889,9 @@ HRESULT CEffectLoader::LoadEffect(CEffect *pEffect, const void *pEffectBuffer, u
     VH( LoadCBs() );
     VH( LoadObjectVariables() );
     VH( LoadInterfaceVariables() );
+
+    // Passes look up the variables they assign by name
+    VH( m_pEffect->BuildNameIndex() );
     VH( LoadGroups() );
 
     // Build shader dependencies
@@ -913,6 +923,7 @@ HRESULT CEffectLoader::LoadEffect(CEffect *pEffect, const void *pEffectBuffer, u
     VH( InitializeReflectionDataAndMoveStrings() );
     VH( ReallocateReflectionData() );
     VH( ReallocateEffectData() );
+    VH( m_pEffect->BuildNameIndex() );
 
     VB( m_pReflection->m_Heap.GetSize() == m_ReflectionMemory );
     
@@ -2387,6 +2398,7 @@ HRESULT CEffectLoader::LoadGroups()
         VHD( m_msStructured.Read((void**) &psGroup, sizeof(*psGroup)), "Invalid pEffectBuffer: cannot read group." );
         pGroup->TechniqueCount = psGroup->cTechniques;
         VN( pGroup->pTechniques = PRIVATENEW STechnique[pGroup->TechniqueCount] );
+        pGroup->pEffect = m_pEffect;
         VHD( GetStringAndAddToReflection(psGroup->oName, &pGroup->pName), "Invalid pEffectBuffer: cannot read group name." );
 
         if( pGroup->pName == nullptr )
@@ -2426,6 +2438,7 @@ HRESULT CEffectLoader::LoadTechnique( STechnique* pTech )
     VHD( m_msStructured.Read((void**) &psTech, sizeof(*psTech)), "Invalid pEffectBuffer: cannot read technique." );
     pTech->PassCount = psTech->cPasses;
     VN( pTech->pPasses = PRIVATENEW SPassBlock[pTech->PassCount] );
+    pTech->pEffect = m_pEffect;
     VHD( GetStringAndAddToReflection(psTech->oName, &pTech->pName), "Invalid pEffectBuffer: cannot read technique name." );
 
     // Read annotations
@@ -3974,6 +3987,7 @@ HRESULT CEffectLoader::ReallocateEffectData( bool Cloning )
         SGroup *pGroup = &m_pEffect->m_pGroups[i];
         uint32_t  cbTechniques;
 
+        pGroup->pEffect = m_pEffect;
         cbTechniques = pGroup->TechniqueCount * sizeof(STechnique);
         VHD( pHeap->MoveData((void**) &pGroup->pTechniques, cbTechniques), "Internal loading error: cannot move techniques." );
 
@@ -3982,6 +3996,7 @@ HRESULT CEffectLoader::ReallocateEffectData( bool Cloning )
             STechnique *pTech = &pGroup->pTechniques[j];
             uint32_t  cbPass;
 
+            pTech->pEffect = m_pEffect;
             cbPass = pTech->PassCount * sizeof(SPassBlock);
             SPassBlock* pOldPasses = Cloning ? pTech->pPasses : nullptr;
             VHD( pHeap->MoveData((void**) &pTech->pPasses, cbPass), "Internal loading error: cannot move passes." );
@@ -40,6 +40,7 @@ SPassBlock::SPassBlock() noexcept :
 }
 
 STechnique::STechnique() noexcept :
+    pEffect(nullptr),
     pName(nullptr),
     PassCount(0),
     pPasses(nullptr),
@@ -51,6 +52,7 @@ STechnique::STechnique() noexcept :
 }
 
 SGroup::SGroup() noexcept :
+    pEffect(nullptr),
     pName(nullptr),
     TechniqueCount(0),
     pTechniques(nullptr),
@@ -719,10 +721,17 @@ CEffect::CEffect( uint32_t Flags ) noexcept :
     m_pDevice(nullptr),
     m_pContext(nullptr),
     m_pClassLinkage(nullptr),
+    m_pStateCache(nullptr),
+    m_pContext1(nullptr),
+    m_PartialCBUpdates(false),
+    m_DeferredPartialCBUpdates(false),
+    m_RuntimeStats{},
     m_pTypePool(nullptr),
     m_pStringPool(nullptr),
     m_pPooledHeap(nullptr),
-    m_pOptimizedTypeHeap(nullptr)
+    m_pOptimizedTypeHeap(nullptr),
+    m_pNameIndex(nullptr),
+    m_pSemanticIndex(nullptr)
 {
 }
 
@@ -774,6 +783,7 @@ CEffect::~CEffect()
     SAFE_DELETE( m_pStringPool );
     SAFE_DELETE( m_pPooledHeap );
     SAFE_DELETE( m_pOptimizedTypeHeap );
+    FreeNameIndex();
 
     // this code assumes the effect has been loaded & relocated,
     // so check for that before freeing the resources
@@ -1122,6 +1132,17 @@ HRESULT CEffect::BindToDevice(ID3D11Device *pDevice, LPCSTR srcName)
     VH( m_pDevice->CreateClassLinkage( &m_pClassLinkage ) );
     SetDebugObjectName(m_pClassLinkage,srcName);
 
+    // Both queries fail on runtimes older than 11.1, leaving whole-buffer updates
+    {
+        D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+        D3D11_FEATURE_DATA_THREADING threading = {};
+        m_PartialCBUpdates = SUCCEEDED( m_pDevice->CheckFeatureSupport( D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options) ) )
+                             && options.ConstantBufferPartialUpdate;
+        m_DeferredPartialCBUpdates = m_PartialCBUpdates
+                                     && SUCCEEDED( m_pDevice->CheckFeatureSupport( D3D11_FEATURE_THREADING, &threading, sizeof(threading) ) )
+                                     && threading.DriverCommandLists;
+    }
+
     // Create all constant buffers
     SConstantBuffer *pCB = m_pCBs;
     SConstantBuffer *pCBLast = m_pCBs + m_CBCount;
@@ -1170,7 +1191,7 @@ HRESULT CEffect::BindToDevice(ID3D11Device *pDevice, LPCSTR srcName)
                 pCB->TBuffer.pShaderResource = nullptr;
             }
 
-            pCB->IsDirty = true;
+            pCB->DirtyAll();
         }
         else
         {
@@ -1510,18 +1531,105 @@ SGlobalVariable * CEffect::FindVariableByName(_In_z_ LPCSTR pName)
 
 SGlobalVariable * CEffect::FindLocalVariableByName(_In_z_ LPCSTR pName)
 {
-    SGlobalVariable *pVariable, *pVariableEnd;
+    uint32_t  i = FindNameInScope(m_pVariables, m_VariableCount, pName);
+
+    return i < m_VariableCount ? m_pVariables + i : nullptr;
+}
+
+// Indexes every name searched by the By-Name and BySemantic lookups.
+// The entries point at the names where they are now, so this is called
+// again whenever loading or cloning moves them.
+HRESULT CEffect::BuildNameIndex()
+{
+    HRESULT hr = S_OK;
+
+    FreeNameIndex();
+    VN( m_pNameIndex = new CNameHashTable );
+    VN( m_pSemanticIndex = new CSemanticHashTable );
+
+    VH( AddNamesToIndex(m_pVariables, m_VariableCount) );
+    VH( AddNamesToIndex(m_pCBs, m_CBCount) );
+    VH( AddNamesToIndex(m_pGroups, m_GroupCount) );
 
-    pVariableEnd = m_pVariables + m_VariableCount;
-    for (pVariable = m_pVariables; pVariable != pVariableEnd; pVariable++)
+    for (uint32_t i = 0; i < m_VariableCount; ++ i)
     {
-        if (strcmp( pVariable->pName, pName) == 0)
+        SGlobalVariable *pVariable = &m_pVariables[i];
+
+        VH( AddNamesToIndex(pVariable->pAnnotations, pVariable->AnnotationCount) );
+
+        // Semantics match case-insensitively, so they are hashed lower-cased
+        if (m_VariableCount >= c_MinIndexedScope && nullptr != pVariable->pSemantic)
         {
-            return pVariable;
+            SNameIndexEntry entry = { m_pVariables, pVariable->pSemantic, i };
+            uint32_t hash = ComputeNameHash(m_pVariables, ComputeHashLower((const uint8_t *)pVariable->pSemantic, (uint32_t)strlen(pVariable->pSemantic)));
+            CSemanticHashTable::CIterator iter;
+
+            if (FAILED(m_pSemanticIndex->FindValueWithHash(entry, hash, &iter)))
+            {
+                VH( m_pSemanticIndex->AddValueWithHash(entry, hash) );
+            }
         }
     }
 
-    return nullptr;
+    for (uint32_t i = 0; i < m_CBCount; ++ i)
+    {
+        VH( AddNamesToIndex(m_pCBs[i].pAnnotations, m_pCBs[i].AnnotationCount) );
+    }
+
+    for (uint32_t i = 0; i < m_GroupCount; ++ i)
+    {
+        SGroup *pGroup = &m_pGroups[i];
+
+        VH( AddNamesToIndex(pGroup->pAnnotations, pGroup->AnnotationCount) );
+        VH( AddNamesToIndex(pGroup->pTechniques, pGroup->TechniqueCount) );
+
+        for (uint32_t j = 0; j < pGroup->TechniqueCount; ++ j)
+        {
+            STechnique *pTech = &pGroup->pTechniques[j];
+
+            VH( AddNamesToIndex(pTech->pAnnotations, pTech->AnnotationCount) );
+            VH( AddNamesToIndex(pTech->pPasses, pTech->PassCount) );
+
+            for (uint32_t k = 0; k < pTech->PassCount; ++ k)
+            {
+                VH( AddNamesToIndex(pTech->pPasses[k].pAnnotations, pTech->pPasses[k].AnnotationCount) );
+            }
+        }
+    }
+
+lExit:
+    if (FAILED(hr))
+    {
+        FreeNameIndex();
+    }
+    return hr;
+}
+
+void CEffect::FreeNameIndex()
+{
+    SAFE_DELETE( m_pNameIndex );
+    SAFE_DELETE( m_pSemanticIndex );
+}
+
+HRESULT CEffect::AddNameToIndex(_In_ const void *pScope, _In_opt_z_ LPCSTR pName, _In_ uint32_t Index)
+{
+    // The null group has no name
+    if (nullptr == pName)
+    {
+        return S_OK;
+    }
+
+    SNameIndexEntry entry = { pScope, pName, Index };
+    uint32_t hash = ComputeNameHash(pScope, ComputeHash(pName));
+    CNameHashTable::CIterator iter;
+
+    // Keep the first of duplicate names, as a linear scan would
+    if (SUCCEEDED(m_pNameIndex->FindValueWithHash(entry, hash, &iter)))
+    {
+        return S_OK;
+    }
+
+    return m_pNameIndex->AddValueWithHash(entry, hash);
 }
 
 
@@ -1652,17 +1760,9 @@ uint32_t SType::GetTotalPackedSize(_In_ bool IsSingleElement) const
 
 SConstantBuffer *CEffect::FindCB(_In_z_ LPCSTR pName)
 {
-    uint32_t  i;
+    uint32_t  i = FindNameInScope(m_pCBs, m_CBCount, pName);
 
-    for (i=0; i<m_CBCount; i++)
-    {
-        if (!strcmp(m_pCBs[i].pName, pName))
-        {
-            return &m_pCBs[i];
-        }
-    }
-
-    return nullptr;
+    return i < m_CBCount ? &m_pCBs[i] : nullptr;
 }
 
 bool CEffect::IsOptimized()
@@ -2004,7 +2104,7 @@ HRESULT CEffect::RecreateCBs()
                 ReplaceCBReference( pCB, (*ppOriginalBuffer) );
             }
 
-            pCB->IsDirty = true;
+            pCB->DirtyAll();
         }
     }
 
@@ -2107,6 +2207,8 @@ HRESULT CEffect::CloneEffect(_In_ uint32_t Flags, _Outptr_ ID3DX11Effect** ppClo
     pNewEffect->m_FXLIndex = m_FXLIndex;
     pNewEffect->m_pDevice = m_pDevice;
     pNewEffect->m_pClassLinkage = m_pClassLinkage;
+    pNewEffect->m_PartialCBUpdates = m_PartialCBUpdates;
+    pNewEffect->m_DeferredPartialCBUpdates = m_DeferredPartialCBUpdates;
 
     pNewEffect->AddRefAllForCloning( this );
 
@@ -2170,6 +2272,10 @@ HRESULT CEffect::CloneEffect(_In_ uint32_t Flags, _Outptr_ ID3DX11Effect** ppClo
         VH( pNewEffect->FixupMemberInterface( pMember, this, mappingTableStrings ) );
     }
 
+    if( !IsOptimized() )
+    {
+        VH( pNewEffect->BuildNameIndex() );
+    }
 
 lExit:
     SAFE_DELETE( pTempHeap );
@@ -2259,6 +2365,9 @@ HRESULT CEffect::Optimize()
         return S_OK;
     }
 
+    // The name index points at the names removed below
+    FreeNameIndex();
+
     // Delete annotations, names, semantics, and string data on variables
     
     for (size_t i = 0; i < m_VariableCount; ++ i)
@@ -64,10 +64,10 @@ ID3DX11EffectVariable * GetAnnotationByIndexHelper(const char *pClassName, uint3
 _Use_decl_annotations_
 ID3DX11EffectVariable * GetAnnotationByNameHelper(const char *pClassName, LPCSTR Name, uint32_t  AnnotationCount, SAnnotation *pAnnotations)
 {
-    uint32_t  i;
-    for (i = 0; i < AnnotationCount; ++ i)
+    if (AnnotationCount > 0)
     {
-        if (strcmp(pAnnotations[i].pName, Name) == 0)
+        uint32_t  i = pAnnotations[0].pEffect->FindNameInScope(pAnnotations, AnnotationCount, Name);
+        if (i < AnnotationCount)
         {
             return pAnnotations + i;
         }
@@ -1148,7 +1148,7 @@ HRESULT SConstantBuffer::SetRawValue(const void *pData, uint32_t Offset, uint32_
     }
     else
     {
-        IsDirty = true;
+        DirtyRange(Offset, Count);
     }
 
     memcpy(pBackingStore + Offset, pData, Count);
@@ -1626,9 +1626,21 @@ HRESULT SPassBlock::Apply(_In_ uint32_t Flags, _In_ ID3D11DeviceContext* pContex
     // Flags are unused, so should be 0
 
 
-    assert( pEffect->m_pContext == nullptr );
+    assert( pEffect->m_pContext == nullptr && pEffect->m_pContext1 == nullptr );
     pEffect->m_pContext = pContext;
+    pEffect->m_pStateCache = SEffectStateCache::Find(pContext);
+
+    // Queried once here rather than for each constant buffer uploaded
+    if (pEffect->m_PartialCBUpdates &&
+        (pEffect->m_DeferredPartialCBUpdates || pContext->GetType() == D3D11_DEVICE_CONTEXT_IMMEDIATE))
+    {
+        if (FAILED(pContext->QueryInterface(__uuidof(ID3D11DeviceContext1), (void**) &pEffect->m_pContext1)))
+            pEffect->m_pContext1 = nullptr;
+    }
+
     pEffect->ApplyPassBlock(this);
+    SAFE_RELEASE(pEffect->m_pContext1);
+    pEffect->m_pStateCache = nullptr;
     pEffect->m_pContext = nullptr;
 
     return hr;
@@ -1802,16 +1814,7 @@ ID3DX11EffectPass * STechnique::GetPassByName(_In_z_ LPCSTR Name)
 {
     static LPCSTR pFuncName = "ID3DX11EffectTechnique::GetPassByName";
 
-    uint32_t  i;
-
-    for (i = 0; i < PassCount; ++ i)
-    {
-        if (nullptr != pPasses[i].pName &&
-            strcmp(pPasses[i].pName, Name) == 0)
-        {
-            break;
-        }
-    }
+    uint32_t  i = pEffect->FindNameInScope(pPasses, PassCount, Name);
 
     if (i == PassCount)
     {
@@ -1898,16 +1901,7 @@ ID3DX11EffectTechnique * SGroup::GetTechniqueByName(_In_z_ LPCSTR Name)
 {
     static LPCSTR pFuncName = "ID3DX11EffectGroup::GetTechniqueByName";
 
-    uint32_t  i;
-
-    for (i = 0; i < TechniqueCount; ++ i)
-    {
-        if (nullptr != pTechniques[i].pName &&
-            strcmp(pTechniques[i].pName, Name) == 0)
-        {
-            break;
-        }
-    }
+    uint32_t  i = pEffect->FindNameInScope(pTechniques, TechniqueCount, Name);
 
     if (i == TechniqueCount)
     {
@@ -1953,6 +1947,24 @@ lExit:
     return hr;    
 }
 
+HRESULT CEffect::GetRuntimeStats(_Out_ D3DX11_EFFECT_RUNTIME_STATS *pStats, _In_ bool Reset)
+{
+    HRESULT hr = S_OK;
+
+    static LPCSTR pFuncName = "ID3DX11Effect::GetRuntimeStats";
+
+    VERIFYPARAMETER(pStats);
+
+    *pStats = m_RuntimeStats;
+    if (Reset)
+    {
+        m_RuntimeStats = {};
+    }
+
+lExit:
+    return hr;
+}
+
 ID3DX11EffectConstantBuffer * CEffect::GetConstantBufferByIndex(_In_ uint32_t Index)
 {
     static LPCSTR pFuncName = "ID3DX11Effect::GetConstantBufferByIndex";
@@ -1982,12 +1994,10 @@ ID3DX11EffectConstantBuffer * CEffect::GetConstantBufferByName(_In_z_ LPCSTR Nam
         return &g_InvalidConstantBuffer;
     }
 
-    for (uint32_t i = 0; i < m_CBCount; ++ i)
+    uint32_t  i = FindNameInScope(m_pCBs, m_CBCount, Name);
+    if (i < m_CBCount)
     {
-        if (strcmp(m_pCBs[i].pName, Name) == 0)
-        {
-            return m_pCBs + i;
-        }
+        return m_pCBs + i;
     }
 
     DPF(0, "%s: Constant Buffer [%s] not found", pFuncName, Name);
@@ -2023,12 +2033,10 @@ ID3DX11EffectVariable * CEffect::GetVariableByName(_In_z_ LPCSTR Name)
         return &g_InvalidScalarVariable;
     }
 
-    for (uint32_t i = 0; i < m_VariableCount; ++ i)
+    uint32_t  i = FindNameInScope(m_pVariables, m_VariableCount, Name);
+    if (i < m_VariableCount)
     {
-        if (strcmp(m_pVariables[i].pName, Name) == 0)
-        {
-            return m_pVariables + i;
-        }
+        return m_pVariables + i;
     }
 
     DPF(0, "%s: Variable [%s] not found", pFuncName, Name);
@@ -2051,14 +2059,26 @@ ID3DX11EffectVariable * CEffect::GetVariableBySemantic(_In_z_ LPCSTR Semantic)
         return &g_InvalidScalarVariable;
     }
 
-    uint32_t  i;
+    if (nullptr != m_pSemanticIndex && m_VariableCount >= c_MinIndexedScope)
+    {
+        SNameIndexEntry entry = { m_pVariables, Semantic, 0 };
+        uint32_t hash = ComputeNameHash(m_pVariables, ComputeHashLower((const uint8_t *)Semantic, (uint32_t)strlen(Semantic)));
+        CSemanticHashTable::CIterator iter;
 
-    for (i = 0; i < m_VariableCount; ++ i)
+        if (SUCCEEDED(m_pSemanticIndex->FindValueWithHash(entry, hash, &iter)))
+        {
+            return (ID3DX11EffectVariable *)(m_pVariables + iter.GetData().Index);
+        }
+    }
+    else
     {
-        if (nullptr != m_pVariables[i].pSemantic && 
-            _stricmp(m_pVariables[i].pSemantic, Semantic) == 0)
+        for (uint32_t i = 0; i < m_VariableCount; ++ i)
         {
-            return (ID3DX11EffectVariable *)(m_pVariables + i);
+            if (nullptr != m_pVariables[i].pSemantic && 
+                _stricmp(m_pVariables[i].pSemantic, Semantic) == 0)
+            {
+                return (ID3DX11EffectVariable *)(m_pVariables + i);
+            }
         }
     }
 
@@ -2161,15 +2181,7 @@ ID3DX11EffectGroup * CEffect::GetGroupByName(_In_z_ LPCSTR Name)
         return m_pNullGroup ? (ID3DX11EffectGroup *)m_pNullGroup : &g_InvalidGroup;
     }
 
-    uint32_t i = 0;
-    for (; i < m_GroupCount; ++ i)
-    {
-        if (nullptr != m_pGroups[i].pName && 
-            strcmp(m_pGroups[i].pName, Name) == 0)
-        {
-            break;
-        }
-    }
+    uint32_t i = FindNameInScope(m_pGroups, m_GroupCount, Name);
 
     if (i == m_GroupCount)
     {
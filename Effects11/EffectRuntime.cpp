@@ -133,24 +133,104 @@ bool SPassBlock::CheckDependencies()
 #pragma warning(pop)
 
 // Update constant buffer contents if necessary
-inline void CheckAndUpdateCB_FX(ID3D11DeviceContext *pContext, SConstantBuffer *pCB)
+inline void CEffect::CheckAndUpdateCB(_In_ SConstantBuffer *pCB)
 {
     if (pCB->IsDirty && !pCB->IsNonUpdatable)
     {
         // CB out of date; rebuild it
-        pContext->UpdateSubresource(pCB->pD3DObject, 0, nullptr, pCB->pBackingStore, pCB->Size, pCB->Size);
-        pCB->IsDirty = false;
+        UploadCB(pCB);
     }
 }
 
+// Sends the registers written since the last upload.  Where the driver takes
+// boxes on constant buffers, a span under c_WholeCBUploadSixteenths of the
+// buffer goes up alone, and anything larger replaces the whole buffer with
+// D3D11_COPY_DISCARD so the copy does not wait for the GPU to finish with the
+// old contents.  Otherwise the whole buffer is updated as before.
+void CEffect::UploadCB(_In_ SConstantBuffer *pCB)
+{
+    assert(pCB->DirtyStart < pCB->DirtyEnd && pCB->DirtyEnd <= pCB->Size);
+    uint32_t bytes = pCB->Size;
+
+    if (m_pContext1)
+    {
+        if ((pCB->DirtyEnd - pCB->DirtyStart) * 16 < pCB->Size * c_WholeCBUploadSixteenths)
+        {
+            D3D11_BOX box = { pCB->DirtyStart, 0, 0, pCB->DirtyEnd, 1, 1 };
+            bytes = pCB->DirtyEnd - pCB->DirtyStart;
+            m_pContext1->UpdateSubresource1(pCB->pD3DObject, 0, &box, pCB->pBackingStore + pCB->DirtyStart, bytes, bytes, 0);
+            m_RuntimeStats.PartialUpdates++;
+        }
+        else
+        {
+            m_pContext1->UpdateSubresource1(pCB->pD3DObject, 0, nullptr, pCB->pBackingStore, pCB->Size, pCB->Size, D3D11_COPY_DISCARD);
+            m_RuntimeStats.DiscardUpdates++;
+        }
+    }
+    else
+    {
+        m_pContext->UpdateSubresource(pCB->pD3DObject, 0, nullptr, pCB->pBackingStore, pCB->Size, pCB->Size);
+    }
+
+    m_RuntimeStats.ConstantBufferUpdates++;
+    m_RuntimeStats.BytesUploaded += bytes;
+    pCB->IsDirty = false;
+}
+
 
 //--------------------------------------------------------------------------------------
 //--------------------------------------------------------------------------------------
 
+// Narrows a binding call to the slots the state cache shows as changing and
+// records them. Returns false if the call would not change anything.
+template<typename T, size_t SlotCount>
+static bool FilterBindings(_Inout_ D3DX11_EFFECT_RUNTIME_STATS &Stats, _Inout_opt_ T *(*pShadow)[SlotCount],
+                           _Inout_ uint32_t &StartSlot, _Inout_ uint32_t &Count, _Inout_ T **&ppObjects)
+{
+    if (!pShadow)
+    {
+        Stats.StateCalls++;
+        return true;
+    }
+
+    assert(StartSlot + Count <= SlotCount);
+    T **ppSlots = *pShadow + StartSlot;
+
+    uint32_t First = 0;
+    while (First < Count && ppSlots[First] == ppObjects[First])
+    {
+        First++;
+    }
+
+    if (First == Count)
+    {
+        Stats.StateCallsSkipped++;
+        return false;
+    }
+
+    uint32_t Last = Count;
+    while (ppSlots[Last - 1] == ppObjects[Last - 1])
+    {
+        Last--;
+    }
+
+    for (uint32_t i = First; i < Last; ++ i)
+    {
+        ppSlots[i] = ppObjects[i];
+    }
+
+    StartSlot += First;
+    Count = Last - First;
+    ppObjects += First;
+    Stats.StateCalls++;
+    return true;
+}
+
 // Set the shader and dependent state (SRVs, samplers, UAVs, interfaces)
 void CEffect::ApplyShaderBlock(_In_ SShaderBlock *pBlock)
 {
     SD3DShaderVTable *pVT = pBlock->pVT;
+    SEffectStateCache::SStage *pShadow = m_pStateCache ? &m_pStateCache->State.Stages[pVT->Stage] : nullptr;
 
     // Apply constant buffers first (tbuffers are done later)
     SShaderCBDependency *pCBDep = pBlock->pCBDeps;
@@ -162,10 +242,16 @@ void CEffect::ApplyShaderBlock(_In_ SShaderBlock *pBlock)
 
         for (size_t i = 0; i < pCBDep->Count; ++ i)
         {
-            CheckAndUpdateCB_FX(m_pContext, (SConstantBuffer*)pCBDep->ppFXPointers[i]);
+            CheckAndUpdateCB((SConstantBuffer*)pCBDep->ppFXPointers[i]);
         }
 
-        (m_pContext->*(pVT->pSetConstantBuffers))(pCBDep->StartIndex, pCBDep->Count, pCBDep->ppD3DObjects);
+        uint32_t StartSlot = pCBDep->StartIndex;
+        uint32_t Count = pCBDep->Count;
+        ID3D11Buffer **ppBuffers = pCBDep->ppD3DObjects;
+        if (FilterBindings(m_RuntimeStats, pShadow ? &pShadow->pConstantBuffers : nullptr, StartSlot, Count, ppBuffers))
+        {
+            (m_pContext->*(pVT->pSetConstantBuffers))(StartSlot, Count, ppBuffers);
+        }
     }
 
     // Next, apply samplers
@@ -184,7 +270,14 @@ void CEffect::ApplyShaderBlock(_In_ SShaderBlock *pBlock)
                 pSampDep->ppD3DObjects[i] = pSampDep->ppFXPointers[i]->pD3DObject;
             }
         }
-        (m_pContext->*(pVT->pSetSamplers))(pSampDep->StartIndex, pSampDep->Count, pSampDep->ppD3DObjects);
+
+        uint32_t StartSlot = pSampDep->StartIndex;
+        uint32_t Count = pSampDep->Count;
+        ID3D11SamplerState **ppSamplers = pSampDep->ppD3DObjects;
+        if (FilterBindings(m_RuntimeStats, pShadow ? &pShadow->pSamplers : nullptr, StartSlot, Count, ppSamplers))
+        {
+            (m_pContext->*(pVT->pSetSamplers))(StartSlot, Count, ppSamplers);
+        }
     }
  
     // Set the UAVs
@@ -210,6 +303,15 @@ void CEffect::ApplyShaderBlock(_In_ SShaderBlock *pBlock)
             // This call could be combined with the call to set render targets if both exist in the pass
             m_pContext->OMSetRenderTargetsAndUnorderedAccessViews( D3D11_KEEP_RENDER_TARGETS_AND_DEPTH_STENCIL, nullptr, nullptr, pUAVDep->StartIndex, pUAVDep->Count, pUAVDep->ppD3DObjects, g_pNegativeOnes );
         }
+        m_RuntimeStats.StateCalls++;
+
+        // UAVs are not cached (their counters are reset on every bind), and binding
+        // them unbinds the same resources from shader inputs and render targets
+        if (m_pStateCache)
+        {
+            m_pStateCache->InvalidateShaderResources();
+            m_pStateCache->InvalidateRenderTargets();
+        }
     }
 
     // TBuffers are funny:
@@ -221,7 +323,7 @@ void CEffect::ApplyShaderBlock(_In_ SShaderBlock *pBlock)
 
     for (; ppTB<ppLastTB; ppTB++)
     {
-        CheckAndUpdateCB_FX(m_pContext, (SConstantBuffer*)*ppTB);
+        CheckAndUpdateCB((SConstantBuffer*)*ppTB);
     }
 
     // Set the textures
@@ -238,7 +340,18 @@ void CEffect::ApplyShaderBlock(_In_ SShaderBlock *pBlock)
             pResourceDep->ppD3DObjects[i] = pResourceDep->ppFXPointers[i]->pShaderResource;
         }
 
-        (m_pContext->*(pVT->pSetShaderResources))(pResourceDep->StartIndex, pResourceDep->Count, pResourceDep->ppD3DObjects);
+        uint32_t StartSlot = pResourceDep->StartIndex;
+        uint32_t Count = pResourceDep->Count;
+        ID3D11ShaderResourceView **ppResources = pResourceDep->ppD3DObjects;
+        if (FilterBindings(m_RuntimeStats, pShadow ? &pShadow->pShaderResources : nullptr, StartSlot, Count, ppResources))
+        {
+            (m_pContext->*(pVT->pSetShaderResources))(StartSlot, Count, ppResources);
+
+            if (pShadow)
+            {
+                m_pStateCache->ForgetOutputShaderResources(m_pContext, pShadow->pShaderResources + StartSlot, Count);
+            }
+        }
     }
 
     // Update Interface dependencies
@@ -270,8 +383,21 @@ void CEffect::ApplyShaderBlock(_In_ SShaderBlock *pBlock)
         }
     }
 
-    // Now set the shader
+    // Now set the shader; class instances are not cached, so any in use force the call
+    if (pShadow && pShadow->pShader == pBlock->pD3DObject && Interfaces == 0 && pShadow->ClassInstanceCount == 0)
+    {
+        m_RuntimeStats.StateCallsSkipped++;
+        return;
+    }
+
     (m_pContext->*(pVT->pSetShader))(pBlock->pD3DObject, ppClassInstances, Interfaces);
+    m_RuntimeStats.StateCalls++;
+
+    if (pShadow)
+    {
+        pShadow->pShader = pBlock->pD3DObject;
+        pShadow->ClassInstanceCount = Interfaces;
+    }
 }
 
 // Returns true if the block D3D data was recreated
@@ -526,6 +652,8 @@ bool CEffect::ValidatePassBlock( _Inout_ SPassBlock* pBlock )
 // Set all state defined in the pass
 void CEffect::ApplyPassBlock(_Inout_ SPassBlock *pBlock)
 {
+    SEffectStateCache::SState *pState = m_pStateCache ? &m_pStateCache->State : nullptr;
+
     pBlock->ApplyPassAssignments();
 
     if (nullptr != pBlock->BackingStore.pBlendBlock)
@@ -536,9 +664,27 @@ void CEffect::ApplyPassBlock(_Inout_ SPassBlock *pBlock)
             DPF( 0, "Pass::Apply - warning: applying invalid BlendState." );
 #endif
         pBlock->BackingStore.pBlendState = pBlock->BackingStore.pBlendBlock->pBlendObject;
-        m_pContext->OMSetBlendState(pBlock->BackingStore.pBlendState,
-            pBlock->BackingStore.BlendFactor,
-            pBlock->BackingStore.SampleMask);
+        if (pState &&
+            pState->pBlendState == pBlock->BackingStore.pBlendState &&
+            pState->SampleMask == pBlock->BackingStore.SampleMask &&
+            memcmp(pState->BlendFactor, pBlock->BackingStore.BlendFactor, sizeof(pState->BlendFactor)) == 0)
+        {
+            m_RuntimeStats.StateCallsSkipped++;
+        }
+        else
+        {
+            m_pContext->OMSetBlendState(pBlock->BackingStore.pBlendState,
+                pBlock->BackingStore.BlendFactor,
+                pBlock->BackingStore.SampleMask);
+            m_RuntimeStats.StateCalls++;
+
+            if (pState)
+            {
+                pState->pBlendState = pBlock->BackingStore.pBlendState;
+                pState->SampleMask = pBlock->BackingStore.SampleMask;
+                memcpy(pState->BlendFactor, pBlock->BackingStore.BlendFactor, sizeof(pState->BlendFactor));
+            }
+        }
     }
 
     if (nullptr != pBlock->BackingStore.pDepthStencilBlock)
@@ -549,8 +695,24 @@ void CEffect::ApplyPassBlock(_Inout_ SPassBlock *pBlock)
             DPF( 0, "Pass::Apply - warning: applying invalid DepthStencilState." );
 #endif
         pBlock->BackingStore.pDepthStencilState = pBlock->BackingStore.pDepthStencilBlock->pDSObject;
-        m_pContext->OMSetDepthStencilState(pBlock->BackingStore.pDepthStencilState,
-            pBlock->BackingStore.StencilRef);
+        if (pState &&
+            pState->pDepthStencilState == pBlock->BackingStore.pDepthStencilState &&
+            pState->StencilRef == pBlock->BackingStore.StencilRef)
+        {
+            m_RuntimeStats.StateCallsSkipped++;
+        }
+        else
+        {
+            m_pContext->OMSetDepthStencilState(pBlock->BackingStore.pDepthStencilState,
+                pBlock->BackingStore.StencilRef);
+            m_RuntimeStats.StateCalls++;
+
+            if (pState)
+            {
+                pState->pDepthStencilState = pBlock->BackingStore.pDepthStencilState;
+                pState->StencilRef = pBlock->BackingStore.StencilRef;
+            }
+        }
     }
 
     if (nullptr != pBlock->BackingStore.pRasterizerBlock)
@@ -560,7 +722,21 @@ void CEffect::ApplyPassBlock(_Inout_ SPassBlock *pBlock)
         if( !pBlock->BackingStore.pRasterizerBlock->IsValid )
             DPF( 0, "Pass::Apply - warning: applying invalid RasterizerState." );
 #endif
-        m_pContext->RSSetState(pBlock->BackingStore.pRasterizerBlock->pRasterizerObject);
+        ID3D11RasterizerState *pRasterizerState = pBlock->BackingStore.pRasterizerBlock->pRasterizerObject;
+        if (pState && pState->pRasterizerState == pRasterizerState)
+        {
+            m_RuntimeStats.StateCallsSkipped++;
+        }
+        else
+        {
+            m_pContext->RSSetState(pRasterizerState);
+            m_RuntimeStats.StateCalls++;
+
+            if (pState)
+            {
+                pState->pRasterizerState = pRasterizerState;
+            }
+        }
     }
 
     if (nullptr != pBlock->BackingStore.pRenderTargetViews[0])
@@ -576,8 +752,30 @@ void CEffect::ApplyPassBlock(_Inout_ SPassBlock *pBlock)
             pRTV[i] = pBlock->BackingStore.pRenderTargetViews[i]->pRenderTargetView;
         }
 
-        // This call could be combined with the call to set PS UAVs if both exist in the pass
-        m_pContext->OMSetRenderTargetsAndUnorderedAccessViews( pBlock->BackingStore.RenderTargetViewCount, pRTV, pBlock->BackingStore.pDepthStencilView->pDepthStencilView, 7, D3D11_KEEP_UNORDERED_ACCESS_VIEWS, nullptr, nullptr );
+        ID3D11DepthStencilView *pDSV = pBlock->BackingStore.pDepthStencilView->pDepthStencilView;
+        if (pState &&
+            pState->RenderTargetViewCount == pBlock->BackingStore.RenderTargetViewCount &&
+            pState->pDepthStencilView == pDSV &&
+            memcmp(pState->pRenderTargetViews, pRTV, pBlock->BackingStore.RenderTargetViewCount * sizeof(pRTV[0])) == 0)
+        {
+            m_RuntimeStats.StateCallsSkipped++;
+        }
+        else
+        {
+            // This call could be combined with the call to set PS UAVs if both exist in the pass
+            m_pContext->OMSetRenderTargetsAndUnorderedAccessViews( pBlock->BackingStore.RenderTargetViewCount, pRTV, pDSV, 7, D3D11_KEEP_UNORDERED_ACCESS_VIEWS, nullptr, nullptr );
+            m_RuntimeStats.StateCalls++;
+
+            if (pState)
+            {
+                // Binding outputs unbinds the same resources from shader inputs
+                m_pStateCache->InvalidateShaderResources();
+                m_pStateCache->InvalidateOutputs();
+                pState->RenderTargetViewCount = pBlock->BackingStore.RenderTargetViewCount;
+                pState->pDepthStencilView = pDSV;
+                memcpy(pState->pRenderTargetViews, pRTV, pBlock->BackingStore.RenderTargetViewCount * sizeof(pRTV[0]));
+            }
+        }
     }
 
     if (nullptr != pBlock->BackingStore.pVertexShaderBlock)
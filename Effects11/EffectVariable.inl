@@ -1323,8 +1323,9 @@ lExit:
     // Annotations should never be able to go down this codepath
     void DirtyVariable()
     {
-        // make sure to call the global variable's version of dirty variable
-        ((TGlobalVariable<ID3DX11EffectVariable>*)pTopLevelEntity)->DirtyVariable();
+        // make sure to call the global variable's version of dirty variable,
+        // passing only the bytes this member or element covers
+        ((TGlobalVariable<ID3DX11EffectVariable>*)pTopLevelEntity)->DirtyBytes(Data.pNumeric, GetTotalUnpackedSize());
     }
 };
 
@@ -1469,10 +1470,15 @@ lExit:
     }
 
     inline void DirtyVariable()
+    {
+        DirtyBytes(Data.pNumeric, GetTotalUnpackedSize());
+    }
+
+    inline void DirtyBytes(_In_ const void *pBytes, _In_ uint32_t ByteCount)
     {
         assert(pCB != 0);
         _Analysis_assume_(pCB != 0);
-        pCB->IsDirty = true;
+        pCB->DirtyRange((uint32_t)((const uint8_t *)pBytes - pCB->pBackingStore), ByteCount);
         LastModifiedTime = pEffect->GetCurrentTime();
     }
 
@@ -997,6 +997,23 @@ struct D3DX11_EFFECT_DESC
     uint32_t    Groups;                 // Number of groups in this effect
 };
 
+//----------------------------------------------------------------------------
+// D3DX11_EFFECT_RUNTIME_STATS:
+//
+// Retrieved by ID3DX11Effect::GetRuntimeStats(); counts accumulate over
+// every Apply() until the stats are reset, typically once per frame
+//----------------------------------------------------------------------------
+
+struct D3DX11_EFFECT_RUNTIME_STATS
+{
+    uint32_t    ConstantBufferUpdates;      // Number of constant/texture buffer uploads
+    uint32_t    PartialUpdates;             // Uploads of only the changed registers
+    uint32_t    DiscardUpdates;             // Whole-buffer uploads made with D3D11_COPY_DISCARD
+    uint64_t    BytesUploaded;              // Bytes sent by all of the above
+    uint32_t    StateCalls;                 // State, shader and binding calls made on the context
+    uint32_t    StateCallsSkipped;          // Calls left out because a state cache showed them redundant
+};
+
 typedef interface ID3DX11Effect ID3DX11Effect;
 typedef interface ID3DX11Effect *LPD3D11EFFECT;
 
@@ -1036,6 +1053,8 @@ DECLARE_INTERFACE_(ID3DX11Effect, IUnknown)
     STDMETHOD(CloneEffect)(THIS_ _In_ uint32_t Flags, _Outptr_ ID3DX11Effect** ppClonedEffect ) PURE;
     STDMETHOD(Optimize)(THIS) PURE;
     STDMETHOD_(bool, IsOptimized)(THIS) PURE;
+
+    STDMETHOD(GetRuntimeStats)(THIS_ _Out_ D3DX11_EFFECT_RUNTIME_STATS *pStats, _In_ bool Reset) PURE;
 };
 
 //////////////////////////////////////////////////////////////////////////////
@@ -1207,6 +1226,48 @@ HRESULT D3DX11CompileEffectFromFile( _In_z_ LPCWSTR pFileName,
 
 bool D3DX11DebugMute(bool mute);
 
+//----------------------------------------------------------------------------
+// D3DX11EnableEffectStateCache
+//
+// Attaches (or detaches) a state cache to a device context. While attached,
+// Apply() on any effect remembers what effects have bound on that context
+// and leaves out state, shader and binding calls that would not change it.
+// Each context, immediate or deferred, has its own cache.
+//
+// The cache only sees what effects set. Call
+// D3DX11InvalidateEffectStateCache after anything else changes the
+// context's state: Set* calls made directly on it, ClearState,
+// ExecuteCommandList, FinishCommandList or other libraries sharing it.
+//
+// The cache holds no references. Shader resource views whose resource is
+// bound as a render target, depth stencil or one of the first
+// D3D11_PS_CS_UAV_REGISTER_COUNT UAVs are bound on every Apply(), since the
+// runtime binds NULL in their place.
+//
+// Parameters:
+//
+// [in]
+//
+//  pContext
+//      Device context whose effect state calls are filtered
+//  Enable
+//      true to attach a cache (starting empty), false to remove it
+//
+//----------------------------------------------------------------------------
+
+HRESULT WINAPI D3DX11EnableEffectStateCache( _In_ ID3D11DeviceContext *pContext,
+                                             _In_ bool Enable );
+
+//----------------------------------------------------------------------------
+// D3DX11InvalidateEffectStateCache
+//
+// Forgets everything the context's cache recorded, so that the next Apply()
+// sets all of its state. Does nothing if the context has no cache.
+//
+//----------------------------------------------------------------------------
+
+void WINAPI D3DX11InvalidateEffectStateCache( _In_ ID3D11DeviceContext *pContext );
+
 #ifdef __cplusplus
 }
 #endif //__cplusplus
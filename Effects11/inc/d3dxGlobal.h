@@ -14,6 +14,8 @@
 #include <assert.h>
 #include <string.h>
 
+#include <intrin.h>
+
 namespace D3DX11Debug
 {
     // Helper sets a D3D resource name string (used by PIX and debug layer leak reporting).
@@ -642,6 +644,8 @@ inline void __cdecl operator delete(_In_opt_ void* p, _In_ CDataBlockStore &pAll
 // Hash table
 //////////////////////////////////////////////////////////////////////////
 
+#ifdef D3DX11_FX_LEGACY_HASH
+
 #define HASH_MIX(a,b,c) \
 { \
     a -= b; a -= c; a ^= (c>>13); \
@@ -754,6 +758,140 @@ static uint32_t ComputeHashLower(_In_reads_bytes_(cbToHash) const uint8_t *pb, _
     return c;
 }
 
+#else // !D3DX11_FX_LEGACY_HASH
+
+// wyhash-style 64-bit hash: the input is read 8 or 4 bytes at a time with
+// unaligned-safe loads and mixed with 64x64->128 bit multiplies, then folded
+// to 32 bits.  Define D3DX11_FX_LEGACY_HASH to use the byte oriented hash
+// above instead.
+
+static const uint64_t c_HashSecret[2] = { 0xa0761d6478bd642full, 0xe7037ed1a0b428dbull };
+static const uint64_t c_HashSeed = 0x1ff5c2923a788d2cull; // HashMix(c_HashSecret[0], c_HashSecret[1])
+
+// Replaces *pA and *pB with the low and high halves of their product
+inline void HashMultiply(_Inout_ uint64_t *pA, _Inout_ uint64_t *pB)
+{
+#if defined(_M_X64)
+    uint64_t high;
+    *pA = _umul128(*pA, *pB, &high);
+    *pB = high;
+#elif defined(_M_ARM64)
+    uint64_t low = *pA * *pB;
+    *pB = __umulh(*pA, *pB);
+    *pA = low;
+#else
+    uint64_t ha = *pA >> 32, hb = *pB >> 32, la = (uint32_t)*pA, lb = (uint32_t)*pB;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32);
+    uint64_t carry = (t < rl) ? 1 : 0;
+    uint64_t low = t + (rm1 << 32);
+    carry += (low < t) ? 1 : 0;
+    *pB = rh + (rm0 >> 32) + (rm1 >> 32) + carry;
+    *pA = low;
+#endif
+}
+
+inline uint64_t HashMix(_In_ uint64_t a, _In_ uint64_t b)
+{
+    HashMultiply(&a, &b);
+    return a ^ b;
+}
+
+// Maps 'A'-'Z' to 'a'-'z' in each byte, leaving every other byte alone
+inline uint64_t HashLowerBytes(_In_ uint64_t v)
+{
+    const uint64_t ones = 0x0101010101010101ull;
+    uint64_t heptets = v & (0x7f * ones);
+    uint64_t aboveA = heptets + (0x80 - 'A') * ones;
+    uint64_t aboveZ = heptets + (0x80 - 'Z' - 1) * ones;
+    uint64_t isUpper = aboveA & ~aboveZ & ~v & (0x80 * ones);
+    return v | (isUpper >> 2);
+}
+
+template<bool bLower>
+inline uint64_t HashRead8(_In_reads_bytes_(8) const uint8_t *pb)
+{
+    uint64_t v;
+    memcpy(&v, pb, sizeof(v));
+    return bLower ? HashLowerBytes(v) : v;
+}
+
+template<bool bLower>
+inline uint64_t HashRead4(_In_reads_bytes_(4) const uint8_t *pb)
+{
+    uint32_t v;
+    memcpy(&v, pb, sizeof(v));
+    return bLower ? HashLowerBytes(v) : v;
+}
+
+template<bool bLower>
+inline uint64_t HashRead1(_In_ const uint8_t *pb)
+{
+    return bLower ? HashLowerBytes(*pb) : *pb;
+}
+
+template<bool bLower>
+static uint32_t ComputeHashT(_In_reads_bytes_(cbToHash) const uint8_t *pb, _In_ uint32_t cbToHash)
+{
+    uint64_t seed = c_HashSeed;
+    uint64_t a;
+    uint64_t b;
+
+    if (cbToHash <= 16)
+    {
+        if (cbToHash >= 4)
+        {
+            // two pairs of 4 byte reads cover 4 to 16 bytes, overlapping if needed
+            uint32_t offset = (cbToHash >> 3) << 2;
+            a = (HashRead4<bLower>(pb) << 32) | HashRead4<bLower>(pb + offset);
+            b = (HashRead4<bLower>(pb + cbToHash - 4) << 32) | HashRead4<bLower>(pb + cbToHash - 4 - offset);
+        }
+        else if (cbToHash > 0)
+        {
+            a = (HashRead1<bLower>(pb) << 16) | (HashRead1<bLower>(pb + (cbToHash >> 1)) << 8) | HashRead1<bLower>(pb + cbToHash - 1);
+            b = 0;
+        }
+        else
+        {
+            a = b = 0;
+        }
+    }
+    else
+    {
+        uint32_t cbLeft = cbToHash;
+        while (cbLeft > 16)
+        {
+            seed = HashMix(HashRead8<bLower>(pb) ^ c_HashSecret[1], HashRead8<bLower>(pb + 8) ^ seed);
+            pb += 16;
+            cbLeft -= 16;
+        }
+
+        // the last 16 bytes, overlapping the loop if needed
+        a = HashRead8<bLower>(pb + cbLeft - 16);
+        b = HashRead8<bLower>(pb + cbLeft - 8);
+    }
+
+    a ^= c_HashSecret[1];
+    b ^= seed;
+    HashMultiply(&a, &b);
+
+    uint64_t hash = HashMix(a ^ c_HashSecret[0] ^ cbToHash, b ^ c_HashSecret[1]);
+    return (uint32_t)(hash ^ (hash >> 32));
+}
+
+static uint32_t ComputeHash(_In_reads_bytes_(cbToHash) const uint8_t *pb, _In_ uint32_t cbToHash)
+{
+    return ComputeHashT<false>(pb, cbToHash);
+}
+
+// Same as ComputeHash on a copy of the data with 'A'-'Z' made lower case
+static uint32_t ComputeHashLower(_In_reads_bytes_(cbToHash) const uint8_t *pb, _In_ uint32_t cbToHash)
+{
+    return ComputeHashT<true>(pb, cbToHash);
+}
+
+#endif // D3DX11_FX_LEGACY_HASH
+
 static uint32_t ComputeHash(_In_z_ LPCSTR pString)
 {
     return ComputeHash(reinterpret_cast<const uint8_t*>(pString), (uint32_t)strlen(pString));
@@ -1126,15 +1264,18 @@ lExit:
         return E_FAIL;
     }
 
-    // Adds data at the specified hash slot without checking for existence
+    // Adds data at the specified hash slot without checking for existence.
+    // Grows the table first if it is full, so chains stay short however
+    // many entries are added.
     HRESULT AddValueWithHash(_In_ T Data, _In_ uint32_t Hash)
     {
         HRESULT hr = S_OK;
 
-        assert(m_NumHashSlots > 0);
-
         SHashEntry *pHashEntry;
-        uint32_t index = Hash % m_NumHashSlots;
+        uint32_t index;
+
+        VH( AutoGrow() );
+        index = Hash % m_NumHashSlots;
 
         VN( pHashEntry = new SHashEntry );
         pHashEntry->pNext = m_rgpHashEntries[index];
@@ -1264,17 +1405,20 @@ public:
         m_pPrivateHeap = pPrivateHeap;
     }
 
-    // Adds data at the specified hash slot without checking for existence
+    // Adds data at the specified hash slot without checking for existence,
+    // growing the table first if it is full
     HRESULT AddValueWithHash(_In_ T Data, _In_ uint32_t Hash)
     {
         HRESULT hr = S_OK;
 
         assert(m_pPrivateHeap);
         _Analysis_assume_(m_pPrivateHeap);
-        assert(m_NumHashSlots > 0);
 
         SHashEntry *pHashEntry;
-        uint32_t index = Hash % m_NumHashSlots;
+        uint32_t index;
+
+        VH( AutoGrow() );
+        index = Hash % m_NumHashSlots;
 
         VN( pHashEntry = new(*m_pPrivateHeap) SHashEntry );
         pHashEntry->pNext = m_rgpHashEntries[index];
@@ -1288,3 +1432,345 @@ lExit:
         return hr;
     }
 };
+
+//////////////////////////////////////////////////////////////////////////
+// CEffectOpenHashTable - An open addressing hash table
+//////////////////////////////////////////////////////////////////////////
+
+// Entries live in one flat array next to an array of control bytes, one
+// per slot: c_EmptySlot, or the top 7 bits of the entry's hash.  Lookups
+// compare the control bytes of a 16 slot group at once and only touch the
+// entries whose byte matches, so a probe costs one or two cache lines
+// instead of a walk down a chain of separately allocated entries.
+//
+// The slot count is a power of 2, and the table grows by itself whenever
+// it would become more than 7/8 full.  Entries cannot be removed; the name
+// indices are only ever rebuilt.
+//
+// Use it when the entries are not allocated next to the data they point at.
+// The string and type pools keep CEffectHashTableWithPrivateHeap: each entry
+// sits on the pooled heap beside its string or type, and with a few thousand
+// names that locality beats the flat layout (see EffectPoolBench).
+
+template<typename T, bool (*pfnIsEqual)(const T &Data1, const T &Data2)>
+class CEffectOpenHashTable
+{
+protected:
+
+    struct SHashEntry
+    {
+        uint32_t    Hash;
+        T           Data;
+    };
+
+    static const uint32_t c_GroupSize = 16;
+    static const uint8_t c_EmptySlot = 0x80;
+
+    uint8_t     *m_pControl;
+    SHashEntry  *m_pEntries;
+    uint32_t    m_NumHashSlots;
+    uint32_t    m_NumEntries;
+
+    static uint8_t GetControlByte(_In_ uint32_t Hash)
+    {
+        // the low bits pick the group, so use the high bits to tell slots apart
+        return (uint8_t)(Hash >> 25);
+    }
+
+    // Bit i is set if control byte i of the group equals Value
+    static uint32_t MatchGroup(_In_reads_(c_GroupSize) const uint8_t *pGroup, _In_ uint8_t Value)
+    {
+#if defined(_M_IX86) || defined(_M_X64)
+        __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pGroup));
+        return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)Value)));
+#else
+        uint32_t mask = 0;
+        for (uint32_t i = 0; i < c_GroupSize; ++ i)
+        {
+            if (pGroup[i] == Value)
+            {
+                mask |= 1u << i;
+            }
+        }
+        return mask;
+#endif
+    }
+
+    static uint32_t LowestBit(_In_ uint32_t Mask)
+    {
+        assert(Mask != 0);
+        unsigned long index;
+        _BitScanForward(&index, Mask);
+        return index;
+    }
+
+    // Stores an entry in the first empty slot of its probe sequence; there
+    // must be one
+    void Insert(_In_ const T &Data, _In_ uint32_t Hash)
+    {
+        uint32_t groupMask = m_NumHashSlots / c_GroupSize - 1;
+        uint32_t group = Hash & groupMask;
+
+        // triangular probing visits every group when the count is a power of 2
+        for (uint32_t step = 1; ; ++ step)
+        {
+            uint32_t empty = MatchGroup(m_pControl + group * c_GroupSize, c_EmptySlot);
+            if (empty != 0)
+            {
+                uint32_t index = group * c_GroupSize + LowestBit(empty);
+                m_pControl[index] = GetControlByte(Hash);
+                m_pEntries[index].Hash = Hash;
+                m_pEntries[index].Data = Data;
+                return;
+            }
+            group = (group + step) & groupMask;
+        }
+    }
+
+public:
+    class CIterator
+    {
+        friend class CEffectOpenHashTable;
+
+    protected:
+        SHashEntry  *pHashEntry;
+        uint32_t    Index;
+
+    public:
+        T GetData()
+        {
+            assert(pHashEntry != 0);
+            _Analysis_assume_(pHashEntry != 0);
+            return pHashEntry->Data;
+        }
+
+        uint32_t GetHash()
+        {
+            assert(pHashEntry != 0);
+            _Analysis_assume_(pHashEntry != 0);
+            return pHashEntry->Hash;
+        }
+    };
+
+    CEffectOpenHashTable() noexcept :
+        m_pControl(nullptr),
+        m_pEntries(nullptr),
+        m_NumHashSlots(0),
+        m_NumEntries(0)
+    {
+    }
+
+    ~CEffectOpenHashTable()
+    {
+        Cleanup();
+    }
+
+    void Cleanup()
+    {
+        SAFE_DELETE_ARRAY(m_pControl);
+        SAFE_DELETE_ARRAY(m_pEntries);
+        m_NumHashSlots = 0;
+        m_NumEntries = 0;
+    }
+
+    uint32_t GetNumEntries() const
+    {
+        return m_NumEntries;
+    }
+
+    // O(n) function
+    // Grows to the smallest power of 2 that holds DesiredSize entries
+    // without going past 7/8 full
+    HRESULT Grow(_In_ uint32_t DesiredSize)
+    {
+        HRESULT hr = S_OK;
+        uint8_t *pOldControl = m_pControl;
+        SHashEntry *pOldEntries = m_pEntries;
+        uint32_t oldSize = m_NumHashSlots;
+        uint8_t *pNewControl = nullptr;
+        SHashEntry *pNewEntries = nullptr;
+        uint32_t actualSize = c_GroupSize;
+
+        VB( DesiredSize > m_NumEntries );
+
+        while (actualSize - actualSize / 8 < DesiredSize)
+        {
+            VB( actualSize < 0x80000000 );
+            actualSize *= 2;
+        }
+
+        VB( actualSize > m_NumHashSlots );
+
+        VN( pNewControl = new uint8_t[actualSize] );
+        VN( pNewEntries = new SHashEntry[actualSize] );
+        memset(pNewControl, c_EmptySlot, actualSize);
+
+        m_pControl = pNewControl;
+        m_pEntries = pNewEntries;
+        m_NumHashSlots = actualSize;
+        pNewControl = nullptr;
+        pNewEntries = nullptr;
+
+        // Expensive operation: rebuild the hash table
+        for (uint32_t i = 0; i < oldSize; ++ i)
+        {
+            if (pOldControl[i] != c_EmptySlot)
+            {
+                Insert(pOldEntries[i].Data, pOldEntries[i].Hash);
+            }
+        }
+
+        SAFE_DELETE_ARRAY(pOldControl);
+        SAFE_DELETE_ARRAY(pOldEntries);
+
+lExit:
+        SAFE_DELETE_ARRAY(pNewControl);
+        SAFE_DELETE_ARRAY(pNewEntries);
+        return hr;
+    }
+
+    HRESULT AutoGrow()
+    {
+        // grow before the next entry would push the table past 7/8 full
+        if (m_NumEntries + 1 > m_NumHashSlots - m_NumHashSlots / 8)
+        {
+            uint32_t desiredSize = m_NumEntries * 2;
+            if (desiredSize < c_GroupSize)
+            {
+                desiredSize = c_GroupSize;
+            }
+            return Grow(desiredSize);
+        }
+        return S_OK;
+    }
+
+#if _DEBUG
+    void PrintHashTableStats()
+    {
+        if (m_NumHashSlots == 0)
+        {
+            DPF(0, "Uninitialized hash table!");
+            return;
+        }
+
+        uint32_t groupMask = m_NumHashSlots / c_GroupSize - 1;
+        uint32_t totalProbes = 0;
+        uint32_t maxProbes = 0;
+
+        DPF(0, "Hash table slots: %d, Entries in table: %d", m_NumHashSlots, m_NumEntries);
+
+        for (uint32_t i = 0; i < m_NumHashSlots; ++ i)
+        {
+            if (m_pControl[i] == c_EmptySlot)
+            {
+                continue;
+            }
+
+            // count the groups a lookup of this entry scans
+            uint32_t group = m_pEntries[i].Hash & groupMask;
+            uint32_t probes = 1;
+            for (uint32_t step = 1; group != i / c_GroupSize; ++ step)
+            {
+                group = (group + step) & groupMask;
+                ++ probes;
+            }
+
+            totalProbes += probes;
+            maxProbes = std::max(maxProbes, probes);
+        }
+
+        DPF(0, "Load factor: %f, Mean groups probed: %f, Max groups probed: %d",
+            (float)m_NumEntries / (float)m_NumHashSlots,
+            (float)totalProbes / (float)std::max(1u, m_NumEntries), maxProbes);
+    }
+#endif // _DEBUG
+
+    // S_OK if element is found, E_FAIL otherwise
+    HRESULT FindValueWithHash(_In_ T Data, _In_ uint32_t Hash, _Out_ CIterator *pIterator)
+    {
+        if (m_NumHashSlots == 0)
+        {
+            return E_FAIL;
+        }
+
+        uint32_t groupMask = m_NumHashSlots / c_GroupSize - 1;
+        uint32_t group = Hash & groupMask;
+        uint8_t control = GetControlByte(Hash);
+
+        for (uint32_t step = 1; ; ++ step)
+        {
+            const uint8_t *pGroup = m_pControl + group * c_GroupSize;
+
+            for (uint32_t match = MatchGroup(pGroup, control); match != 0; match &= match - 1)
+            {
+                uint32_t index = group * c_GroupSize + LowestBit(match);
+                SHashEntry *pEntry = m_pEntries + index;
+                if (Hash == pEntry->Hash && pfnIsEqual(pEntry->Data, Data))
+                {
+                    pIterator->pHashEntry = pEntry;
+                    pIterator->Index = index;
+                    return S_OK;
+                }
+            }
+
+            // nothing is ever removed, so an empty slot ends the probe sequence
+            if (MatchGroup(pGroup, c_EmptySlot) != 0)
+            {
+                return E_FAIL;
+            }
+            group = (group + step) & groupMask;
+        }
+    }
+
+    // Adds data without checking for existence, growing the table if needed
+    HRESULT AddValueWithHash(_In_ T Data, _In_ uint32_t Hash)
+    {
+        HRESULT hr = S_OK;
+
+        VH( AutoGrow() );
+
+        Insert(Data, Hash);
+        ++ m_NumEntries;
+
+lExit:
+        return hr;
+    }
+
+    // Iterator code:
+    //
+    // CMyHashTable::CIterator myIt;
+    // for (myTable.GetFirstEntry(&myIt); !myTable.PastEnd(&myIt); myTable.GetNextEntry(&myIt)
+    // { myTable.GetData(&myIt); }
+    void GetFirstEntry(_Out_ CIterator *pIterator)
+    {
+        pIterator->Index = 0;
+        pIterator->pHashEntry = nullptr;
+        while (pIterator->Index < m_NumHashSlots && m_pControl[pIterator->Index] == c_EmptySlot)
+        {
+            ++ pIterator->Index;
+        }
+        if (pIterator->Index < m_NumHashSlots)
+        {
+            pIterator->pHashEntry = m_pEntries + pIterator->Index;
+        }
+    }
+
+    bool PastEnd(_Inout_ CIterator *pIterator)
+    {
+        assert(pIterator->Index <= m_NumHashSlots);
+        return (pIterator->Index == m_NumHashSlots);
+    }
+
+    void GetNextEntry(_Inout_ CIterator *pIterator)
+    {
+        assert(pIterator->Index < m_NumHashSlots);
+
+        ++ pIterator->Index;
+        while (pIterator->Index < m_NumHashSlots && m_pControl[pIterator->Index] == c_EmptySlot)
+        {
+            ++ pIterator->Index;
+        }
+        pIterator->pHashEntry = (pIterator->Index < m_NumHashSlots) ? m_pEntries + pIterator->Index : nullptr;
+        // at the end of the table, Index == m_NumHashSlots
+    }
+};
@@ -0,0 +1,288 @@
+//--------------------------------------------------------------------------------------
+// File: mipchainbench.cpp
+//
+// Command-line benchmark for GenerateMipChain in TextureConvert.h. A full mip chain is
+// built from a square level 0 of random RGBA8 texels, with each filter, for
+// R8G8B8A8_UNORM_SRGB and R8G8B8A8_UNORM, on one thread and on one thread per logical
+// processor. The best of a few runs is reported, with a scalar sRGB box filter that
+// converts each texel with powf as the reference. The sRGB box chain is also checked
+// against that reference, and the largest difference in any channel is printed.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248926
+//--------------------------------------------------------------------------------------
+
+#pragma warning(push)
+#pragma warning(disable : 4005)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#define NODRAWTEXT
+#define NOGDI
+#define NOBITMAP
+#define NOMCX
+#define NOSERVICE
+#define NOHELP
+#pragma warning(pop)
+
+#include <Windows.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cwchar>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "TextureConvert.h"
+
+using namespace DirectX;
+
+namespace
+{
+    constexpr size_t DEFAULT_SIZE = 4096;
+    constexpr uint32_t DEFAULT_REPEAT_COUNT = 3;
+
+    //----------------------------------------------------------------------------------
+    // Timer
+    //----------------------------------------------------------------------------------
+    double GetMilliseconds()
+    {
+        static LARGE_INTEGER frequency = {};
+        if (!frequency.QuadPart)
+            QueryPerformanceFrequency(&frequency);
+
+        LARGE_INTEGER counter;
+        QueryPerformanceCounter(&counter);
+        return double(counter.QuadPart) * 1000.0 / double(frequency.QuadPart);
+    }
+
+    //----------------------------------------------------------------------------------
+    // RGBA8 mip chain, one buffer per level
+    //----------------------------------------------------------------------------------
+    struct MipChain
+    {
+        std::vector<std::vector<uint8_t>> pixels;
+        std::vector<MIP_LEVEL_DATA> levels;
+
+        MipChain(size_t size, size_t mipLevels)
+        {
+            pixels.resize(mipLevels);
+            levels.resize(mipLevels);
+
+            for (size_t level = 0; level < mipLevels; ++level)
+            {
+                pixels[level].resize(size * size * 4);
+                levels[level].pixels = pixels[level].data();
+                levels[level].rowPitch = size * 4;
+                size = std::max<size_t>(size >> 1, 1);
+            }
+        }
+    };
+
+    float SRGBToLinear(float c)
+    {
+        return (c <= 0.04045f) ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+    }
+
+    float LinearToSRGB(float c)
+    {
+        return (c <= 0.0031308f) ? c * 12.92f : 1.055f * powf(c, 1.f / 2.4f) - 0.055f;
+    }
+
+    // Each texel is the average of the 2x2 texels above it in linear light, as a simple
+    // loader would write it
+    void ScalarSRGBBoxChain(MipChain& chain, size_t size)
+    {
+        for (size_t level = 1; level < chain.levels.size(); ++level)
+        {
+            const uint8_t* src = chain.pixels[level - 1].data();
+            uint8_t* dest = chain.pixels[level].data();
+            const size_t dsize = std::max<size_t>(size >> 1, 1);
+
+            for (size_t y = 0; y < dsize; ++y)
+            {
+                for (size_t x = 0; x < dsize; ++x)
+                {
+                    for (size_t c = 0; c < 4; ++c)
+                    {
+                        float sum = 0.f;
+                        for (size_t j = 0; j < 2; ++j)
+                        {
+                            for (size_t i = 0; i < 2; ++i)
+                            {
+                                const size_t sx = std::min(2 * x + i, size - 1);
+                                const size_t sy = std::min(2 * y + j, size - 1);
+                                const float value = float(src[(sy * size + sx) * 4 + c]) / 255.f;
+                                sum += (c < 3) ? SRGBToLinear(value) : value;
+                            }
+                        }
+
+                        sum *= 0.25f;
+                        if (c < 3)
+                            sum = LinearToSRGB(sum);
+                        dest[(y * dsize + x) * 4 + c] = uint8_t(sum * 255.f + 0.5f);
+                    }
+                }
+            }
+
+            size = dsize;
+        }
+    }
+
+    template<typename F>
+    double BestOf(uint32_t repeatCount, F func)
+    {
+        double best = 0.0;
+        for (uint32_t run = 0; run < repeatCount; ++run)
+        {
+            const double start = GetMilliseconds();
+            func();
+            const double time = GetMilliseconds() - start;
+            if (!run || time < best)
+                best = time;
+        }
+        return best;
+    }
+
+    //----------------------------------------------------------------------------------
+    void PrintUsage()
+    {
+        wprintf(L"Usage: mipchainbench <options>\n");
+        wprintf(L"\n");
+        wprintf(L"   -s <size>           width and height of level 0 (defaults to %zu)\n", DEFAULT_SIZE);
+        wprintf(L"   -r <count>          number of runs, the best is reported (defaults to %u)\n", DEFAULT_REPEAT_COUNT);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Entry-point
+//--------------------------------------------------------------------------------------
+#pragma prefast(disable : 28198, "Command-line tool, frees all memory on exit")
+
+int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
+{
+    size_t size = DEFAULT_SIZE;
+    uint32_t repeatCount = DEFAULT_REPEAT_COUNT;
+
+    for (int iArg = 1; iArg < argc; iArg++)
+    {
+        const wchar_t* pArg = argv[iArg];
+        if ((('-' != pArg[0]) && ('/' != pArg[0])) || (iArg + 1 >= argc))
+        {
+            PrintUsage();
+            return 1;
+        }
+
+        pArg++;
+        const wchar_t* pValue = argv[++iArg];
+        if (!_wcsicmp(pArg, L"s"))
+        {
+            if (swscanf_s(pValue, L"%zu", &size) != 1 || size < 2 || size > 16384)
+            {
+                wprintf(L"Invalid value specified with -s (%ls), must be 2 to 16384\n", pValue);
+                return 1;
+            }
+        }
+        else if (!_wcsicmp(pArg, L"r"))
+        {
+            if (swscanf_s(pValue, L"%u", &repeatCount) != 1 || !repeatCount)
+            {
+                wprintf(L"Invalid value specified with -r (%ls)\n", pValue);
+                return 1;
+            }
+        }
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    const size_t mipLevels = CountMipLevels(size, size);
+    const double megapixels = double(size) * double(size) / 1000000.0;
+
+    MipChain chain(size, mipLevels);
+    MipChain reference(size, mipLevels);
+
+    std::mt19937 rng(43);
+    for (auto& texel : chain.pixels[0])
+        texel = uint8_t(rng());
+    reference.pixels[0] = chain.pixels[0];
+
+    wprintf(L"%zux%zu level 0, %zu levels, best of %u runs\n", size, size, mipLevels, repeatCount);
+
+    double time = BestOf(repeatCount, [&]() { ScalarSRGBBoxChain(reference, size); });
+    wprintf(L"  %-24ls %-6ls           %9.1f ms (%.0f MP/s of level 0)\n", L"scalar reference sRGB", L"box", time, megapixels * 1000.0 / time);
+
+    const unsigned int processors = std::max(1u, std::thread::hardware_concurrency());
+
+    static const DXGI_FORMAT s_formats[] = { DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, DXGI_FORMAT_R8G8B8A8_UNORM };
+    static const MIP_FILTER s_filters[] = { MIP_FILTER_BOX, MIP_FILTER_KAISER };
+
+    for (DXGI_FORMAT format : s_formats)
+    {
+        for (MIP_FILTER filter : s_filters)
+        {
+            for (unsigned int threads = 1; ; threads = processors)
+            {
+                HRESULT hr = S_OK;
+                time = BestOf(repeatCount, [&]()
+                    {
+                        hr = GenerateMipChain(format, size, size, mipLevels, chain.levels.data(), filter, 0.f, threads);
+                    });
+                if (FAILED(hr))
+                {
+                    wprintf(L"ERROR: GenerateMipChain failed (%08X)\n", static_cast<unsigned int>(hr));
+                    return 1;
+                }
+
+                wprintf(L"  %-24ls %-6ls %2u threads %9.1f ms (%.0f MP/s of level 0)\n",
+                    (format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB) ? L"R8G8B8A8_UNORM_SRGB" : L"R8G8B8A8_UNORM",
+                    (filter == MIP_FILTER_BOX) ? L"box" : L"kaiser",
+                    threads, time, megapixels * 1000.0 / time);
+
+                if (threads == processors)
+                    break;
+            }
+        }
+    }
+
+    HRESULT hr = S_OK;
+    time = BestOf(repeatCount, [&]()
+        {
+            hr = GenerateMipChain(DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, size, size, mipLevels, chain.levels.data(), MIP_FILTER_BOX, 0.5f, 1);
+        });
+    if (FAILED(hr))
+    {
+        wprintf(L"ERROR: GenerateMipChain failed (%08X)\n", static_cast<unsigned int>(hr));
+        return 1;
+    }
+    wprintf(L"  %-24ls %-6ls  1 threads %9.1f ms (alpha coverage 0.5)\n", L"R8G8B8A8_UNORM_SRGB", L"box", time);
+
+    // The box filter with an even level 0 averages the same 2x2 texels as the reference
+    hr = GenerateMipChain(DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, size, size, mipLevels, chain.levels.data(), MIP_FILTER_BOX, 0.f, 1);
+    if (FAILED(hr))
+    {
+        wprintf(L"ERROR: GenerateMipChain failed (%08X)\n", static_cast<unsigned int>(hr));
+        return 1;
+    }
+
+    int maxDifference = 0;
+    for (size_t level = 1; level < mipLevels; ++level)
+    {
+        for (size_t i = 0; i < chain.pixels[level].size(); ++i)
+        {
+            maxDifference = std::max(maxDifference, std::abs(int(chain.pixels[level][i]) - int(reference.pixels[level][i])));
+        }
+    }
+
+    wprintf(L"sRGB box chain differs from the reference by at most %d\n", maxDifference);
+
+    return 0;
+}
@@ -0,0 +1,311 @@
+//--------------------------------------------------------------------------------------
+// File: sdkmeshframebench.cpp
+//
+// Command-line benchmark for CDXUTSDKMesh frame lookup by name. It builds a mesh with a
+// binary tree of frames named Bone_0 to Bone_<n-1> and an animation with one track per
+// frame. The tracks are named BONE_<n-1> down to BONE_0, so every track is bound to a
+// different frame and names only match case-insensitively. It reports:
+//
+//   create     CreateFromMemory without a device, which builds the frame name index
+//   bind       LoadAnimation, which reads the animation file and binds each track with
+//              FindFrame
+//   indexed    FindFrameIndex for every track name
+//   linear     the same lookups as a _stricmp scan over the frames, which is what
+//              FindFrame did before the index
+//
+// Each frame is also checked to be bound to the right track, and a name that matches no
+// frame is checked not to be found.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=320437
+//--------------------------------------------------------------------------------------
+
+#include "DXUT.h"
+#include "SDKmesh.h"
+
+#include <cstdio>
+#include <cwchar>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+    constexpr UINT DEFAULT_FRAME_COUNT = 5000;
+    constexpr UINT DEFAULT_REPEAT_COUNT = 5;
+    constexpr UINT ANIMATION_KEYS = 2;
+
+    //----------------------------------------------------------------------------------
+    // Timer
+    //----------------------------------------------------------------------------------
+    double GetMilliseconds()
+    {
+        static LARGE_INTEGER frequency = {};
+        if (!frequency.QuadPart)
+            QueryPerformanceFrequency(&frequency);
+
+        LARGE_INTEGER counter;
+        QueryPerformanceCounter(&counter);
+        return double(counter.QuadPart) * 1000.0 / double(frequency.QuadPart);
+    }
+
+    //----------------------------------------------------------------------------------
+    // A mesh file with frames only: no vertex or index buffers, meshes or materials
+    //----------------------------------------------------------------------------------
+    std::vector<BYTE> CreateFrameHierarchy(UINT frameCount)
+    {
+        std::vector<BYTE> data(sizeof(SDKMESH_HEADER) + frameCount * sizeof(SDKMESH_FRAME));
+
+        auto header = reinterpret_cast<SDKMESH_HEADER*>(data.data());
+        header->Version = SDKMESH_FILE_VERSION;
+        header->HeaderSize = sizeof(SDKMESH_HEADER);
+        header->NonBufferDataSize = frameCount * sizeof(SDKMESH_FRAME);
+        header->NumFrames = frameCount;
+        header->VertexStreamHeadersOffset = sizeof(SDKMESH_HEADER);
+        header->IndexStreamHeadersOffset = sizeof(SDKMESH_HEADER);
+        header->MeshDataOffset = sizeof(SDKMESH_HEADER);
+        header->SubsetDataOffset = sizeof(SDKMESH_HEADER);
+        header->FrameDataOffset = sizeof(SDKMESH_HEADER);
+        header->MaterialDataOffset = sizeof(SDKMESH_HEADER);
+
+        // The parent of frame i is frame (i - 1) / 2
+        auto frames = reinterpret_cast<SDKMESH_FRAME*>(data.data() + header->FrameDataOffset);
+        for (UINT i = 0; i < frameCount; ++i)
+        {
+            auto& frame = frames[i];
+            sprintf_s(frame.Name, "Bone_%u", i);
+            frame.Mesh = INVALID_MESH;
+            frame.ParentFrame = (i > 0) ? (i - 1) / 2 : INVALID_FRAME;
+            frame.ChildFrame = (2 * i + 1 < frameCount) ? 2 * i + 1 : INVALID_FRAME;
+            frame.SiblingFrame = (i > 0 && (i & 1) && i + 1 < frameCount) ? i + 1 : INVALID_FRAME;
+            XMStoreFloat4x4(&frame.Matrix, XMMatrixTranslation(1.f, 0.f, 0.f));
+            frame.AnimationDataIndex = INVALID_ANIMATION_DATA;
+        }
+
+        return data;
+    }
+
+    //----------------------------------------------------------------------------------
+    // Track i animates frame frameCount - 1 - i
+    //----------------------------------------------------------------------------------
+    std::vector<BYTE> CreateAnimation(UINT frameCount)
+    {
+        const size_t trackBytes = ANIMATION_KEYS * sizeof(SDKANIMATION_DATA);
+        const size_t frameDataBytes = frameCount * sizeof(SDKANIMATION_FRAME_DATA);
+
+        std::vector<BYTE> data(sizeof(SDKANIMATION_FILE_HEADER) + frameDataBytes + frameCount * trackBytes);
+
+        auto header = reinterpret_cast<SDKANIMATION_FILE_HEADER*>(data.data());
+        header->Version = SDKMESH_FILE_VERSION;
+        header->FrameTransformType = FTT_RELATIVE;
+        header->NumFrames = frameCount;
+        header->NumAnimationKeys = ANIMATION_KEYS;
+        header->AnimationFPS = 30;
+        header->AnimationDataSize = data.size() - sizeof(SDKANIMATION_FILE_HEADER);
+        header->AnimationDataOffset = sizeof(SDKANIMATION_FILE_HEADER);
+
+        // Key offsets are relative to the end of the header
+        auto frameData = reinterpret_cast<SDKANIMATION_FRAME_DATA*>(data.data() + header->AnimationDataOffset);
+        for (UINT i = 0; i < frameCount; ++i)
+        {
+            sprintf_s(frameData[i].FrameName, "BONE_%u", frameCount - 1 - i);
+            frameData[i].DataOffset = frameDataBytes + i * trackBytes;
+
+            auto keys = reinterpret_cast<SDKANIMATION_DATA*>(data.data() + sizeof(SDKANIMATION_FILE_HEADER) + frameData[i].DataOffset);
+            for (UINT key = 0; key < ANIMATION_KEYS; ++key)
+            {
+                keys[key].Translation = XMFLOAT3(1.f, 0.f, 0.f);
+                keys[key].Orientation = XMFLOAT4(0.f, 0.f, 0.f, 1.f);
+                keys[key].Scaling = XMFLOAT3(1.f, 1.f, 1.f);
+            }
+        }
+
+        return data;
+    }
+
+    HRESULT WriteDataFile(const wchar_t* fileName, const std::vector<BYTE>& data)
+    {
+        HANDLE hFile = CreateFileW(fileName, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (hFile == INVALID_HANDLE_VALUE)
+            return HRESULT_FROM_WIN32(GetLastError());
+
+        DWORD bytesWritten = 0;
+        const BOOL result = ::WriteFile(hFile, data.data(), static_cast<DWORD>(data.size()), &bytesWritten, nullptr);
+        const HRESULT hr = (result && bytesWritten == data.size()) ? S_OK : E_FAIL;
+        CloseHandle(hFile);
+        return hr;
+    }
+
+    // What FindFrame did before the name index
+    UINT LinearFindFrameIndex(const CDXUTSDKMesh& mesh, const char* pszName)
+    {
+        for (UINT i = 0; i < mesh.GetNumFrames(); ++i)
+        {
+            if (_stricmp(mesh.GetFrame(i)->Name, pszName) == 0)
+                return i;
+        }
+        return INVALID_FRAME;
+    }
+
+    //----------------------------------------------------------------------------------
+    void PrintUsage()
+    {
+        wprintf(L"Usage: sdkmeshframebench <options>\n");
+        wprintf(L"\n");
+        wprintf(L"   -n <count>          number of frames and tracks (defaults to %u)\n", DEFAULT_FRAME_COUNT);
+        wprintf(L"   -r <count>          number of runs, the best is reported (defaults to %u)\n", DEFAULT_REPEAT_COUNT);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Entry-point
+//--------------------------------------------------------------------------------------
+#pragma prefast(disable : 28198, "Command-line tool, frees all memory on exit")
+
+int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
+{
+    UINT frameCount = DEFAULT_FRAME_COUNT;
+    UINT repeatCount = DEFAULT_REPEAT_COUNT;
+
+    for (int iArg = 1; iArg < argc; iArg++)
+    {
+        const wchar_t* pArg = argv[iArg];
+        if ((('-' != pArg[0]) && ('/' != pArg[0])) || (iArg + 1 >= argc))
+        {
+            PrintUsage();
+            return 1;
+        }
+
+        pArg++;
+        const wchar_t* pValue = argv[++iArg];
+        if (!_wcsicmp(pArg, L"n"))
+        {
+            if (swscanf_s(pValue, L"%u", &frameCount) != 1 || !frameCount || frameCount > 1000000)
+            {
+                wprintf(L"Invalid value specified with -n (%ls), must be 1 to 1000000\n", pValue);
+                return 1;
+            }
+        }
+        else if (!_wcsicmp(pArg, L"r"))
+        {
+            if (swscanf_s(pValue, L"%u", &repeatCount) != 1 || !repeatCount)
+            {
+                wprintf(L"Invalid value specified with -r (%ls)\n", pValue);
+                return 1;
+            }
+        }
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    wchar_t animationFile[MAX_PATH] = {};
+    wchar_t tempPath[MAX_PATH] = {};
+    if (!GetTempPathW(MAX_PATH, tempPath)
+        || swprintf_s(animationFile, L"%lssdkmeshframebench.sdkmesh_anim", tempPath) < 0)
+    {
+        wprintf(L"ERROR: Failed to get the temporary path\n");
+        return 1;
+    }
+
+    HRESULT hr = WriteDataFile(animationFile, CreateAnimation(frameCount));
+    if (FAILED(hr))
+    {
+        wprintf(L"ERROR: Failed to write %ls (%08X)\n", animationFile, static_cast<unsigned int>(hr));
+        return 1;
+    }
+
+    std::vector<BYTE> meshData = CreateFrameHierarchy(frameCount);
+
+    std::vector<char> names(frameCount * MAX_FRAME_NAME);
+    for (UINT i = 0; i < frameCount; ++i)
+    {
+        sprintf_s(&names[i * MAX_FRAME_NAME], MAX_FRAME_NAME, "BONE_%u", frameCount - 1 - i);
+    }
+
+    double createTime = 0.0;
+    double bindTime = 0.0;
+    double indexedTime = 0.0;
+    double linearTime = 0.0;
+    UINT mismatches = 0;
+
+    for (UINT run = 0; run < repeatCount; ++run)
+    {
+        CDXUTSDKMesh mesh;
+
+        double start = GetMilliseconds();
+        hr = mesh.Create(nullptr, meshData.data(), meshData.size(), true);
+        const double create = GetMilliseconds() - start;
+        if (FAILED(hr))
+        {
+            wprintf(L"ERROR: Failed to create the mesh (%08X)\n", static_cast<unsigned int>(hr));
+            break;
+        }
+
+        start = GetMilliseconds();
+        hr = mesh.LoadAnimation(animationFile);
+        const double bind = GetMilliseconds() - start;
+        if (FAILED(hr))
+        {
+            wprintf(L"ERROR: Failed to load %ls (%08X)\n", animationFile, static_cast<unsigned int>(hr));
+            break;
+        }
+
+        start = GetMilliseconds();
+        for (UINT i = 0; i < frameCount; ++i)
+        {
+            if (mesh.FindFrameIndex(&names[i * MAX_FRAME_NAME]) != frameCount - 1 - i)
+                ++mismatches;
+        }
+        const double indexed = GetMilliseconds() - start;
+
+        start = GetMilliseconds();
+        for (UINT i = 0; i < frameCount; ++i)
+        {
+            if (LinearFindFrameIndex(mesh, &names[i * MAX_FRAME_NAME]) != frameCount - 1 - i)
+                ++mismatches;
+        }
+        const double linear = GetMilliseconds() - start;
+
+        for (UINT i = 0; i < frameCount; ++i)
+        {
+            if (mesh.GetFrame(i)->AnimationDataIndex != frameCount - 1 - i)
+                ++mismatches;
+        }
+        if (mesh.FindFrameIndex("Bone_") != INVALID_FRAME || mesh.FindFrame("BONE_X") != nullptr)
+            ++mismatches;
+
+        if (!run || create < createTime)
+            createTime = create;
+        if (!run || bind < bindTime)
+            bindTime = bind;
+        if (!run || indexed < indexedTime)
+            indexedTime = indexed;
+        if (!run || linear < linearTime)
+            linearTime = linear;
+    }
+
+    DeleteFileW(animationFile);
+
+    if (FAILED(hr))
+        return 1;
+
+    if (mismatches)
+    {
+        wprintf(L"ERROR: %u frames were not found or bound correctly\n", mismatches);
+        return 1;
+    }
+
+    wprintf(L"%u frames, %u tracks, best of %u runs\n", frameCount, frameCount, repeatCount);
+    wprintf(L"  create     %9.3f ms\n", createTime);
+    wprintf(L"  bind       %9.3f ms (LoadAnimation, including file I/O)\n", bindTime);
+    wprintf(L"  indexed    %9.3f ms\n", indexedTime);
+    wprintf(L"  linear     %9.3f ms\n", linearTime);
+
+    return 0;
+}
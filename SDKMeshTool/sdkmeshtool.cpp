@@ -0,0 +1,2284 @@
+//--------------------------------------------------------------------------------------
+// File: sdkmeshtool.cpp
+//
+// Simple command-line tool for optimizing .sdkmesh files offline. The indices of each
+// triangle list subset are reordered for the post-transform vertex cache and then for
+// overdraw, and the vertices of each mesh are reordered into the order they are first
+// fetched. The average cache miss ratio (ACMR) and average transform to vertex ratio
+// (ATVR) are reported before and after.
+//
+// With -q, positions are quantized to 16 bits relative to the bounds of each subset,
+// normals, tangents and binormals are octahedral encoded and texture coordinates are
+// stored as halves. With -z, the vertex buffers are entropy coded. Either writes a
+// version 102 file (see SDKMESH_HEADER_EXTENSION); otherwise the file layout is
+// unchanged, so the output can be loaded by CDXUTSDKMesh as before.
+//
+// With -m, each triangle list subset is also split into meshlets of at most 64 vertices
+// and 124 triangles, with a bounding sphere and normal cone each for cluster culling
+// (see SDKMESH_MESHLET_HEADER). Meshlets already in the input are always rebuilt, as the
+// reordered indices no longer match them.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=320437
+//--------------------------------------------------------------------------------------
+
+#pragma warning(push)
+#pragma warning(disable : 4005)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#define NODRAWTEXT
+#define NOGDI
+#define NOBITMAP
+#define NOMCX
+#define NOSERVICE
+#define NOHELP
+#pragma warning(pop)
+
+#include <Windows.h>
+#include <d3d11.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cwchar>
+#include <locale>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <DirectXMath.h>
+#include <DirectXPackedVector.h>
+
+// Only the file format structures are needed, not the Direct3D 11 mesh class
+#define _CONVERTER_APP_
+#include "SDKmesh.h"
+#include "SDKmeshCodec.h"
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+namespace
+{
+    struct handle_closer { void operator()(HANDLE h) { if (h) CloseHandle(h); } };
+
+    using ScopedHandle = std::unique_ptr<void, handle_closer>;
+
+    inline HANDLE safe_handle(HANDLE h) { return (h == INVALID_HANDLE_VALUE) ? nullptr : h; }
+
+    constexpr uint32_t DEFAULT_CACHE_SIZE = 16;
+    constexpr uint32_t MAX_CACHE_SIZE = 64;
+    constexpr float DEFAULT_OVERDRAW_THRESHOLD = 1.05f;
+    constexpr uint32_t ENCODING_BLOCK_VERTICES = 16384;
+
+    //----------------------------------------------------------------------------------
+    // Whole .sdkmesh file held in memory. The structures are used in place, so their
+    // unions still hold the file offsets.
+    //----------------------------------------------------------------------------------
+    struct MeshFile
+    {
+        std::unique_ptr<uint8_t[]> data;
+        size_t size;
+
+        SDKMESH_HEADER* header;
+        SDKMESH_VERTEX_BUFFER_HEADER* vbs;
+        SDKMESH_INDEX_BUFFER_HEADER* ibs;
+        SDKMESH_MESH* meshes;
+        SDKMESH_SUBSET* subsets;
+
+        // End of the static part copied when the file is laid out again
+        uint64_t bodyEnd;
+
+        // Vertices of each buffer; those decoded or converted by the tool have their own storage
+        std::vector<uint8_t*> vertices;
+        std::vector<std::unique_ptr<uint8_t[]>> vertexStorage;
+
+        // One entry per subset, or empty if no positions are quantized
+        std::vector<SDKMESH_VERTEX_QUANTIZATION> quantization;
+        bool encoded;
+
+        // Meshlet tables as laid out by SDKMESH_MESHLET_HEADER, or empty. Those of the input
+        // are not read, only noted in inputMeshlets.
+        std::vector<SDKMESH_SUBSET_MESHLETS> subsetMeshlets;
+        std::vector<SDKMESH_MESHLET> meshlets;
+        std::vector<uint32_t> meshletVertexIndices;
+        std::vector<uint32_t> meshletPrimitives;
+        bool inputMeshlets;
+
+        MeshFile() noexcept :
+            size(0),
+            header(nullptr),
+            vbs(nullptr),
+            ibs(nullptr),
+            meshes(nullptr),
+            subsets(nullptr),
+            bodyEnd(0),
+            encoded(false),
+            inputMeshlets(false)
+        {}
+
+        uint8_t* Vertices(UINT iVB) const noexcept { return vertices[iVB]; }
+        uint8_t* Indices(UINT iIB) const noexcept { return data.get() + ibs[iIB].DataOffset; }
+
+        UINT MeshSubset(const SDKMESH_MESH& mesh, UINT iSubset) const noexcept
+        {
+            UINT value;
+            memcpy(&value, data.get() + mesh.SubsetOffset + sizeof(UINT) * iSubset, sizeof(UINT));
+            return value;
+        }
+    };
+
+    struct CacheStatistics
+    {
+        uint64_t triangles;
+        uint64_t misses;        // vertices transformed
+        uint64_t vertices;      // unique vertices referenced
+
+        CacheStatistics() noexcept : triangles(0), misses(0), vertices(0) {}
+
+        void Add(const CacheStatistics& other) noexcept
+        {
+            triangles += other.triangles;
+            misses += other.misses;
+            vertices += other.vertices;
+        }
+
+        double ACMR() const noexcept { return triangles ? double(misses) / double(triangles) : 0.0; }
+        double ATVR() const noexcept { return vertices ? double(misses) / double(vertices) : 0.0; }
+    };
+
+    struct IndexRange
+    {
+        uint64_t start;
+        uint64_t count;
+
+        bool operator==(const IndexRange& other) const noexcept { return start == other.start && count == other.count; }
+        bool operator<(const IndexRange& other) const noexcept { return std::tie(start, count) < std::tie(other.start, other.count); }
+    };
+
+    // True if count elements of elementSize bytes starting at offset fit within limit
+    inline bool IsRangeValid(uint64_t offset, uint64_t count, uint64_t elementSize, uint64_t limit) noexcept
+    {
+        if (offset > limit)
+            return false;
+
+        return !elementSize || count <= (limit - offset) / elementSize;
+    }
+
+    //----------------------------------------------------------------------------------
+    HRESULT ValidateMeshFile(MeshFile& file)
+    {
+        auto pData = file.data.get();
+        const uint64_t size = file.size;
+
+        if (size < sizeof(SDKMESH_HEADER))
+            return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+        auto header = reinterpret_cast<SDKMESH_HEADER*>(pData);
+        if (header->Version != SDKMESH_FILE_VERSION && header->Version != SDKMESH_FILE_VERSION_EXTENDED)
+            return E_NOINTERFACE;
+
+        // Everything but the buffers is in the static part, which is mostly kept as is when the file is laid out again
+        if (header->HeaderSize < sizeof(SDKMESH_HEADER)
+            || !IsRangeValid(header->HeaderSize, header->NonBufferDataSize, 1, size))
+            return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+        const uint64_t staticSize = header->HeaderSize + header->NonBufferDataSize;
+
+        // The tables of the header extension follow the rest of the static part, and are
+        // written again rather than copied when the file is laid out again
+        uint64_t bodyEnd = staticSize;
+
+        const SDKMESH_VERTEX_ENCODING* encoding = nullptr;
+        if (header->Version == SDKMESH_FILE_VERSION_EXTENDED)
+        {
+            if (header->HeaderSize < sizeof(SDKMESH_HEADER) + sizeof(SDKMESH_HEADER_EXTENSION))
+                return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+            auto extension = reinterpret_cast<const SDKMESH_HEADER_EXTENSION*>(pData + sizeof(SDKMESH_HEADER));
+
+            if (extension->Flags & SDKMESH_MESHLETS)
+            {
+                if (!IsRangeValid(extension->MeshletOffset, 1, sizeof(SDKMESH_MESHLET_HEADER), staticSize))
+                    return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+                file.inputMeshlets = true;
+                bodyEnd = std::min(bodyEnd, extension->MeshletOffset);
+            }
+
+            if (extension->Flags & SDKMESH_QUANTIZED_VERTICES)
+            {
+                if (!IsRangeValid(extension->VertexQuantizationOffset, header->NumTotalSubsets, sizeof(SDKMESH_VERTEX_QUANTIZATION), staticSize))
+                    return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+                auto quantization = reinterpret_cast<const SDKMESH_VERTEX_QUANTIZATION*>(pData + extension->VertexQuantizationOffset);
+                file.quantization.assign(quantization, quantization + header->NumTotalSubsets);
+                bodyEnd = std::min(bodyEnd, extension->VertexQuantizationOffset);
+            }
+
+            if (extension->Flags & SDKMESH_ENCODED_VERTICES)
+            {
+                if (!IsRangeValid(extension->VertexEncodingOffset, header->NumVertexBuffers, sizeof(SDKMESH_VERTEX_ENCODING), staticSize))
+                    return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+                encoding = reinterpret_cast<const SDKMESH_VERTEX_ENCODING*>(pData + extension->VertexEncodingOffset);
+                bodyEnd = std::min(bodyEnd, extension->VertexEncodingOffset);
+            }
+        }
+
+        if (bodyEnd < header->HeaderSize
+            || !IsRangeValid(header->VertexStreamHeadersOffset, header->NumVertexBuffers, sizeof(SDKMESH_VERTEX_BUFFER_HEADER), bodyEnd)
+            || !IsRangeValid(header->IndexStreamHeadersOffset, header->NumIndexBuffers, sizeof(SDKMESH_INDEX_BUFFER_HEADER), bodyEnd)
+            || !IsRangeValid(header->MeshDataOffset, header->NumMeshes, sizeof(SDKMESH_MESH), bodyEnd)
+            || !IsRangeValid(header->SubsetDataOffset, header->NumTotalSubsets, sizeof(SDKMESH_SUBSET), bodyEnd)
+            || !IsRangeValid(header->FrameDataOffset, header->NumFrames, sizeof(SDKMESH_FRAME), bodyEnd)
+            || !IsRangeValid(header->MaterialDataOffset, header->NumMaterials, sizeof(SDKMESH_MATERIAL), bodyEnd))
+            return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+        file.header = header;
+        file.bodyEnd = bodyEnd;
+        file.vbs = reinterpret_cast<SDKMESH_VERTEX_BUFFER_HEADER*>(pData + header->VertexStreamHeadersOffset);
+        file.ibs = reinterpret_cast<SDKMESH_INDEX_BUFFER_HEADER*>(pData + header->IndexStreamHeadersOffset);
+        file.meshes = reinterpret_cast<SDKMESH_MESH*>(pData + header->MeshDataOffset);
+        file.subsets = reinterpret_cast<SDKMESH_SUBSET*>(pData + header->SubsetDataOffset);
+
+        file.vertices.resize(header->NumVertexBuffers);
+        file.vertexStorage.resize(header->NumVertexBuffers);
+
+        for (UINT i = 0; i < header->NumVertexBuffers; ++i)
+        {
+            auto& vb = file.vbs[i];
+            if (!vb.StrideBytes
+                || vb.StrideBytes > UINT32_MAX
+                || !IsRangeValid(0, vb.NumVertices, vb.StrideBytes, vb.SizeBytes))
+                return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+            if (!encoding || !encoding[i].EncodedBytes)
+            {
+                if (!IsRangeValid(vb.DataOffset, vb.SizeBytes, 1, size))
+                    return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+                file.vertices[i] = pData + vb.DataOffset;
+                continue;
+            }
+
+            // Entropy coded buffers are decoded up front, so the rest of the tool only sees vertices
+            auto& coding = encoding[i];
+            if (vb.NumVertices * vb.StrideBytes != vb.SizeBytes
+                || !coding.NumBlocks
+                || coding.NumBlocks != SDKMeshGetVertexBlockCount(vb.NumVertices, coding.BlockVertices)
+                || !IsRangeValid(vb.DataOffset, coding.EncodedBytes, 1, size))
+                return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+            file.vertexStorage[i].reset(new (std::nothrow) uint8_t[size_t(vb.SizeBytes)]);
+            if (!file.vertexStorage[i])
+                return E_OUTOFMEMORY;
+
+            for (UINT j = 0; j < coding.NumBlocks; ++j)
+            {
+                HRESULT hr = SDKMeshDecodeVertexBlock(pData + vb.DataOffset, size_t(coding.EncodedBytes),
+                    vb.NumVertices, static_cast<UINT>(vb.StrideBytes), coding.BlockVertices, j, file.vertexStorage[i].get());
+                if (FAILED(hr))
+                    return hr;
+            }
+
+            file.vertices[i] = file.vertexStorage[i].get();
+            file.encoded = true;
+        }
+
+        for (UINT i = 0; i < header->NumIndexBuffers; ++i)
+        {
+            auto& ib = file.ibs[i];
+            if ((ib.IndexType != IT_16BIT && ib.IndexType != IT_32BIT)
+                || !IsRangeValid(ib.DataOffset, ib.SizeBytes, 1, size)
+                || !IsRangeValid(0, ib.NumIndices, (ib.IndexType == IT_32BIT) ? 4 : 2, ib.SizeBytes))
+                return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+        }
+
+        for (UINT i = 0; i < header->NumMeshes; ++i)
+        {
+            auto& mesh = file.meshes[i];
+            if (mesh.IndexBuffer >= header->NumIndexBuffers
+                || mesh.NumVertexBuffers > MAX_VERTEX_STREAMS
+                || !IsRangeValid(mesh.SubsetOffset, mesh.NumSubsets, sizeof(UINT), bodyEnd)
+                || !IsRangeValid(mesh.FrameInfluenceOffset, mesh.NumFrameInfluences, sizeof(UINT), bodyEnd))
+                return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+            for (UINT j = 0; j < mesh.NumVertexBuffers; ++j)
+            {
+                if (mesh.VertexBuffers[j] >= header->NumVertexBuffers)
+                    return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+            }
+
+            for (UINT j = 0; j < mesh.NumSubsets; ++j)
+            {
+                if (file.MeshSubset(mesh, j) >= header->NumTotalSubsets)
+                    return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+            }
+        }
+
+        return S_OK;
+    }
+
+    //----------------------------------------------------------------------------------
+    HRESULT ReadMeshFile(const wchar_t* szFile, MeshFile& file)
+    {
+        ScopedHandle hFile(safe_handle(CreateFileW(szFile,
+            GENERIC_READ, FILE_SHARE_READ,
+            nullptr,
+            OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN,
+            nullptr)));
+        if (!hFile)
+            return HRESULT_FROM_WIN32(GetLastError());
+
+        LARGE_INTEGER fileSize = {};
+        if (!GetFileSizeEx(hFile.get(), &fileSize))
+            return HRESULT_FROM_WIN32(GetLastError());
+
+        // File is too big for 32-bit allocation, so reject read
+        if (fileSize.HighPart > 0)
+            return E_FAIL;
+
+        file.data.reset(new (std::nothrow) uint8_t[fileSize.LowPart]);
+        if (!file.data)
+            return E_OUTOFMEMORY;
+
+        DWORD bytesRead = 0;
+        if (!ReadFile(hFile.get(), file.data.get(), fileSize.LowPart, &bytesRead, nullptr))
+            return HRESULT_FROM_WIN32(GetLastError());
+
+        if (bytesRead != fileSize.LowPart)
+            return E_FAIL;
+
+        file.size = fileSize.LowPart;
+
+        return ValidateMeshFile(file);
+    }
+
+    //----------------------------------------------------------------------------------
+    void ReadIndices(const MeshFile& file, UINT iIB, const IndexRange& range, std::vector<uint32_t>& indices)
+    {
+        indices.resize(size_t(range.count));
+
+        if (file.ibs[iIB].IndexType == IT_32BIT)
+        {
+            memcpy(indices.data(), file.Indices(iIB) + range.start * sizeof(uint32_t), indices.size() * sizeof(uint32_t));
+        }
+        else
+        {
+            auto src = reinterpret_cast<const uint16_t*>(file.Indices(iIB)) + range.start;
+            std::copy(src, src + indices.size(), indices.begin());
+        }
+    }
+
+    void WriteIndices(MeshFile& file, UINT iIB, const IndexRange& range, const std::vector<uint32_t>& indices)
+    {
+        assert(indices.size() == range.count);
+
+        if (file.ibs[iIB].IndexType == IT_32BIT)
+        {
+            memcpy(file.Indices(iIB) + range.start * sizeof(uint32_t), indices.data(), indices.size() * sizeof(uint32_t));
+        }
+        else
+        {
+            auto dest = reinterpret_cast<uint16_t*>(file.Indices(iIB)) + range.start;
+            for (size_t i = 0; i < indices.size(); ++i)
+            {
+                dest[i] = static_cast<uint16_t>(indices[i]);
+            }
+        }
+    }
+
+    //----------------------------------------------------------------------------------
+    // Simulates a FIFO post-transform cache of cacheSize entries
+    //----------------------------------------------------------------------------------
+    void AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize, CacheStatistics& stats)
+    {
+        std::vector<uint32_t> timestamps(vertexCount, 0);
+        uint32_t time = cacheSize + 1;
+
+        for (size_t i = 0; i < indexCount; ++i)
+        {
+            uint32_t v = indices[i];
+            if (time - timestamps[v] > cacheSize)
+            {
+                timestamps[v] = time++;
+                ++stats.misses;
+            }
+        }
+
+        // Every vertex referenced has missed at least once
+        for (auto it : timestamps)
+        {
+            if (it)
+                ++stats.vertices;
+        }
+
+        stats.triangles += indexCount / 3;
+    }
+
+    //----------------------------------------------------------------------------------
+    // Linear-time vertex cache optimization ("Tipsify", Sander, Nehab & Barczak 2007).
+    // Fans out from one vertex at a time, choosing the next vertex that is still in the
+    // cache and has the most remaining triangles.
+    //----------------------------------------------------------------------------------
+    void OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize)
+    {
+        const size_t faceCount = indexCount / 3;
+        if (faceCount < 2)
+            return;
+
+        // Triangles that use each vertex
+        std::vector<uint32_t> liveTriangles(vertexCount, 0);
+        for (size_t i = 0; i < faceCount * 3; ++i)
+        {
+            ++liveTriangles[indices[i]];
+        }
+
+        std::vector<uint32_t> offsets(vertexCount + 1, 0);
+        for (size_t v = 0; v < vertexCount; ++v)
+        {
+            offsets[v + 1] = offsets[v] + liveTriangles[v];
+        }
+
+        std::vector<uint32_t> adjacency(faceCount * 3);
+        {
+            std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+            for (size_t i = 0; i < faceCount * 3; ++i)
+            {
+                adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+            }
+        }
+
+        std::vector<uint32_t> cacheTime(vertexCount, 0);
+        std::vector<bool> emitted(faceCount, false);
+        std::vector<uint32_t> deadEnd;
+        std::vector<uint32_t> candidates;
+        std::vector<uint32_t> output;
+        deadEnd.reserve(faceCount * 3);
+        output.reserve(faceCount * 3);
+
+        uint32_t time = cacheSize + 1;
+        size_t cursor = 0;
+        uint32_t fanning = indices[0];
+
+        while (fanning != UINT32_MAX)
+        {
+            candidates.clear();
+
+            for (uint32_t k = offsets[fanning]; k < offsets[fanning + 1]; ++k)
+            {
+                uint32_t t = adjacency[k];
+                if (emitted[t])
+                    continue;
+
+                for (size_t c = 0; c < 3; ++c)
+                {
+                    uint32_t v = indices[t * 3 + c];
+                    output.push_back(v);
+                    deadEnd.push_back(v);
+                    candidates.push_back(v);
+
+                    --liveTriangles[v];
+                    if (time - cacheTime[v] > cacheSize)
+                        cacheTime[v] = time++;
+                }
+
+                emitted[t] = true;
+            }
+
+            // Prefer the oldest candidate that will still be cached once its own fan is emitted
+            fanning = UINT32_MAX;
+            int bestPriority = -1;
+            for (auto v : candidates)
+            {
+                if (!liveTriangles[v])
+                    continue;
+
+                int priority = 0;
+                if (time - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize)
+                    priority = static_cast<int>(time - cacheTime[v]);
+
+                if (priority > bestPriority)
+                {
+                    bestPriority = priority;
+                    fanning = v;
+                }
+            }
+
+            if (fanning == UINT32_MAX)
+            {
+                // Dead end: back up through recently used vertices, then scan for any remaining
+                while (!deadEnd.empty())
+                {
+                    uint32_t v = deadEnd.back();
+                    deadEnd.pop_back();
+                    if (liveTriangles[v])
+                    {
+                        fanning = v;
+                        break;
+                    }
+                }
+
+                for (; fanning == UINT32_MAX && cursor < vertexCount; ++cursor)
+                {
+                    if (liveTriangles[cursor])
+                        fanning = static_cast<uint32_t>(cursor);
+                }
+            }
+        }
+
+        assert(output.size() == faceCount * 3);
+        std::copy(output.begin(), output.end(), indices);
+    }
+
+    //----------------------------------------------------------------------------------
+    // Splits the cache-optimized triangles into clusters at the points where the cache
+    // starts cold, or where the ACMR so far is within threshold of the cluster's, then
+    // orders the clusters so those facing outward from the centre of the subset are drawn
+    // first ("Fast triangle reordering for vertex locality and reduced overdraw", Sander,
+    // Nehab & Barczak 2007)
+    //----------------------------------------------------------------------------------
+    void OptimizeOverdraw(uint32_t* indices, size_t indexCount, const std::vector<XMFLOAT3>& positions, uint32_t cacheSize, float threshold)
+    {
+        const size_t faceCount = indexCount / 3;
+        if (faceCount < 2)
+            return;
+
+        std::vector<uint32_t> timestamps(positions.size(), 0);
+        uint32_t time = cacheSize + 1;
+
+        auto triangleMisses = [&](size_t t) -> uint32_t
+        {
+            uint32_t result = 0;
+            for (size_t c = 0; c < 3; ++c)
+            {
+                uint32_t v = indices[t * 3 + c];
+                if (time - timestamps[v] > cacheSize)
+                {
+                    timestamps[v] = time++;
+                    ++result;
+                }
+            }
+            return result;
+        };
+
+        // Hard boundaries where every vertex of a triangle misses the cache
+        std::vector<size_t> hard;
+        for (size_t t = 0; t < faceCount; ++t)
+        {
+            if (triangleMisses(t) == 3 || !t)
+                hard.push_back(t);
+        }
+        hard.push_back(faceCount);
+
+        // Soft boundaries split each hard cluster as soon as the run so far, starting from a cold
+        // cache, is within threshold of the whole cluster's ACMR
+        std::vector<size_t> clusters;
+        for (size_t h = 0; h + 1 < hard.size(); ++h)
+        {
+            const size_t start = hard[h];
+            const size_t end = hard[h + 1];
+
+            time += cacheSize + 1;
+            uint32_t clusterMisses = 0;
+            for (size_t t = start; t < end; ++t)
+                clusterMisses += triangleMisses(t);
+
+            const float limit = threshold * float(clusterMisses) / float(end - start);
+
+            clusters.push_back(start);
+
+            time += cacheSize + 1;
+            uint32_t runMisses = 0;
+            size_t runStart = start;
+            for (size_t t = start; t < end; ++t)
+            {
+                runMisses += triangleMisses(t);
+                if (t + 1 < end && float(runMisses) <= limit * float(t + 1 - runStart))
+                {
+                    clusters.push_back(t + 1);
+                    time += cacheSize + 1;
+                    runStart = t + 1;
+                    runMisses = 0;
+                }
+            }
+
+            // The last run is usually short, so merge it back if it missed the target
+            if (runStart != start && float(runMisses) > limit * float(end - runStart))
+                clusters.pop_back();
+        }
+
+        if (clusters.size() < 2)
+            return;
+
+        clusters.push_back(faceCount);
+
+        // Area-weighted centroid and normal of each cluster
+        const size_t clusterCount = clusters.size() - 1;
+        std::vector<XMFLOAT3> clusterCentroid(clusterCount);
+        std::vector<XMFLOAT3> clusterNormal(clusterCount);
+
+        XMVECTOR meshCentroid = XMVectorZero();
+        float meshArea = 0.f;
+
+        for (size_t c = 0; c < clusterCount; ++c)
+        {
+            XMVECTOR centroid = XMVectorZero();
+            XMVECTOR normal = XMVectorZero();
+            float area = 0.f;
+
+            for (size_t t = clusters[c]; t < clusters[c + 1]; ++t)
+            {
+                XMVECTOR p0 = XMLoadFloat3(&positions[indices[t * 3]]);
+                XMVECTOR p1 = XMLoadFloat3(&positions[indices[t * 3 + 1]]);
+                XMVECTOR p2 = XMLoadFloat3(&positions[indices[t * 3 + 2]]);
+
+                XMVECTOR n = XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+                float a = XMVectorGetX(XMVector3Length(n));
+
+                centroid = XMVectorMultiplyAdd(XMVectorAdd(XMVectorAdd(p0, p1), p2), XMVectorReplicate(a / 3.f), centroid);
+                normal = XMVectorAdd(normal, n);
+                area += a;
+            }
+
+            meshCentroid = XMVectorAdd(meshCentroid, centroid);
+            meshArea += area;
+
+            XMStoreFloat3(&clusterCentroid[c], (area > 0.f) ? XMVectorScale(centroid, 1.f / area) : centroid);
+            XMStoreFloat3(&clusterNormal[c], XMVector3Normalize(normal));
+        }
+
+        if (meshArea > 0.f)
+            meshCentroid = XMVectorScale(meshCentroid, 1.f / meshArea);
+
+        std::vector<std::pair<float, size_t>> order(clusterCount);
+        for (size_t c = 0; c < clusterCount; ++c)
+        {
+            XMVECTOR offset = XMVectorSubtract(XMLoadFloat3(&clusterCentroid[c]), meshCentroid);
+            order[c] = std::make_pair(-XMVectorGetX(XMVector3Dot(offset, XMLoadFloat3(&clusterNormal[c]))), c);
+        }
+
+        std::stable_sort(order.begin(), order.end());
+
+        std::vector<uint32_t> output;
+        output.reserve(faceCount * 3);
+        for (auto& it : order)
+        {
+            output.insert(output.end(), indices + clusters[it.second] * 3, indices + clusters[it.second + 1] * 3);
+        }
+
+        std::copy(output.begin(), output.end(), indices);
+    }
+
+    //----------------------------------------------------------------------------------
+    // Finds the float3 (or float4) position element among the vertex streams of the mesh
+    //----------------------------------------------------------------------------------
+    bool FindPositions(const MeshFile& file, const SDKMESH_MESH& mesh, UINT& iVB, UINT& offset)
+    {
+        for (UINT s = 0; s < mesh.NumVertexBuffers; ++s)
+        {
+            auto& vb = file.vbs[mesh.VertexBuffers[s]];
+
+            for (size_t e = 0; e < MAX_VERTEX_ELEMENTS && vb.Decl[e].Stream != 0xFF; ++e)
+            {
+                auto& element = vb.Decl[e];
+                if (element.Usage == D3DDECLUSAGE_POSITION && !element.UsageIndex
+                    && (element.Type == D3DDECLTYPE_FLOAT3 || element.Type == D3DDECLTYPE_FLOAT4)
+                    && element.Offset + sizeof(XMFLOAT3) <= vb.StrideBytes)
+                {
+                    iVB = mesh.VertexBuffers[s];
+                    offset = element.Offset;
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+
+    //----------------------------------------------------------------------------------
+    // Index ranges that partially overlap another range in the same index buffer can not
+    // be reordered independently
+    //----------------------------------------------------------------------------------
+    std::vector<std::vector<IndexRange>> FindOverlappingRanges(const MeshFile& file)
+    {
+        std::vector<std::vector<IndexRange>> ranges(file.header->NumIndexBuffers);
+
+        for (UINT i = 0; i < file.header->NumMeshes; ++i)
+        {
+            auto& mesh = file.meshes[i];
+            for (UINT j = 0; j < mesh.NumSubsets; ++j)
+            {
+                auto& subset = file.subsets[file.MeshSubset(mesh, j)];
+                ranges[mesh.IndexBuffer].push_back(IndexRange{ subset.IndexStart, subset.IndexCount });
+            }
+        }
+
+        std::vector<std::vector<IndexRange>> overlapping(file.header->NumIndexBuffers);
+
+        for (size_t ib = 0; ib < ranges.size(); ++ib)
+        {
+            auto& list = ranges[ib];
+            std::sort(list.begin(), list.end());
+            list.erase(std::unique(list.begin(), list.end()), list.end());
+
+            for (size_t a = 0; a < list.size(); ++a)
+            {
+                for (size_t b = a + 1; b < list.size() && list[b].start < list[a].start + list[a].count; ++b)
+                {
+                    overlapping[ib].push_back(list[a]);
+                    overlapping[ib].push_back(list[b]);
+                }
+            }
+
+            std::sort(overlapping[ib].begin(), overlapping[ib].end());
+            overlapping[ib].erase(std::unique(overlapping[ib].begin(), overlapping[ib].end()), overlapping[ib].end());
+        }
+
+        return overlapping;
+    }
+
+    struct MeshReport
+    {
+        UINT subsetsOptimized;
+        UINT subsetsSkipped;
+        CacheStatistics before;
+        CacheStatistics after;
+        const wchar_t* fetchResult;
+
+        MeshReport() noexcept : subsetsOptimized(0), subsetsSkipped(0), fetchResult(L"") {}
+    };
+
+    struct Settings
+    {
+        uint32_t cacheSize;
+        float overdrawThreshold;
+        bool optimize;
+        bool overdraw;
+        bool fetch;
+        bool quantize;
+        bool encode;
+        bool meshlets;
+    };
+
+    //----------------------------------------------------------------------------------
+    // Reorders the vertices of a mesh into first-use order, within each subset's vertex
+    // range. Every stream of the mesh is permuted and all of its indices are remapped.
+    //----------------------------------------------------------------------------------
+    const wchar_t* OptimizeVertexFetch(MeshFile& file, UINT iMesh, const std::vector<UINT>& vbUsers, const std::vector<UINT>& ibUsers,
+        const std::vector<std::vector<IndexRange>>& overlapping)
+    {
+        auto& mesh = file.meshes[iMesh];
+
+        if (!mesh.NumVertexBuffers || !mesh.NumSubsets)
+            return L"no vertices";
+
+        if (ibUsers[mesh.IndexBuffer] > 1)
+            return L"skipped, index buffer is shared";
+
+        const uint64_t numVertices = file.vbs[mesh.VertexBuffers[0]].NumVertices;
+        for (UINT s = 0; s < mesh.NumVertexBuffers; ++s)
+        {
+            if (vbUsers[mesh.VertexBuffers[s]] > 1)
+                return L"skipped, vertex buffer is shared";
+
+            if (file.vbs[mesh.VertexBuffers[s]].NumVertices != numVertices)
+                return L"skipped, vertex streams differ in length";
+
+            for (UINT t = 0; t < s; ++t)
+            {
+                if (mesh.VertexBuffers[t] == mesh.VertexBuffers[s])
+                    return L"skipped, vertex buffer is bound twice";
+            }
+        }
+
+        // Distinct (index range, vertex range) pairs; vertex ranges must match or be disjoint
+        struct Draw
+        {
+            IndexRange indices;
+            uint64_t vertexStart;
+            uint64_t vertexCount;
+        };
+
+        std::vector<Draw> draws;
+        for (UINT j = 0; j < mesh.NumSubsets; ++j)
+        {
+            auto& subset = file.subsets[file.MeshSubset(mesh, j)];
+            Draw draw = { IndexRange{ subset.IndexStart, subset.IndexCount }, subset.VertexStart, subset.VertexCount };
+
+            if (std::binary_search(overlapping[mesh.IndexBuffer].begin(), overlapping[mesh.IndexBuffer].end(), draw.indices))
+                return L"skipped, subset index ranges overlap";
+
+            if (draw.indices.start + draw.indices.count > file.ibs[mesh.IndexBuffer].NumIndices
+                || draw.vertexStart + draw.vertexCount > numVertices)
+                return L"skipped, subset out of range";
+
+            bool found = false;
+            for (auto& it : draws)
+            {
+                bool sameVertices = (it.vertexStart == draw.vertexStart && it.vertexCount == draw.vertexCount);
+                bool disjointVertices = (draw.vertexStart + draw.vertexCount <= it.vertexStart || it.vertexStart + it.vertexCount <= draw.vertexStart);
+
+                if (it.indices == draw.indices)
+                {
+                    if (!sameVertices)
+                        return L"skipped, index range drawn with different vertex ranges";
+                    found = true;
+                }
+                else if (!sameVertices && !disjointVertices)
+                {
+                    return L"skipped, subset vertex ranges overlap";
+                }
+            }
+
+            if (!found)
+                draws.push_back(draw);
+        }
+
+        // First-use order within each vertex range
+        std::vector<uint32_t> remap(size_t(numVertices), UINT32_MAX);
+        std::vector<uint32_t> indices;
+        std::vector<bool> rangeDone(draws.size(), false);
+
+        for (size_t d = 0; d < draws.size(); ++d)
+        {
+            if (rangeDone[d])
+                continue;
+
+            const uint64_t vertexStart = draws[d].vertexStart;
+            const uint64_t vertexCount = draws[d].vertexCount;
+            uint64_t next = vertexStart;
+
+            for (size_t e = d; e < draws.size(); ++e)
+            {
+                if (draws[e].vertexStart != vertexStart || draws[e].vertexCount != vertexCount)
+                    continue;
+
+                rangeDone[e] = true;
+
+                ReadIndices(file, mesh.IndexBuffer, draws[e].indices, indices);
+                for (auto it : indices)
+                {
+                    if (it >= vertexCount)
+                        return L"skipped, index outside subset vertex range";
+
+                    auto& slot = remap[size_t(vertexStart + it)];
+                    if (slot == UINT32_MAX)
+                        slot = static_cast<uint32_t>(next++);
+                }
+            }
+
+            // Unreferenced vertices keep their relative order after the used ones
+            for (uint64_t v = vertexStart; v < vertexStart + vertexCount; ++v)
+            {
+                if (remap[size_t(v)] == UINT32_MAX)
+                    remap[size_t(v)] = static_cast<uint32_t>(next++);
+            }
+        }
+
+        // Vertices outside every subset stay where they are
+        for (size_t v = 0; v < remap.size(); ++v)
+        {
+            if (remap[v] == UINT32_MAX)
+                remap[v] = static_cast<uint32_t>(v);
+        }
+
+        for (auto& it : draws)
+        {
+            ReadIndices(file, mesh.IndexBuffer, it.indices, indices);
+            for (auto& index : indices)
+            {
+                index = remap[size_t(it.vertexStart + index)] - static_cast<uint32_t>(it.vertexStart);
+            }
+            WriteIndices(file, mesh.IndexBuffer, it.indices, indices);
+        }
+
+        for (UINT s = 0; s < mesh.NumVertexBuffers; ++s)
+        {
+            auto& vb = file.vbs[mesh.VertexBuffers[s]];
+            const size_t stride = size_t(vb.StrideBytes);
+            uint8_t* vertices = file.Vertices(mesh.VertexBuffers[s]);
+
+            std::vector<uint8_t> source(vertices, vertices + stride * size_t(numVertices));
+            for (size_t v = 0; v < remap.size(); ++v)
+            {
+                memcpy(vertices + stride * remap[v], source.data() + stride * v, stride);
+            }
+        }
+
+        return L"vertices reordered for fetch";
+    }
+
+    //----------------------------------------------------------------------------------
+    void ProcessMesh(MeshFile& file, UINT iMesh, const Settings& settings,
+        const std::vector<std::vector<IndexRange>>& overlapping, MeshReport& report)
+    {
+        auto& mesh = file.meshes[iMesh];
+        auto& ib = file.ibs[mesh.IndexBuffer];
+
+        UINT positionVB = 0;
+        UINT positionOffset = 0;
+        const bool hasPositions = FindPositions(file, mesh, positionVB, positionOffset);
+
+        std::vector<IndexRange> done;
+        std::vector<uint32_t> indices;
+        std::vector<XMFLOAT3> positions;
+
+        for (UINT j = 0; j < mesh.NumSubsets; ++j)
+        {
+            auto& subset = file.subsets[file.MeshSubset(mesh, j)];
+            IndexRange range = { subset.IndexStart, subset.IndexCount };
+
+            // Several subsets may draw the same indices (with different materials, say)
+            if (std::find(done.begin(), done.end(), range) != done.end())
+                continue;
+            done.push_back(range);
+
+            if (subset.PrimitiveType != PT_TRIANGLE_LIST || range.count < 3)
+                continue;
+
+            if (range.start + range.count > ib.NumIndices
+                || std::binary_search(overlapping[mesh.IndexBuffer].begin(), overlapping[mesh.IndexBuffer].end(), range))
+            {
+                ++report.subsetsSkipped;
+                continue;
+            }
+
+            ReadIndices(file, mesh.IndexBuffer, range, indices);
+
+            size_t vertexCount = size_t(*std::max_element(indices.begin(), indices.end())) + 1;
+
+            CacheStatistics before;
+            AnalyzeVertexCache(indices.data(), indices.size(), vertexCount, settings.cacheSize, before);
+            report.before.Add(before);
+
+            if (settings.optimize)
+            {
+                OptimizeVertexCache(indices.data(), indices.size(), vertexCount, settings.cacheSize);
+
+                if (settings.overdraw && hasPositions
+                    && subset.VertexStart + vertexCount <= file.vbs[positionVB].NumVertices)
+                {
+                    auto& vb = file.vbs[positionVB];
+                    const uint8_t* src = file.Vertices(positionVB) + (subset.VertexStart * vb.StrideBytes) + positionOffset;
+
+                    positions.resize(vertexCount);
+                    for (size_t v = 0; v < vertexCount; ++v)
+                    {
+                        memcpy(&positions[v], src + v * vb.StrideBytes, sizeof(XMFLOAT3));
+                    }
+
+                    OptimizeOverdraw(indices.data(), indices.size(), positions, settings.cacheSize, settings.overdrawThreshold);
+                }
+
+                WriteIndices(file, mesh.IndexBuffer, range, indices);
+                ++report.subsetsOptimized;
+            }
+
+            CacheStatistics after;
+            AnalyzeVertexCache(indices.data(), indices.size(), vertexCount, settings.cacheSize, after);
+            report.after.Add(after);
+        }
+    }
+
+    inline uint64_t AlignUp(uint64_t value, uint64_t alignment) noexcept
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+
+    // Size of each D3DDECLTYPE, or 0 for D3DDECLTYPE_UNUSED
+    UINT GetDeclTypeSize(BYTE type) noexcept
+    {
+        static const UINT s_sizes[] = { 4, 8, 12, 16, 4, 4, 4, 8, 4, 4, 8, 4, 8, 4, 4, 4, 8 };
+        return (type < _countof(s_sizes)) ? s_sizes[type] : 0;
+    }
+
+    struct QuantizeReport
+    {
+        UINT buffers;
+        uint64_t bytesBefore;
+        uint64_t bytesAfter;
+        float positionError;    // distance in model units
+        float normalError;      // degrees
+        float texcoordError;
+
+        QuantizeReport() noexcept : buffers(0), bytesBefore(0), bytesAfter(0), positionError(0), normalError(0), texcoordError(0) {}
+    };
+
+    struct ElementConversion
+    {
+        UINT srcOffset;
+        UINT srcSize;
+        UINT dstOffset;
+        BYTE srcType;
+        BYTE dstType;
+    };
+
+    //----------------------------------------------------------------------------------
+    // Bounds of a vertex range, as the scale and offset that map [0,1] onto it
+    //----------------------------------------------------------------------------------
+    SDKMESH_VERTEX_QUANTIZATION ComputePositionBounds(const uint8_t* pVertices, UINT stride, UINT offset, const IndexRange& range)
+    {
+        XMVECTOR vMin = g_XMZero;
+        XMVECTOR vMax = g_XMZero;
+
+        for (uint64_t v = 0; v < range.count; ++v)
+        {
+            XMFLOAT3 p;
+            memcpy(&p, pVertices + (range.start + v) * stride + offset, sizeof(XMFLOAT3));
+
+            XMVECTOR position = XMLoadFloat3(&p);
+            vMin = v ? XMVectorMin(vMin, position) : position;
+            vMax = v ? XMVectorMax(vMax, position) : position;
+        }
+
+        // Flat bounds still need a scale that can be divided by
+        XMVECTOR extent = XMVectorSubtract(vMax, vMin);
+        extent = XMVectorSelect(extent, g_XMOne, XMVectorLessOrEqual(extent, g_XMZero));
+
+        SDKMESH_VERTEX_QUANTIZATION bounds;
+        XMStoreFloat3(&bounds.PositionScale, extent);
+        XMStoreFloat3(&bounds.PositionOffset, vMin);
+        return bounds;
+    }
+
+    //----------------------------------------------------------------------------------
+    // Rewrites the vertex buffers with positions as 16-bit unorms relative to the bounds
+    // of the vertices each subset draws, octahedral normals, tangents and binormals, and
+    // half texture coordinates. Other elements are copied. The bounds go in
+    // file.quantization for the loader. The drawn vertices are found from the indices,
+    // which may reach past the declared VertexCount. Vertex ranges that overlap without
+    // matching share the bounds of the whole buffer, as do buffers whose subsets take
+    // positions from more than one buffer or have indices outside their index buffer.
+    //----------------------------------------------------------------------------------
+    HRESULT QuantizeVertices(MeshFile& file, QuantizeReport& report)
+    {
+        const UINT numVBs = file.header->NumVertexBuffers;
+        const UINT numSubsets = file.header->NumTotalSubsets;
+
+        // Subsets drawing their positions from each buffer, and the vertices they draw
+        std::vector<std::vector<UINT>> positionSubsets(numVBs);
+        std::vector<UINT> positionVB(numSubsets, UINT32_MAX);
+        std::vector<IndexRange> drawnRanges(numSubsets, IndexRange{ 0, 0 });
+        std::vector<bool> conflicting(numVBs, false);
+        std::vector<bool> unreadable(numVBs, false);
+        std::vector<uint32_t> indices;
+
+        for (UINT i = 0; i < file.header->NumMeshes; ++i)
+        {
+            auto& mesh = file.meshes[i];
+
+            UINT iVB = 0;
+            UINT offset = 0;
+            if (!FindPositions(file, mesh, iVB, offset))
+                continue;
+
+            auto& ib = file.ibs[mesh.IndexBuffer];
+            const uint64_t numVertices = file.vbs[iVB].NumVertices;
+
+            for (UINT j = 0; j < mesh.NumSubsets; ++j)
+            {
+                UINT iSubset = file.MeshSubset(mesh, j);
+                if (positionVB[iSubset] != UINT32_MAX && positionVB[iSubset] != iVB)
+                {
+                    conflicting[iVB] = true;
+                    conflicting[positionVB[iSubset]] = true;
+                }
+
+                positionVB[iSubset] = iVB;
+                positionSubsets[iVB].push_back(iSubset);
+
+                auto& subset = file.subsets[iSubset];
+                if (subset.IndexStart > ib.NumIndices
+                    || subset.IndexCount > ib.NumIndices - subset.IndexStart)
+                {
+                    unreadable[iVB] = true;
+                    continue;
+                }
+
+                // Vertices past the end of the buffer are not drawn from it
+                ReadIndices(file, mesh.IndexBuffer, IndexRange{ subset.IndexStart, subset.IndexCount }, indices);
+
+                auto& range = drawnRanges[iSubset];
+                for (auto index : indices)
+                {
+                    const uint64_t v = subset.VertexStart + index;
+                    if (v >= numVertices)
+                        continue;
+
+                    if (!range.count)
+                    {
+                        range = IndexRange{ v, 1 };
+                    }
+                    else
+                    {
+                        const uint64_t end = std::max(range.start + range.count, v + 1);
+                        range.start = std::min(range.start, v);
+                        range.count = end - range.start;
+                    }
+                }
+            }
+        }
+
+        std::vector<ElementConversion> elements;
+        std::vector<IndexRange> ranges;
+        std::vector<SDKMESH_VERTEX_QUANTIZATION> bounds;
+        std::vector<UINT> vertexBounds;
+
+        for (UINT iVB = 0; iVB < numVBs; ++iVB)
+        {
+            auto& vb = file.vbs[iVB];
+            const UINT stride = static_cast<UINT>(vb.StrideBytes);
+            const bool quantizePositions = !positionSubsets[iVB].empty() && !conflicting[iVB];
+
+            // Buffers described by anything but a simple declaration are left alone
+            elements.clear();
+            bool valid = true;
+            bool convert = false;
+            bool convertPositions = false;
+            UINT positionOffset = 0;
+            for (size_t e = 0; e < MAX_VERTEX_ELEMENTS && vb.Decl[e].Stream != 0xFF; ++e)
+            {
+                auto& element = vb.Decl[e];
+                const UINT size = GetDeclTypeSize(element.Type);
+                if (element.Stream != 0 || !size || element.Offset + size > stride)
+                {
+                    valid = false;
+                    break;
+                }
+
+                ElementConversion conversion = { element.Offset, size, 0, element.Type, element.Type };
+                if (element.Type == D3DDECLTYPE_FLOAT3)
+                {
+                    if (element.Usage == D3DDECLUSAGE_POSITION && !element.UsageIndex && quantizePositions)
+                    {
+                        conversion.dstType = D3DDECLTYPE_USHORT4N;
+                        convertPositions = true;
+                        positionOffset = element.Offset;
+                    }
+                    else if (element.Usage == D3DDECLUSAGE_NORMAL || element.Usage == D3DDECLUSAGE_TANGENT || element.Usage == D3DDECLUSAGE_BINORMAL)
+                    {
+                        conversion.dstType = D3DDECLTYPE_SHORT2N;
+                    }
+                }
+                else if (element.Type == D3DDECLTYPE_FLOAT2 && element.Usage == D3DDECLUSAGE_TEXCOORD)
+                {
+                    conversion.dstType = D3DDECLTYPE_FLOAT16_2;
+                }
+
+                convert |= (conversion.dstType != conversion.srcType);
+                elements.push_back(conversion);
+            }
+
+            if (!valid || !convert)
+                continue;
+
+            auto sorted = elements;
+            std::sort(sorted.begin(), sorted.end(), [](const ElementConversion& a, const ElementConversion& b) { return a.srcOffset < b.srcOffset; });
+            for (size_t e = 1; e < sorted.size(); ++e)
+            {
+                if (sorted[e].srcOffset < sorted[e - 1].srcOffset + sorted[e - 1].srcSize)
+                    valid = false;
+            }
+
+            if (!valid)
+                continue;
+
+            // Elements keep their order, packed without padding
+            UINT newStride = 0;
+            UINT positionDstOffset = 0;
+            for (auto& element : elements)
+            {
+                element.dstOffset = newStride;
+                newStride += GetDeclTypeSize(element.dstType);
+
+                if (element.dstType == D3DDECLTYPE_USHORT4N && element.srcType != D3DDECLTYPE_USHORT4N)
+                    positionDstOffset = element.dstOffset;
+            }
+
+            const uint8_t* src = file.Vertices(iVB);
+            const uint64_t numVertices = vb.NumVertices;
+
+            if (convertPositions)
+            {
+                ranges.clear();
+                for (auto iSubset : positionSubsets[iVB])
+                {
+                    if (drawnRanges[iSubset].count)
+                        ranges.push_back(drawnRanges[iSubset]);
+                }
+                std::sort(ranges.begin(), ranges.end());
+                ranges.erase(std::unique(ranges.begin(), ranges.end()), ranges.end());
+
+                bool disjoint = !unreadable[iVB];
+                for (size_t k = 1; k < ranges.size(); ++k)
+                {
+                    if (ranges[k].start < ranges[k - 1].start + ranges[k - 1].count)
+                        disjoint = false;
+                }
+
+                // Vertices outside every range are not drawn, but still use the bounds of the whole buffer
+                bounds.clear();
+                bounds.push_back(ComputePositionBounds(src, stride, positionOffset, IndexRange{ 0, numVertices }));
+                vertexBounds.assign(size_t(numVertices), 0);
+
+                if (disjoint)
+                {
+                    for (auto& range : ranges)
+                    {
+                        std::fill_n(vertexBounds.begin() + ptrdiff_t(range.start), size_t(range.count), UINT(bounds.size()));
+                        bounds.push_back(ComputePositionBounds(src, stride, positionOffset, range));
+                    }
+                }
+
+                if (file.quantization.empty())
+                {
+                    SDKMESH_VERTEX_QUANTIZATION identity = { XMFLOAT3(1.f, 1.f, 1.f), XMFLOAT3(0.f, 0.f, 0.f) };
+                    file.quantization.assign(numSubsets, identity);
+                }
+
+                for (auto iSubset : positionSubsets[iVB])
+                {
+                    size_t index = 0;
+                    if (disjoint && drawnRanges[iSubset].count)
+                        index = 1 + size_t(std::lower_bound(ranges.begin(), ranges.end(), drawnRanges[iSubset]) - ranges.begin());
+
+                    file.quantization[iSubset] = bounds[index];
+                }
+            }
+
+            std::unique_ptr<uint8_t[]> converted(new (std::nothrow) uint8_t[size_t(numVertices * newStride)]);
+            if (!converted)
+                return E_OUTOFMEMORY;
+
+            for (uint64_t v = 0; v < numVertices; ++v)
+            {
+                const uint8_t* srcVertex = src + v * stride;
+                uint8_t* dstVertex = converted.get() + v * newStride;
+
+                for (auto& element : elements)
+                {
+                    const uint8_t* in = srcVertex + element.srcOffset;
+                    uint8_t* out = dstVertex + element.dstOffset;
+
+                    switch (element.dstType == element.srcType ? D3DDECLTYPE_UNUSED : element.dstType)
+                    {
+                    case D3DDECLTYPE_USHORT4N:
+                    {
+                        auto& box = bounds[vertexBounds[size_t(v)]];
+                        XMVECTOR scale = XMLoadFloat3(&box.PositionScale);
+                        XMVECTOR offset = XMLoadFloat3(&box.PositionOffset);
+
+                        XMFLOAT3 p;
+                        memcpy(&p, in, sizeof(XMFLOAT3));
+                        XMVECTOR position = XMLoadFloat3(&p);
+
+                        XMUSHORTN4 packed;
+                        XMStoreUShortN4(&packed, XMVectorSetW(XMVectorSaturate(XMVectorDivide(XMVectorSubtract(position, offset), scale)), 1.f));
+                        memcpy(out, &packed, sizeof(packed));
+                        break;
+                    }
+
+                    case D3DDECLTYPE_SHORT2N:
+                    {
+                        XMFLOAT3 n;
+                        memcpy(&n, in, sizeof(XMFLOAT3));
+                        XMVECTOR normal = XMLoadFloat3(&n);
+
+                        short packed[2];
+                        SDKMeshEncodeOctahedral(normal, packed);
+                        memcpy(out, packed, sizeof(packed));
+
+                        if (XMVectorGetX(XMVector3LengthSq(normal)) > 0.f)
+                        {
+                            float angle = XMVectorGetX(XMVector3AngleBetweenNormals(XMVector3Normalize(normal), SDKMeshDecodeOctahedral(packed)));
+                            report.normalError = std::max(report.normalError, XMConvertToDegrees(angle));
+                        }
+                        break;
+                    }
+
+                    case D3DDECLTYPE_FLOAT16_2:
+                    {
+                        XMFLOAT2 uv;
+                        memcpy(&uv, in, sizeof(XMFLOAT2));
+
+                        XMHALF2 packed(uv.x, uv.y);
+                        memcpy(out, &packed, sizeof(packed));
+
+                        report.texcoordError = std::max(report.texcoordError, std::max(
+                            fabsf(XMConvertHalfToFloat(packed.x) - uv.x),
+                            fabsf(XMConvertHalfToFloat(packed.y) - uv.y)));
+                        break;
+                    }
+
+                    default:
+                        memcpy(out, in, element.srcSize);
+                        break;
+                    }
+                }
+            }
+
+            // Round trip the positions each subset draws through the bounds the loader will
+            // expand them with; anything beyond a quantization step is a bug in the bounds
+            if (convertPositions)
+            {
+                for (auto iSubset : positionSubsets[iVB])
+                {
+                    auto& range = drawnRanges[iSubset];
+                    XMVECTOR scale = XMLoadFloat3(&file.quantization[iSubset].PositionScale);
+                    XMVECTOR offset = XMLoadFloat3(&file.quantization[iSubset].PositionOffset);
+
+                    const float tolerance = XMVectorGetX(XMVector3Length(scale)) / 65535.f
+                        + XMVectorGetX(XMVector3Length(XMVectorAdd(XMVectorAbs(offset), scale))) * 4.f * FLT_EPSILON;
+
+                    for (uint64_t v = range.start; v < range.start + range.count; ++v)
+                    {
+                        XMFLOAT3 p;
+                        memcpy(&p, src + v * stride + positionOffset, sizeof(XMFLOAT3));
+
+                        XMUSHORTN4 packed;
+                        memcpy(&packed, converted.get() + v * newStride + positionDstOffset, sizeof(packed));
+
+                        XMVECTOR restored = XMVectorMultiplyAdd(XMLoadUShortN4(&packed), scale, offset);
+                        const float error = XMVectorGetX(XMVector3Length(XMVectorSubtract(restored, XMLoadFloat3(&p))));
+                        if (error > tolerance)
+                            return E_UNEXPECTED;
+
+                        report.positionError = std::max(report.positionError, error);
+                    }
+                }
+            }
+
+            for (size_t e = 0; e < elements.size(); ++e)
+            {
+                vb.Decl[e].Offset = static_cast<WORD>(elements[e].dstOffset);
+                vb.Decl[e].Type = elements[e].dstType;
+            }
+
+            report.bytesBefore += vb.SizeBytes;
+
+            vb.StrideBytes = newStride;
+            vb.SizeBytes = numVertices * newStride;
+
+            report.bytesAfter += vb.SizeBytes;
+            ++report.buffers;
+
+            file.vertexStorage[iVB] = std::move(converted);
+            file.vertices[iVB] = file.vertexStorage[iVB].get();
+        }
+
+        return S_OK;
+    }
+
+    //----------------------------------------------------------------------------------
+    // Model space positions of the vertices a subset draws, expanding quantized positions
+    // with the bounds of the subset. False if the mesh has no usable position element or
+    // the vertices are out of range.
+    //----------------------------------------------------------------------------------
+    bool ReadSubsetPositions(const MeshFile& file, const SDKMESH_MESH& mesh, UINT iSubset, uint64_t vertexCount,
+        std::vector<XMFLOAT3>& positions)
+    {
+        auto& subset = file.subsets[iSubset];
+
+        for (UINT s = 0; s < mesh.NumVertexBuffers; ++s)
+        {
+            const UINT iVB = mesh.VertexBuffers[s];
+            auto& vb = file.vbs[iVB];
+
+            for (size_t e = 0; e < MAX_VERTEX_ELEMENTS && vb.Decl[e].Stream != 0xFF; ++e)
+            {
+                auto& element = vb.Decl[e];
+                if (element.Usage != D3DDECLUSAGE_POSITION || element.UsageIndex)
+                    continue;
+
+                const bool quantized = (element.Type == D3DDECLTYPE_USHORT4N && !file.quantization.empty());
+                if (!quantized && element.Type != D3DDECLTYPE_FLOAT3 && element.Type != D3DDECLTYPE_FLOAT4)
+                    return false;
+
+                if (element.Offset + (quantized ? sizeof(XMUSHORTN4) : sizeof(XMFLOAT3)) > vb.StrideBytes
+                    || subset.VertexStart > vb.NumVertices
+                    || vertexCount > vb.NumVertices - subset.VertexStart)
+                    return false;
+
+                XMVECTOR scale = g_XMOne;
+                XMVECTOR offset = g_XMZero;
+                if (quantized)
+                {
+                    scale = XMLoadFloat3(&file.quantization[iSubset].PositionScale);
+                    offset = XMLoadFloat3(&file.quantization[iSubset].PositionOffset);
+                }
+
+                const uint8_t* src = file.Vertices(iVB) + subset.VertexStart * vb.StrideBytes + element.Offset;
+
+                positions.resize(size_t(vertexCount));
+                for (size_t v = 0; v < positions.size(); ++v, src += vb.StrideBytes)
+                {
+                    if (quantized)
+                    {
+                        XMUSHORTN4 packed;
+                        memcpy(&packed, src, sizeof(packed));
+                        XMStoreFloat3(&positions[v], XMVectorMultiplyAdd(XMLoadUShortN4(&packed), scale, offset));
+                    }
+                    else
+                    {
+                        memcpy(&positions[v], src, sizeof(XMFLOAT3));
+                    }
+                }
+
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    struct MeshletReport
+    {
+        UINT subsets;
+        uint64_t meshlets;
+        uint64_t triangles;
+        uint64_t vertices;
+        uint64_t cones;         // meshlets whose normal cone can reject them
+
+        MeshletReport() noexcept : subsets(0), meshlets(0), triangles(0), vertices(0), cones(0) {}
+    };
+
+    //----------------------------------------------------------------------------------
+    // Bounding sphere (about the centre of the bounding box) and normal cone of a meshlet
+    //----------------------------------------------------------------------------------
+    void ComputeMeshletBounds(SDKMESH_MESHLET& meshlet, const uint32_t* vertexIndices, const uint32_t* primitives,
+        const std::vector<XMFLOAT3>& positions)
+    {
+        XMVECTOR vMin = XMLoadFloat3(&positions[vertexIndices[0]]);
+        XMVECTOR vMax = vMin;
+        for (UINT v = 1; v < meshlet.VertexCount; ++v)
+        {
+            XMVECTOR p = XMLoadFloat3(&positions[vertexIndices[v]]);
+            vMin = XMVectorMin(vMin, p);
+            vMax = XMVectorMax(vMax, p);
+        }
+
+        XMVECTOR center = XMVectorScale(XMVectorAdd(vMin, vMax), 0.5f);
+        XMVECTOR radius = g_XMZero;
+        for (UINT v = 0; v < meshlet.VertexCount; ++v)
+        {
+            radius = XMVectorMax(radius, XMVector3Length(XMVectorSubtract(XMLoadFloat3(&positions[vertexIndices[v]]), center)));
+        }
+
+        XMStoreFloat4(&meshlet.BoundingSphere, XMVectorSelect(radius, center, g_XMSelect1110));
+
+        // Clockwise triangles face along the cross product of their edges. Degenerate ones
+        // draw nothing, so they do not widen the cone.
+        std::vector<XMFLOAT3> normals;
+        normals.reserve(meshlet.PrimitiveCount);
+
+        XMVECTOR sum = g_XMZero;
+        for (UINT t = 0; t < meshlet.PrimitiveCount; ++t)
+        {
+            const uint32_t primitive = primitives[t];
+            XMVECTOR p0 = XMLoadFloat3(&positions[vertexIndices[primitive & 0x3FF]]);
+            XMVECTOR p1 = XMLoadFloat3(&positions[vertexIndices[(primitive >> 10) & 0x3FF]]);
+            XMVECTOR p2 = XMLoadFloat3(&positions[vertexIndices[(primitive >> 20) & 0x3FF]]);
+
+            XMVECTOR normal = XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+            if (XMVectorGetX(XMVector3LengthSq(normal)) <= 0.f)
+                continue;
+
+            normal = XMVector3Normalize(normal);
+            sum = XMVectorAdd(sum, normal);
+
+            normals.emplace_back();
+            XMStoreFloat3(&normals.back(), normal);
+        }
+
+        meshlet.ConeAxis = XMFLOAT3(0.f, 0.f, 0.f);
+        meshlet.ConeCutoff = 1.f;
+
+        if (normals.empty() || XMVectorGetX(XMVector3LengthSq(sum)) <= 0.f)
+            return;
+
+        XMVECTOR axis = XMVector3Normalize(sum);
+        float minDot = 1.f;
+        for (auto& it : normals)
+        {
+            minDot = std::min(minDot, XMVectorGetX(XMVector3Dot(XMLoadFloat3(&it), axis)));
+        }
+
+        // Normals more than 90 degrees apart can not all face away at once
+        if (minDot <= 0.f)
+            return;
+
+        XMStoreFloat3(&meshlet.ConeAxis, axis);
+        meshlet.ConeCutoff = sqrtf(1.f - minDot * minDot);
+    }
+
+    //----------------------------------------------------------------------------------
+    // Splits each triangle list subset into meshlets, taking its triangles in index order
+    // (so after vertex cache optimization, neighbouring triangles) until either limit is
+    // reached. Meshlet vertices are the subset's indices, so relative to VertexStart.
+    //----------------------------------------------------------------------------------
+    HRESULT BuildMeshlets(MeshFile& file, MeshletReport& report)
+    {
+        const UINT numSubsets = file.header->NumTotalSubsets;
+
+        file.subsetMeshlets.assign(numSubsets, SDKMESH_SUBSET_MESHLETS{});
+        file.meshlets.clear();
+        file.meshletVertexIndices.clear();
+        file.meshletPrimitives.clear();
+
+        std::vector<bool> done(numSubsets, false);
+        std::vector<uint32_t> indices;
+        std::vector<XMFLOAT3> positions;
+        std::vector<uint32_t> local;
+
+        for (UINT i = 0; i < file.header->NumMeshes; ++i)
+        {
+            auto& mesh = file.meshes[i];
+            auto& ib = file.ibs[mesh.IndexBuffer];
+
+            for (UINT j = 0; j < mesh.NumSubsets; ++j)
+            {
+                const UINT iSubset = file.MeshSubset(mesh, j);
+                if (done[iSubset])
+                    continue;
+                done[iSubset] = true;
+
+                auto& subset = file.subsets[iSubset];
+                if (subset.PrimitiveType != PT_TRIANGLE_LIST
+                    || subset.IndexCount < 3
+                    || subset.IndexStart > ib.NumIndices
+                    || subset.IndexCount > ib.NumIndices - subset.IndexStart)
+                    continue;
+
+                ReadIndices(file, mesh.IndexBuffer, IndexRange{ subset.IndexStart, subset.IndexCount - subset.IndexCount % 3 }, indices);
+
+                const uint64_t vertexCount = uint64_t(*std::max_element(indices.begin(), indices.end())) + 1;
+                if (!ReadSubsetPositions(file, mesh, iSubset, vertexCount, positions))
+                    continue;
+
+                // The tables are indexed with UINTs
+                if (file.meshletPrimitives.size() + indices.size() / 3 > UINT32_MAX
+                    || file.meshletVertexIndices.size() + indices.size() > UINT32_MAX)
+                    return HRESULT_FROM_WIN32(ERROR_FILE_TOO_LARGE);
+
+                auto& range = file.subsetMeshlets[iSubset];
+                range.FirstMeshlet = static_cast<UINT>(file.meshlets.size());
+
+                // Meshlet vertex of each subset vertex, for the meshlet being filled
+                local.assign(size_t(vertexCount), UINT32_MAX);
+
+                SDKMESH_MESHLET meshlet = {};
+                auto finish = [&]()
+                {
+                    ComputeMeshletBounds(meshlet,
+                        file.meshletVertexIndices.data() + meshlet.VertexOffset,
+                        file.meshletPrimitives.data() + meshlet.PrimitiveOffset, positions);
+
+                    if (meshlet.ConeCutoff < 1.f)
+                        ++report.cones;
+                    report.vertices += meshlet.VertexCount;
+                    report.triangles += meshlet.PrimitiveCount;
+
+                    for (UINT v = 0; v < meshlet.VertexCount; ++v)
+                    {
+                        local[file.meshletVertexIndices[meshlet.VertexOffset + v]] = UINT32_MAX;
+                    }
+
+                    file.meshlets.push_back(meshlet);
+                };
+
+                for (size_t t = 0; t < indices.size(); t += 3)
+                {
+                    const uint32_t a = indices[t];
+                    const uint32_t b = indices[t + 1];
+                    const uint32_t c = indices[t + 2];
+
+                    UINT newVertices = (local[a] == UINT32_MAX) ? 1u : 0u;
+                    if (local[b] == UINT32_MAX && b != a)
+                        ++newVertices;
+                    if (local[c] == UINT32_MAX && c != a && c != b)
+                        ++newVertices;
+
+                    if (meshlet.PrimitiveCount
+                        && (meshlet.VertexCount + newVertices > SDKMESH_MESHLET_MAX_VERTICES
+                            || meshlet.PrimitiveCount + 1 > SDKMESH_MESHLET_MAX_PRIMITIVES))
+                    {
+                        finish();
+                        meshlet = {};
+                    }
+
+                    if (!meshlet.PrimitiveCount)
+                    {
+                        meshlet.VertexOffset = static_cast<UINT>(file.meshletVertexIndices.size());
+                        meshlet.PrimitiveOffset = static_cast<UINT>(file.meshletPrimitives.size());
+                    }
+
+                    for (uint32_t v : { a, b, c })
+                    {
+                        if (local[v] == UINT32_MAX)
+                        {
+                            local[v] = meshlet.VertexCount++;
+                            file.meshletVertexIndices.push_back(v);
+                        }
+                    }
+
+                    file.meshletPrimitives.push_back(local[a] | (local[b] << 10) | (local[c] << 20));
+                    ++meshlet.PrimitiveCount;
+                }
+
+                finish();
+
+                range.NumMeshlets = static_cast<UINT>(file.meshlets.size()) - range.FirstMeshlet;
+                ++report.subsets;
+            }
+        }
+
+        if (file.meshlets.size() > UINT32_MAX)
+            return HRESULT_FROM_WIN32(ERROR_FILE_TOO_LARGE);
+
+        report.meshlets = file.meshlets.size();
+
+        // Nothing to write without any triangle lists
+        if (file.meshlets.empty())
+            file.subsetMeshlets.clear();
+
+        return S_OK;
+    }
+
+    //----------------------------------------------------------------------------------
+    // Lays the file out again once its vertex buffers have changed. The static part is
+    // kept after the header, followed by the tables of the header extension, then the
+    // vertex and index buffers, each 16-byte aligned. With encode, each vertex buffer is
+    // entropy coded if that makes it smaller.
+    //----------------------------------------------------------------------------------
+    HRESULT BuildMeshFile(const MeshFile& file, bool encode, std::vector<uint8_t>& output,
+        uint64_t& vertexBytesBefore, uint64_t& vertexBytesAfter)
+    {
+        auto& header = *file.header;
+        const UINT numVBs = header.NumVertexBuffers;
+        const UINT numIBs = header.NumIndexBuffers;
+
+        std::vector<std::vector<BYTE>> encoded(numVBs);
+        std::vector<SDKMESH_VERTEX_ENCODING> encoding(numVBs);
+        bool anyEncoded = false;
+
+        vertexBytesBefore = vertexBytesAfter = 0;
+
+        for (UINT i = 0; i < numVBs; ++i)
+        {
+            auto& vb = file.vbs[i];
+            vertexBytesBefore += vb.SizeBytes;
+
+            if (encode && vb.NumVertices && vb.NumVertices <= UINT32_MAX)
+            {
+                HRESULT hr = SDKMeshEncodeVertices(file.Vertices(i), vb.NumVertices, static_cast<UINT>(vb.StrideBytes),
+                    ENCODING_BLOCK_VERTICES, encoded[i]);
+                if (FAILED(hr))
+                    return hr;
+
+                if (encoded[i].size() < vb.SizeBytes)
+                {
+                    encoding[i].EncodedBytes = encoded[i].size();
+                    encoding[i].BlockVertices = ENCODING_BLOCK_VERTICES;
+                    encoding[i].NumBlocks = SDKMeshGetVertexBlockCount(vb.NumVertices, ENCODING_BLOCK_VERTICES);
+                    anyEncoded = true;
+                }
+            }
+
+            vertexBytesAfter += encoding[i].EncodedBytes ? encoding[i].EncodedBytes : vb.SizeBytes;
+        }
+
+        const bool quantized = !file.quantization.empty();
+        const bool meshlets = !file.subsetMeshlets.empty();
+        const bool extended = quantized || anyEncoded || meshlets;
+
+        // Everything after the header and its extension is kept, including any stream
+        // headers that older files count in HeaderSize
+        const uint64_t oldBodyStart = sizeof(SDKMESH_HEADER)
+            + ((header.Version == SDKMESH_FILE_VERSION_EXTENDED) ? sizeof(SDKMESH_HEADER_EXTENSION) : 0);
+        const uint64_t bodyStart = sizeof(SDKMESH_HEADER) + (extended ? sizeof(SDKMESH_HEADER_EXTENSION) : 0);
+        const uint64_t bodySize = file.bodyEnd - oldBodyStart;
+        const uint64_t headerSize = header.HeaderSize - oldBodyStart + bodyStart;
+
+        uint64_t staticSize = bodyStart + bodySize;
+
+        const uint64_t quantizationOffset = AlignUp(staticSize, 8);
+        if (quantized)
+            staticSize = quantizationOffset + sizeof(SDKMESH_VERTEX_QUANTIZATION) * uint64_t(header.NumTotalSubsets);
+
+        const uint64_t encodingOffset = AlignUp(staticSize, 8);
+        if (anyEncoded)
+            staticSize = encodingOffset + sizeof(SDKMESH_VERTEX_ENCODING) * uint64_t(numVBs);
+
+        SDKMESH_MESHLET_HEADER meshletHeader = {};
+        const uint64_t meshletOffset = AlignUp(staticSize, 8);
+        if (meshlets)
+        {
+            meshletHeader.NumMeshlets = static_cast<UINT>(file.meshlets.size());
+            meshletHeader.NumVertexIndices = static_cast<UINT>(file.meshletVertexIndices.size());
+            meshletHeader.NumPrimitives = static_cast<UINT>(file.meshletPrimitives.size());
+
+            meshletHeader.SubsetMeshletsOffset = AlignUp(meshletOffset + sizeof(SDKMESH_MESHLET_HEADER), 8);
+            meshletHeader.MeshletDataOffset = AlignUp(meshletHeader.SubsetMeshletsOffset + sizeof(SDKMESH_SUBSET_MESHLETS) * file.subsetMeshlets.size(), 16);
+            meshletHeader.VertexIndexOffset = meshletHeader.MeshletDataOffset + sizeof(SDKMESH_MESHLET) * file.meshlets.size();
+            meshletHeader.PrimitiveOffset = AlignUp(meshletHeader.VertexIndexOffset + sizeof(uint32_t) * file.meshletVertexIndices.size(), 8);
+            staticSize = meshletHeader.PrimitiveOffset + sizeof(uint32_t) * file.meshletPrimitives.size();
+        }
+
+        staticSize = AlignUp(staticSize, 16);
+
+        uint64_t totalSize = staticSize;
+        std::vector<uint64_t> vbOffsets(numVBs);
+        for (UINT i = 0; i < numVBs; ++i)
+        {
+            vbOffsets[i] = totalSize;
+            totalSize = AlignUp(totalSize + (encoding[i].EncodedBytes ? encoding[i].EncodedBytes : file.vbs[i].SizeBytes), 16);
+        }
+
+        std::vector<uint64_t> ibOffsets(numIBs);
+        for (UINT i = 0; i < numIBs; ++i)
+        {
+            ibOffsets[i] = totalSize;
+            totalSize = AlignUp(totalSize + file.ibs[i].SizeBytes, 16);
+        }
+
+        if (totalSize > UINT32_MAX)
+            return HRESULT_FROM_WIN32(ERROR_FILE_TOO_LARGE);
+
+        output.assign(size_t(totalSize), 0);
+        uint8_t* dest = output.data();
+
+        memcpy(dest, &header, sizeof(SDKMESH_HEADER));
+        memcpy(dest + bodyStart, file.data.get() + oldBodyStart, size_t(bodySize));
+
+        auto newHeader = reinterpret_cast<SDKMESH_HEADER*>(dest);
+        newHeader->Version = extended ? SDKMESH_FILE_VERSION_EXTENDED : SDKMESH_FILE_VERSION;
+        newHeader->HeaderSize = headerSize;
+        newHeader->NonBufferDataSize = staticSize - headerSize;
+        newHeader->BufferDataSize = totalSize - staticSize;
+
+        // Offsets into the static part move with it
+        auto relocate = [&](UINT64& offset) noexcept
+        {
+            if (offset >= oldBodyStart)
+                offset = offset - oldBodyStart + bodyStart;
+        };
+
+        relocate(newHeader->VertexStreamHeadersOffset);
+        relocate(newHeader->IndexStreamHeadersOffset);
+        relocate(newHeader->MeshDataOffset);
+        relocate(newHeader->SubsetDataOffset);
+        relocate(newHeader->FrameDataOffset);
+        relocate(newHeader->MaterialDataOffset);
+
+        auto meshes = reinterpret_cast<SDKMESH_MESH*>(dest + newHeader->MeshDataOffset);
+        for (UINT i = 0; i < header.NumMeshes; ++i)
+        {
+            relocate(meshes[i].SubsetOffset);
+            relocate(meshes[i].FrameInfluenceOffset);
+        }
+
+        auto vbs = reinterpret_cast<SDKMESH_VERTEX_BUFFER_HEADER*>(dest + newHeader->VertexStreamHeadersOffset);
+        for (UINT i = 0; i < numVBs; ++i)
+        {
+            vbs[i].DataOffset = vbOffsets[i];
+
+            if (encoding[i].EncodedBytes)
+            {
+                // The loader decodes exactly the vertices, so any padding after them is dropped
+                vbs[i].SizeBytes = vbs[i].NumVertices * vbs[i].StrideBytes;
+                memcpy(dest + vbOffsets[i], encoded[i].data(), encoded[i].size());
+            }
+            else
+            {
+                memcpy(dest + vbOffsets[i], file.Vertices(i), size_t(vbs[i].SizeBytes));
+            }
+        }
+
+        auto ibs = reinterpret_cast<SDKMESH_INDEX_BUFFER_HEADER*>(dest + newHeader->IndexStreamHeadersOffset);
+        for (UINT i = 0; i < numIBs; ++i)
+        {
+            ibs[i].DataOffset = ibOffsets[i];
+            memcpy(dest + ibOffsets[i], file.Indices(i), size_t(ibs[i].SizeBytes));
+        }
+
+        if (extended)
+        {
+            SDKMESH_HEADER_EXTENSION extension = {};
+
+            if (quantized)
+            {
+                extension.Flags |= SDKMESH_QUANTIZED_VERTICES;
+                extension.VertexQuantizationOffset = quantizationOffset;
+                memcpy(dest + quantizationOffset, file.quantization.data(), sizeof(SDKMESH_VERTEX_QUANTIZATION) * file.quantization.size());
+            }
+
+            if (anyEncoded)
+            {
+                extension.Flags |= SDKMESH_ENCODED_VERTICES;
+                extension.VertexEncodingOffset = encodingOffset;
+                memcpy(dest + encodingOffset, encoding.data(), sizeof(SDKMESH_VERTEX_ENCODING) * encoding.size());
+            }
+
+            if (meshlets)
+            {
+                extension.Flags |= SDKMESH_MESHLETS;
+                extension.MeshletOffset = meshletOffset;
+                memcpy(dest + meshletOffset, &meshletHeader, sizeof(meshletHeader));
+                memcpy(dest + meshletHeader.SubsetMeshletsOffset, file.subsetMeshlets.data(), sizeof(SDKMESH_SUBSET_MESHLETS) * file.subsetMeshlets.size());
+                memcpy(dest + meshletHeader.MeshletDataOffset, file.meshlets.data(), sizeof(SDKMESH_MESHLET) * file.meshlets.size());
+                memcpy(dest + meshletHeader.VertexIndexOffset, file.meshletVertexIndices.data(), sizeof(uint32_t) * file.meshletVertexIndices.size());
+                memcpy(dest + meshletHeader.PrimitiveOffset, file.meshletPrimitives.data(), sizeof(uint32_t) * file.meshletPrimitives.size());
+            }
+
+            memcpy(dest + sizeof(SDKMESH_HEADER), &extension, sizeof(extension));
+        }
+
+        return S_OK;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+
+enum OPTIONS : uint32_t
+{
+    OPT_OUTPUTFILE = 1,
+    OPT_OVERWRITE,
+    OPT_NOLOGO,
+    OPT_CACHESIZE,
+    OPT_NOOVERDRAW,
+    OPT_OVERDRAW_THRESHOLD,
+    OPT_NOFETCH,
+    OPT_ANALYZE,
+    OPT_QUANTIZE,
+    OPT_ENCODE,
+    OPT_MESHLETS,
+    OPT_MAX
+};
+
+static_assert(OPT_MAX <= 32, "dwOptions is a unsigned int bitfield");
+
+struct SValue
+{
+    const wchar_t*  name;
+    uint32_t        value;
+};
+
+const SValue g_pOptions[] =
+{
+    { L"o",         OPT_OUTPUTFILE },
+    { L"y",         OPT_OVERWRITE },
+    { L"nologo",    OPT_NOLOGO },
+    { L"c",         OPT_CACHESIZE },
+    { L"nd",        OPT_NOOVERDRAW },
+    { L"t",         OPT_OVERDRAW_THRESHOLD },
+    { L"nf",        OPT_NOFETCH },
+    { L"a",         OPT_ANALYZE },
+    { L"q",         OPT_QUANTIZE },
+    { L"z",         OPT_ENCODE },
+    { L"m",         OPT_MESHLETS },
+    { nullptr,      0 }
+};
+
+//////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+#ifdef _PREFAST_
+#pragma prefast(disable : 26018, "Only used with static internal arrays")
+#endif
+
+    uint32_t LookupByName(const wchar_t *pName, const SValue *pArray)
+    {
+        while (pArray->name)
+        {
+            if (!_wcsicmp(pName, pArray->name))
+                return pArray->value;
+
+            pArray++;
+        }
+
+        return 0;
+    }
+
+    void PrintLogo()
+    {
+        wprintf(L"Microsoft (R) SDKMESH Optimizer Tool\n");
+        wprintf(L"Copyright (C) Microsoft Corporation.\n");
+#ifdef _DEBUG
+        wprintf(L"*** Debug build ***\n");
+#endif
+        wprintf(L"\n");
+    }
+
+    void PrintUsage()
+    {
+        PrintLogo();
+
+        wprintf(L"Usage: sdkmeshtool <options> <sdkmesh-file>\n");
+        wprintf(L"\n");
+        wprintf(L"   -o <filename>       output filename\n");
+        wprintf(L"   -y                  overwrite existing output file (if any)\n");
+        wprintf(L"   -nologo             suppress copyright message\n");
+        wprintf(L"   -a                  analyze only, no output file is written\n");
+        wprintf(L"   -c <entries>        post-transform vertex cache size (defaults to %u)\n", DEFAULT_CACHE_SIZE);
+        wprintf(L"   -nd                 do not reorder for overdraw\n");
+        wprintf(L"   -t <ratio>          ACMR increase allowed by overdraw reordering (defaults to %.2f)\n", double(DEFAULT_OVERDRAW_THRESHOLD));
+        wprintf(L"   -nf                 do not reorder vertices for fetch\n");
+        wprintf(L"   -q                  quantize positions, normals and texture coordinates\n");
+        wprintf(L"   -z                  entropy code vertex buffers\n");
+        wprintf(L"   -m                  build meshlets for cluster culling\n");
+    }
+
+    const wchar_t* GetErrorDesc(HRESULT hr)
+    {
+        static wchar_t desc[1024] = {};
+
+        LPWSTR errorText = nullptr;
+
+        DWORD result = FormatMessageW(FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS | FORMAT_MESSAGE_ALLOCATE_BUFFER,
+            nullptr, static_cast<DWORD>(hr),
+            MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT), reinterpret_cast<LPWSTR>(&errorText), 0, nullptr);
+
+        *desc = 0;
+
+        if (result > 0 && errorText)
+        {
+            swprintf_s(desc, L": %ls", errorText);
+
+            size_t len = wcslen(desc);
+            if (len >= 2)
+            {
+                desc[len - 2] = 0;
+                desc[len - 1] = 0;
+            }
+
+            if (errorText)
+                LocalFree(errorText);
+        }
+
+        return desc;
+    }
+
+    void PrintReport(const wchar_t* name, const MeshReport& report, bool optimize)
+    {
+        if (optimize)
+        {
+            wprintf(L"%ls: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f",
+                name,
+                report.before.ACMR(), report.after.ACMR(),
+                report.before.ATVR(), report.after.ATVR());
+        }
+        else
+        {
+            wprintf(L"%ls: ACMR %.3f, ATVR %.3f", name, report.before.ACMR(), report.before.ATVR());
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+
+//--------------------------------------------------------------------------------------
+// Entry-point
+//--------------------------------------------------------------------------------------
+#ifdef _PREFAST_
+#pragma prefast(disable : 28198, "Command-line tool, frees all memory on exit")
+#endif
+
+int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
+{
+    // Parameters and defaults
+    wchar_t szInputFile[MAX_PATH] = {};
+    wchar_t szOutputFile[MAX_PATH] = {};
+
+    Settings settings = {};
+    settings.cacheSize = DEFAULT_CACHE_SIZE;
+    settings.overdrawThreshold = DEFAULT_OVERDRAW_THRESHOLD;
+
+    // Set locale for output since GetErrorDesc can get localized strings.
+    std::locale::global(std::locale(""));
+
+    // Process command line
+    uint32_t dwOptions = 0;
+
+    for (int iArg = 1; iArg < argc; iArg++)
+    {
+        PWSTR pArg = argv[iArg];
+
+        if (('-' == pArg[0]) || ('/' == pArg[0]))
+        {
+            pArg++;
+            PWSTR pValue;
+
+            for (pValue = pArg; *pValue && (':' != *pValue); pValue++);
+
+            if (*pValue)
+                *pValue++ = 0;
+
+            uint32_t dwOption = LookupByName(pArg, g_pOptions);
+
+            if (!dwOption || (dwOptions & (1 << dwOption)))
+            {
+                PrintUsage();
+                return 1;
+            }
+
+            dwOptions |= 1 << dwOption;
+
+            // Handle options with additional value parameter
+            switch (dwOption)
+            {
+            case OPT_OUTPUTFILE:
+            case OPT_CACHESIZE:
+            case OPT_OVERDRAW_THRESHOLD:
+                if (!*pValue)
+                {
+                    if ((iArg + 1 >= argc))
+                    {
+                        PrintUsage();
+                        return 1;
+                    }
+
+                    iArg++;
+                    pValue = argv[iArg];
+                }
+                break;
+            }
+
+            switch (dwOption)
+            {
+            case OPT_OUTPUTFILE:
+                wcscpy_s(szOutputFile, MAX_PATH, pValue);
+                break;
+
+            case OPT_CACHESIZE:
+                if (swscanf_s(pValue, L"%u", &settings.cacheSize) != 1
+                    || settings.cacheSize < 3 || settings.cacheSize > MAX_CACHE_SIZE)
+                {
+                    wprintf(L"Invalid value specified with -c (%ls), must be 3 to %u\n", pValue, MAX_CACHE_SIZE);
+                    return 1;
+                }
+                break;
+
+            case OPT_OVERDRAW_THRESHOLD:
+                if (swscanf_s(pValue, L"%f", &settings.overdrawThreshold) != 1
+                    || settings.overdrawThreshold < 1.f || settings.overdrawThreshold > 3.f)
+                {
+                    wprintf(L"Invalid value specified with -t (%ls), must be 1 to 3\n", pValue);
+                    return 1;
+                }
+                break;
+            }
+        }
+        else if (!*szInputFile)
+        {
+            wcscpy_s(szInputFile, MAX_PATH, pArg);
+        }
+        else
+        {
+            wprintf(L"ERROR: Only one sdkmesh file can be optimized at a time\n\n");
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (!*szInputFile)
+    {
+        wprintf(L"ERROR: Need an sdkmesh file to optimize\n\n");
+        PrintUsage();
+        return 0;
+    }
+
+    settings.optimize = (dwOptions & (1 << OPT_ANALYZE)) == 0;
+    settings.overdraw = (dwOptions & (1 << OPT_NOOVERDRAW)) == 0;
+    settings.fetch = (dwOptions & (1 << OPT_NOFETCH)) == 0;
+    settings.quantize = (dwOptions & (1 << OPT_QUANTIZE)) != 0;
+    settings.encode = (dwOptions & (1 << OPT_ENCODE)) != 0;
+    settings.meshlets = (dwOptions & (1 << OPT_MESHLETS)) != 0;
+
+    if (~dwOptions & (1 << OPT_NOLOGO))
+        PrintLogo();
+
+    if (settings.optimize)
+    {
+        if (!*szOutputFile)
+        {
+            wprintf(L"ERROR: Need to specify output file via -o\n");
+            return 1;
+        }
+
+        if (~dwOptions & (1 << OPT_OVERWRITE))
+        {
+            if (GetFileAttributesW(szOutputFile) != INVALID_FILE_ATTRIBUTES)
+            {
+                wprintf(L"ERROR: Output file %ls already exists, use -y to overwrite!\n", szOutputFile);
+                return 1;
+            }
+        }
+    }
+
+    // Load mesh
+    wprintf(L"reading %ls", szInputFile);
+    fflush(stdout);
+
+    MeshFile file;
+    HRESULT hr = ReadMeshFile(szInputFile, file);
+    if (FAILED(hr))
+    {
+        wprintf(L"\nERROR: Failed to load file (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
+        return 1;
+    }
+
+    wprintf(L" (%u meshes, %u subsets, %u vertex buffers, %u index buffers)\n",
+        file.header->NumMeshes, file.header->NumTotalSubsets, file.header->NumVertexBuffers, file.header->NumIndexBuffers);
+
+    // Count the meshes that use each buffer, since shared buffers can not have their vertices reordered
+    std::vector<UINT> vbUsers(file.header->NumVertexBuffers, 0);
+    std::vector<UINT> ibUsers(file.header->NumIndexBuffers, 0);
+    for (UINT i = 0; i < file.header->NumMeshes; ++i)
+    {
+        auto& mesh = file.meshes[i];
+        ++ibUsers[mesh.IndexBuffer];
+        for (UINT s = 0; s < mesh.NumVertexBuffers; ++s)
+        {
+            ++vbUsers[mesh.VertexBuffers[s]];
+        }
+    }
+
+    auto overlapping = FindOverlappingRanges(file);
+
+    wprintf(L"FIFO vertex cache of %u entries\n", settings.cacheSize);
+
+    MeshReport total;
+    for (UINT i = 0; i < file.header->NumMeshes; ++i)
+    {
+        MeshReport report;
+        ProcessMesh(file, i, settings, overlapping, report);
+
+        if (settings.optimize && settings.fetch)
+            report.fetchResult = OptimizeVertexFetch(file, i, vbUsers, ibUsers, overlapping);
+
+        wchar_t name[MAX_MESH_NAME + 16] = {};
+        swprintf_s(name, L"mesh %u '%.*hs'", i, MAX_MESH_NAME, file.meshes[i].Name);
+
+        wprintf(L"    ");
+        PrintReport(name, report, settings.optimize);
+        if (report.subsetsSkipped)
+            wprintf(L", %u subsets skipped (overlapping index ranges)", report.subsetsSkipped);
+        if (*report.fetchResult)
+            wprintf(L", %ls", report.fetchResult);
+        wprintf(L"\n");
+
+        total.before.Add(report.before);
+        total.after.Add(report.after);
+    }
+
+    PrintReport(L"total", total, settings.optimize);
+    wprintf(L" (%llu triangles)\n", total.before.triangles);
+
+    if (!settings.optimize)
+        return 0;
+
+    if (settings.quantize)
+    {
+        QuantizeReport quantizeReport;
+        hr = QuantizeVertices(file, quantizeReport);
+        if (FAILED(hr))
+        {
+            wprintf(L"ERROR: Failed quantizing vertices (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
+            return 1;
+        }
+
+        wprintf(L"quantized %u vertex buffers (%llu -> %llu bytes), max error: position %g, normal %.3f degrees, texcoord %g\n",
+            quantizeReport.buffers, quantizeReport.bytesBefore, quantizeReport.bytesAfter,
+            double(quantizeReport.positionError), double(quantizeReport.normalError), double(quantizeReport.texcoordError));
+    }
+
+    // Meshlets of the input index triangles that may since have moved, so they are rebuilt
+    if (settings.meshlets || file.inputMeshlets)
+    {
+        MeshletReport meshletReport;
+        hr = BuildMeshlets(file, meshletReport);
+        if (FAILED(hr))
+        {
+            wprintf(L"ERROR: Failed building meshlets (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
+            return 1;
+        }
+
+        if (meshletReport.meshlets)
+        {
+            wprintf(L"built %llu meshlets for %u subsets (%.1f vertices, %.1f triangles each, %.1f%% with a normal cone)\n",
+                meshletReport.meshlets, meshletReport.subsets,
+                double(meshletReport.vertices) / double(meshletReport.meshlets),
+                double(meshletReport.triangles) / double(meshletReport.meshlets),
+                100.0 * double(meshletReport.cones) / double(meshletReport.meshlets));
+        }
+        else
+        {
+            wprintf(L"no triangle list subsets with positions to build meshlets for\n");
+        }
+    }
+
+    // Vertex buffers that change size, and new extension tables, need the file laid out again
+    const uint8_t* pOutput = file.data.get();
+    size_t outputSize = file.size;
+
+    std::vector<uint8_t> rebuilt;
+    if (settings.quantize || settings.encode || file.encoded || settings.meshlets || file.inputMeshlets)
+    {
+        uint64_t vertexBytesBefore = 0;
+        uint64_t vertexBytesAfter = 0;
+        hr = BuildMeshFile(file, settings.encode, rebuilt, vertexBytesBefore, vertexBytesAfter);
+        if (FAILED(hr))
+        {
+            wprintf(L"ERROR: Failed building output file (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
+            return 1;
+        }
+
+        if (settings.encode)
+            wprintf(L"entropy coded vertex buffers (%llu -> %llu bytes)\n", vertexBytesBefore, vertexBytesAfter);
+
+        pOutput = rebuilt.data();
+        outputSize = rebuilt.size();
+    }
+
+    // Write optimized mesh
+    wprintf(L"writing %ls (%llu -> %llu bytes)\n", szOutputFile, uint64_t(file.size), uint64_t(outputSize));
+    fflush(stdout);
+
+    ScopedHandle hFile(safe_handle(CreateFileW(
+        szOutputFile,
+        GENERIC_WRITE, 0,
+        nullptr,
+        CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL,
+        nullptr)));
+    if (!hFile)
+    {
+        wprintf(L"ERROR: Failed opening output file %ls, %lu\n", szOutputFile, GetLastError());
+        return 1;
+    }
+
+    DWORD bytesWritten = 0;
+    if (!WriteFile(hFile.get(), pOutput, static_cast<DWORD>(outputSize), &bytesWritten, nullptr)
+        || bytesWritten != outputSize)
+    {
+        wprintf(L"ERROR: Failed writing output file %ls, %lu\n", szOutputFile, GetLastError());
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,598 @@
+//--------------------------------------------------------------------------------------
+// File: WaveBankLossless.cpp
+//
+// Lossless compression for 16-bit PCM wave bank entries
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+// http://go.microsoft.com/fwlink/?LinkID=615561
+//-------------------------------------------------------------------------------------
+
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#include <cassert>
+
+#include "WaveBankLossless.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <new>
+
+#if defined(_M_IX86) || defined(_M_X64)
+#include <emmintrin.h>
+#include <intrin.h>
+#define LOSSLESS_USE_SSE2
+#endif
+
+#ifndef MAKEFOURCC
+#define MAKEFOURCC(ch0, ch1, ch2, ch3) \
+                (static_cast<uint32_t>(static_cast<uint8_t>(ch0)) \
+                | (static_cast<uint32_t>(static_cast<uint8_t>(ch1)) << 8) \
+                | (static_cast<uint32_t>(static_cast<uint8_t>(ch2)) << 16) \
+                | (static_cast<uint32_t>(static_cast<uint8_t>(ch3)) << 24))
+#endif /* defined(MAKEFOURCC) */
+
+using namespace DirectX;
+
+namespace
+{
+#pragma pack(push, 1)
+
+    // Entry payload layout:
+    //
+    //  LOSSLESSHEADER
+    //  uint32_t chunkOffsets[dwChunkCount + 1]    (relative to the start of the payload)
+    //  chunk data
+    //
+    // Each chunk holds, for every channel in turn:
+    //
+    //  uint8_t  predictor order (0 - 4)
+    //  uint8_t  Rice parameter
+    //  int32_t  residuals[order]                  (verbatim)
+    //  Rice coded residuals for the remaining frames, padded to a byte boundary
+    //
+    struct LOSSLESSHEADER
+    {
+        static constexpr uint32_t SIGNATURE = MAKEFOURCC('W', 'B', 'L', 'C');
+
+        uint32_t    dwSignature;
+        uint16_t    wChannels;
+        uint16_t    wFramesPerChunk;
+        uint32_t    dwTotalFrames;
+        uint32_t    dwChunkCount;
+    };
+
+#pragma pack(pop)
+
+    static_assert(sizeof(LOSSLESSHEADER) == 16, "Lossless header size mismatch");
+
+    constexpr uint32_t MAX_ORDER = 4;
+    constexpr uint32_t MAX_RICE_PARAM = 30;
+
+    // Quotients of this size or larger are written as an escape code followed by the raw value
+    constexpr uint32_t RICE_ESCAPE = 32;
+
+    inline uint32_t ZigZag(int32_t v) noexcept
+    {
+        return (static_cast<uint32_t>(v) << 1) ^ static_cast<uint32_t>(v >> 31);
+    }
+
+    inline int32_t UnZigZag(uint32_t u) noexcept
+    {
+        return static_cast<int32_t>((u >> 1) ^ (0u - (u & 1)));
+    }
+
+    inline uint32_t CountLeadingZeros64(uint64_t v) noexcept
+    {
+        assert(v != 0);
+    #if defined(_M_X64)
+        unsigned long index;
+        _BitScanReverse64(&index, v);
+        return 63u - index;
+    #elif defined(_MSC_VER)
+        unsigned long index;
+        if (_BitScanReverse(&index, static_cast<unsigned long>(v >> 32)))
+            return 31u - index;
+        _BitScanReverse(&index, static_cast<unsigned long>(v));
+        return 63u - index;
+    #else
+        return static_cast<uint32_t>(__builtin_clzll(v));
+    #endif
+    }
+
+    //----------------------------------------------------------------------------------
+    // MSB-first bit stream writer
+    //----------------------------------------------------------------------------------
+    class BitWriter
+    {
+    public:
+        explicit BitWriter(std::vector<uint8_t>& output) noexcept :
+            m_output(output),
+            m_cache(0),
+            m_count(0)
+        {
+        }
+
+        void Write(uint32_t value, uint32_t bits)
+        {
+            assert(bits <= 32);
+            if (!bits)
+                return;
+
+            m_cache = (m_cache << bits) | (uint64_t(value) & ((uint64_t(1) << bits) - 1));
+            m_count += bits;
+
+            while (m_count >= 8)
+            {
+                m_count -= 8;
+                m_output.push_back(static_cast<uint8_t>(m_cache >> m_count));
+            }
+        }
+
+        void Flush()
+        {
+            if (m_count > 0)
+            {
+                m_output.push_back(static_cast<uint8_t>(m_cache << (8 - m_count)));
+                m_count = 0;
+            }
+            m_cache = 0;
+        }
+
+    private:
+        std::vector<uint8_t>&   m_output;
+        uint64_t                m_cache;
+        uint32_t                m_count;
+    };
+
+    //----------------------------------------------------------------------------------
+    // MSB-first bit stream reader. Reads past the end return zero bits, so a corrupt
+    // stream produces garbage samples rather than an out-of-bounds access.
+    //----------------------------------------------------------------------------------
+    class BitReader
+    {
+    public:
+        BitReader(const uint8_t* ptr, const uint8_t* end) noexcept :
+            m_start(ptr),
+            m_ptr(ptr),
+            m_end(end),
+            m_cache(0),
+            m_count(0)
+        {
+        }
+
+        uint32_t ReadBits(uint32_t bits) noexcept
+        {
+            assert(bits <= 32);
+            if (!bits)
+                return 0;
+
+            Refill();
+            const auto result = static_cast<uint32_t>(m_cache >> (64 - bits));
+            m_cache <<= bits;
+            m_count -= bits;
+            return result;
+        }
+
+        uint32_t ReadRice(uint32_t k) noexcept
+        {
+            Refill();
+
+            uint32_t zeros = (m_cache) ? CountLeadingZeros64(m_cache) : 64u;
+            if (zeros >= RICE_ESCAPE)
+            {
+                m_cache <<= RICE_ESCAPE;
+                m_count -= RICE_ESCAPE;
+                return ReadBits(32);
+            }
+
+            m_cache <<= (zeros + 1);
+            m_count -= (zeros + 1);
+
+            return (zeros << k) | ReadBits(k);
+        }
+
+        // Bytes consumed so far, rounded up to a whole byte
+        size_t BytesConsumed() const noexcept
+        {
+            const size_t bits = size_t(m_ptr - m_start) * 8 - m_count;
+            return (bits + 7) / 8;
+        }
+
+    private:
+        void Refill() noexcept
+        {
+            while (m_count <= 56)
+            {
+                const uint64_t b = (m_ptr < m_end) ? *m_ptr : 0;
+                ++m_ptr;
+                m_cache |= b << (56 - m_count);
+                m_count += 8;
+            }
+        }
+
+        const uint8_t*  m_start;
+        const uint8_t*  m_ptr;
+        const uint8_t*  m_end;
+        uint64_t        m_cache;
+        uint32_t        m_count;
+    };
+
+    //----------------------------------------------------------------------------------
+    // In-place inclusive prefix sum (modulo 2^32). A predictor of order N is undone by
+    // applying this N times.
+    //----------------------------------------------------------------------------------
+    void PrefixSum(int32_t* data, size_t count) noexcept
+    {
+        size_t j = 0;
+
+    #ifdef LOSSLESS_USE_SSE2
+        __m128i carry = _mm_setzero_si128();
+        for (; j + 4 <= count; j += 4)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + j));
+            v = _mm_add_epi32(v, _mm_slli_si128(v, 4));
+            v = _mm_add_epi32(v, _mm_slli_si128(v, 8));
+            v = _mm_add_epi32(v, carry);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(data + j), v);
+            carry = _mm_shuffle_epi32(v, _MM_SHUFFLE(3, 3, 3, 3));
+        }
+        uint32_t sum = static_cast<uint32_t>(_mm_cvtsi128_si32(carry));
+    #else
+        uint32_t sum = 0;
+    #endif
+
+        for (; j < count; ++j)
+        {
+            sum += static_cast<uint32_t>(data[j]);
+            data[j] = static_cast<int32_t>(sum);
+        }
+    }
+
+    // Copies one decoded channel into an interleaved 16-bit destination
+    void StoreChannel(const int32_t* src, size_t count, int16_t* dest, uint32_t stride) noexcept
+    {
+        if (stride == 1)
+        {
+            size_t j = 0;
+        #ifdef LOSSLESS_USE_SSE2
+            for (; j + 8 <= count; j += 8)
+            {
+                const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + j));
+                const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + j + 4));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + j), _mm_packs_epi32(a, b));
+            }
+        #endif
+            for (; j < count; ++j)
+            {
+                dest[j] = static_cast<int16_t>(src[j]);
+            }
+        }
+        else
+        {
+            for (size_t j = 0; j < count; ++j)
+            {
+                dest[j * stride] = static_cast<int16_t>(src[j]);
+            }
+        }
+    }
+
+    uint64_t RiceCost(const uint32_t* values, size_t count, uint32_t k) noexcept
+    {
+        uint64_t bits = 0;
+        for (size_t j = 0; j < count; ++j)
+        {
+            const uint32_t q = values[j] >> k;
+            bits += (q < RICE_ESCAPE) ? (uint64_t(q) + 1 + k) : uint64_t(RICE_ESCAPE + 32);
+        }
+        return bits;
+    }
+
+    void EncodeChannel(const int32_t* samples, uint32_t count, std::vector<uint8_t>& output)
+    {
+        // Build residuals for every predictor order (zero initial state)
+        std::vector<int32_t> residuals[MAX_ORDER + 1];
+        residuals[0].assign(samples, samples + count);
+        for (uint32_t order = 1; order <= MAX_ORDER; ++order)
+        {
+            auto& prev = residuals[order - 1];
+            auto& cur = residuals[order];
+            cur.resize(count);
+            int32_t last = 0;
+            for (uint32_t j = 0; j < count; ++j)
+            {
+                cur[j] = static_cast<int32_t>(static_cast<uint32_t>(prev[j]) - static_cast<uint32_t>(last));
+                last = prev[j];
+            }
+        }
+
+        // Pick the predictor order and Rice parameter with the smallest output
+        std::vector<uint32_t> zz(count);
+
+        uint32_t bestOrder = 0;
+        uint32_t bestK = 0;
+        uint64_t bestBits = UINT64_MAX;
+        for (uint32_t order = 0; order <= MAX_ORDER && order <= count; ++order)
+        {
+            const uint32_t riceCount = count - order;
+            uint64_t sum = 0;
+            for (uint32_t j = 0; j < riceCount; ++j)
+            {
+                zz[j] = ZigZag(residuals[order][order + j]);
+                sum += zz[j];
+            }
+
+            uint32_t k0 = 0;
+            if (riceCount > 0)
+            {
+                const uint64_t mean = sum / riceCount;
+                while (k0 < MAX_RICE_PARAM && (uint64_t(1) << (k0 + 1)) <= mean)
+                    ++k0;
+            }
+
+            const uint32_t kmin = (k0 > 0) ? k0 - 1 : 0;
+            const uint32_t kmax = std::min(k0 + 1, MAX_RICE_PARAM);
+            for (uint32_t k = kmin; k <= kmax; ++k)
+            {
+                const uint64_t bits = uint64_t(order) * 32 + RiceCost(zz.data(), riceCount, k);
+                if (bits < bestBits)
+                {
+                    bestBits = bits;
+                    bestOrder = order;
+                    bestK = k;
+                }
+            }
+        }
+
+        output.push_back(static_cast<uint8_t>(bestOrder));
+        output.push_back(static_cast<uint8_t>(bestK));
+
+        const auto& res = residuals[bestOrder];
+        for (uint32_t j = 0; j < bestOrder; ++j)
+        {
+            const auto v = static_cast<uint32_t>(res[j]);
+            output.push_back(static_cast<uint8_t>(v));
+            output.push_back(static_cast<uint8_t>(v >> 8));
+            output.push_back(static_cast<uint8_t>(v >> 16));
+            output.push_back(static_cast<uint8_t>(v >> 24));
+        }
+
+        BitWriter writer(output);
+        for (uint32_t j = bestOrder; j < count; ++j)
+        {
+            const uint32_t u = ZigZag(res[j]);
+            const uint32_t q = u >> bestK;
+            if (q < RICE_ESCAPE)
+            {
+                writer.Write(0, q);
+                writer.Write(1, 1);
+                writer.Write(u, bestK);
+            }
+            else
+            {
+                writer.Write(0, RICE_ESCAPE);
+                writer.Write(u, 32);
+            }
+        }
+        writer.Flush();
+    }
+
+    // Decodes one chunk into per-channel planes of LOSSLESS_FRAMES_PER_CHUNK samples
+    bool DecodeChunk(const uint8_t* ptr, const uint8_t* end, uint32_t channels, uint32_t frames, int32_t* planes) noexcept
+    {
+        for (uint32_t ch = 0; ch < channels; ++ch)
+        {
+            int32_t* out = planes + size_t(ch) * LOSSLESS_FRAMES_PER_CHUNK;
+
+            if ((end - ptr) < 2)
+                return false;
+
+            const uint32_t order = ptr[0];
+            const uint32_t k = ptr[1];
+            ptr += 2;
+
+            if (order > MAX_ORDER || order > frames || k > MAX_RICE_PARAM)
+                return false;
+
+            if (size_t(end - ptr) < size_t(order) * sizeof(int32_t))
+                return false;
+
+            for (uint32_t j = 0; j < order; ++j, ptr += 4)
+            {
+                out[j] = static_cast<int32_t>(uint32_t(ptr[0])
+                    | (uint32_t(ptr[1]) << 8)
+                    | (uint32_t(ptr[2]) << 16)
+                    | (uint32_t(ptr[3]) << 24));
+            }
+
+            BitReader reader(ptr, end);
+            for (uint32_t j = order; j < frames; ++j)
+            {
+                out[j] = UnZigZag(reader.ReadRice(k));
+            }
+
+            const size_t consumed = reader.BytesConsumed();
+            if (consumed > size_t(end - ptr))
+                return false;
+            ptr += consumed;
+
+            for (uint32_t j = 0; j < order; ++j)
+            {
+                PrefixSum(out, frames);
+            }
+        }
+
+        return true;
+    }
+
+    const LOSSLESSHEADER* ValidateHeader(const uint8_t* data, size_t dataSize) noexcept
+    {
+        if (!data || dataSize < sizeof(LOSSLESSHEADER))
+            return nullptr;
+
+        auto header = reinterpret_cast<const LOSSLESSHEADER*>(data);
+        if (header->dwSignature != LOSSLESSHEADER::SIGNATURE)
+            return nullptr;
+
+        if (!header->wChannels || header->wChannels > LOSSLESS_MAX_CHANNELS)
+            return nullptr;
+
+        if (header->wFramesPerChunk != LOSSLESS_FRAMES_PER_CHUNK)
+            return nullptr;
+
+        const uint64_t expectedChunks = (uint64_t(header->dwTotalFrames) + LOSSLESS_FRAMES_PER_CHUNK - 1) / LOSSLESS_FRAMES_PER_CHUNK;
+        if (header->dwChunkCount != expectedChunks)
+            return nullptr;
+
+        const uint64_t tableSize = (uint64_t(header->dwChunkCount) + 1) * sizeof(uint32_t);
+        if (sizeof(LOSSLESSHEADER) + tableSize > dataSize)
+            return nullptr;
+
+        return header;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+bool DirectX::IsLosslessAudio(const uint8_t* data, size_t dataSize) noexcept
+{
+    return ValidateHeader(data, dataSize) != nullptr;
+}
+
+
+_Use_decl_annotations_
+HRESULT DirectX::GetLosslessAudioInfo(const uint8_t* data, size_t dataSize, uint32_t& channels, uint32_t& totalFrames) noexcept
+{
+    channels = totalFrames = 0;
+
+    auto header = ValidateHeader(data, dataSize);
+    if (!header)
+        return E_FAIL;
+
+    channels = header->wChannels;
+    totalFrames = header->dwTotalFrames;
+
+    return S_OK;
+}
+
+
+_Use_decl_annotations_
+HRESULT DirectX::EncodeLosslessAudio(const int16_t* samples, uint32_t frameCount, uint32_t channels, std::vector<uint8_t>& output)
+{
+    if (!samples || !frameCount)
+        return E_INVALIDARG;
+
+    if (!channels || channels > LOSSLESS_MAX_CHANNELS)
+        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+    // Rounded up in 64 bits, as ValidateHeader does, so counts near UINT32_MAX do not wrap
+    const auto chunkCount = static_cast<uint32_t>((uint64_t(frameCount) + LOSSLESS_FRAMES_PER_CHUNK - 1) / LOSSLESS_FRAMES_PER_CHUNK);
+
+    output.clear();
+    output.resize(sizeof(LOSSLESSHEADER) + (size_t(chunkCount) + 1) * sizeof(uint32_t));
+
+    LOSSLESSHEADER header = {};
+    header.dwSignature = LOSSLESSHEADER::SIGNATURE;
+    header.wChannels = static_cast<uint16_t>(channels);
+    header.wFramesPerChunk = static_cast<uint16_t>(LOSSLESS_FRAMES_PER_CHUNK);
+    header.dwTotalFrames = frameCount;
+    header.dwChunkCount = chunkCount;
+    memcpy(output.data(), &header, sizeof(header));
+
+    std::vector<uint32_t> offsets(size_t(chunkCount) + 1);
+    std::vector<int32_t> plane(LOSSLESS_FRAMES_PER_CHUNK);
+
+    for (uint32_t chunk = 0; chunk < chunkCount; ++chunk)
+    {
+        if (output.size() > UINT32_MAX)
+            return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+        offsets[chunk] = static_cast<uint32_t>(output.size());
+
+        const uint32_t start = chunk * LOSSLESS_FRAMES_PER_CHUNK;
+        const uint32_t frames = std::min(LOSSLESS_FRAMES_PER_CHUNK, frameCount - start);
+
+        for (uint32_t ch = 0; ch < channels; ++ch)
+        {
+            const int16_t* src = samples + size_t(start) * channels + ch;
+            for (uint32_t j = 0; j < frames; ++j)
+            {
+                plane[j] = src[size_t(j) * channels];
+            }
+
+            EncodeChannel(plane.data(), frames, output);
+        }
+    }
+
+    if (output.size() > UINT32_MAX)
+        return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+    offsets[chunkCount] = static_cast<uint32_t>(output.size());
+
+    memcpy(output.data() + sizeof(LOSSLESSHEADER), offsets.data(), offsets.size() * sizeof(uint32_t));
+
+    return S_OK;
+}
+
+
+_Use_decl_annotations_
+HRESULT DirectX::DecodeLosslessAudio(const uint8_t* data, size_t dataSize, uint32_t channels, uint32_t bitsPerSample,
+    uint32_t startFrame, uint32_t frameCount, int16_t* dest) noexcept
+{
+    if (!dest)
+        return E_INVALIDARG;
+
+    if (bitsPerSample != 16)
+        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+    auto header = ValidateHeader(data, dataSize);
+    if (!header)
+        return E_FAIL;
+
+    // The caller sized dest from its own format, so a different channel count would overrun it
+    if (header->wChannels != channels)
+        return E_FAIL;
+
+    if (uint64_t(startFrame) + uint64_t(frameCount) > header->dwTotalFrames)
+        return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+
+    auto offsets = reinterpret_cast<const uint32_t*>(data + sizeof(LOSSLESSHEADER));
+
+    std::unique_ptr<int32_t[]> planes(new (std::nothrow) int32_t[size_t(channels) * LOSSLESS_FRAMES_PER_CHUNK]);
+    if (!planes)
+        return E_OUTOFMEMORY;
+
+    uint32_t frame = startFrame;
+    const uint32_t endFrame = startFrame + frameCount;
+    while (frame < endFrame)
+    {
+        const uint32_t chunk = frame / LOSSLESS_FRAMES_PER_CHUNK;
+        const uint32_t chunkStart = chunk * LOSSLESS_FRAMES_PER_CHUNK;
+        const uint32_t chunkFrames = std::min(LOSSLESS_FRAMES_PER_CHUNK, header->dwTotalFrames - chunkStart);
+
+        const uint32_t begin = offsets[chunk];
+        const uint32_t end = offsets[chunk + 1];
+        if (begin > end || end > dataSize)
+            return E_FAIL;
+
+        if (!DecodeChunk(data + begin, data + end, channels, chunkFrames, planes.get()))
+            return E_FAIL;
+
+        const uint32_t first = frame - chunkStart;
+        const uint32_t count = std::min(chunkStart + chunkFrames, endFrame) - frame;
+
+        int16_t* out = dest + size_t(frame - startFrame) * channels;
+        for (uint32_t ch = 0; ch < channels; ++ch)
+        {
+            StoreChannel(planes.get() + size_t(ch) * LOSSLESS_FRAMES_PER_CHUNK + first, count, out + ch, channels);
+        }
+
+        frame += count;
+    }
+
+    return S_OK;
+}
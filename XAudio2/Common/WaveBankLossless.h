@@ -0,0 +1,60 @@
+//--------------------------------------------------------------------------------------
+// File: WaveBankLossless.h
+//
+// Lossless compression for 16-bit PCM wave bank entries
+//
+// Each entry is split into fixed-size chunks of frames that can be decoded
+// independently of each other, so random access into an entry only requires
+// decoding the chunk that contains the requested frame. Within a chunk every
+// channel is coded with a fixed polynomial predictor (order 0 - 4) and the
+// residuals are Rice coded.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+// http://go.microsoft.com/fwlink/?LinkID=615561
+//-------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <objbase.h>
+
+#include <cstdint>
+#include <vector>
+
+
+namespace DirectX
+{
+    constexpr uint32_t LOSSLESS_FRAMES_PER_CHUNK = 4096;
+    constexpr uint32_t LOSSLESS_MAX_CHANNELS = 8;
+
+    // Returns true if the data starts with a valid lossless entry header
+    bool IsLosslessAudio(
+        _In_reads_bytes_(dataSize) const uint8_t* data,
+        _In_ size_t dataSize) noexcept;
+
+    HRESULT GetLosslessAudioInfo(
+        _In_reads_bytes_(dataSize) const uint8_t* data,
+        _In_ size_t dataSize,
+        _Out_ uint32_t& channels,
+        _Out_ uint32_t& totalFrames) noexcept;
+
+    // Interleaved 16-bit PCM in, compressed entry payload out
+    HRESULT EncodeLosslessAudio(
+        _In_reads_(frameCount * channels) const int16_t* samples,
+        _In_ uint32_t frameCount,
+        _In_ uint32_t channels,
+        _Inout_ std::vector<uint8_t>& output);
+
+    // Decodes frameCount frames starting at startFrame into interleaved 16-bit PCM. Fails
+    // unless the entry has the channel count and bit depth that dest was sized for.
+    HRESULT DecodeLosslessAudio(
+        _In_reads_bytes_(dataSize) const uint8_t* data,
+        _In_ size_t dataSize,
+        _In_ uint32_t channels,
+        _In_ uint32_t bitsPerSample,
+        _In_ uint32_t startFrame,
+        _In_ uint32_t frameCount,
+        _Out_writes_(_Inexpressible_(frameCount * channels)) int16_t* dest) noexcept;
+}
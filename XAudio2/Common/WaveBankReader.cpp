@@ -15,10 +15,12 @@
 #include <cassert>
 
 #include "WaveBankReader.h"
+#include "WaveBankLossless.h"
 
-#include <map>
-#include <string>
+#include <algorithm>
+#include <cstring>
 #include <tuple>
+#include <vector>
 
 #ifndef MAKEFOURCC
 #define MAKEFOURCC(ch0, ch1, ch2, ch3) \
@@ -236,6 +238,9 @@ namespace
         static constexpr uint32_t FLAGS_SEEKTABLES = 0x00080000;
         static constexpr uint32_t FLAGS_MASK = 0x000F0000;
 
+        // Extension: 16-bit PCM entries are stored losslessly compressed (not supported by XACT 3)
+        static constexpr uint32_t FLAGS_LOSSLESS = 0x00100000;
+
         uint32_t        dwFlags;                        // Bank flags
         uint32_t        dwEntryCount;                   // Number of entries in the bank
         char            szBankName[BANKNAME_LENGTH];    // Bank friendly name
@@ -387,7 +392,11 @@ public:
         m_request{},
         m_prepared(false),
         m_header{},
-        m_data{}
+        m_data{},
+        m_entries(nullptr),
+        m_seekData(nullptr),
+        m_waveData(nullptr),
+        m_nameData(nullptr)
     {
     }
 
@@ -400,8 +409,11 @@ public:
     ~Impl() { Close(); }
 
     HRESULT Open(_In_z_ const wchar_t* szFileName) noexcept(false);
+    HRESULT Open(_In_reads_bytes_(dataSize) const uint8_t* data, _In_ size_t dataSize) noexcept(false);
     void Close() noexcept;
 
+    uint32_t Find(_In_z_ const char* name) const;
+
     HRESULT GetFormat(_In_ uint32_t index, _Out_writes_bytes_(maxsize) WAVEFORMATEX* pFormat, _In_ size_t maxsize) const noexcept;
 
     HRESULT GetWaveData(_In_ uint32_t index, _Outptr_ const uint8_t** pData, _Out_ uint32_t& dataSize) const noexcept;
@@ -410,6 +422,10 @@ public:
 
     HRESULT GetMetadata(_In_ uint32_t index, _Out_ Metadata& metadata) const noexcept;
 
+    HRESULT DecodeWaveData(_In_ uint32_t index, _In_ uint32_t startSample, _In_ uint32_t sampleCount, _Out_writes_bytes_(maxsize) uint8_t* pDest, _In_ size_t maxsize) const noexcept;
+
+    bool IsLossless(_In_ uint32_t index) const noexcept;
+
     bool UpdatePrepared() noexcept;
 
     void Clear() noexcept
@@ -417,12 +433,19 @@ public:
         memset(&m_header, 0, sizeof(HEADER));
         memset(&m_data, 0, sizeof(BANKDATA));
 
-        m_names.clear();
-        m_entries.reset();
-        m_seekData.reset();
-        m_waveData.reset();
+        m_nameIndex.clear();
+        m_entriesBuffer.reset();
+        m_seekBuffer.reset();
+        m_waveBuffer.reset();
+        m_nameBuffer.reset();
+
+        m_entries = m_seekData = m_waveData = nullptr;
+        m_nameData = nullptr;
     }
 
+    HRESULT ValidateBankData() const noexcept;
+    HRESULT BuildNameIndex(_In_reads_bytes_(namesBytes) const char* names, _In_ size_t namesBytes);
+
     HANDLE                              m_async;
     ScopedHandle                        m_event;
     OVERLAPPED                          m_request;
@@ -430,12 +453,19 @@ public:
 
     HEADER                              m_header;
     BANKDATA                            m_data;
-    std::map<std::string, uint32_t>     m_names;
+    std::vector<uint32_t>               m_nameIndex;    // Entry indices sorted by name
 
 private:
-    std::unique_ptr<uint8_t[]>          m_entries;
-    std::unique_ptr<uint8_t[]>          m_seekData;
-    std::unique_ptr<uint8_t[]>          m_waveData;
+    // Views of the bank segments, either into the owned buffers below or into caller memory
+    const uint8_t*                      m_entries;
+    const uint8_t*                      m_seekData;
+    const uint8_t*                      m_waveData;
+    const char*                         m_nameData;
+
+    std::unique_ptr<uint8_t[]>          m_entriesBuffer;
+    std::unique_ptr<uint8_t[]>          m_seekBuffer;
+    std::unique_ptr<uint8_t[]>          m_waveBuffer;
+    std::unique_ptr<char[]>             m_nameBuffer;
 };
 
 
@@ -553,49 +583,11 @@ HRESULT WaveBankReader::Impl::Open(const wchar_t* szFileName) noexcept(false)
         return HRESULT_FROM_WIN32(GetLastError());
     }
 
-    if (!m_data.dwEntryCount)
-    {
-        return HRESULT_FROM_WIN32(ERROR_NO_DATA);
-    }
-
-    if (m_data.dwFlags & BANKDATA::TYPE_STREAMING)
-    {
-        if (m_data.dwAlignment < ALIGNMENT_DVD)
-            return E_FAIL;
-        if (m_data.dwAlignment % DVD_SECTOR_SIZE)
-            return E_FAIL;
-    }
-    else if (m_data.dwAlignment < ALIGNMENT_MIN)
-    {
-        return E_FAIL;
-    }
-
-    if (m_data.dwFlags & BANKDATA::FLAGS_COMPACT)
-    {
-        if (m_data.dwEntryMetaDataElementSize != sizeof(ENTRYCOMPACT))
-        {
-            return E_FAIL;
-        }
-
-        if (m_header.Segments[HEADER::SEGIDX_ENTRYWAVEDATA].dwLength > (MAX_COMPACT_DATA_SEGMENT_SIZE * m_data.dwAlignment))
-        {
-            // Data segment is too large to be valid compact wavebank
-            return E_FAIL;
-        }
-    }
-    else
-    {
-        if (m_data.dwEntryMetaDataElementSize != sizeof(ENTRY))
-        {
-            return E_FAIL;
-        }
-    }
+    HRESULT hr = ValidateBankData();
+    if (FAILED(hr))
+        return hr;
 
     const DWORD metadataBytes = m_header.Segments[HEADER::SEGIDX_ENTRYMETADATA].dwLength;
-    if (metadataBytes != (m_data.dwEntryCount * m_data.dwEntryMetaDataElementSize))
-    {
-        return E_FAIL;
-    }
 
     // Load names
     const DWORD namesBytes = m_header.Segments[HEADER::SEGIDX_ENTRYNAMES].dwLength;
@@ -603,8 +595,8 @@ HRESULT WaveBankReader::Impl::Open(const wchar_t* szFileName) noexcept(false)
     {
         if (namesBytes >= (m_data.dwEntryNameElementSize * m_data.dwEntryCount))
         {
-            std::unique_ptr<char[]> temp(new (std::nothrow) char[namesBytes]);
-            if (!temp)
+            m_nameBuffer.reset(new (std::nothrow) char[namesBytes]);
+            if (!m_nameBuffer)
                 return E_OUTOFMEMORY;
 
             memset(&request, 0, sizeof(request));
@@ -612,7 +604,7 @@ HRESULT WaveBankReader::Impl::Open(const wchar_t* szFileName) noexcept(false)
             request.hEvent = m_event.get();
 
             wait = false;
-            if (!ReadFile(hFile.get(), temp.get(), namesBytes, nullptr, &request))
+            if (!ReadFile(hFile.get(), m_nameBuffer.get(), namesBytes, nullptr, &request))
             {
                 const DWORD error = GetLastError();
                 if (error != ERROR_IO_PENDING)
@@ -636,36 +628,32 @@ HRESULT WaveBankReader::Impl::Open(const wchar_t* szFileName) noexcept(false)
                 return HRESULT_FROM_WIN32(GetLastError());
             }
 
-            for (uint32_t j = 0; j < m_data.dwEntryCount; ++j)
-            {
-                const DWORD n = m_data.dwEntryNameElementSize * j;
-
-                char name[64] = {};
-                strncpy_s(name, &temp[n], sizeof(name));
-
-                m_names[name] = j;
-            }
+            hr = BuildNameIndex(m_nameBuffer.get(), namesBytes);
+            if (FAILED(hr))
+                return hr;
         }
     }
 
     // Load entries
     if (m_data.dwFlags & BANKDATA::FLAGS_COMPACT)
     {
-        m_entries.reset(reinterpret_cast<uint8_t*>(new (std::nothrow) ENTRYCOMPACT[m_data.dwEntryCount]));
+        m_entriesBuffer.reset(reinterpret_cast<uint8_t*>(new (std::nothrow) ENTRYCOMPACT[m_data.dwEntryCount]));
     }
     else
     {
-        m_entries.reset(reinterpret_cast<uint8_t*>(new (std::nothrow) ENTRY[m_data.dwEntryCount]));
+        m_entriesBuffer.reset(reinterpret_cast<uint8_t*>(new (std::nothrow) ENTRY[m_data.dwEntryCount]));
     }
-    if (!m_entries)
+    if (!m_entriesBuffer)
         return E_OUTOFMEMORY;
 
+    m_entries = m_entriesBuffer.get();
+
     memset(&request, 0, sizeof(request));
     request.Offset = m_header.Segments[HEADER::SEGIDX_ENTRYMETADATA].dwOffset;
     request.hEvent = m_event.get();
 
     wait = false;
-    if (!ReadFile(hFile.get(), m_entries.get(), metadataBytes, nullptr, &request))
+    if (!ReadFile(hFile.get(), m_entriesBuffer.get(), metadataBytes, nullptr, &request))
     {
         const DWORD error = GetLastError();
         if (error != ERROR_IO_PENDING)
@@ -693,16 +681,18 @@ HRESULT WaveBankReader::Impl::Open(const wchar_t* szFileName) noexcept(false)
     const DWORD seekLen = m_header.Segments[HEADER::SEGIDX_SEEKTABLES].dwLength;
     if (seekLen > 0)
     {
-        m_seekData.reset(new (std::nothrow) uint8_t[seekLen]);
-        if (!m_seekData)
+        m_seekBuffer.reset(new (std::nothrow) uint8_t[seekLen]);
+        if (!m_seekBuffer)
             return E_OUTOFMEMORY;
 
+        m_seekData = m_seekBuffer.get();
+
         memset(&request, 0, sizeof(OVERLAPPED));
         request.Offset = m_header.Segments[HEADER::SEGIDX_SEEKTABLES].dwOffset;
         request.hEvent = m_event.get();
 
         wait = false;
-        if (!ReadFile(hFile.get(), m_seekData.get(), seekLen, nullptr, &request))
+        if (!ReadFile(hFile.get(), m_seekBuffer.get(), seekLen, nullptr, &request))
         {
             const DWORD error = GetLastError();
             if (error != ERROR_IO_PENDING)
@@ -728,7 +718,7 @@ HRESULT WaveBankReader::Impl::Open(const wchar_t* szFileName) noexcept(false)
 
         if (be)
         {
-            auto ptr = reinterpret_cast<uint32_t*>(m_seekData.get());
+            auto ptr = reinterpret_cast<uint32_t*>(m_seekBuffer.get());
             for (size_t j = 0; j < seekLen; j += 4, ++ptr)
             {
                 *ptr = _byteswap_ulong(*ptr);
@@ -779,11 +769,12 @@ HRESULT WaveBankReader::Impl::Open(const wchar_t* szFileName) noexcept(false)
         void* dest = nullptr;
 
         {
-            m_waveData.reset(new (std::nothrow) uint8_t[waveLen]);
-            if (!m_waveData)
+            m_waveBuffer.reset(new (std::nothrow) uint8_t[waveLen]);
+            if (!m_waveBuffer)
                 return E_OUTOFMEMORY;
 
-            dest = m_waveData.get();
+            m_waveData = m_waveBuffer.get();
+            dest = m_waveBuffer.get();
         }
 
         memset(&m_request, 0, sizeof(OVERLAPPED));
@@ -809,6 +800,192 @@ HRESULT WaveBankReader::Impl::Open(const wchar_t* szFileName) noexcept(false)
 }
 
 
+_Use_decl_annotations_
+HRESULT WaveBankReader::Impl::Open(const uint8_t* data, size_t dataSize) noexcept(false)
+{
+    Close();
+    Clear();
+
+    m_prepared = false;
+
+    if (!data)
+        return E_INVALIDARG;
+
+    // Seek tables are read in place as uint32_t
+    if (reinterpret_cast<uintptr_t>(data) & (sizeof(uint32_t) - 1))
+        return E_INVALIDARG;
+
+    if (dataSize < sizeof(HEADER) || dataSize > UINT32_MAX)
+        return E_FAIL;
+
+    memcpy(&m_header, data, sizeof(HEADER));
+
+    if (m_header.dwSignature == HEADER::BE_SIGNATURE)
+    {
+        // Big-endian (Xbox 360) banks would have to be byte-swapped, which cannot be done in place
+        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+    }
+
+    if (m_header.dwSignature != HEADER::SIGNATURE)
+    {
+        return E_FAIL;
+    }
+
+    if (m_header.dwHeaderVersion != HEADER::VERSION)
+    {
+        return E_FAIL;
+    }
+
+    for (size_t j = 0; j < HEADER::SEGIDX_COUNT; ++j)
+    {
+        if ((uint64_t(m_header.Segments[j].dwOffset) + uint64_t(m_header.Segments[j].dwLength)) > dataSize)
+            return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+    }
+
+    if (m_header.Segments[HEADER::SEGIDX_BANKDATA].dwLength < sizeof(BANKDATA))
+        return E_FAIL;
+
+    memcpy(&m_data, data + m_header.Segments[HEADER::SEGIDX_BANKDATA].dwOffset, sizeof(BANKDATA));
+
+    HRESULT hr = ValidateBankData();
+    if (FAILED(hr))
+        return hr;
+
+    if (m_data.dwFlags & BANKDATA::TYPE_STREAMING)
+    {
+        // Streaming banks are read from disk on demand
+        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+    }
+
+    const DWORD namesBytes = m_header.Segments[HEADER::SEGIDX_ENTRYNAMES].dwLength;
+    if (namesBytes > 0 && namesBytes >= (m_data.dwEntryNameElementSize * m_data.dwEntryCount))
+    {
+        hr = BuildNameIndex(reinterpret_cast<const char*>(data + m_header.Segments[HEADER::SEGIDX_ENTRYNAMES].dwOffset), namesBytes);
+        if (FAILED(hr))
+            return hr;
+    }
+
+    m_entries = data + m_header.Segments[HEADER::SEGIDX_ENTRYMETADATA].dwOffset;
+
+    if (m_header.Segments[HEADER::SEGIDX_SEEKTABLES].dwLength > 0)
+    {
+        if (m_header.Segments[HEADER::SEGIDX_SEEKTABLES].dwOffset & (sizeof(uint32_t) - 1))
+            return E_FAIL;
+
+        m_seekData = data + m_header.Segments[HEADER::SEGIDX_SEEKTABLES].dwOffset;
+    }
+
+    if (!m_header.Segments[HEADER::SEGIDX_ENTRYWAVEDATA].dwLength)
+    {
+        return HRESULT_FROM_WIN32(ERROR_NO_DATA);
+    }
+
+    m_waveData = data + m_header.Segments[HEADER::SEGIDX_ENTRYWAVEDATA].dwOffset;
+    m_prepared = true;
+
+    return S_OK;
+}
+
+
+HRESULT WaveBankReader::Impl::ValidateBankData() const noexcept
+{
+    if (!m_data.dwEntryCount)
+    {
+        return HRESULT_FROM_WIN32(ERROR_NO_DATA);
+    }
+
+    if (m_data.dwFlags & BANKDATA::TYPE_STREAMING)
+    {
+        if (m_data.dwAlignment < ALIGNMENT_DVD)
+            return E_FAIL;
+        if (m_data.dwAlignment % DVD_SECTOR_SIZE)
+            return E_FAIL;
+    }
+    else if (m_data.dwAlignment < ALIGNMENT_MIN)
+    {
+        return E_FAIL;
+    }
+
+    if (m_data.dwFlags & BANKDATA::FLAGS_COMPACT)
+    {
+        if (m_data.dwEntryMetaDataElementSize != sizeof(ENTRYCOMPACT))
+        {
+            return E_FAIL;
+        }
+
+        if (m_header.Segments[HEADER::SEGIDX_ENTRYWAVEDATA].dwLength > (MAX_COMPACT_DATA_SEGMENT_SIZE * m_data.dwAlignment))
+        {
+            // Data segment is too large to be valid compact wavebank
+            return E_FAIL;
+        }
+    }
+    else
+    {
+        if (m_data.dwEntryMetaDataElementSize != sizeof(ENTRY))
+        {
+            return E_FAIL;
+        }
+    }
+
+    if (m_header.Segments[HEADER::SEGIDX_ENTRYMETADATA].dwLength != (m_data.dwEntryCount * m_data.dwEntryMetaDataElementSize))
+    {
+        return E_FAIL;
+    }
+
+    return S_OK;
+}
+
+
+_Use_decl_annotations_
+HRESULT WaveBankReader::Impl::BuildNameIndex(const char* names, size_t namesBytes)
+{
+    if (!m_data.dwEntryNameElementSize || (size_t(m_data.dwEntryNameElementSize) * m_data.dwEntryCount) > namesBytes)
+        return E_FAIL;
+
+    m_nameData = names;
+
+    m_nameIndex.resize(m_data.dwEntryCount);
+    for (uint32_t j = 0; j < m_data.dwEntryCount; ++j)
+    {
+        m_nameIndex[j] = j;
+    }
+
+    const size_t elementSize = m_data.dwEntryNameElementSize;
+    std::stable_sort(m_nameIndex.begin(), m_nameIndex.end(), [=](uint32_t a, uint32_t b)
+        {
+            return strncmp(names + a * elementSize, names + b * elementSize, elementSize) < 0;
+        });
+
+    return S_OK;
+}
+
+
+_Use_decl_annotations_
+uint32_t WaveBankReader::Impl::Find(const char* name) const
+{
+    if (!name || m_nameIndex.empty())
+        return uint32_t(-1);
+
+    const size_t elementSize = m_data.dwEntryNameElementSize;
+    if (strnlen(name, elementSize) >= elementSize)
+        return uint32_t(-1);
+
+    // Duplicate names are sorted in entry order; the last one wins, as it did when the names
+    // were kept in a map
+    auto it = std::upper_bound(m_nameIndex.cbegin(), m_nameIndex.cend(), name, [&](const char* value, uint32_t index)
+        {
+            return strncmp(value, m_nameData + index * elementSize, elementSize) < 0;
+        });
+
+    if (it != m_nameIndex.cbegin() && strncmp(m_nameData + *(--it) * elementSize, name, elementSize) == 0)
+    {
+        return *it;
+    }
+
+    return uint32_t(-1);
+}
+
+
 void WaveBankReader::Impl::Close() noexcept
 {
     if (m_async != INVALID_HANDLE_VALUE)
@@ -843,7 +1020,7 @@ HRESULT WaveBankReader::Impl::GetFormat(uint32_t index, WAVEFORMATEX* pFormat, s
         return E_FAIL;
     }
 
-    auto& miniFmt = (m_data.dwFlags & BANKDATA::FLAGS_COMPACT) ? m_data.CompactFormat : (reinterpret_cast<const ENTRY*>(m_entries.get())[index].Format);
+    auto& miniFmt = (m_data.dwFlags & BANKDATA::FLAGS_COMPACT) ? m_data.CompactFormat : (reinterpret_cast<const ENTRY*>(m_entries)[index].Format);
 
     switch (miniFmt.wFormatTag)
     {
@@ -908,7 +1085,7 @@ HRESULT WaveBankReader::Impl::GetWaveData(uint32_t index, const uint8_t** pData,
         return E_FAIL;
     }
 
-    const uint8_t* waveData = m_waveData.get();
+    const uint8_t* waveData = m_waveData;
 
     if (!waveData)
         return E_FAIL;
@@ -923,12 +1100,18 @@ HRESULT WaveBankReader::Impl::GetWaveData(uint32_t index, const uint8_t** pData,
         return HRESULT_FROM_WIN32(ERROR_IO_INCOMPLETE);
     }
 
+    if (IsLossless(index))
+    {
+        // Compressed entries must be expanded with DecodeWaveData
+        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+    }
+
     if (m_data.dwFlags & BANKDATA::FLAGS_COMPACT)
     {
-        auto& entry = reinterpret_cast<const ENTRYCOMPACT*>(m_entries.get())[index];
+        auto& entry = reinterpret_cast<const ENTRYCOMPACT*>(m_entries)[index];
 
         DWORD dwOffset, dwLength;
-        entry.ComputeLocations(dwOffset, dwLength, index, m_header, m_data, reinterpret_cast<const ENTRYCOMPACT*>(m_entries.get()));
+        entry.ComputeLocations(dwOffset, dwLength, index, m_header, m_data, reinterpret_cast<const ENTRYCOMPACT*>(m_entries));
 
         if ((uint64_t(dwOffset) + uint64_t(dwLength)) > uint64_t(m_header.Segments[HEADER::SEGIDX_ENTRYWAVEDATA].dwLength))
         {
@@ -940,7 +1123,7 @@ HRESULT WaveBankReader::Impl::GetWaveData(uint32_t index, const uint8_t** pData,
     }
     else
     {
-        auto& entry = reinterpret_cast<const ENTRY*>(m_entries.get())[index];
+        auto& entry = reinterpret_cast<const ENTRY*>(m_entries)[index];
 
         if ((uint64_t(entry.PlayRegion.dwOffset) + uint64_t(entry.PlayRegion.dwLength)) > uint64_t(m_header.Segments[HEADER::SEGIDX_ENTRYWAVEDATA].dwLength))
         {
@@ -973,7 +1156,7 @@ HRESULT WaveBankReader::Impl::GetSeekTable(uint32_t index, const uint32_t** pDat
     if (!m_seekData)
         return S_OK;
 
-    auto& miniFmt = (m_data.dwFlags & BANKDATA::FLAGS_COMPACT) ? m_data.CompactFormat : (reinterpret_cast<const ENTRY*>(m_entries.get())[index].Format);
+    auto& miniFmt = (m_data.dwFlags & BANKDATA::FLAGS_COMPACT) ? m_data.CompactFormat : (reinterpret_cast<const ENTRY*>(m_entries)[index].Format);
 
     switch (miniFmt.wFormatTag)
     {
@@ -989,7 +1172,7 @@ HRESULT WaveBankReader::Impl::GetSeekTable(uint32_t index, const uint32_t** pDat
             return S_OK;
     }
 
-    auto seekTable = FindSeekTable(index, m_seekData.get(), m_header, m_data);
+    auto seekTable = FindSeekTable(index, m_seekData, m_header, m_data);
     if (!seekTable)
         return S_OK;
 
@@ -1010,12 +1193,12 @@ HRESULT WaveBankReader::Impl::GetMetadata(uint32_t index, Metadata& metadata) co
 
     if (m_data.dwFlags & BANKDATA::FLAGS_COMPACT)
     {
-        auto& entry = reinterpret_cast<const ENTRYCOMPACT*>(m_entries.get())[index];
+        auto& entry = reinterpret_cast<const ENTRYCOMPACT*>(m_entries)[index];
 
         DWORD dwOffset, dwLength;
-        entry.ComputeLocations(dwOffset, dwLength, index, m_header, m_data, reinterpret_cast<const ENTRYCOMPACT*>(m_entries.get()));
+        entry.ComputeLocations(dwOffset, dwLength, index, m_header, m_data, reinterpret_cast<const ENTRYCOMPACT*>(m_entries));
 
-        auto seekTable = FindSeekTable(index, m_seekData.get(), m_header, m_data);
+        auto seekTable = FindSeekTable(index, m_seekData, m_header, m_data);
         metadata.duration = entry.GetDuration(dwLength, m_data, seekTable);
         metadata.loopStart = metadata.loopLength = 0;
         metadata.offsetBytes = dwOffset;
@@ -1023,7 +1206,7 @@ HRESULT WaveBankReader::Impl::GetMetadata(uint32_t index, Metadata& metadata) co
     }
     else
     {
-        auto& entry = reinterpret_cast<const ENTRY*>(m_entries.get())[index];
+        auto& entry = reinterpret_cast<const ENTRY*>(m_entries)[index];
 
         metadata.duration = entry.Duration;
         metadata.loopStart = entry.LoopRegion.dwStartSample;
@@ -1045,6 +1228,84 @@ HRESULT WaveBankReader::Impl::GetMetadata(uint32_t index, Metadata& metadata) co
 }
 
 
+_Use_decl_annotations_
+HRESULT WaveBankReader::Impl::DecodeWaveData(uint32_t index, uint32_t startSample, uint32_t sampleCount, uint8_t* pDest, size_t maxsize) const noexcept
+{
+    if (!pDest)
+        return E_INVALIDARG;
+
+    if (index >= m_data.dwEntryCount || !m_entries)
+    {
+        return E_FAIL;
+    }
+
+    if (m_data.dwFlags & BANKDATA::TYPE_STREAMING)
+    {
+        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+    }
+
+    if (!m_waveData)
+        return E_FAIL;
+
+    if (!m_prepared)
+    {
+        return HRESULT_FROM_WIN32(ERROR_IO_INCOMPLETE);
+    }
+
+    auto& miniFmt = (m_data.dwFlags & BANKDATA::FLAGS_COMPACT) ? m_data.CompactFormat : (reinterpret_cast<const ENTRY*>(m_entries)[index].Format);
+    if (miniFmt.wFormatTag != MINIWAVEFORMAT::TAG_PCM)
+    {
+        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+    }
+
+    const uint64_t bytes = uint64_t(sampleCount) * uint64_t(miniFmt.BlockAlign());
+    if (bytes > maxsize)
+        return HRESULT_FROM_WIN32(ERROR_MORE_DATA);
+
+    Metadata metadata;
+    HRESULT hr = GetMetadata(index, metadata);
+    if (FAILED(hr))
+        return hr;
+
+    if ((uint64_t(metadata.offsetBytes) + uint64_t(metadata.lengthBytes)) > uint64_t(m_header.Segments[HEADER::SEGIDX_ENTRYWAVEDATA].dwLength))
+    {
+        return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+    }
+
+    const uint8_t* waveData = &m_waveData[metadata.offsetBytes];
+
+    if (IsLossless(index))
+    {
+        return DirectX::DecodeLosslessAudio(waveData, metadata.lengthBytes,
+            miniFmt.nChannels, miniFmt.BitsPerSample(),
+            startSample, sampleCount, reinterpret_cast<int16_t*>(pDest));
+    }
+
+    const uint64_t offset = uint64_t(startSample) * uint64_t(miniFmt.BlockAlign());
+    if ((offset + bytes) > metadata.lengthBytes)
+        return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+
+    memcpy(pDest, waveData + offset, static_cast<size_t>(bytes));
+
+    return S_OK;
+}
+
+
+_Use_decl_annotations_
+bool WaveBankReader::Impl::IsLossless(uint32_t index) const noexcept
+{
+    if (!(m_data.dwFlags & BANKDATA::FLAGS_LOSSLESS))
+        return false;
+
+    if (index >= m_data.dwEntryCount || !m_entries)
+        return false;
+
+    auto& miniFmt = (m_data.dwFlags & BANKDATA::FLAGS_COMPACT) ? m_data.CompactFormat : (reinterpret_cast<const ENTRY*>(m_entries)[index].Format);
+
+    return (miniFmt.wFormatTag == MINIWAVEFORMAT::TAG_PCM) && (miniFmt.wBitsPerSample == MINIWAVEFORMAT::BITDEPTH_16);
+}
+
+
 bool WaveBankReader::Impl::UpdatePrepared() noexcept
 {
     if (m_prepared)
@@ -1095,15 +1356,16 @@ HRESULT WaveBankReader::Open(const wchar_t* szFileName) noexcept
 
 
 _Use_decl_annotations_
-uint32_t WaveBankReader::Find(const char* name) const
+HRESULT WaveBankReader::Open(const uint8_t* data, size_t dataSize) noexcept
 {
-    auto it = pImpl->m_names.find(name);
-    if (it != pImpl->m_names.cend())
-    {
-        return it->second;
-    }
+    return pImpl->Open(data, dataSize);
+}
 
-    return uint32_t(-1);
+
+_Use_decl_annotations_
+uint32_t WaveBankReader::Find(const char* name) const
+{
+    return pImpl->Find(name);
 }
 
 
@@ -1132,7 +1394,7 @@ void WaveBankReader::WaitOnPrepare() noexcept
 
 bool WaveBankReader::HasNames() const noexcept
 {
-    return !pImpl->m_names.empty();
+    return !pImpl->m_nameIndex.empty();
 }
 
 
@@ -1188,6 +1450,20 @@ HRESULT WaveBankReader::GetMetadata(uint32_t index, Metadata& metadata) const no
 }
 
 
+_Use_decl_annotations_
+HRESULT WaveBankReader::DecodeWaveData(uint32_t index, uint32_t startSample, uint32_t sampleCount, uint8_t* pDest, size_t maxsize) const noexcept
+{
+    return pImpl->DecodeWaveData(index, startSample, sampleCount, pDest, maxsize);
+}
+
+
+_Use_decl_annotations_
+bool WaveBankReader::IsLossless(uint32_t index) const noexcept
+{
+    return pImpl->IsLossless(index);
+}
+
+
 HANDLE WaveBankReader::GetAsyncHandle() const noexcept
 {
     return (pImpl->m_data.dwFlags & BANKDATA::TYPE_STREAMING) ? pImpl->m_async : INVALID_HANDLE_VALUE;
@@ -36,6 +36,10 @@ namespace DirectX
 
         HRESULT Open(_In_z_ const wchar_t* szFileName) noexcept;
 
+        // Parses an in-memory bank in place. The data must be 4-byte aligned and outlive the reader.
+        // Big-endian (Xbox 360) and streaming banks return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED).
+        HRESULT Open(_In_reads_bytes_(dataSize) const uint8_t* data, _In_ size_t dataSize) noexcept;
+
         uint32_t Find(_In_z_ const char* name) const;
 
         bool IsPrepared() noexcept;
@@ -70,6 +74,13 @@ namespace DirectX
         };
         HRESULT GetMetadata(_In_ uint32_t index, _Out_ Metadata& metadata) const noexcept;
 
+        // Entries of a bank built with 'xwbtool -lc' are stored losslessly compressed and
+        // must be expanded with DecodeWaveData. This also works for uncompressed PCM entries.
+        bool IsLossless(_In_ uint32_t index) const noexcept;
+
+        HRESULT DecodeWaveData(_In_ uint32_t index, _In_ uint32_t startSample, _In_ uint32_t sampleCount,
+            _Out_writes_bytes_(maxsize) uint8_t* pDest, _In_ size_t maxsize) const noexcept;
+
     private:
         // Private implementation.
         class Impl;
@@ -12,6 +12,8 @@
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
 #include <cstdio>
+#include <memory>
+#include <new>
 
 #include <wrl\client.h>
 #include "XAudio2Versions.h"
@@ -216,18 +218,36 @@ HRESULT PlayWaveFromWaveBank( IXAudio2* pXaudio2, WaveBankReader& wb, uint32_t i
     if ( FAILED(hr) )
         return hr;
 
-    const uint8_t* waveData = nullptr;
-    uint32_t waveSize;
-
-    hr = wb.GetWaveData( index, &waveData, waveSize );
-    if ( FAILED(hr) )
-        return hr;
-
     WaveBankReader::Metadata metadata;
     hr = wb.GetMetadata( index, metadata );
     if ( FAILED(hr) )
         return hr;
 
+    const uint8_t* waveData = nullptr;
+    uint32_t waveSize;
+
+    std::unique_ptr<uint8_t[]> decodedData;
+    if ( wb.IsLossless( index ) )
+    {
+        // Lossless entries are expanded to PCM before submitting
+        waveSize = metadata.duration * pwfx->nBlockAlign;
+        decodedData.reset( new (std::nothrow) uint8_t[ waveSize ] );
+        if ( !decodedData )
+            return E_OUTOFMEMORY;
+
+        hr = wb.DecodeWaveData( index, 0, metadata.duration, decodedData.get(), waveSize );
+        if ( FAILED(hr) )
+            return hr;
+
+        waveData = decodedData.get();
+    }
+    else
+    {
+        hr = wb.GetWaveData( index, &waveData, waveSize );
+        if ( FAILED(hr) )
+            return hr;
+    }
+
     //
     // Play the wave using a XAudio2SourceVoice
     //
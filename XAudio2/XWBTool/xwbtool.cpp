@@ -3,7 +3,8 @@
 //
 // Simple command-line tool for building wave banks from 1 or more .WAV files. This
 // generates binary wave banks compliant with XACT 3's Wave Bank .XWB format. The
-// .WAV files are not format converted or compressed.
+// .WAV files are not format converted or compressed, other than the optional lossless
+// compression of 16-bit PCM entries (-lc).
 //
 // For a more full-featured builder, see XACT 3 and the XACTBLD tool in the legacy
 // DirectX SDK (June 2010) release.
@@ -29,7 +30,10 @@
 #include <Windows.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <clocale>
+#include <cmath>
 #include <cstddef>
 #include <cstdio>
 #include <cstdlib>
@@ -42,11 +46,16 @@
 #include <memory>
 #include <set>
 #include <string>
+#include <thread>
 #include <tuple>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
+#include <DirectXMath.h>
+
 #include "WAVFileReader.h"
+#include "WaveBankLossless.h"
 
 #ifdef __INTEL_COMPILER
 #pragma warning(disable : 161)
@@ -77,6 +86,10 @@ namespace
 
     using ScopedFindHandle = std::unique_ptr<void, find_closer>;
 
+    struct locale_freer { void operator()(_locale_t l) { if (l) _free_locale(l); } };
+
+    using ScopedLocale = std::unique_ptr<std::remove_pointer<_locale_t>::type, locale_freer>;
+
 #define BLOCKALIGNPAD(a, b) \
     ((((a) + ((b) - 1)) / (b)) * (b))
 
@@ -206,6 +219,9 @@ namespace
         static constexpr uint32_t FLAGS_SEEKTABLES = 0x00080000;
         static constexpr uint32_t FLAGS_MASK = 0x000F0000;
 
+        // Extension: 16-bit PCM entries are stored losslessly compressed (not supported by XACT 3)
+        static constexpr uint32_t FLAGS_LOSSLESS = 0x00100000;
+
         uint32_t        dwFlags;                        // Bank flags
         uint32_t        dwEntryCount;                   // Number of entries in the bank
         char            szBankName[BANKNAME_LENGTH];    // Bank friendly name
@@ -654,6 +670,291 @@ namespace
             return false;
         }
     }
+
+    //----------------------------------------------------------------------------------
+    // Loudness analysis (ITU-R BS.1770-4)
+    //----------------------------------------------------------------------------------
+    constexpr float LOUDNESS_ABSOLUTE_GATE = -70.f;     // LUFS
+    constexpr float LOUDNESS_RELATIVE_GATE = -10.f;     // LU
+    constexpr float LOUDNESS_PEAK_CEILING = -1.f;       // dBTP
+
+    struct Biquad
+    {
+        float b0, b1, b2, a1, a2;
+    };
+
+    // K-weighting filter coefficients for an arbitrary sample rate
+    void ComputeKWeighting(uint32_t sampleRate, Biquad& shelf, Biquad& highpass)
+    {
+        const double pi = 3.14159265358979323846;
+        const double fs = double(sampleRate);
+
+        // Stage 1: high-frequency shelf modelling the acoustic effect of the head
+        {
+            const double f0 = 1681.974450955533;
+            const double G = 3.999843853973347;
+            const double Q = 0.7071752369554196;
+
+            const double K = tan(pi * f0 / fs);
+            const double Vh = pow(10.0, G / 20.0);
+            const double Vb = pow(Vh, 0.4996667741545416);
+            const double a0 = 1.0 + K / Q + K * K;
+
+            shelf.b0 = float((Vh + Vb * K / Q + K * K) / a0);
+            shelf.b1 = float(2.0 * (K * K - Vh) / a0);
+            shelf.b2 = float((Vh - Vb * K / Q + K * K) / a0);
+            shelf.a1 = float(2.0 * (K * K - 1.0) / a0);
+            shelf.a2 = float((1.0 - K / Q + K * K) / a0);
+        }
+
+        // Stage 2: RLB high-pass
+        {
+            const double f0 = 38.13547087602444;
+            const double Q = 0.5003270373238773;
+
+            const double K = tan(pi * f0 / fs);
+            const double a0 = 1.0 + K / Q + K * K;
+
+            highpass.b0 = 1.f;
+            highpass.b1 = -2.f;
+            highpass.b2 = 1.f;
+            highpass.a1 = float(2.0 * (K * K - 1.0) / a0);
+            highpass.a2 = float((1.0 - K / Q + K * K) / a0);
+        }
+    }
+
+    // Channel weights assume the standard wave channel order since wave banks do not store a channel mask
+    float ChannelWeight(uint32_t channel, uint32_t channelCount) noexcept
+    {
+        if (channelCount >= 6)
+        {
+            if (channel == 3)
+                return 0.f;     // LFE
+            if (channel >= 4)
+                return 1.41f;   // Surrounds
+        }
+        return 1.f;
+    }
+
+    // 4x oversampling interpolation filter for true-peak measurement (BS.1770-4 Annex 2)
+    const float g_TruePeakFilter[4][12] =
+    {
+        { 0.0017089843750f, 0.0109863281250f, -0.0196533203125f, 0.0332031250000f, -0.0594482421875f, 0.1373291015625f, 0.9721679687500f, -0.1022949218750f, 0.0476074218750f, -0.0266113281250f, 0.0148925781250f, -0.0083007812500f },
+        { -0.0291748046875f, 0.0292968750000f, -0.0517578125000f, 0.0891113281250f, -0.1665039062500f, 0.4650878906250f, 0.7797851562500f, -0.2003173828125f, 0.1015625000000f, -0.0582275390625f, 0.0330810546875f, -0.0189208984375f },
+        { -0.0189208984375f, 0.0330810546875f, -0.0582275390625f, 0.1015625000000f, -0.2003173828125f, 0.7797851562500f, 0.4650878906250f, -0.1665039062500f, 0.0891113281250f, -0.0517578125000f, 0.0292968750000f, -0.0291748046875f },
+        { -0.0083007812500f, 0.0148925781250f, -0.0266113281250f, 0.0476074218750f, -0.1022949218750f, 0.9721679687500f, 0.1373291015625f, -0.0594482421875f, 0.0332031250000f, -0.0196533203125f, 0.0109863281250f, 0.0017089843750f },
+    };
+
+    float ReadSample(const uint8_t* audio, size_t index, WORD bitsPerSample) noexcept
+    {
+        if (bitsPerSample == 16)
+        {
+            return float(reinterpret_cast<const int16_t*>(audio)[index]) * (1.f / 32768.f);
+        }
+        return float(int(audio[index]) - 128) * (1.f / 128.f);
+    }
+
+    // Measures integrated loudness (LUFS) and true peak (dBTP) of 8-bit or 16-bit PCM data.
+    // Channels are processed four at a time in the lanes of a vector.
+    bool AnalyzeLoudness(const WAVEFORMATEX* wfx, const uint8_t* audio, uint32_t audioBytes, float& loudness, float& truePeak)
+    {
+        using namespace DirectX;
+
+        if (!wfx || !audio || !wfx->nBlockAlign || !wfx->nSamplesPerSec)
+            return false;
+
+        WORD formatTag = wfx->wFormatTag;
+        if (formatTag == WAVE_FORMAT_EXTENSIBLE)
+        {
+            if (wfx->cbSize < (sizeof(WAVEFORMATEXTENSIBLE) - sizeof(WAVEFORMATEX)))
+                return false;
+            formatTag = static_cast<WORD>(reinterpret_cast<const WAVEFORMATEXTENSIBLE*>(wfx)->SubFormat.Data1);
+        }
+
+        if (formatTag != WAVE_FORMAT_PCM || (wfx->wBitsPerSample != 8 && wfx->wBitsPerSample != 16))
+            return false;
+
+        const uint32_t channels = wfx->nChannels;
+        const size_t frames = audioBytes / wfx->nBlockAlign;
+        if (!frames)
+            return false;
+
+        Biquad shelf, highpass;
+        ComputeKWeighting(wfx->nSamplesPerSec, shelf, highpass);
+
+        // 100 ms steps; gating blocks are four steps long (400 ms, 75% overlap)
+        const size_t stepFrames = std::max<size_t>(wfx->nSamplesPerSec / 10, 1);
+        const size_t stepCount = std::max<size_t>(frames / stepFrames, 1);
+
+        std::vector<double> stepPower(stepCount, 0.0);
+        float peak = 0.f;
+
+        for (uint32_t chBase = 0; chBase < channels; chBase += 4)
+        {
+            const uint32_t lanes = std::min(channels - chBase, 4u);
+
+            XMFLOAT4 weights(0.f, 0.f, 0.f, 0.f);
+            float* w = &weights.x;
+            for (uint32_t lane = 0; lane < lanes; ++lane)
+                w[lane] = ChannelWeight(chBase + lane, channels);
+            const XMVECTOR vWeights = XMLoadFloat4(&weights);
+
+            const XMVECTOR sb0 = XMVectorReplicate(shelf.b0);
+            const XMVECTOR sb1 = XMVectorReplicate(shelf.b1);
+            const XMVECTOR sb2 = XMVectorReplicate(shelf.b2);
+            const XMVECTOR sa1 = XMVectorReplicate(shelf.a1);
+            const XMVECTOR sa2 = XMVectorReplicate(shelf.a2);
+            const XMVECTOR ha1 = XMVectorReplicate(highpass.a1);
+            const XMVECTOR ha2 = XMVectorReplicate(highpass.a2);
+
+            XMVECTOR s1 = XMVectorZero();
+            XMVECTOR s2 = XMVectorZero();
+            XMVECTOR h1 = XMVectorZero();
+            XMVECTOR h2 = XMVectorZero();
+
+            // Interpolator history is stored twice so a window is always contiguous
+            XMVECTOR history[24] = {};
+            size_t historyPos = 0;
+            XMVECTOR vPeak = XMVectorZero();
+
+            XMVECTOR energy = XMVectorZero();
+            size_t step = 0;
+            size_t stepPos = 0;
+
+            for (size_t frame = 0; frame < frames; ++frame)
+            {
+                XMFLOAT4 in(0.f, 0.f, 0.f, 0.f);
+                float* f = &in.x;
+                for (uint32_t lane = 0; lane < lanes; ++lane)
+                    f[lane] = ReadSample(audio, frame * channels + chBase + lane, wfx->wBitsPerSample);
+                const XMVECTOR x = XMLoadFloat4(&in);
+
+                // K-weighting (two transposed direct form II biquads)
+                XMVECTOR y = XMVectorMultiplyAdd(sb0, x, s1);
+                s1 = XMVectorNegativeMultiplySubtract(sa1, y, XMVectorMultiplyAdd(sb1, x, s2));
+                s2 = XMVectorNegativeMultiplySubtract(sa2, y, XMVectorMultiply(sb2, x));
+
+                XMVECTOR z = XMVectorAdd(y, h1);
+                h1 = XMVectorNegativeMultiplySubtract(ha1, z, XMVectorAdd(XMVectorScale(y, -2.f), h2));
+                h2 = XMVectorNegativeMultiplySubtract(ha2, z, y);
+
+                energy = XMVectorMultiplyAdd(z, z, energy);
+
+                if (++stepPos == stepFrames || (frame + 1) == frames)
+                {
+                    if (step < stepCount)
+                    {
+                        stepPower[step] += double(XMVectorGetX(XMVector4Dot(energy, vWeights)));
+                    }
+                    energy = XMVectorZero();
+                    stepPos = 0;
+                    ++step;
+                }
+
+                // True peak via 4x polyphase interpolation
+                history[historyPos] = history[historyPos + 12] = x;
+                historyPos = (historyPos + 1) % 12;
+
+                const XMVECTOR* window = &history[historyPos];
+                for (size_t phase = 0; phase < 4; ++phase)
+                {
+                    XMVECTOR acc = XMVectorZero();
+                    for (size_t tap = 0; tap < 12; ++tap)
+                    {
+                        acc = XMVectorMultiplyAdd(XMVectorReplicate(g_TruePeakFilter[phase][11 - tap]), window[tap], acc);
+                    }
+                    vPeak = XMVectorMax(vPeak, XMVectorAbs(acc));
+                }
+                vPeak = XMVectorMax(vPeak, XMVectorAbs(x));
+            }
+
+            XMFLOAT4 peaks;
+            XMStoreFloat4(&peaks, vPeak);
+            const float* p = &peaks.x;
+            for (uint32_t lane = 0; lane < lanes; ++lane)
+                peak = std::max(peak, p[lane]);
+        }
+
+        truePeak = 20.f * log10f(std::max(peak, 1e-7f));
+
+        // Gated block loudness
+        const size_t blockSteps = std::min<size_t>(4, stepCount);
+        const size_t blockFrames = std::min(stepFrames * blockSteps, frames);
+
+        std::vector<double> blocks;
+        blocks.reserve(stepCount);
+        for (size_t j = 0; j + blockSteps <= stepCount; ++j)
+        {
+            double sum = 0.0;
+            for (size_t k = 0; k < blockSteps; ++k)
+                sum += stepPower[j + k];
+            blocks.push_back(sum / double(blockFrames));
+        }
+
+        auto toLUFS = [](double power) { return -0.691 + 10.0 * log10(power); };
+
+        double sum = 0.0;
+        size_t count = 0;
+        for (auto power : blocks)
+        {
+            if (power > 0.0 && toLUFS(power) > LOUDNESS_ABSOLUTE_GATE)
+            {
+                sum += power;
+                ++count;
+            }
+        }
+
+        if (!count)
+        {
+            loudness = LOUDNESS_ABSOLUTE_GATE;
+            return true;
+        }
+
+        const double relativeGate = toLUFS(sum / double(count)) + LOUDNESS_RELATIVE_GATE;
+
+        sum = 0.0;
+        count = 0;
+        for (auto power : blocks)
+        {
+            if (power > 0.0)
+            {
+                const double l = toLUFS(power);
+                if (l > LOUDNESS_ABSOLUTE_GATE && l > relativeGate)
+                {
+                    sum += power;
+                    ++count;
+                }
+            }
+        }
+
+        loudness = (count > 0) ? float(toLUFS(sum / double(count))) : LOUDNESS_ABSOLUTE_GATE;
+        return true;
+    }
+
+    // Scales 8-bit or 16-bit PCM data in-place
+    void ApplyGain(uint8_t* audio, uint32_t audioBytes, WORD bitsPerSample, float gainDB) noexcept
+    {
+        const float scale = powf(10.f, gainDB / 20.f);
+
+        if (bitsPerSample == 16)
+        {
+            auto samples = reinterpret_cast<int16_t*>(audio);
+            const size_t count = audioBytes / sizeof(int16_t);
+            for (size_t j = 0; j < count; ++j)
+            {
+                const long v = lrintf(float(samples[j]) * scale);
+                samples[j] = static_cast<int16_t>(std::min(std::max(v, -32768L), 32767L));
+            }
+        }
+        else
+        {
+            for (size_t j = 0; j < audioBytes; ++j)
+            {
+                const long v = lrintf(float(int(audio[j]) - 128) * scale) + 128;
+                audio[j] = static_cast<uint8_t>(std::min(std::max(v, 0L), 255L));
+            }
+        }
+    }
 }
 
 
@@ -675,6 +976,9 @@ enum OPTIONS : uint32_t
     OPT_FRIENDLY_NAMES,
     OPT_NOLOGO,
     OPT_FILELIST,
+    OPT_LOSSLESS,
+    OPT_LOUDNESS,
+    OPT_NORMALIZE,
     OPT_MAX
 };
 
@@ -697,11 +1001,23 @@ struct WaveFile
     size_t conv;
     MINIWAVEFORMAT miniFmt;
     std::unique_ptr<uint8_t[]> waveData;
+    std::vector<uint8_t> lossless;
+    bool hasLoudness;
+    float loudness;     // LUFS
+    float truePeak;     // dBTP
+    float gain;         // dB
+
+    const uint8_t* StoredData() const noexcept { return lossless.empty() ? data.startAudio : lossless.data(); }
+    uint32_t StoredBytes() const noexcept { return lossless.empty() ? data.audioBytes : uint32_t(lossless.size()); }
 
     WaveFile() noexcept :
         data{},
         conv(0),
-        miniFmt{}
+        miniFmt{},
+        hasLoudness(false),
+        loudness(0.f),
+        truePeak(0.f),
+        gain(0.f)
     {}
 
     WaveFile(WaveFile&) = delete;
@@ -744,6 +1060,9 @@ const SValue g_pOptions[] =
     { L"f",         OPT_FRIENDLY_NAMES },
     { L"nologo",    OPT_NOLOGO },
     { L"flist",     OPT_FILELIST },
+    { L"lc",        OPT_LOSSLESS },
+    { L"la",        OPT_LOUDNESS },
+    { L"ln",        OPT_NORMALIZE },
     { nullptr,      0 }
 };
 
@@ -958,6 +1277,9 @@ namespace
         wprintf(L"   -f                  include entry friendly names\n");
         wprintf(L"   -nologo             suppress copyright message\n");
         wprintf(L"   -flist <filename>   use text file with a list of input files (one per line)\n");
+        wprintf(L"   -lc                 losslessly compress 16-bit PCM entries (in-memory only, not XACT compatible)\n");
+        wprintf(L"   -la                 analyze loudness and true peak of PCM entries\n");
+        wprintf(L"   -ln <LUFS>          normalize PCM entries to the given integrated loudness\n");
     }
 
     const wchar_t* GetErrorDesc(HRESULT hr)
@@ -1059,10 +1381,19 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
     // Parameters and defaults
     wchar_t szOutputFile[MAX_PATH] = {};
     wchar_t szHeaderFile[MAX_PATH] = {};
+    float targetLoudness = -23.f;
 
     // Set locale for output since GetErrorDesc can get localized strings.
     std::locale::global(std::locale(""));
 
+    // Numbers on the command line and in the C header always use '.', whatever the user's locale
+    ScopedLocale cLocale(_create_locale(LC_NUMERIC, "C"));
+    if (!cLocale)
+    {
+        wprintf(L"ERROR: Failed creating C locale\n");
+        return 1;
+    }
+
     // Process command line
     uint32_t dwOptions = 0;
     std::list<SConversion> conversion;
@@ -1097,6 +1428,7 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             case OPT_OUTPUTFILE:
             case OPT_OUTPUTHEADER:
             case OPT_FILELIST:
+            case OPT_NORMALIZE:
                 if (!*pValue)
                 {
                     if ((iArg + 1 >= argc))
@@ -1137,6 +1469,11 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                     wprintf(L"-c and -af are mutually exclusive options\n");
                     return 1;
                 }
+                if (dwOptions & (1 << OPT_LOSSLESS))
+                {
+                    wprintf(L"-c and -lc are mutually exclusive options\n");
+                    return 1;
+                }
                 if (dwOptions & (1 << OPT_NOCOMPACT))
                 {
                     wprintf(L"-c and -nc are mutually exclusive options\n");
@@ -1152,6 +1489,39 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                 }
                 break;
 
+            case OPT_NORMALIZE:
+                if (_swscanf_s_l(pValue, L"%f", cLocale.get(), &targetLoudness) != 1
+                    || targetLoudness > 0.f || targetLoudness < LOUDNESS_ABSOLUTE_GATE)
+                {
+                    wprintf(L"Invalid value specified with -ln (%ls), must be -70 to 0 LUFS\n", pValue);
+                    return 1;
+                }
+                break;
+
+            case OPT_STREAMING:
+                if (dwOptions & (1 << OPT_LOSSLESS))
+                {
+                    wprintf(L"-s and -lc are mutually exclusive options\n");
+                    return 1;
+                }
+                break;
+
+            case OPT_LOSSLESS:
+                // Compact entries derive their duration from the stored length
+                if (dwOptions & (1 << OPT_COMPACT))
+                {
+                    wprintf(L"-c and -lc are mutually exclusive options\n");
+                    return 1;
+                }
+                // Streaming entries are read straight from disk into voice buffers, so they must stay PCM
+                if (dwOptions & (1 << OPT_STREAMING))
+                {
+                    wprintf(L"-s and -lc are mutually exclusive options\n");
+                    return 1;
+                }
+                dwOptions |= (1 << OPT_NOCOMPACT);
+                break;
+
             case OPT_FILELIST:
             {
                 std::wifstream inFile(pValue);
@@ -1283,6 +1653,70 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
 
     wprintf(L"\n");
 
+    // Loudness analysis and normalization; -ln implies -la but may be given with it
+    const bool analyzeLoudness = (dwOptions & ((1 << OPT_LOUDNESS) | (1 << OPT_NORMALIZE))) != 0;
+    if (analyzeLoudness)
+    {
+        // Entries are independent, so they are analyzed concurrently
+        std::atomic<size_t> next(0);
+        auto worker = [&]()
+        {
+            for (size_t j = next++; j < waves.size(); j = next++)
+            {
+                auto& wave = waves[j];
+                wave.hasLoudness = AnalyzeLoudness(wave.data.wfx, wave.data.startAudio, wave.data.audioBytes, wave.loudness, wave.truePeak);
+            }
+        };
+
+        const size_t threadCount = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), waves.size());
+
+        std::vector<std::thread> threads;
+        for (size_t j = 1; j < threadCount; ++j)
+        {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for (auto& t : threads)
+        {
+            t.join();
+        }
+
+        for (auto& it : waves)
+        {
+            auto cit = conversion.cbegin();
+            advance(cit, it.conv);
+
+            if (!it.hasLoudness)
+            {
+                wprintf(L"WARNING: Loudness analysis only supports 8-bit or 16-bit PCM, skipping %ls\n", cit->szSrc);
+                continue;
+            }
+
+            if ((dwOptions & (1 << OPT_NORMALIZE)) && it.loudness > LOUDNESS_ABSOLUTE_GATE)
+            {
+                it.gain = targetLoudness - it.loudness;
+                if (it.truePeak + it.gain > LOUDNESS_PEAK_CEILING)
+                {
+                    it.gain = LOUDNESS_PEAK_CEILING - it.truePeak;
+                    wprintf(L"WARNING: Gain for %ls limited by true peak to %.2f dB\n", cit->szSrc, it.gain);
+                }
+
+                // startAudio points into the writable buffer owned by waveData
+                ApplyGain(const_cast<uint8_t*>(it.data.startAudio), it.data.audioBytes, it.data.wfx->wBitsPerSample, it.gain);
+
+                it.loudness += it.gain;
+                it.truePeak += it.gain;
+            }
+
+            wprintf(L"%ls: %.2f LUFS, %.2f dBTP", cit->szSrc, it.loudness, it.truePeak);
+            if (it.gain != 0.f)
+            {
+                wprintf(L" (gain %+.2f dB)", it.gain);
+            }
+            wprintf(L"\n");
+        }
+    }
+
     DWORD dwAlignment = ALIGNMENT_MIN;
     if (dwOptions & (1 << OPT_STREAMING))
     {
@@ -1294,6 +1728,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
     bool compact = (dwOptions & (1 << OPT_NOCOMPACT)) ? false : true;
     int reason = 0;
     uint64_t waveOffset = 0;
+    uint64_t pcmBytes = 0;
+    uint64_t losslessBytes = 0;
 
     for (auto it = waves.begin(); it != waves.end(); ++it)
     {
@@ -1305,6 +1741,38 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             return 1;
         }
 
+        if ((dwOptions & (1 << OPT_LOSSLESS))
+            && it->miniFmt.wFormatTag == MINIWAVEFORMAT::TAG_PCM
+            && it->miniFmt.wBitsPerSample == MINIWAVEFORMAT::BITDEPTH_16)
+        {
+            auto cit = conversion.cbegin();
+            advance(cit, it->conv);
+
+            const uint32_t channels = it->data.wfx->nChannels;
+            const uint32_t frames = it->data.audioBytes / it->data.wfx->nBlockAlign;
+            auto samples = reinterpret_cast<const int16_t*>(it->data.startAudio);
+
+            HRESULT hr = (frames > 0) ? DirectX::EncodeLosslessAudio(samples, frames, channels, it->lossless) : E_INVALIDARG;
+            if (FAILED(hr))
+            {
+                wprintf(L"ERROR: Failed compressing %ls (%08X%ls)\n", cit->szSrc, static_cast<unsigned int>(hr), GetErrorDesc(hr));
+                return 1;
+            }
+
+            // Verify the round-trip before committing to the compressed form
+            auto check = std::make_unique<int16_t[]>(size_t(frames) * channels);
+            hr = DirectX::DecodeLosslessAudio(it->lossless.data(), it->lossless.size(),
+                channels, it->data.wfx->wBitsPerSample, 0, frames, check.get());
+            if (FAILED(hr) || memcmp(check.get(), samples, size_t(frames) * channels * sizeof(int16_t)) != 0)
+            {
+                wprintf(L"ERROR: Lossless round-trip failed for %ls\n", cit->szSrc);
+                return 1;
+            }
+
+            pcmBytes += it->data.audioBytes;
+            losslessBytes += it->lossless.size();
+        }
+
         if (it == waves.begin())
         {
             memcpy(&compactFormat, &it->miniFmt, sizeof(MINIWAVEFORMAT));
@@ -1321,10 +1789,15 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             reason |= 0x2;
         }
 
-        DWORD alignedSize = BLOCKALIGNPAD(it->data.audioBytes, dwAlignment);
+        DWORD alignedSize = BLOCKALIGNPAD(it->StoredBytes(), dwAlignment);
         waveOffset += alignedSize;
     }
 
+    if (pcmBytes > 0)
+    {
+        wprintf(L"lossless: %llu -> %llu bytes (%.1f%%)\n", pcmBytes, losslessBytes, double(losslessBytes) * 100.0 / double(pcmBytes));
+    }
+
     if (waveOffset > UINT32_MAX)
     {
         wprintf(L"ERROR: Audio wave data is too large to encode into wavebank (offset %llu)", waveOffset);
@@ -1369,7 +1842,7 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
     size_t seekEntries = 0;
     for (auto it = waves.begin(); it != waves.end(); ++it, ++count)
     {
-        DWORD alignedSize = BLOCKALIGNPAD(it->data.audioBytes, dwAlignment);
+        DWORD alignedSize = BLOCKALIGNPAD(it->StoredBytes(), dwAlignment);
 
         auto wfx = it->data.wfx;
 
@@ -1412,7 +1885,7 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             entry->dwOffset = uint32_t(waveOffset / dwAlignment);
 
             assert(dwAlignment <= 2048);
-            entry->dwLengthDeviation = alignedSize - it->data.audioBytes;
+            entry->dwLengthDeviation = alignedSize - it->StoredBytes();
         }
         else
         {
@@ -1428,7 +1901,7 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             entry->Duration = uint32_t(duration);
             memcpy(&entry->Format, &it->miniFmt, sizeof(MINIWAVEFORMAT));
             entry->PlayRegion.dwOffset = uint32_t(waveOffset);
-            entry->PlayRegion.dwLength = it->data.audioBytes;
+            entry->PlayRegion.dwLength = it->StoredBytes();
 
             if (it->data.loopLength > 0)
             {
@@ -1500,6 +1973,11 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
         data.dwFlags |= BANKDATA::FLAGS_SEEKTABLES;
     }
 
+    if (losslessBytes > 0)
+    {
+        data.dwFlags |= BANKDATA::FLAGS_LOSSLESS;
+    }
+
     if (dwOptions & (1 << OPT_FRIENDLY_NAMES))
     {
         data.dwFlags |= BANKDATA::FLAGS_ENTRYNAMES;
@@ -1664,14 +2142,14 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             return 1;
         }
 
-        if (!WriteFile(hFile.get(), it.data.startAudio, it.data.audioBytes, &bytesWritten, nullptr)
-            || bytesWritten != it.data.audioBytes)
+        if (!WriteFile(hFile.get(), it.StoredData(), it.StoredBytes(), &bytesWritten, nullptr)
+            || bytesWritten != it.StoredBytes())
         {
             wprintf(L"ERROR: Failed writing audio data to %ls, %lu\n", szOutputFile, GetLastError());
             return 1;
         }
 
-        DWORD alignedSize = BLOCKALIGNPAD(it.data.audioBytes, dwAlignment);
+        DWORD alignedSize = BLOCKALIGNPAD(it.StoredBytes(), dwAlignment);
 
         if ((uint64_t(segmentOffset) + alignedSize) > UINT32_MAX)
         {
@@ -1742,6 +2220,29 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
 
             fprintf_s(file, "};\n\n#define XACT_WAVEBANK_%ls_ENTRY_COUNT %zu\n", wBankName, count);
 
+            if (analyzeLoudness)
+            {
+                fprintf_s(file, "\n// Integrated loudness (LUFS), true peak (dBTP), and normalization gain (dB) per entry\n");
+
+                for (auto it = waves.begin(); it != waves.end(); ++it)
+                {
+                    if (!it->hasLoudness)
+                        continue;
+
+                    auto cit = conversion.cbegin();
+                    advance(cit, it->conv);
+
+                    wchar_t wEntryName[_MAX_FNAME] = {};
+                    _wsplitpath_s(cit->szSrc, nullptr, 0, nullptr, 0, wEntryName, _MAX_FNAME, nullptr, 0);
+
+                    FileNameToIdentifier(wEntryName, _MAX_FNAME);
+
+                    _fprintf_s_l(file, "#define XACT_WAVEBANK_%ls_%ls_LOUDNESS (%.2ff)\n", cLocale.get(), wBankName, wEntryName, it->loudness);
+                    _fprintf_s_l(file, "#define XACT_WAVEBANK_%ls_%ls_TRUEPEAK (%.2ff)\n", cLocale.get(), wBankName, wEntryName, it->truePeak);
+                    _fprintf_s_l(file, "#define XACT_WAVEBANK_%ls_%ls_GAIN (%.2ff)\n", cLocale.get(), wBankName, wEntryName, it->gain);
+                }
+            }
+
             fclose(file);
         }
         else